@@ -33,6 +33,7 @@
 #include <boost/python/module.hpp>
 #include <boost/python/numeric.hpp>
 #include <boost/python/object.hpp>
+#include <boost/python/overloads.hpp>
 #include <cmath>
 
 /*! @brief Tell numpy to use the non deprecated API. */
@@ -161,6 +162,96 @@ static boost::python::dict python_linestr(LineCoolingData &lines,
   return result;
 }
 
+/**
+ * @brief Get the line cooling for the given temperatures and electron
+ * densities.
+ *
+ * @param lines LineCoolingData object that is wrapped by this function.
+ * @param T numpy.ndarray containing temperatures (in K).
+ * @param ne numpy.ndarray containing electron densities (in m^-3).
+ * @param abundances boost::python::list of abundances.
+ * @param exact Flag indicating whether we want to use the exact level
+ * population solver, even if a cooling table is available.
+ * @return numpy.ndarray containing the cooling for each temperature and
+ * electron density (in kg m^2s^-3).
+ */
+static boost::python::numeric::array
+get_cooling_array(LineCoolingData &lines, boost::python::numeric::array &T,
+                  boost::python::numeric::array &ne,
+                  boost::python::list abundances, bool exact) {
+  double abund[LINECOOLINGDATA_NUMCHANNELS];
+  for (unsigned int i = 0; i < LINECOOLINGDATA_NUMCHANNELS; ++i) {
+    abund[i] = boost::python::extract< double >(abundances[i]);
+  }
+
+  const unsigned int numT = boost::python::len(T);
+  const unsigned int numne = boost::python::len(ne);
+  if (numT != numne) {
+    cmac_error("Temperature and electron density arrays have different sizes "
+               "(len(T) = %u, len(ne) = %u)!",
+               numT, numne);
+  }
+
+  npy_intp size = numT;
+  PyObject *narr = PyArray_SimpleNew(1, &size, NPY_DOUBLE);
+  boost::python::handle<> handle(narr);
+  boost::python::numeric::array result(handle);
+
+  for (unsigned int iT = 0; iT < numT; ++iT) {
+    double Ti = boost::python::extract< double >(T[iT]);
+    double nei = boost::python::extract< double >(ne[iT]);
+    if (exact) {
+      result[iT] = lines.get_exact_cooling(Ti, nei, abund);
+    } else {
+      result[iT] = lines.get_cooling(Ti, nei, abund);
+    }
+  }
+
+  return result;
+}
+
+/**
+ * @brief Python version of LineCoolingData::get_cooling().
+ *
+ * Uses the cooling table if LineCoolingData.tabulate_cooling() was called.
+ *
+ * @param lines LineCoolingData object that is wrapped by this function.
+ * @param T numpy.ndarray containing temperatures (in K).
+ * @param ne numpy.ndarray containing electron densities (in m^-3).
+ * @param abundances boost::python::list of abundances.
+ * @return numpy.ndarray containing the cooling for each temperature and
+ * electron density (in kg m^2s^-3).
+ */
+static boost::python::numeric::array
+python_get_cooling(LineCoolingData &lines, boost::python::numeric::array &T,
+                   boost::python::numeric::array &ne,
+                   boost::python::list abundances) {
+  return get_cooling_array(lines, T, ne, abundances, false);
+}
+
+/**
+ * @brief Python version of LineCoolingData::get_exact_cooling().
+ *
+ * @param lines LineCoolingData object that is wrapped by this function.
+ * @param T numpy.ndarray containing temperatures (in K).
+ * @param ne numpy.ndarray containing electron densities (in m^-3).
+ * @param abundances boost::python::list of abundances.
+ * @return numpy.ndarray containing the cooling for each temperature and
+ * electron density (in kg m^2s^-3).
+ */
+static boost::python::numeric::array
+python_get_exact_cooling(LineCoolingData &lines,
+                         boost::python::numeric::array &T,
+                         boost::python::numeric::array &ne,
+                         boost::python::list abundances) {
+  return get_cooling_array(lines, T, ne, abundances, true);
+}
+
+/*! @brief Python overloads for LineCoolingData::tabulate_cooling(), so that
+ *  the default parameter values can be used from Python as well. */
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(tabulate_cooling_overloads,
+                                       LineCoolingData::tabulate_cooling, 0, 6)
+
 /**
  * @brief Python module exposure.
  */
@@ -172,6 +263,12 @@ BOOST_PYTHON_MODULE(liblinecoolingdata) {
   import_array();
 
   // we tell Boost we want to expose our version of LineCoolingData.linestr()
+  // and of the cooling functions
   boost::python::class_< LineCoolingData >("LineCoolingData")
-      .def("linestr", &python_linestr);
+      .def("linestr", &python_linestr)
+      .def("get_cooling", &python_get_cooling)
+      .def("get_exact_cooling", &python_get_exact_cooling)
+      .def("tabulate_cooling", &LineCoolingData::tabulate_cooling,
+           tabulate_cooling_overloads())
+      .def("is_tabulated", &LineCoolingData::is_tabulated);
 }
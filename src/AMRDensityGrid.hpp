@@ -32,10 +32,44 @@
 #include "DensityGrid.hpp"
 #include "ParameterFile.hpp"
 
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
 #include <ostream>
 #include <vector>
 
+/*! @brief Maximum depth of a lowest level cell within its top level block.
+ *  This is the depth that can be encoded in the 32-bit cell part of an AMRGrid
+ *  key. */
+#define AMRDENSITYGRID_MAXLEVEL 10
+
+/*! @brief Value of an AMRDensityGridCell face neighbour that signals a face on
+ *  a non-periodic box boundary. */
+#define AMRDENSITYGRID_NONGB 0xffffffffu
+
+/*! @brief Flag that is set in an AMRDensityGridCell face neighbour if the face
+ *  has multiple neighbours. The other bits contain the offset of the
+ *  neighbour list. */
+#define AMRDENSITYGRID_MULTIPLENGBS 0x80000000u
+
+/**
+ * @brief Geometry and face neighbours of a single lowest level cell of an
+ * AMRDensityGrid, packed together so that a photon traversal step only needs
+ * to read a single cell.
+ */
+struct AMRDensityGridCell {
+  /*! @brief Geometry of the cell (in m). */
+  Box<> _geometry;
+
+  /*! @brief Neighbours of the faces of the cell, in AMRNgbPosition order. This
+   *  is the index of the neighbouring cell if the neighbour is on the same or a
+   *  coarser level, AMRDENSITYGRID_NONGB if the face is on a non-periodic box
+   *  boundary, or AMRDENSITYGRID_MULTIPLENGBS plus the offset of the neighbour
+   *  list in the AMRDensityGrid if the neighbouring region is refined further.
+   *  */
+  unsigned int _ngbs[6];
+};
+
 /**
  * @brief AMR density grid.
  */
@@ -47,6 +81,21 @@ private:
   /*! @brief Convenient cell list used for faster cell indexing. */
   std::vector< AMRGridCell< unsigned long > * > _cells;
 
+  /*! @brief Number of top level blocks in each dimension. */
+  CoordinateVector< int > _nblock;
+
+  /*! @brief Geometry and face neighbours of all lowest level cells, stored
+   *  contiguously in the same order as the cell data. */
+  std::vector< AMRDensityGridCell > _linear_cells;
+
+  /*! @brief Neighbour lists of faces that border a more refined region. Every
+   *  list consists of the number of neighbours, followed by their indices. */
+  std::vector< unsigned int > _multiple_ngbs;
+
+  /*! @brief Morton keys of the first corner of all lowest level cells,
+   *  together with the index of the cell, sorted on key. */
+  std::vector< std::pair< unsigned long, unsigned long > > _cell_keys;
+
   /*! @brief AMRRefinementScheme used to refine cells. */
   AMRRefinementScheme *_refinement_scheme;
 
@@ -86,6 +135,228 @@ private:
     return number / get_largest_odd_factor(number);
   }
 
+  /**
+   * @brief Get the Morton key of the finest possible cell that contains the
+   * given position.
+   *
+   * The key consists of the index of the top level block (in the same order as
+   * the blocks in the AMRGrid), followed by 3 bits per level for the
+   * AMRDENSITYGRID_MAXLEVEL levels within the block. Positions outside the box
+   * are mapped onto the closest cell on the box boundary.
+   *
+   * @param position CoordinateVector<> specifying a position (in m).
+   * @return Morton key of the position.
+   */
+  inline unsigned long
+  get_morton_key(const CoordinateVector<> &position) const {
+    const long maxbits = 1l << AMRDENSITYGRID_MAXLEVEL;
+    unsigned long block = 0;
+    unsigned long bits[3];
+    for (unsigned char i = 0; i < 3; ++i) {
+      // position in units of the top level block size
+      const double x = _nblock[i] * (position[i] - _box.get_anchor()[i]) /
+                       _box.get_sides()[i];
+      const int iblock =
+          std::max(0, std::min(static_cast< int >(std::floor(x)),
+                               _nblock[i] - 1));
+      block = block * _nblock[i] + iblock;
+      const long ibits = std::floor((x - iblock) * maxbits);
+      bits[i] = std::max(0l, std::min(ibits, maxbits - 1));
+    }
+    unsigned long key = block;
+    for (int ilevel = AMRDENSITYGRID_MAXLEVEL - 1; ilevel >= 0; --ilevel) {
+      key = (key << 3) + (((bits[0] >> ilevel) & 1) << 2) +
+            (((bits[1] >> ilevel) & 1) << 1) + ((bits[2] >> ilevel) & 1);
+    }
+    return key;
+  }
+
+  /**
+   * @brief Add the indices of the lowest level cells within the given cell
+   * that border the face of a neighbouring cell at the given position to the
+   * given list.
+   *
+   * @param cell Neighbouring cell, at the same level as the cell that owns the
+   * face.
+   * @param position AMRNgbPosition of the neighbouring cell w.r.t. the cell
+   * that owns the face.
+   * @param ngbs List to add to.
+   */
+  inline static void
+  add_face_neighbours(const AMRGridCell< unsigned long > *cell,
+                      AMRNgbPosition position,
+                      std::vector< unsigned int > &ngbs) {
+    if (cell->is_single_cell()) {
+      ngbs.push_back(cell->value());
+    } else {
+      // only the children on the side facing the face border it: if the
+      // neighbour is on the low side, these are the children in the high half
+      // and vice versa
+      const unsigned char axis_bit = 4 >> (position / 2);
+      const bool high_half = (position % 2) == 0;
+      for (unsigned char ic = 0; ic < 8; ++ic) {
+        const AMRGridCell< unsigned long > *child =
+            cell->get_child(static_cast< AMRChildPosition >(ic));
+        if (child != nullptr && ((ic & axis_bit) != 0) == high_half) {
+          add_face_neighbours(child, position, ngbs);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Rebuild the linear cell tables that are used for point location and
+   * photon traversal from the AMRGrid.
+   *
+   * This needs to be done every time the AMRGrid structure changes, after the
+   * neighbour relations in the AMRGrid have been set.
+   */
+  inline void update_cell_tables() {
+    const unsigned long numcell = _cells.size();
+
+    _linear_cells.resize(numcell);
+    _cell_keys.resize(numcell);
+    for (unsigned long i = 0; i < numcell; ++i) {
+      _linear_cells[i]._geometry = _cells[i]->get_geometry();
+      // the key of the midpoint, with the bits of all levels deeper than the
+      // cell level set to zero, is the key of the first corner of the cell
+      const unsigned char shift =
+          3 * (AMRDENSITYGRID_MAXLEVEL - _cells[i]->get_level());
+      const unsigned long key =
+          (get_morton_key(_cells[i]->get_midpoint()) >> shift) << shift;
+      _cell_keys[i] = std::make_pair(key, i);
+    }
+    std::sort(_cell_keys.begin(), _cell_keys.end());
+
+    _multiple_ngbs.clear();
+    std::vector< unsigned int > ngbs;
+    for (unsigned long i = 0; i < numcell; ++i) {
+      for (unsigned char j = 0; j < 6; ++j) {
+        const AMRNgbPosition position = static_cast< AMRNgbPosition >(j);
+        const AMRGridCell< unsigned long > *ngb = _cells[i]->get_ngb(position);
+        ngbs.clear();
+        if (ngb != nullptr) {
+          add_face_neighbours(ngb, position, ngbs);
+        }
+        if (ngbs.size() == 0) {
+          _linear_cells[i]._ngbs[j] = AMRDENSITYGRID_NONGB;
+        } else if (ngbs.size() == 1) {
+          _linear_cells[i]._ngbs[j] = ngbs[0];
+        } else {
+          _linear_cells[i]._ngbs[j] =
+              AMRDENSITYGRID_MULTIPLENGBS + _multiple_ngbs.size();
+          _multiple_ngbs.push_back(ngbs.size());
+          _multiple_ngbs.insert(_multiple_ngbs.end(), ngbs.begin(), ngbs.end());
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Get the intersection point of a photon with one of the walls of the
+   * cell with the given index, and the index of the cell on the other side of
+   * that wall.
+   *
+   * This version only uses the linear cell tables.
+   *
+   * @param index Index of the cell that contains the photon.
+   * @param photon_origin Current position of the photon (in m).
+   * @param photon_direction Direction the photon is travelling in.
+   * @param ds Variable to store the distance covered from the photon position
+   * to the intersection point in (in m).
+   * @param next_wall Variable to store the intersection point in (in m).
+   * @param periodic_correction CoordinateVector used to store periodic
+   * correction terms that will be applied to the photon position if we jump to
+   * the neighbouring cell.
+   * @return Index of the neighbouring cell, or the number of cells if the
+   * photon leaves the box.
+   */
+  inline unsigned long
+  get_next_cell(unsigned long index, const CoordinateVector<> &photon_origin,
+                const CoordinateVector<> &photon_direction, double &ds,
+                CoordinateVector<> &next_wall,
+                CoordinateVector<> &periodic_correction) const {
+    const AMRDensityGridCell &linear_cell = _linear_cells[index];
+    const Box<> &cell = linear_cell._geometry;
+
+    // find out which cell wall the photon is going to hit next
+    // ties are resolved in favour of the lowest coordinate axis
+    unsigned char axis = 0;
+    unsigned char face = 0;
+    ds = DBL_MAX;
+    for (unsigned char i = 0; i < 3; ++i) {
+      double l;
+      unsigned char next_face;
+      if (photon_direction[i] > 0.) {
+        l = (cell.get_anchor()[i] + cell.get_sides()[i] - photon_origin[i]) /
+            photon_direction[i];
+        next_face = 2 * i + 1;
+      } else if (photon_direction[i] < 0.) {
+        l = (cell.get_anchor()[i] - photon_origin[i]) / photon_direction[i];
+        next_face = 2 * i;
+      } else {
+        continue;
+      }
+      if (l < ds) {
+        ds = l;
+        axis = i;
+        face = next_face;
+      }
+    }
+    // round off can put the photon just outside the cell
+    ds = std::max(ds, 0.);
+    next_wall = photon_origin + ds * photon_direction;
+
+    const unsigned int ngb = linear_cell._ngbs[face];
+    if (ngb == AMRDENSITYGRID_NONGB) {
+      return _cells.size();
+    }
+
+    unsigned long next_index = ngb;
+    if ((ngb & AMRDENSITYGRID_MULTIPLENGBS) != 0) {
+      // the face borders a more refined region: find the neighbour that
+      // contains the intersection point (or is closest to it, to allow for
+      // round off)
+      const unsigned int *ngbs =
+          &_multiple_ngbs[ngb & ~AMRDENSITYGRID_MULTIPLENGBS];
+      const unsigned char axis1 = (axis + 1) % 3;
+      const unsigned char axis2 = (axis + 2) % 3;
+      double min_distance = DBL_MAX;
+      for (unsigned int ingb = 1; ingb <= ngbs[0]; ++ingb) {
+        const Box<> &ngb_cell = _linear_cells[ngbs[ingb]]._geometry;
+        const double distance =
+            std::max(ngb_cell.get_anchor()[axis1] - next_wall[axis1], 0.) +
+            std::max(next_wall[axis1] - ngb_cell.get_anchor()[axis1] -
+                         ngb_cell.get_sides()[axis1],
+                     0.) +
+            std::max(ngb_cell.get_anchor()[axis2] - next_wall[axis2], 0.) +
+            std::max(next_wall[axis2] - ngb_cell.get_anchor()[axis2] -
+                         ngb_cell.get_sides()[axis2],
+                     0.);
+        if (distance < min_distance) {
+          min_distance = distance;
+          next_index = ngbs[ingb];
+          if (distance == 0.) {
+            break;
+          }
+        }
+      }
+    }
+
+    // calculate periodic boundary corrections (if any)
+    if (_periodic[axis]) {
+      const double ngb_anchor =
+          _linear_cells[next_index]._geometry.get_anchor()[axis];
+      if ((face % 2) == 1 && ngb_anchor < cell.get_anchor()[axis]) {
+        periodic_correction[axis] = -_box.get_sides()[axis];
+      } else if ((face % 2) == 0 && ngb_anchor > cell.get_anchor()[axis]) {
+        periodic_correction[axis] = _box.get_sides()[axis];
+      }
+    }
+
+    return next_index;
+  }
+
   /**
    * @brief Check if the cell with the given index should be refined, using the
    * given AMRRefinementScheme. Apply the refinement if necessary, using the
@@ -124,6 +395,7 @@ private:
       // we do not copy the mean intensity integrals from the old cell, as these
       // will be reset before the refined cells are used
       double old_neutral_fraction_H_old = _neutral_fraction_H_old[index];
+      double old_temperature_old = _temperature_old[index];
       // we will not copy the heating terms for the same reasons
       // nor the EmissivityValues
       // nor the Lock, since that has to be unique
@@ -137,8 +409,10 @@ private:
         if (ic == 0) {
           _mean_intensity_H_old[index] = 0.;
           _neutral_fraction_H_old[index] = old_neutral_fraction_H_old;
+          _temperature_old[index] = old_temperature_old;
           _emissivities[index] = nullptr;
           _cells[index] = childcell;
+          _linear_cells[index]._geometry = childcell->get_geometry();
           childcell->value() = index;
 
           const DensityValues funcvalue =
@@ -171,11 +445,16 @@ private:
           _ionization_variables.push_back(IonizationVariables());
           _mean_intensity_H_old.push_back(0.);
           _neutral_fraction_H_old.push_back(old_neutral_fraction_H_old);
+          _temperature_old.push_back(old_temperature_old);
           _emissivities.push_back(nullptr);
-#ifndef USE_LOCKFREE
+#if defined(USE_PRIVATE_ACCUMULATORS)
+          _accumulator.resize(_cells.size() + 1);
+#elif !defined(USE_LOCKFREE)
           _lock.push_back(Lock());
 #endif
           _cells.push_back(childcell);
+          _linear_cells.push_back(AMRDensityGridCell());
+          _linear_cells.back()._geometry = childcell->get_geometry();
           childcell->value() = _cells.size() - 1;
 
           const DensityValues funcvalue =
@@ -250,6 +529,7 @@ public:
     power_of_2 = std::min(power_of_2, power_of_2_z);
     CoordinateVector< int > nblock = ncell / power_of_2;
     _grid = AMRGrid< unsigned long >(box, nblock);
+    _nblock = nblock;
 
     // find out how many cells each block should have at the lowest level
     // this is just the power in power_of_2
@@ -271,6 +551,9 @@ public:
       ++index;
       key = _grid.get_next_key(key);
     }
+    // the neighbour relations are only set during initialization, so the
+    // neighbour lists are still empty at this point
+    update_cell_tables();
 
     allocate_memory(_grid.get_number_of_cells());
 
@@ -353,6 +636,7 @@ public:
 
     // finalize grid: set neighbour relations
     _grid.set_ngbs(_periodic);
+    update_cell_tables();
 
     // make sure all values are correctly initialized (also in refined cells)
     // the refinement procedure itself only reads the density from the density
@@ -388,6 +672,7 @@ public:
 
       // reset the ngbs
       _grid.set_ngbs(_periodic);
+      update_cell_tables();
     }
 
     // make sure all cells are correctly reset (also the new ones, if any)
@@ -411,7 +696,36 @@ public:
    * @return Index of the cell containing that position.
    */
   virtual unsigned long get_cell_index(CoordinateVector<> position) const {
-    return _grid.get_cell(position);
+    // the cell containing the position is the cell with the largest key that
+    // is smaller than or equal to the key of the position
+    const std::pair< unsigned long, unsigned long > key =
+        std::make_pair(get_morton_key(position), _cells.size());
+    return (std::upper_bound(_cell_keys.begin(), _cell_keys.end(), key) - 1)
+        ->second;
+  }
+
+  /**
+   * @brief Get the indices of the cells that border the given face of the cell
+   * with the given index.
+   *
+   * @param index Index of a cell.
+   * @param position AMRNgbPosition of the face.
+   * @return Indices of the neighbouring cells (empty if the face is on a
+   * non-periodic box boundary).
+   */
+  inline std::vector< unsigned long >
+  get_face_neighbours(unsigned long index, AMRNgbPosition position) const {
+    const unsigned int ngb = _linear_cells[index]._ngbs[position];
+    if (ngb == AMRDENSITYGRID_NONGB) {
+      return std::vector< unsigned long >();
+    } else if ((ngb & AMRDENSITYGRID_MULTIPLENGBS) == 0) {
+      return std::vector< unsigned long >(1, ngb);
+    } else {
+      const unsigned int offset = ngb & ~AMRDENSITYGRID_MULTIPLENGBS;
+      return std::vector< unsigned long >(
+          _multiple_ngbs.begin() + offset + 1,
+          _multiple_ngbs.begin() + offset + 1 + _multiple_ngbs[offset]);
+    }
   }
 
   /**
@@ -421,7 +735,8 @@ public:
    * @return Midpoint of that cell (in m).
    */
   virtual CoordinateVector<> get_cell_midpoint(unsigned long index) const {
-    return _cells[index]->get_midpoint();
+    const Box<> &cell = _linear_cells[index]._geometry;
+    return cell.get_anchor() + 0.5 * cell.get_sides();
   }
 
   /**
@@ -431,7 +746,9 @@ public:
    * @return Volume of that cell (in m^3).
    */
   virtual double get_cell_volume(unsigned long index) const {
-    return _cells[index]->get_volume();
+    const CoordinateVector<> &sides =
+        _linear_cells[index]._geometry.get_sides();
+    return sides.x() * sides.y() * sides.z();
   }
 
   /**
@@ -599,9 +916,12 @@ public:
           periodic_correction[2] = _box.get_sides().z();
         }
       }
-      // find the child cell containing the new position
+      // find the child cell containing the new position (after applying the
+      // periodic correction, since the neighbour is on the other side of the
+      // box in that case)
+      const CoordinateVector<> next_position = next_wall + periodic_correction;
       while (!next_cell->is_single_cell()) {
-        next_cell = next_cell->get_child(next_wall);
+        next_cell = next_cell->get_child(next_position);
       }
     }
     cell = next_cell;
@@ -613,6 +933,10 @@ public:
    * @brief Let the given Photon travel through the density grid until the given
    * optical depth is reached.
    *
+   * The photon traversal only uses the linear cell tables: the next cell is
+   * found from the neighbour list of the face through which the photon leaves
+   * the current cell.
+   *
    * @param photon Photon.
    * @param optical_depth Optical depth the photon should travel in total
    * (dimensionless).
@@ -621,10 +945,74 @@ public:
    */
   virtual DensityGrid::iterator interact(Photon &photon, double optical_depth) {
     CoordinateVector<> photon_origin = photon.get_position();
-    CoordinateVector<> photon_direction = photon.get_direction();
+    const CoordinateVector<> photon_direction = photon.get_direction();
 
+    const unsigned long numcell = _cells.size();
     unsigned long index = get_cell_index(photon_origin);
-    AMRGridCell< unsigned long > *current_cell = _cells[index];
+
+    // while the photon has not exceeded the optical depth and is still in the
+    // box
+    while (index < numcell && optical_depth > 0.) {
+      double ds;
+      CoordinateVector<> next_wall;
+      CoordinateVector<> periodic_correction;
+      const unsigned long next_index =
+          get_next_cell(index, photon_origin, photon_direction, ds, next_wall,
+                        periodic_correction);
+
+      DensityGrid::iterator it(index, *this);
+
+      double tau = get_optical_depth(ds, it, photon);
+      optical_depth -= tau;
+
+      // if the optical depth exceeded the wanted value: find out where in the
+      // cell we end up, and correct S
+      if (optical_depth < 0.) {
+        double Scorr = ds * optical_depth / tau;
+        ds += Scorr;
+        photon_origin += ds * photon_direction;
+      } else {
+        photon_origin = next_wall;
+        // apply periodic boundaries if necessary
+        photon_origin += periodic_correction;
+        index = next_index;
+      }
+
+      // ds is now the actual distance travelled in the cell
+      // update contributions to mean intensity integrals
+      update_integrals(ds, it, photon);
+    }
+
+    photon.set_position(photon_origin);
+
+    if (index < numcell) {
+      return DensityGrid::iterator(index, *this);
+    } else {
+      return end();
+    }
+  }
+
+  /**
+   * @brief Let the given Photon travel through the density grid until the given
+   * optical depth is reached, by walking the AMRGrid cell hierarchy.
+   *
+   * This is the original traversal algorithm, which follows the neighbour and
+   * child pointers of the AMRGridCells. It is kept as a reference for the
+   * linear cell table traversal in interact().
+   *
+   * @param photon Photon.
+   * @param optical_depth Optical depth the photon should travel in total
+   * (dimensionless).
+   * @return DensityGrid::iterator pointing to the cell the photon was last in,
+   * or DensityGrid::end() if the photon left the box.
+   */
+  inline DensityGrid::iterator interact_tree(Photon &photon,
+                                             double optical_depth) {
+    CoordinateVector<> photon_origin = photon.get_position();
+    CoordinateVector<> photon_direction = photon.get_direction();
+
+    AMRGridCell< unsigned long > *current_cell =
+        _cells[_grid.get_cell(photon_origin)];
 
     // while the photon has not exceeded the optical depth and is still in the
     // box
@@ -644,8 +1032,7 @@ public:
       DensityGrid::iterator it(old_cell->value(), *this);
       last_cell = it;
 
-      // Helium abundance. Should be a parameter.
-      double tau = get_optical_depth(ds, it.get_ionization_variables(), photon);
+      double tau = get_optical_depth(ds, it, photon);
       optical_depth -= tau;
 
       // if the optical depth exceeds or equals the wanted value: exit the loop
@@ -657,6 +1044,8 @@ public:
         // order is important here!
         photon_origin += (next_wall - photon_origin) * (ds + Scorr) / ds;
         ds += Scorr;
+        // the photon did not leave the cell
+        current_cell = old_cell;
       } else {
         photon_origin = next_wall;
         // apply periodic boundaries if necessary
@@ -691,19 +1080,17 @@ public:
                                     EmissionLine line) {
     double S = 0.;
 
+    const unsigned long numcell = _cells.size();
     unsigned long index = get_cell_index(origin);
-    AMRGridCell< unsigned long > *current_cell = _cells[index];
-
-    while (current_cell != nullptr) {
-      Box<> cell = current_cell->get_geometry();
 
-      double ds = 0.;
-      AMRGridCell< unsigned long > *old_cell = current_cell;
+    while (index < numcell) {
+      double ds;
+      CoordinateVector<> next_wall;
       CoordinateVector<> periodic_correction;
-      CoordinateVector<> next_wall = get_wall_intersection(
-          origin, direction, cell, current_cell, ds, periodic_correction);
+      const unsigned long next_index = get_next_cell(
+          index, origin, direction, ds, next_wall, periodic_correction);
 
-      DensityGrid::iterator it(old_cell->value(), *this);
+      DensityGrid::iterator it(index, *this);
 
       origin = next_wall;
 
@@ -712,6 +1099,8 @@ public:
       if (periodic_correction.norm2() > 0.) {
         break;
       }
+
+      index = next_index;
     }
 
     return S;
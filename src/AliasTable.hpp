@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file AliasTable.hpp
+ *
+ * @brief Walker alias table for constant time sampling of a discrete
+ * probability distribution.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef ALIASTABLE_HPP
+#define ALIASTABLE_HPP
+
+#include "Error.hpp"
+
+#include <vector>
+
+/**
+ * @brief Walker alias table for constant time sampling of a discrete
+ * probability distribution.
+ *
+ * The table is constructed using Vose's algorithm: every entry i of the table
+ * contains a probability p_i and an alias a_i. To sample, we pick a uniform
+ * random entry i and return i with probability p_i, and a_i otherwise. The
+ * construction is linear in the number of entries, while sampling takes
+ * constant time, independent of the number of entries.
+ *
+ * A single uniform random number is used for both the selection of the entry
+ * and the comparison with p_i, so that the table consumes the same number of
+ * random numbers as a linear search through a cumulative distribution.
+ */
+class AliasTable {
+private:
+  /*! @brief Probability of returning the entry itself rather than its
+   *  alias. */
+  std::vector< double > _probabilities;
+
+  /*! @brief Aliases for the entries. */
+  std::vector< unsigned int > _aliases;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param weights Weights of the entries (do not need to be normalized, but
+   * should be positive and have a non-zero sum).
+   */
+  inline AliasTable(
+      const std::vector< double > &weights = std::vector< double >())
+      : _probabilities(weights.size(), 1.), _aliases(weights.size()) {
+
+    const unsigned int size = weights.size();
+    if (size == 0) {
+      return;
+    }
+
+    double total_weight = 0.;
+    for (unsigned int i = 0; i < size; ++i) {
+      if (weights[i] < 0.) {
+        cmac_error("Negative weight in alias table (%g)!", weights[i]);
+      }
+      total_weight += weights[i];
+    }
+    if (total_weight <= 0.) {
+      cmac_error("Alias table weights have a zero sum!");
+    }
+
+    // scale the weights so that their average is 1, and split the entries
+    // into entries below (small) and above (large) the average
+    std::vector< double > scaled_weights(size);
+    std::vector< unsigned int > small, large;
+    small.reserve(size);
+    large.reserve(size);
+    for (unsigned int i = 0; i < size; ++i) {
+      _aliases[i] = i;
+      scaled_weights[i] = weights[i] * size / total_weight;
+      if (scaled_weights[i] < 1.) {
+        small.push_back(i);
+      } else {
+        large.push_back(i);
+      }
+    }
+
+    // fill up every small entry with part of a large entry
+    while (!small.empty() && !large.empty()) {
+      const unsigned int ismall = small.back();
+      small.pop_back();
+      const unsigned int ilarge = large.back();
+      _probabilities[ismall] = scaled_weights[ismall];
+      _aliases[ismall] = ilarge;
+      scaled_weights[ilarge] =
+          (scaled_weights[ilarge] + scaled_weights[ismall]) - 1.;
+      if (scaled_weights[ilarge] < 1.) {
+        large.pop_back();
+        small.push_back(ilarge);
+      }
+    }
+    // the remaining entries should have a scaled weight of exactly 1; any
+    // deviation is due to round off and is ignored (their probability was
+    // initialized to 1)
+  }
+
+  /**
+   * @brief Get the number of entries in the table.
+   *
+   * @return Number of entries.
+   */
+  inline unsigned int size() const { return _probabilities.size(); }
+
+  /**
+   * @brief Get a random entry from the table.
+   *
+   * @param x Uniform random number in the range [0, 1].
+   * @return Index of a random entry, distributed according to the weights.
+   */
+  inline unsigned int sample(double x) const {
+    cmac_assert(_probabilities.size() > 0);
+
+    const double u = x * _probabilities.size();
+    unsigned int i = u;
+    if (i >= _probabilities.size()) {
+      i = _probabilities.size() - 1;
+    }
+    if (u - i < _probabilities[i]) {
+      return i;
+    } else {
+      return _aliases[i];
+    }
+  }
+};
+
+#endif // ALIASTABLE_HPP
@@ -33,6 +33,7 @@
 #include "ConfigurationInfo.hpp"
 #include "ContinuousPhotonSourceFactory.hpp"
 #include "CoordinateVector.hpp"
+#include "CrossSectionsFactory.hpp"
 #include "DensityFunctionFactory.hpp"
 #include "DensityGridFactory.hpp"
 #include "DensityGridWriterFactory.hpp"
@@ -41,17 +42,22 @@
 #include "FileLog.hpp"
 #include "HydroIntegrator.hpp"
 #include "IonizationStateCalculator.hpp"
+#include "IterationConvergenceChecker.hpp"
 #include "LineCoolingData.hpp"
+#include "MPIBlockReduction.hpp"
 #include "MPICommunicator.hpp"
 #include "ParameterFile.hpp"
 #include "PhotonShootJobMarket.hpp"
 #include "PhotonSource.hpp"
 #include "PhotonSourceDistributionFactory.hpp"
 #include "PhotonSourceSpectrumFactory.hpp"
+#include "ReemissionProbabilityTable.hpp"
+#include "ReproducibleSum.hpp"
+#include "TabulatedChargeTransferRates.hpp"
+#include "TabulatedRecombinationRates.hpp"
 #include "TemperatureCalculator.hpp"
 #include "TerminalLog.hpp"
 #include "Timer.hpp"
-#include "VernerCrossSections.hpp"
 #include "VernerRecombinationRates.hpp"
 #include "WorkDistributor.hpp"
 #include "WorkEnvironment.hpp"
@@ -101,6 +107,10 @@ int main(int argc, char **argv) {
                     COMMANDLINEOPTION_NOARGUMENT, "false");
   parser.add_option("threads", 't', "Number of parallel threads to use.",
                     COMMANDLINEOPTION_INTARGUMENT, "1");
+  parser.add_option("pin-threads", 'a',
+                    "Pin every thread to a single CPU, so that threads do not "
+                    "migrate away from the memory they use during the run.",
+                    COMMANDLINEOPTION_NOARGUMENT, "false");
   parser.add_option("dry-run", 'n',
                     "Perform a dry run of the program: this reads the "
                     "parameter file and sets up all the components, but aborts "
@@ -208,6 +218,19 @@ int main(int argc, char **argv) {
 
   // set the maximum number of openmp threads
   WorkEnvironment::set_max_num_threads(parser.get_value< int >("threads"));
+  // pin the threads before the grid memory is allocated, so that the memory is
+  // first touched by the threads that will use it
+  if (parser.get_value< bool >("pin-threads")) {
+    const int num_pinned =
+        WorkEnvironment::pin_threads(parser.get_value< int >("threads"));
+    if (log) {
+      if (num_pinned > 0) {
+        log->write_status("Pinned ", num_pinned, " threads.");
+      } else {
+        log->write_warning("Thread pinning is not supported on this system!");
+      }
+    }
+  }
 
   // second: initialize the parameters that are read in from static files
   // these files should be configured by CMake and put in a location that is
@@ -223,8 +246,74 @@ int main(int argc, char **argv) {
   DensityFunction *density_function =
       DensityFunctionFactory::generate(params, log);
   DensityMask *density_mask = DensityMaskFactory::generate(params, log);
-  VernerCrossSections cross_sections;
-  VernerRecombinationRates recombination_rates;
+  CrossSections *cross_sections = CrossSectionsFactory::generate(params, log);
+  VernerRecombinationRates verner_recombination_rates;
+
+  // by default, all temperature dependent atomic rates are interpolated from
+  // tables that are computed once at startup
+  RecombinationRates *recombination_rates = &verner_recombination_rates;
+  ChargeTransferRates *charge_transfer_rates = nullptr;
+  TabulatedRecombinationRates *tabulated_recombination_rates = nullptr;
+  ReemissionProbabilityTable *reemission_probability_table = nullptr;
+  if (params.get_value< bool >("atomicrates:tabulate", true)) {
+    TemperatureTable temperature_table(
+        params.get_physical_value< QUANTITY_TEMPERATURE >(
+            "atomicrates:minimum_temperature", "1000. K"),
+        params.get_physical_value< QUANTITY_TEMPERATURE >(
+            "atomicrates:maximum_temperature", "1.e6 K"),
+        params.get_value< unsigned int >("atomicrates:points_per_decade",
+                                         100));
+    tabulated_recombination_rates = new TabulatedRecombinationRates(
+        verner_recombination_rates, temperature_table);
+    recombination_rates = tabulated_recombination_rates;
+    charge_transfer_rates = new TabulatedChargeTransferRates(temperature_table);
+    reemission_probability_table =
+        new ReemissionProbabilityTable(temperature_table);
+    if (log) {
+      log->write_status("Tabulated atomic rates in the temperature range [",
+                        temperature_table.get_minimum_temperature(), " K, ",
+                        temperature_table.get_maximum_temperature(), " K] (",
+                        temperature_table.get_number_of_points(),
+                        " temperature values).");
+    }
+  } else {
+    charge_transfer_rates = new ChargeTransferRates();
+  }
+
+  // the line cooling can be interpolated on a temperature-electron density
+  // grid (linecooling:tabulate: true). This is faster, but introduces relative
+  // errors of up to 5e-4 in the cooling for the default number of points per
+  // decade (values outside the table range are still computed exactly).
+  // By default (false), the line cooling is computed exactly, so that results
+  // only change when the table is explicitly requested
+  if (params.get_value< bool >("linecooling:tabulate", false)) {
+    const double minimum_temperature =
+        params.get_physical_value< QUANTITY_TEMPERATURE >(
+            "linecooling:minimum_temperature", "1000. K");
+    const double maximum_temperature =
+        params.get_physical_value< QUANTITY_TEMPERATURE >(
+            "linecooling:maximum_temperature", "1.e6 K");
+    const double minimum_electron_density =
+        params.get_physical_value< QUANTITY_NUMBER_DENSITY >(
+            "linecooling:minimum_electron_density", "100. m^-3");
+    const double maximum_electron_density =
+        params.get_physical_value< QUANTITY_NUMBER_DENSITY >(
+            "linecooling:maximum_electron_density", "1.e14 m^-3");
+    line_cooling_data.tabulate_cooling(
+        minimum_temperature, maximum_temperature, minimum_electron_density,
+        maximum_electron_density,
+        params.get_value< unsigned int >(
+            "linecooling:temperature_points_per_decade", 100),
+        params.get_value< unsigned int >(
+            "linecooling:electron_density_points_per_decade", 20));
+    if (log) {
+      log->write_status("Tabulated line cooling in the temperature range [",
+                        minimum_temperature, " K, ", maximum_temperature,
+                        " K] and electron density range [",
+                        minimum_electron_density, " m^-3, ",
+                        maximum_electron_density, " m^-3].");
+    }
+  }
 
   HydroIntegrator *hydro_integrator = nullptr;
   double hydro_timestep = 0.;
@@ -247,6 +336,7 @@ int main(int argc, char **argv) {
 
   DensityGrid *grid =
       DensityGridFactory::generate(params, *density_function, log);
+  grid->set_reemission_probability_table(reemission_probability_table);
 
   // fifth: construct the stellar sources. These should be stored in a
   // separate StellarSources object with geometrical and physical properties.
@@ -283,7 +373,7 @@ int main(int argc, char **argv) {
   Abundances abundances(params, log);
 
   PhotonSource source(sourcedistribution, spectrum, continuoussource,
-                      continuousspectrum, abundances, cross_sections, log);
+                      continuousspectrum, abundances, *cross_sections, log);
 
   // set up output
   DensityGridWriter *writer =
@@ -296,13 +386,37 @@ int main(int argc, char **argv) {
       params.get_value< unsigned int >("number of photons", 100);
   unsigned int numphoton1 =
       params.get_value< unsigned int >("number of photons init", numphoton);
+
+  // optionally stop iterating once the ionization state and temperature have
+  // converged (this also increases the number of photons if required)
+  // the default Passive checker always does the maximum number of iterations
+  IterationConvergenceChecker *convergence_checker = nullptr;
+  const std::string convergence_checker_type = params.get_value< std::string >(
+      "iterationconvergencechecker:type", "Passive");
+  if (convergence_checker_type == "Adaptive") {
+    convergence_checker =
+        new IterationConvergenceChecker(params, numphoton, log);
+  } else if (convergence_checker_type != "Passive") {
+    cmac_error("Unknown IterationConvergenceChecker type: %s!",
+               convergence_checker_type.c_str());
+  }
   double Q = source.get_total_luminosity();
 
-  ChargeTransferRates charge_transfer_rates;
+  // cells whose hydrogen mean intensity changed by less than this relative
+  // amount since their state was last computed keep their old state (0 means
+  // all cells are recomputed every iteration)
+  const double dirty_cell_threshold =
+      params.get_value< double >("dirtycells:threshold", 0.);
+  if (log && dirty_cell_threshold > 0.) {
+    log->write_status("Only recomputing cells whose hydrogen mean intensity "
+                      "changed by more than ",
+                      100. * dirty_cell_threshold, "%.");
+  }
 
   // used to calculate the ionization state at fixed temperature
   IonizationStateCalculator ionization_state_calculator(
-      Q, abundances, recombination_rates, charge_transfer_rates);
+      Q, abundances, *recombination_rates, *charge_transfer_rates,
+      dirty_cell_threshold);
 
   bool calculate_temperature =
       params.get_value< bool >("calculate_temperature", true);
@@ -315,7 +429,8 @@ int main(int argc, char **argv) {
         params.get_value< double >("crfac", 0.),
         params.get_value< double >("crlim", 0.75),
         params.get_physical_value< QUANTITY_LENGTH >("crscale", "1.33333 kpc"),
-        line_cooling_data, recombination_rates, charge_transfer_rates, log);
+        line_cooling_data, *recombination_rates, *charge_transfer_rates,
+        dirty_cell_threshold, log);
   }
 
   // we are done reading the parameter file
@@ -344,26 +459,42 @@ int main(int argc, char **argv) {
   std::pair< unsigned long, unsigned long > block =
       comm.distribute_block(0, grid->get_number_of_cells());
   grid->initialize(block);
+  grid->set_source_positions(source.get_discrete_positions());
 
-  // grid->initialize initialized:
+  // grid->initialize only initialized the local block of cells:
   // - densities
   // - temperatures
   // - ionic fractions
-  // we have to gather these across all processes
-
-  // this is currently BROKEN...
-  //  comm.gather(grid->get_number_density_handle());
-  //  comm.gather(grid->get_temperature_handle());
-  //  for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
-  //    IonName ion = static_cast< IonName >(i);
-  //    comm.gather(grid->get_ionic_fraction_handle(ion));
-  //  }
+  // - fluid velocities (if hydro is active)
+  // we have to gather these across all processes, since photons can travel
+  // through all cells
+  comm.gather< IONIZATIONVARIABLES_NUMFULLSTATEVALUE >(
+      grid->get_ionization_variables_handle().begin(),
+      grid->get_ionization_variables_handle().end(),
+      &IonizationVariables::get_full_state,
+      &IonizationVariables::set_full_state);
+  if (hydro_integrator != nullptr) {
+    comm.gather< 5 >(grid->get_hydro_variables_handle().begin(),
+                     grid->get_hydro_variables_handle().end(),
+                     &HydroVariables::get_primitives,
+                     &HydroVariables::set_primitives);
+  }
 
   // object used to distribute jobs in a shared memory parallel context
   WorkDistributor< PhotonShootJobMarket, PhotonShootJob > workdistributor(
       parser.get_value< int >("threads"));
   const int worksize = workdistributor.get_worksize();
+  grid->set_number_of_threads(worksize);
   Timer worktimer;
+  // time spent in blocking MPI communication during a single iteration
+  Timer mpitimer;
+
+  // non-blocking reduction of the mean intensity integrals and heating terms
+  // we split the block of every process in a number of chunks, so that the
+  // ionization state of a chunk can be computed while the reductions of other
+  // chunks are still in flight
+  MPIBlockReduction< IONIZATIONVARIABLES_NUMRADIATIONFIELDVALUE >
+      radiation_field_reduction(comm, grid->get_number_of_cells(), 8);
 
   if (density_mask != nullptr) {
     log->write_status("Initializing DensityMask...");
@@ -373,8 +504,12 @@ int main(int argc, char **argv) {
     log->write_status("Done applying mask.");
   }
 
+#ifndef USE_COUNTER_BASED_RANDOM
   // make sure every thread on every process has another random seed
+  // (the counter-based generator uses a separate stream for every photon
+  // instead)
   random_seed += comm.get_rank() * worksize;
+#endif
 
   if (log) {
     log->write_status("Program will use ",
@@ -393,6 +528,8 @@ int main(int argc, char **argv) {
     writer->write(0, params);
   }
 
+  // global index of the first photon of the next loop
+  unsigned long photon_index = 0;
   for (unsigned int istep = 0; istep < numstep; ++istep) {
     if (log) {
       log->write_status("Starting hydro step ", istep, ".");
@@ -401,16 +538,16 @@ int main(int argc, char **argv) {
     // finally: the actual program loop whereby the density grid is ray traced
     // using photon packets generated by the stellar sources
     unsigned int loop = 0;
-    while (loop < nloop) {
+    bool converged = false;
+    if (convergence_checker != nullptr) {
+      convergence_checker->reset();
+    }
+    while (loop < nloop && !converged) {
 
       if (log) {
         log->write_status("Starting loop ", loop, ".");
       }
 
-      //    if (loop == 3 || loop == 9) {
-      //      numphoton *= 10;
-      //    }
-
       unsigned int lnumphoton = numphoton;
 
       if (loop == 0) {
@@ -435,16 +572,47 @@ int main(int argc, char **argv) {
       local_numphoton = comm.distribute(local_numphoton);
 
       photonshootjobs.set_numphoton(local_numphoton);
+      photonshootjobs.set_photon_index(photon_index +
+                                       comm.distribute_offset(lnumphoton));
+      photon_index += lnumphoton;
       worktimer.start();
       workdistributor.do_in_parallel(photonshootjobs);
+#ifdef USE_REPRODUCIBLE_RESULTS
+      // sum the order independent accumulators across all processes before
+      // they are added to the cells, so that the result does not depend on the
+      // number of processes
+      mpitimer.start();
+      comm.reduce(grid->get_accumulated_radiation_field_handle(),
+                  grid->get_accumulated_radiation_field_size());
+      mpitimer.stop();
+#endif
+      // add the contributions that were accumulated in thread private buffers
+      // (if applicable)
+      grid->reduce_accumulators(worksize);
+#ifndef USE_REPRODUCIBLE_RESULTS
+      // start reducing the mean intensity integrals and heating terms across
+      // all processes; we only wait for the result right before we need it
+      radiation_field_reduction.start(
+          grid->get_ionization_variables_handle().begin(),
+          &IonizationVariables::get_radiation_field);
+#endif
       worktimer.stop();
 
-      photonshootjobs.update_counters(totweight, typecount);
+      // the counters are summed in an order independent way, so that they do
+      // not depend on the number of threads and processes
+      // the last element holds the total weight
+      ReproducibleSum counters[PHOTONTYPE_NUMBER + 1];
+      photonshootjobs.update_counters(counters[PHOTONTYPE_NUMBER], counters);
 
       // make sure the total weight and typecount is reduced across all
       // processes
-      comm.reduce< MPI_SUM_OF_ALL_PROCESSES >(totweight);
-      comm.reduce< MPI_SUM_OF_ALL_PROCESSES, PHOTONTYPE_NUMBER >(typecount);
+      mpitimer.start();
+      comm.reduce(counters, PHOTONTYPE_NUMBER + 1);
+      mpitimer.stop();
+      totweight = counters[PHOTONTYPE_NUMBER].get_value();
+      for (int i = 0; i < PHOTONTYPE_NUMBER; ++i) {
+        typecount[i] = counters[i].get_value();
+      }
 
       if (log) {
         log->write_status("Done shooting photons.");
@@ -478,46 +646,84 @@ int main(int argc, char **argv) {
                           lnumphoton, " photons...");
       }
 
-      // reduce the mean intensity integrals and heating terms across all
-      // processes
+      if (convergence_checker != nullptr) {
+        convergence_checker->store_old_values(*grid, block);
+      }
 
-      // this code is currently BROKEN...
-      //      for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
-      //        IonName ion = static_cast< IonName >(i);
-      //        comm.reduce< MPI_SUM_OF_ALL_PROCESSES >(
-      //            grid->get_mean_intensity_handle(ion));
-      //      }
-      //      if (calculate_temperature && loop > 3) {
-      //        comm.reduce< MPI_SUM_OF_ALL_PROCESSES
-      //        >(grid->get_heating_H_handle());
-      //        comm.reduce< MPI_SUM_OF_ALL_PROCESSES
-      //        >(grid->get_heating_He_handle());
-      //      }
-
-      if (calculate_temperature && loop > 3) {
-        temperature_calculator->calculate_temperature(totweight, *grid, block);
-      } else {
-        ionization_state_calculator.calculate_ionization_state(totweight, *grid,
-                                                               block);
+      // all cells need to be recomputed at the start of a hydro step (the
+      // densities changed) and when we switch on the temperature calculation
+      if (loop == 0 || (calculate_temperature && loop == 4)) {
+        grid->mark_all_cells_dirty();
+      }
+
+      // process the chunks of the local block in the order in which their
+      // radiation field reductions complete
+      unsigned long number_of_updated_cells = 0;
+      std::pair< unsigned long, unsigned long > chunk;
+      while (radiation_field_reduction.get_next_chunk(
+          grid->get_ionization_variables_handle().begin(),
+          &IonizationVariables::set_radiation_field, chunk)) {
+        if (calculate_temperature && loop > 3) {
+          number_of_updated_cells +=
+              temperature_calculator->calculate_temperature(totweight, *grid,
+                                                            chunk);
+        } else {
+          number_of_updated_cells +=
+              ionization_state_calculator.calculate_ionization_state(
+                  totweight, *grid, chunk);
+        }
+      }
+      radiation_field_reduction.finish();
+
+      mpitimer.start();
+      comm.reduce< MPI_SUM_OF_ALL_PROCESSES >(number_of_updated_cells);
+      mpitimer.stop();
+      if (log) {
+        log->write_status("Updated ", number_of_updated_cells, " of ",
+                          grid->get_number_of_cells(), " cells.");
       }
 
       // the calculation above will have changed the ionic fractions, and might
       // have changed the temperatures
       // we have to gather these across all processes
-
-      // this is currently BROKEN...
-      //      for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
-      //        IonName ion = static_cast< IonName >(i);
-      //        comm.gather(grid->get_ionic_fraction_handle(ion));
-      //      }
-      //      if (calculate_temperature && loop > 3) {
-      //        comm.gather(grid->get_temperature_handle());
-      //      }
+      mpitimer.start();
+      comm.gather< IONIZATIONVARIABLES_NUMSTATEVALUE >(
+          grid->get_ionization_variables_handle().begin(),
+          grid->get_ionization_variables_handle().end(),
+          &IonizationVariables::get_state, &IonizationVariables::set_state);
+      mpitimer.stop();
 
       if (log) {
         log->write_status("Done calculating ionization state.");
       }
 
+      // check if the iterations have converged. If the temperature is
+      // computed, we only start checking once the temperature calculation is
+      // active, since switching it on causes a large change.
+      if (convergence_checker != nullptr &&
+          (!calculate_temperature || loop > 3)) {
+        ReproducibleSum changes[ITERATIONCONVERGENCECHECKER_NUMSUM];
+        convergence_checker->compute_changes(*grid, block, changes);
+        mpitimer.start();
+        comm.reduce(changes, ITERATIONCONVERGENCECHECKER_NUMSUM);
+        mpitimer.stop();
+        converged = convergence_checker->is_converged(changes, numphoton);
+      }
+
+      if (comm.get_size() > 1) {
+        // report the time the slowest process spent waiting for other
+        // processes during this iteration
+        double mpi_time =
+            mpitimer.value() + radiation_field_reduction.get_blocked_time();
+        comm.reduce< MPI_MAX_OF_ALL_PROCESSES >(mpi_time);
+        if (log) {
+          log->write_status("Time spent waiting for MPI communication: ",
+                            mpi_time, " s.");
+        }
+        mpitimer.reset();
+        radiation_field_reduction.reset_blocked_time();
+      }
+
       // calculate emissivities
       // we disabled this, since we now have the post-processing Python library
       // for this
@@ -527,12 +733,17 @@ int main(int argc, char **argv) {
 
       ++loop;
 
-      if (write_output && every_iteration_output && loop < nloop) {
+      if (write_output && every_iteration_output && loop < nloop &&
+          !converged) {
         writer->write(loop, params);
       }
     }
 
-    if (log && loop == nloop) {
+    if (log && converged) {
+      log->write_status("Converged after ", loop, " iterations, stopping.");
+    }
+
+    if (log && !converged && loop == nloop) {
       log->write_status("Maximum number of iterations (", nloop,
                         ") reached, stopping.");
     }
@@ -540,6 +751,15 @@ int main(int argc, char **argv) {
     if (hydro_integrator != nullptr) {
       hydro_integrator->do_hydro_step(*grid, hydro_timestep);
 
+      // every process evolves the entire grid, but we make sure all processes
+      // continue from the densities and temperatures of the process that owns
+      // each cell, so that differences between processes cannot build up
+      comm.gather< IONIZATIONVARIABLES_NUMFULLSTATEVALUE >(
+          grid->get_ionization_variables_handle().begin(),
+          grid->get_ionization_variables_handle().end(),
+          &IonizationVariables::get_full_state,
+          &IonizationVariables::set_full_state);
+
       // write snapshot
       if (write_output &&
           hydro_lastsnap * hydro_snaptime < (istep + 1) * hydro_timestep) {
@@ -583,8 +803,13 @@ int main(int argc, char **argv) {
     delete hydro_integrator;
   }
   delete temperature_calculator;
+  delete convergence_checker;
   delete continuousspectrum;
   delete spectrum;
+  delete cross_sections;
+  delete charge_transfer_rates;
+  delete tabulated_recombination_rates;
+  delete reemission_probability_table;
 
   // we cannot delete the log, since it is still used in the destructor of
   // objects that are destructed at the return of the main program
@@ -32,6 +32,8 @@
 #include "Photon.hpp"
 #include "RecombinationRates.hpp"
 #include "Timer.hpp"
+#include <algorithm>
+#include <limits>
 #include <sstream>
 using namespace std;
 
@@ -401,6 +403,14 @@ CoordinateVector<> CartesianDensityGrid::get_wall_intersection(
  * @brief Let the given Photon travel through the density grid until the given
  * optical depth is reached.
  *
+ * This uses a 3D digital differential analyzer (Amanatides & Woo, 1987): for
+ * every coordinate axis, we precompute the distance along the photon path to
+ * the next cell wall perpendicular to that axis, and the distance between two
+ * such walls. Moving to the next cell then only requires finding the smallest
+ * of three distances and updating the values for the corresponding axis. The
+ * path lengths are the same as those obtained with
+ * interact_wall_intersection() (up to round off).
+ *
  * @param photon Photon.
  * @param optical_depth Optical depth the photon should travel in total
  * (dimensionless).
@@ -409,6 +419,135 @@ CoordinateVector<> CartesianDensityGrid::get_wall_intersection(
  */
 DensityGrid::iterator CartesianDensityGrid::interact(Photon &photon,
                                                      double optical_depth) {
+
+  CoordinateVector<> photon_origin = photon.get_position();
+  const CoordinateVector<> photon_direction = photon.get_direction();
+
+  // find out in which cell the photon is currently hiding
+  CoordinateVector< int > index = get_cell_indices(photon_origin);
+  bool inside = is_inside(index, photon_origin);
+
+  // set up the traversal variables for every axis:
+  //  - step: change in the cell index when crossing a wall
+  //  - tmax: distance along the path from photon_origin to the next wall
+  //  - tdelta: distance along the path between two walls
+  const long stride[3] = {_ncell.y() * _ncell.z(), _ncell.z(), 1};
+  int step[3];
+  double tmax[3];
+  double tdelta[3];
+  for (unsigned char i = 0; i < 3; ++i) {
+    const double cell_min = _box.get_anchor()[i] + _cellside[i] * index[i];
+    if (photon_direction[i] > 0.) {
+      const double inverse_direction = 1. / photon_direction[i];
+      step[i] = 1;
+      tmax[i] =
+          (cell_min + _cellside[i] - photon_origin[i]) * inverse_direction;
+      tdelta[i] = _cellside[i] * inverse_direction;
+    } else if (photon_direction[i] < 0.) {
+      const double inverse_direction = 1. / photon_direction[i];
+      step[i] = -1;
+      tmax[i] = (cell_min - photon_origin[i]) * inverse_direction;
+      tdelta[i] = -_cellside[i] * inverse_direction;
+    } else {
+      // we never reach a wall perpendicular to this axis
+      step[i] = 0;
+      tmax[i] = std::numeric_limits< double >::max();
+      tdelta[i] = 0.;
+    }
+  }
+
+  long long_index = get_long_index(index);
+  // distance travelled along the path (in m)
+  double t = 0.;
+  unsigned int ncell = 0;
+  DensityGrid::iterator last_cell = end();
+  while (inside && optical_depth > 0.) {
+    ++ncell;
+
+    // find the closest wall
+    unsigned char axis;
+    if (tmax[0] < tmax[1]) {
+      axis = (tmax[0] < tmax[2]) ? 0 : 2;
+    } else {
+      axis = (tmax[1] < tmax[2]) ? 1 : 2;
+    }
+    // due to round off, the photon might lie slightly beyond the wall (see
+    // get_wall_intersection())
+    double ds = std::max(0., tmax[axis] - t);
+
+    DensityGrid::iterator it(long_index, *this);
+    last_cell = it;
+
+    const double tau = get_optical_depth(ds, it, photon);
+    optical_depth -= tau;
+
+    if (optical_depth < 0.) {
+      // the photon is absorbed inside this cell: correct the path length
+      ds += ds * optical_depth / tau;
+    } else {
+      // move to the next cell, applying periodic boundaries if necessary
+      index[axis] += step[axis];
+      long_index += step[axis] * stride[axis];
+      tmax[axis] += tdelta[axis];
+      if (index[axis] < 0 || index[axis] >= _ncell[axis]) {
+        if (_periodic[axis]) {
+          // moving the origin of the path keeps the distances along the path
+          // consistent with the new cell indices
+          if (index[axis] < 0) {
+            index[axis] += _ncell[axis];
+            long_index += _ncell[axis] * stride[axis];
+            photon_origin[axis] += _box.get_sides()[axis];
+          } else {
+            index[axis] -= _ncell[axis];
+            long_index -= _ncell[axis] * stride[axis];
+            photon_origin[axis] -= _box.get_sides()[axis];
+          }
+        } else {
+          inside = false;
+        }
+      }
+    }
+
+    t += ds;
+
+    // update contributions to mean intensity integrals
+    update_integrals(ds, it, photon);
+  }
+
+  if (ncell == 0 && optical_depth > 0.) {
+    cmac_error("Photon leaves the system immediately (position: %g %g %g, "
+               "direction: %g %g %g)!",
+               photon_origin.x(), photon_origin.y(), photon_origin.z(),
+               photon_direction.x(), photon_direction.y(),
+               photon_direction.z());
+  }
+
+  photon.set_position(photon_origin + t * photon_direction);
+
+  if (!inside) {
+    last_cell = end();
+  }
+
+  return last_cell;
+}
+
+/**
+ * @brief Let the given Photon travel through the density grid until the given
+ * optical depth is reached, by explicitly computing the intersection point with
+ * the walls of every cell.
+ *
+ * This is the original traversal algorithm, which we keep as a reference for
+ * interact().
+ *
+ * @param photon Photon.
+ * @param optical_depth Optical depth the photon should travel in total
+ * (dimensionless).
+ * @return DensityGrid::iterator pointing to the cell the photon was last in,
+ * or DensityGrid::end() if the photon left the box.
+ */
+DensityGrid::iterator
+CartesianDensityGrid::interact_wall_intersection(Photon &photon,
+                                                 double optical_depth) {
   double S = 0.;
 
   CoordinateVector<> photon_origin = photon.get_position();
@@ -435,7 +574,7 @@ DensityGrid::iterator CartesianDensityGrid::interact(Photon &photon,
     last_cell = it;
 
     // Helium abundance. Should be a parameter.
-    double tau = get_optical_depth(ds, it.get_ionization_variables(), photon);
+    double tau = get_optical_depth(ds, it, photon);
     optical_depth -= tau;
 
     // if the optical depth exceeds or equals the wanted value: exit the loop
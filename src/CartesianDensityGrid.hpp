@@ -193,6 +193,9 @@ public:
 
   virtual DensityGrid::iterator interact(Photon &photon, double optical_depth);
 
+  DensityGrid::iterator interact_wall_intersection(Photon &photon,
+                                                   double optical_depth);
+
   virtual double get_total_emission(CoordinateVector<> origin,
                                     CoordinateVector<> direction,
                                     EmissionLine line);
@@ -135,3 +135,60 @@ double ChargeTransferRates::get_charge_transfer_ionization_rate(
               std::exp(_CTIon[3][ipIon - 1][atom - 1] * tused)) *
          std::exp(-_CTIon[6][ipIon - 1][atom - 1] / tused);
 }
+
+/**
+ * @brief Get the charge transfer recombination rate with neutral helium.
+ *
+ * These fits come from Kenny's code. Only the ions that are used in the
+ * ionization balance have a non zero rate.
+ *
+ * @param stage Stage of ionization.
+ * @param atom Atomic number.
+ * @param temperature Temperature (in K).
+ * @return Charge transfer recombination rate with neutral helium
+ * (in m^3s^-1).
+ */
+double ChargeTransferRates::get_charge_transfer_recombination_rate_He(
+    unsigned char stage, unsigned char atom, double temperature) const {
+
+  const double T4 = temperature * 1.e-4;
+  // in Kenny's code, the rates are in cm^3s^-1
+  // to put them in m^3s^-1, we multiplied Kenny's original factor 1.e-9 with
+  // 1.e-6
+  switch (atom) {
+  case 6:
+    if (stage == 4) {
+      return 1.e-15 * 0.046 * T4 * T4;
+    }
+    break;
+  case 7:
+    if (stage == 3) {
+      return 1.e-15 * 0.33 * std::pow(T4, 0.29) *
+             (1. + 1.3 * std::exp(-4.5 / T4));
+    }
+    if (stage == 4) {
+      return 1.e-15 * 0.15;
+    }
+    break;
+  case 8:
+    if (stage == 3) {
+      return 0.2e-15 * std::pow(T4, 0.95);
+    }
+    break;
+  case 10:
+    if (stage == 3) {
+      return 1.e-15 * 1.e-5;
+    }
+    break;
+  case 16:
+    if (stage == 4) {
+      return 1.e-15 * 1.1 * std::pow(T4, 0.56);
+    }
+    if (stage == 5) {
+      return 1.e-15 * 7.6e-4 * std::pow(T4, 0.32) *
+             (1. + 3.4 * std::exp(-5.25 * T4));
+    }
+    break;
+  }
+  return 0.;
+}
@@ -40,13 +40,20 @@ private:
 public:
   ChargeTransferRates();
 
-  double get_charge_transfer_recombination_rate(unsigned char stage,
-                                                unsigned char atom,
-                                                double temperature) const;
+  /**
+   * @brief Virtual destructor.
+   */
+  virtual ~ChargeTransferRates() {}
 
-  double get_charge_transfer_ionization_rate(unsigned char stage,
-                                             unsigned char atom,
-                                             double temperature) const;
+  virtual double get_charge_transfer_recombination_rate(
+      unsigned char stage, unsigned char atom, double temperature) const;
+
+  virtual double get_charge_transfer_ionization_rate(unsigned char stage,
+                                                     unsigned char atom,
+                                                     double temperature) const;
+
+  virtual double get_charge_transfer_recombination_rate_He(
+      unsigned char stage, unsigned char atom, double temperature) const;
 };
 
 #endif // CHARGETRANSFERRATES_HPP
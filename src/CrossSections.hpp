@@ -33,6 +33,8 @@
  */
 class CrossSections {
 public:
+  virtual ~CrossSections() {}
+
   /**
    * @brief Get the photoionization cross section for the given ion at the
    * given photon energy.
@@ -42,6 +44,24 @@ public:
    * @return Photoionization cross section (in m^-2).
    */
   virtual double get_cross_section(IonName ion, double energy) const = 0;
+
+  /**
+   * @brief Get the photoionization cross sections for all ions at the given
+   * photon energy.
+   *
+   * The default implementation simply calls get_cross_section() for every ion.
+   * Implementations that can share work between ions should override it.
+   *
+   * @param energy Photon frequency (in Hz).
+   * @param cross_sections Array to store the photoionization cross sections in
+   * (should have room for NUMBER_OF_IONNAMES values, in m^-2).
+   */
+  virtual void get_cross_sections(double energy, double *cross_sections) const {
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      const IonName ion = static_cast< IonName >(i);
+      cross_sections[i] = get_cross_section(ion, energy);
+    }
+  }
 };
 
 #endif // CROSSSECTIONS_HPP
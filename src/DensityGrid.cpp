@@ -25,6 +25,9 @@
  */
 #include "DensityGrid.hpp"
 #include "DensityGridTraversalJobMarket.hpp"
+#include "NUMATools.hpp"
+
+#include <sstream>
 
 /**
  * @brief Initialize the cells in the grid.
@@ -39,7 +42,8 @@
  */
 void DensityGrid::initialize(std::pair< unsigned long, unsigned long > &block,
                              DensityFunction &function, int worksize) {
-  DensityGridInitializationFunction init(function, _hydro);
+  DensityGridInitializationFunction init(function, _hydro,
+                                         _reemission_probability_table);
   WorkDistributor<
       DensityGridTraversalJobMarket< DensityGridInitializationFunction >,
       DensityGridTraversalJob< DensityGridInitializationFunction > >
@@ -54,7 +58,98 @@ void DensityGrid::initialize(std::pair< unsigned long, unsigned long > &block,
       *this, init, block);
   workers.do_in_parallel(jobs);
 
+  update_opacity_variables();
+
   if (_log) {
     _log->write_status("Done initializing grid.");
   }
 }
+
+/**
+ * @brief Add the contributions to the mean intensity and heating integrals
+ * that were accumulated during photon propagation to the cells.
+ *
+ * This routine should be called after all photons have been propagated, and
+ * before the ionization state or temperature is computed.
+ *
+ * @param worksize Number of parallel threads to use. If a negative number is
+ * given, all available threads will be used.
+ */
+void DensityGrid::reduce_accumulators(int worksize) {
+  AccumulatorReductionFunction reduction(*this);
+  WorkDistributor<
+      DensityGridTraversalJobMarket< AccumulatorReductionFunction >,
+      DensityGridTraversalJob< AccumulatorReductionFunction > >
+      workers(worksize);
+  // photons can travel through all cells, so we always reduce the entire grid
+  std::pair< unsigned long, unsigned long > block(0, get_number_of_cells());
+  DensityGridTraversalJobMarket< AccumulatorReductionFunction > jobs(
+      *this, reduction, block);
+  workers.do_in_parallel(jobs);
+
+#ifdef USE_PRIVATE_ACCUMULATORS
+  if (_log) {
+    _log->write_info("Thread private accumulators use ",
+                     Utilities::human_readable_bytes(
+                         _accumulator.get_allocated_size()),
+                     ".");
+  }
+#endif
+}
+
+/**
+ * @brief Construct the elements of the per cell arrays for the given range of
+ * cells in parallel.
+ *
+ * Memory pages are placed on the NUMA node of the thread that first writes to
+ * them. We use the same decomposition of the grid over the threads as the
+ * later grid traversals, so that most cells are stored close to the thread
+ * that uses them. The resulting placement of the memory is written to the log.
+ *
+ * @param begin Index of the first cell that needs to be constructed.
+ * @param end Index beyond the last cell that needs to be constructed.
+ * @param worksize Number of parallel threads to use. If a negative number is
+ * given, all available threads will be used.
+ */
+void DensityGrid::first_touch(unsigned long begin, unsigned long end,
+                              int worksize) {
+  FirstTouchFunction touch(*this);
+  WorkDistributor< DensityGridTraversalJobMarket< FirstTouchFunction >,
+                   DensityGridTraversalJob< FirstTouchFunction > >
+      workers(worksize);
+  std::pair< unsigned long, unsigned long > block(begin, end);
+  DensityGridTraversalJobMarket< FirstTouchFunction > jobs(*this, touch,
+                                                           block);
+  workers.do_in_parallel(jobs);
+
+  if (_log) {
+    std::vector< unsigned long > pages_per_node;
+    unsigned int num_pages = NUMATools::get_memory_placement(
+        _ionization_variables.data(),
+        _ionization_variables.size() * sizeof(IonizationVariables),
+        pages_per_node);
+    num_pages += NUMATools::get_memory_placement(
+        _opacity_variables.data(), _opacity_variables.size() * sizeof(double),
+        pages_per_node);
+#ifndef USE_PRIVATE_ACCUMULATORS
+    num_pages += NUMATools::get_memory_placement(
+        _accumulated_radiation_field.data(),
+        _accumulated_radiation_field.size() *
+            sizeof(DensityGridAccumulatedValue),
+        pages_per_node);
+#endif
+    if (num_pages > 0) {
+      std::stringstream placement;
+      for (unsigned int i = 0; i < pages_per_node.size(); ++i) {
+        if (pages_per_node[i] > 0) {
+          placement << " node " << i << ": "
+                    << (100. * pages_per_node[i]) / num_pages << "%";
+        }
+      }
+      _log->write_info("Memory placement of grid arrays (", num_pages,
+                       " sampled pages):", placement.str(), ".");
+    } else {
+      _log->write_info("Memory placement of grid arrays is not available.");
+    }
+  }
+}
@@ -34,11 +34,14 @@
 #include "DensityFunction.hpp"
 #include "DensityValues.hpp"
 #include "EmissivityValues.hpp"
+#include "FirstTouchAllocator.hpp"
 #include "HydroVariables.hpp"
 #include "IonizationVariables.hpp"
 #include "Lock.hpp"
 #include "Log.hpp"
 #include "Photon.hpp"
+#include "RadiationFieldAccumulator.hpp"
+#include "ReemissionProbabilityTable.hpp"
 #include "Timer.hpp"
 #include "UnitConverter.hpp"
 #include "WorkDistributor.hpp"
@@ -47,9 +50,32 @@
 #include "Atomic.hpp"
 #endif
 
+#ifdef USE_PRIVATE_ACCUMULATORS
+#include "WorkEnvironment.hpp"
+#endif
+
+#ifdef USE_REPRODUCIBLE_RESULTS
+#include "ReproducibleSum.hpp"
+#endif
+
+#include <algorithm>
 #include <cmath>
+#include <new>
 #include <tuple>
 
+/*! @brief Number of values per cell in the packed array of opacity variables:
+ *  the number density, and the neutral fractions of hydrogen and helium. */
+#define DENSITYGRID_NUMOPACITYVARIABLE 3
+
+#ifdef USE_REPRODUCIBLE_RESULTS
+/*! @brief Type used to accumulate the mean intensity and heating integrals: a
+ *  sum that does not depend on the order in which photons arrive. */
+typedef ReproducibleSum DensityGridAccumulatedValue;
+#else
+/*! @brief Type used to accumulate the mean intensity and heating integrals. */
+typedef double DensityGridAccumulatedValue;
+#endif
+
 /**
  * @brief General interface for density grids.
  */
@@ -74,14 +100,28 @@ protected:
   double _ionization_energy_He;
 
   /*! @brief Ionization calculation variables. */
-  std::vector< IonizationVariables > _ionization_variables;
-
-  /*! @brief Mean intensity of hydrogen ionizing radiation during the previous
-   *  sub-step (in m^3 s^-1). */
-  std::vector< double > _mean_intensity_H_old;
+  std::vector< IonizationVariables,
+               FirstTouchAllocator< IonizationVariables > >
+      _ionization_variables;
+
+  /*! @brief Packed copy of the variables that are needed to compute the optical
+   *  depth of a cell during photon propagation (number density, neutral
+   *  fraction of hydrogen, neutral fraction of helium for every cell). This
+   *  array is updated from _ionization_variables in reset_grid(), so that the
+   *  photon traversal only needs to read 24 bytes per cell. */
+  std::vector< double, FirstTouchAllocator< double > > _opacity_variables;
+
+  /*! @brief Normalized mean intensity of hydrogen ionizing radiation the last
+   *  time the state of the cell was computed (0 if the cell is dirty; in
+   *  s^-1). */
+  std::vector< double, FirstTouchAllocator< double > > _mean_intensity_H_old;
 
   /*! @brief Hydrogen neutral fraction during the previous iteration. */
-  std::vector< double > _neutral_fraction_H_old;
+  std::vector< double, FirstTouchAllocator< double > >
+      _neutral_fraction_H_old;
+
+  /*! @brief Temperature during the previous iteration (in K). */
+  std::vector< double, FirstTouchAllocator< double > > _temperature_old;
 
   /// hydro
 
@@ -94,33 +134,52 @@ protected:
   /// end hydro
 
   /*! @brief EmissivityValues for the cells. */
-  std::vector< EmissivityValues * > _emissivities;
+  std::vector< EmissivityValues *, FirstTouchAllocator< EmissivityValues * > >
+      _emissivities;
+
+#if defined(USE_PRIVATE_ACCUMULATORS)
+  /*! @brief Thread private buffers for the mean intensity and heating
+   *  integrals. */
+  RadiationFieldAccumulator _accumulator;
+#else
+  /*! @brief Mean intensity and heating integrals accumulated during photon
+   *  propagation (RADIATIONFIELDACCUMULATOR_NUMVALUE contiguous values for
+   *  every cell). These are added to _ionization_variables in
+   *  reduce_accumulators(). */
+  std::vector< DensityGridAccumulatedValue,
+               FirstTouchAllocator< DensityGridAccumulatedValue > >
+      _accumulated_radiation_field;
 
 #ifndef USE_LOCKFREE
   /*! @brief Locks to ensure safe write access to the cell data. */
-  std::vector< Lock > _lock;
+  std::vector< Lock, FirstTouchAllocator< Lock > > _lock;
+#endif
 #endif
 
   /*! @brief Log to write log messages to. */
   Log *_log;
 
+  /*! @brief Table used to interpolate the reemission probabilities (if not
+   *  set, the exact fits are used). */
+  const ReemissionProbabilityTable *_reemission_probability_table;
+
   /**
    * @brief Get the optical depth for a photon travelling the given path in the
    * given cell.
    *
    * @param ds Path length the photon traverses (in m).
-   * @param ionization_variables IonizationVariables of the cell.
+   * @param cell DensityGrid::iterator pointing to the cell.
    * @param photon Photon.
    * @return Optical depth.
    */
-  inline static double
-  get_optical_depth(double ds, const IonizationVariables &ionization_variables,
-                    const Photon &photon) {
-    return ds * ionization_variables.get_number_density() *
-           (photon.get_cross_section(ION_H_n) *
-                ionization_variables.get_ionic_fraction(ION_H_n) +
-            photon.get_cross_section_He_corr() *
-                ionization_variables.get_ionic_fraction(ION_He_n));
+  inline double get_optical_depth(double ds,
+                                  const DensityGrid::iterator &cell,
+                                  const Photon &photon) const {
+    const double *opacity_variables =
+        &_opacity_variables[DENSITYGRID_NUMOPACITYVARIABLE * cell.get_index()];
+    return ds * opacity_variables[0] *
+           (photon.get_cross_section(ION_H_n) * opacity_variables[1] +
+            photon.get_cross_section_He_corr() * opacity_variables[2]);
   }
 
   /**
@@ -132,9 +191,9 @@ protected:
    * @param photon Photon.
    */
   inline void update_integrals(double ds, DensityGrid::iterator &cell,
-                               const Photon &photon) const {
-    IonizationVariables &ionization_variables = cell.get_ionization_variables();
-    if (ionization_variables.get_number_density() > 0.) {
+                               const Photon &photon) {
+    const unsigned long index = cell.get_index();
+    if (_opacity_variables[DENSITYGRID_NUMOPACITYVARIABLE * index] > 0.) {
       // we tried speeding things up by using lock-free addition, but it turns
       // out that the overhead caused by doing this is larger than the overhead
       // of using a single lock
@@ -148,65 +207,103 @@ protected:
         dmean_intensity[i] =
             ds * photon.get_weight() * photon.get_cross_section(ion);
       }
-      double dheating_H = ds * photon.get_weight() *
-                          photon.get_cross_section(ION_H_n) *
-                          (photon.get_energy() - _ionization_energy_H);
-      double dheating_He = ds * photon.get_weight() *
-                           photon.get_cross_section(ION_He_n) *
-                           (photon.get_energy() - _ionization_energy_He);
+      double dheating[NUMBER_OF_HEATINGTERMS];
+      dheating[HEATINGTERM_H] = ds * photon.get_weight() *
+                                photon.get_cross_section(ION_H_n) *
+                                (photon.get_energy() - _ionization_energy_H);
+      dheating[HEATINGTERM_He] = ds * photon.get_weight() *
+                                 photon.get_cross_section(ION_He_n) *
+                                 (photon.get_energy() - _ionization_energy_He);
+#ifdef USE_PRIVATE_ACCUMULATORS
+      // no locking at all: every thread writes to its own buffer, the buffers
+      // are added to the cells in reduce_accumulators()
+      _accumulator.add(WorkEnvironment::get_thread_id(), index,
+                       dmean_intensity, dheating);
+#else
+      DensityGridAccumulatedValue *accumulated_values =
+          &_accumulated_radiation_field[RADIATIONFIELDACCUMULATOR_NUMVALUE *
+                                        index];
 #ifndef USE_LOCKFREE
       cell.lock();
 #endif
       for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
-        IonName ion = static_cast< IonName >(i);
-        ionization_variables.increase_mean_intensity(ion, dmean_intensity[i]);
+#ifdef USE_LOCKFREE
+        Atomic::add(accumulated_values[i], dmean_intensity[i]);
+#else
+        accumulated_values[i] += dmean_intensity[i];
+#endif
+      }
+      for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+#ifdef USE_LOCKFREE
+        Atomic::add(accumulated_values[NUMBER_OF_IONNAMES + i], dheating[i]);
+#else
+        accumulated_values[NUMBER_OF_IONNAMES + i] += dheating[i];
+#endif
       }
-      ionization_variables.increase_heating(HEATINGTERM_H, dheating_H);
-      ionization_variables.increase_heating(HEATINGTERM_He, dheating_He);
 #ifndef USE_LOCKFREE
       cell.unlock();
+#endif
 #endif
     }
   }
 
 protected:
+  /**
+   * @brief Copy the opacity variables of the cell with the given index into the
+   * packed array that is used during photon propagation.
+   *
+   * @param index Index of the cell.
+   */
+  inline void update_opacity_variables(unsigned long index) {
+    const IonizationVariables &ionization_variables =
+        _ionization_variables[index];
+    double *opacity_variables =
+        &_opacity_variables[DENSITYGRID_NUMOPACITYVARIABLE * index];
+    opacity_variables[0] = ionization_variables.get_number_density();
+    opacity_variables[1] = ionization_variables.get_ionic_fraction(ION_H_n);
+    opacity_variables[2] = ionization_variables.get_ionic_fraction(ION_He_n);
+  }
+
+  /**
+   * @brief Make sure the packed transport arrays have the correct size.
+   *
+   * Grids that add cells after the initial memory allocation (like the AMR
+   * grid) rely on this routine to grow the arrays.
+   */
+  inline void resize_transport_arrays() {
+    const unsigned long numcell = _ionization_variables.size();
+    _opacity_variables.resize(DENSITYGRID_NUMOPACITYVARIABLE * numcell, 0.);
+#ifndef USE_PRIVATE_ACCUMULATORS
+    _accumulated_radiation_field.resize(
+        RADIATIONFIELDACCUMULATOR_NUMVALUE * numcell, 0.);
+#endif
+  }
+
   /**
    * @brief Set the re-emission probabilities for the given cell.
    *
-   * These quantities are all dimensionless.
+   * These quantities are all dimensionless. They are interpolated from the
+   * given table, or computed from the exact fits if no table is given.
    *
+   * @param table ReemissionProbabilityTable to use (can be a nullptr).
    * @param ionization_variables IonizationVariables of the cell.
    */
   inline static void
-  set_reemission_probabilities(IonizationVariables &ionization_variables) {
-    const double T4 = ionization_variables.get_temperature() * 1.e-4;
-
-    // reemission probabilities
-    const double alpha_1_H = 1.58e-13 * std::pow(T4, -0.53);
-    const double alpha_A_agn = 4.18e-13 * std::pow(T4, -0.7);
-    ionization_variables.set_reemission_probability(
-        REEMISSIONPROBABILITY_HYDROGEN, alpha_1_H / alpha_A_agn);
-
-    const double alpha_1_He = 1.54e-13 * std::pow(T4, -0.486);
-    const double alpha_e_2tS = 2.1e-13 * std::pow(T4, -0.381);
-    const double alpha_e_2sS = 2.06e-14 * std::pow(T4, -0.451);
-    const double alpha_e_2sP = 4.17e-14 * std::pow(T4, -0.695);
-    // We make sure the sum of all probabilities is 1...
-    const double alphaHe = alpha_1_He + alpha_e_2tS + alpha_e_2sS + alpha_e_2sP;
-
-    const double He_LyC = alpha_1_He / alphaHe;
-    const double He_NpEEv = He_LyC + alpha_e_2tS / alphaHe;
-    const double He_TPC = He_NpEEv + alpha_e_2sS / alphaHe;
-    const double He_LyA = He_TPC + alpha_e_2sP / alphaHe;
-    // make cumulative
-    ionization_variables.set_reemission_probability(
-        REEMISSIONPROBABILITY_HELIUM_LYC, He_LyC);
-    ionization_variables.set_reemission_probability(
-        REEMISSIONPROBABILITY_HELIUM_NPEEV, He_NpEEv);
-    ionization_variables.set_reemission_probability(
-        REEMISSIONPROBABILITY_HELIUM_TPC, He_TPC);
-    ionization_variables.set_reemission_probability(
-        REEMISSIONPROBABILITY_HELIUM_LYA, He_LyA);
+  set_reemission_probabilities(const ReemissionProbabilityTable *table,
+                               IonizationVariables &ionization_variables) {
+
+    double probabilities[NUMBER_OF_REEMISSIONPROBABILITIES];
+    if (table != nullptr) {
+      table->get_probabilities(ionization_variables.get_temperature(),
+                               probabilities);
+    } else {
+      ReemissionProbabilityTable::get_exact_probabilities(
+          ionization_variables.get_temperature(), probabilities);
+    }
+    for (int i = 0; i < NUMBER_OF_REEMISSIONPROBABILITIES; ++i) {
+      ionization_variables.set_reemission_probability(
+          static_cast< ReemissionProbabilityName >(i), probabilities[i]);
+    }
   }
 
 public:
@@ -230,7 +327,8 @@ public:
       CoordinateVector< bool > periodic = CoordinateVector< bool >(false),
       bool hydro = false, Log *log = nullptr)
       : _density_function(density_function), _box(box), _periodic(periodic),
-        _hydro(hydro), _log(log) {
+        _hydro(hydro), _log(log),
+        _reemission_probability_table(nullptr) {
 
     _ionization_energy_H =
         UnitConverter::to_SI< QUANTITY_FREQUENCY >(13.6, "eV");
@@ -243,6 +341,19 @@ public:
    */
   virtual ~DensityGrid() {}
 
+  /**
+   * @brief Set the table used to interpolate the reemission probabilities.
+   *
+   * This should be done before the grid is initialized. If no table is set,
+   * the reemission probabilities are computed from the exact fits.
+   *
+   * @param table ReemissionProbabilityTable to use (can be a nullptr).
+   */
+  inline void
+  set_reemission_probability_table(const ReemissionProbabilityTable *table) {
+    _reemission_probability_table = table;
+  }
+
   /**
    * @brief Allocate memory for the given number of cells.
    *
@@ -257,13 +368,26 @@ public:
     }
     // we allocate memory for the cells, so that --dry-run can already check the
     // available memory
+    // the per cell arrays use a FirstTouchAllocator: resizing them without a
+    // value does not touch the new memory, this is done in parallel by
+    // first_touch()
+    const unsigned long old_numcell = _ionization_variables.size();
     _ionization_variables.resize(numcell);
+    _opacity_variables.resize(DENSITYGRID_NUMOPACITYVARIABLE * numcell);
     _mean_intensity_H_old.resize(numcell);
     _neutral_fraction_H_old.resize(numcell);
-    _emissivities.resize(numcell, nullptr);
-#ifndef USE_LOCKFREE
+    _temperature_old.resize(numcell);
+    _emissivities.resize(numcell);
+#if defined(USE_PRIVATE_ACCUMULATORS)
+    _accumulator.resize(numcell);
+#else
+    _accumulated_radiation_field.resize(RADIATIONFIELDACCUMULATOR_NUMVALUE *
+                                        numcell);
+#if !defined(USE_LOCKFREE)
     _lock.resize(numcell);
 #endif
+#endif
+    first_touch(old_numcell, numcell);
 
     if (_log) {
       _log->write_status("Done allocating memory.");
@@ -401,6 +525,42 @@ public:
   virtual DensityGrid::iterator interact(Photon &photon,
                                          double optical_depth) = 0;
 
+  /**
+   * @brief Let the given Photon travel through the density grid until the given
+   * optical depth is reached, starting from a cell that is known to contain
+   * the Photon.
+   *
+   * The cell usually is the result of the previous interact() call for the
+   * same Photon, as a reemitted Photon starts from the position where it was
+   * absorbed. Grids for which point location is expensive can use this cell as
+   * a starting point; the default implementation ignores it.
+   *
+   * @param photon Photon.
+   * @param optical_depth Optical depth the photon should travel in total
+   * (dimensionless).
+   * @param cell DensityGrid::iterator pointing to the cell that contains the
+   * Photon.
+   * @return DensityGrid::iterator pointing to the cell the photon was last in,
+   * or DensityGrid::end() if the photon left the box.
+   */
+  virtual DensityGrid::iterator
+  interact_from_cell(Photon &photon, double optical_depth,
+                     const DensityGrid::iterator &cell) {
+    return interact(photon, optical_depth);
+  }
+
+  /**
+   * @brief Set the positions of the discrete photon sources.
+   *
+   * Grids for which point location is expensive can use this to locate the
+   * cells that contain the sources once. The default implementation does
+   * nothing.
+   *
+   * @param positions Positions of the discrete photon sources (in m).
+   */
+  virtual void
+  set_source_positions(const std::vector< CoordinateVector<> > &positions) {}
+
   /**
    * @brief Get the total line emission along a ray with the given origin and
    * direction.
@@ -490,22 +650,43 @@ public:
     }
 
     /**
-     * @brief Get the mean intensity of hydrogen ionizing radiation during the
-     * previous iteration for the cell the iterator is currently pointing to.
+     * @brief Get the temperature during the previous iteration.
+     *
+     * @return Temperature during the previous iteration (in K).
+     */
+    inline double get_temperature_old() const {
+      return _grid->_temperature_old[_index];
+    }
+
+    /**
+     * @brief Set the temperature during the previous iteration.
+     *
+     * @param temperature_old Temperature during the previous iteration (in K).
+     */
+    inline void set_temperature_old(double temperature_old) {
+      _grid->_temperature_old[_index] = temperature_old;
+    }
+
+    /**
+     * @brief Get the normalized mean intensity of hydrogen ionizing radiation
+     * the last time the state of the cell the iterator is currently pointing
+     * to was computed.
      *
-     * @return Mean intensity of hydrogen ionizing radiation during the previous
-     * iteration (without normalization factor, in m^3).
+     * @return Normalized mean intensity of hydrogen ionizing radiation the last
+     * time the state of the cell was computed (0 if the cell is dirty; in
+     * s^-1).
      */
     inline double get_mean_intensity_H_old() const {
       return _grid->_mean_intensity_H_old[_index];
     }
 
     /**
-     * @brief Set the mean intensity of hydrogen ionizing radiation during the
-     * previous iteration for the cell the iterator is currently pointing to.
+     * @brief Set the normalized mean intensity of hydrogen ionizing radiation
+     * the last time the state of the cell the iterator is currently pointing
+     * to was computed.
      *
-     * @param mean_intensity_H_old Mean intensity of hydrogen ionizing radiation
-     * during the previous iteration (without normalization factor, in m^3).
+     * @param mean_intensity_H_old Normalized mean intensity of hydrogen
+     * ionizing radiation (0 to mark the cell as dirty; in s^-1).
      */
     inline void set_mean_intensity_H_old(double mean_intensity_H_old) {
       _grid->_mean_intensity_H_old[_index] = mean_intensity_H_old;
@@ -516,11 +697,16 @@ public:
      * currently pointing to.
      */
     inline void reset_mean_intensities() {
+#ifndef USE_PRIVATE_ACCUMULATORS
+      for (int i = 0; i < RADIATIONFIELDACCUMULATOR_NUMVALUE; ++i) {
+        _grid->_accumulated_radiation_field
+            [RADIATIONFIELDACCUMULATOR_NUMVALUE * _index + i] = 0.;
+      }
+#endif
       for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
         const IonName ion = static_cast< IonName >(i);
         _grid->_ionization_variables[_index].set_mean_intensity(ion, 0.);
       }
-      _grid->_mean_intensity_H_old[_index] = 0.;
       for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
         const HeatingTermName name = static_cast< HeatingTermName >(i);
         _grid->_ionization_variables[_index].set_heating(name, 0.);
@@ -599,7 +785,7 @@ public:
       _grid->_emissivities[_index] = emissivities;
     }
 
-#ifndef USE_LOCKFREE
+#if !defined(USE_LOCKFREE) && !defined(USE_PRIVATE_ACCUMULATORS)
     /**
      * @brief Lock the cell the iterator is pointing to.
      */
@@ -738,6 +924,10 @@ public:
     /*! @brief Do we need to initialize hydro variables? */
     bool _hydro;
 
+    /*! @brief Table used to interpolate the reemission probabilities (can be
+     *  a nullptr). */
+    const ReemissionProbabilityTable *_reemission_probability_table;
+
   public:
     /**
      * @brief Constructor.
@@ -745,9 +935,14 @@ public:
      * @param function DensityFunction that set the density for each cell in the
      * grid.
      * @param hydro Do we need to initialize hydro variables?
+     * @param reemission_probability_table Table used to interpolate the
+     * reemission probabilities (can be a nullptr).
      */
-    DensityGridInitializationFunction(DensityFunction &function, bool hydro)
-        : _function(function), _hydro(hydro) {}
+    DensityGridInitializationFunction(
+        DensityFunction &function, bool hydro,
+        const ReemissionProbabilityTable *reemission_probability_table)
+        : _function(function), _hydro(hydro),
+          _reemission_probability_table(reemission_probability_table) {}
 
     /**
      * @brief Routine that sets the density for a single cell in the grid.
@@ -768,7 +963,8 @@ public:
         const CoordinateVector<> v = vals.get_velocity();
         it.get_hydro_variables().set_primitives_velocity(v);
       }
-      set_reemission_probabilities(ionization_variables);
+      set_reemission_probabilities(_reemission_probability_table,
+                                   ionization_variables);
     }
   };
 
@@ -776,13 +972,209 @@ public:
                   DensityFunction &function, int worksize = -1);
 
   /**
-   * @brief Reset the mean intensity counters and update the reemission
-   * probabilities for all cells.
+   * @brief Functor class used to add the accumulated mean intensity and heating
+   * integrals to the cells.
+   */
+  class AccumulatorReductionFunction {
+  private:
+    /*! @brief DensityGrid that holds the accumulators. */
+    DensityGrid &_grid;
+
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param grid DensityGrid that holds the accumulators.
+     */
+    AccumulatorReductionFunction(DensityGrid &grid) : _grid(grid) {}
+
+    /**
+     * @brief Add the accumulated contributions for a single cell and reset the
+     * accumulators for that cell.
+     *
+     * @param it DensityGrid::iterator pointing to a single cell in the grid.
+     */
+    inline void operator()(iterator it) {
+      IonizationVariables &ionization_variables = it.get_ionization_variables();
+#ifdef USE_PRIVATE_ACCUMULATORS
+      _grid._accumulator.reduce(it.get_index(), ionization_variables);
+#else
+      DensityGridAccumulatedValue *accumulated_values =
+          &_grid._accumulated_radiation_field
+               [RADIATIONFIELDACCUMULATOR_NUMVALUE * it.get_index()];
+      for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+        const IonName ion = static_cast< IonName >(i);
+        ionization_variables.increase_mean_intensity(ion,
+                                                     accumulated_values[i]);
+        accumulated_values[i] = 0.;
+      }
+      for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+        const HeatingTermName name = static_cast< HeatingTermName >(i);
+        ionization_variables.increase_heating(
+            name, accumulated_values[NUMBER_OF_IONNAMES + i]);
+        accumulated_values[NUMBER_OF_IONNAMES + i] = 0.;
+      }
+#endif
+    }
+  };
+
+  void reduce_accumulators(int worksize = -1);
+
+  /**
+   * @brief Set the number of threads that will propagate photons through the
+   * grid.
+   *
+   * The thread private accumulators (if used) base the memory budget of every
+   * thread on this number.
+   *
+   * @param worksize Number of threads that will propagate photons.
+   */
+  inline void set_number_of_threads(int worksize) {
+#ifdef USE_PRIVATE_ACCUMULATORS
+    _accumulator.set_number_of_threads(worksize);
+    if (_log) {
+      _log->write_status(
+          "Thread private accumulators can use up to ",
+          _accumulator.get_max_private_copies(),
+          " private copies of the grid, shared out over ", worksize,
+          " threads.");
+    }
+#endif
+  }
+
+  /**
+   * @brief Get a reference to the IonizationVariables of all cells.
+   *
+   * This is used to communicate the radiation field and the ionization state
+   * of the cells between MPI processes.
+   *
+   * @return Reference to the internal IonizationVariables list.
+   */
+  inline std::vector< IonizationVariables,
+                      FirstTouchAllocator< IonizationVariables > > &
+  get_ionization_variables_handle() {
+    return _ionization_variables;
+  }
+
+  /**
+   * @brief Get a reference to the HydroVariables of all cells.
+   *
+   * This is used to communicate the hydro state of the cells between MPI
+   * processes. The list is empty if hydro is not active.
+   *
+   * @return Reference to the internal HydroVariables list.
+   */
+  inline std::vector< HydroVariables > &get_hydro_variables_handle() {
+    return _hydro_variables;
+  }
+
+#ifdef USE_REPRODUCIBLE_RESULTS
+  /**
+   * @brief Get a pointer to the order independent accumulators of all cells.
+   *
+   * These are summed across all MPI processes before they are added to the
+   * cells by reduce_accumulators(), so that the result does not depend on the
+   * number of processes.
+   *
+   * @return Pointer to the first of get_accumulated_radiation_field_size()
+   * accumulated values.
+   */
+  inline DensityGridAccumulatedValue *get_accumulated_radiation_field_handle() {
+    return _accumulated_radiation_field.data();
+  }
+
+  /**
+   * @brief Get the number of order independent accumulators.
+   *
+   * @return Number of accumulated values
+   * (RADIATIONFIELDACCUMULATOR_NUMVALUE per cell).
+   */
+  inline unsigned long get_accumulated_radiation_field_size() const {
+    return _accumulated_radiation_field.size();
+  }
+#endif
+
+  /**
+   * @brief Functor class used to construct the per cell arrays of the grid in
+   * parallel.
+   */
+  class FirstTouchFunction {
+  private:
+    /*! @brief DensityGrid that holds the arrays. */
+    DensityGrid &_grid;
+
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param grid DensityGrid that holds the arrays.
+     */
+    FirstTouchFunction(DensityGrid &grid) : _grid(grid) {}
+
+    /**
+     * @brief Construct the elements of all per cell arrays for a single cell.
+     *
+     * This is the first write to this memory, which places the corresponding
+     * memory pages on the NUMA node of the calling thread.
+     *
+     * @param it DensityGrid::iterator pointing to a single cell in the grid.
+     */
+    inline void operator()(iterator it) {
+      const unsigned long index = it.get_index();
+      new (&_grid._ionization_variables[index]) IonizationVariables();
+      for (int i = 0; i < DENSITYGRID_NUMOPACITYVARIABLE; ++i) {
+        new (&_grid._opacity_variables[DENSITYGRID_NUMOPACITYVARIABLE * index +
+                                       i]) double(0.);
+      }
+      new (&_grid._mean_intensity_H_old[index]) double(0.);
+      new (&_grid._neutral_fraction_H_old[index]) double(0.);
+      new (&_grid._temperature_old[index]) double(0.);
+      new (&_grid._emissivities[index]) EmissivityValues *(nullptr);
+#ifndef USE_PRIVATE_ACCUMULATORS
+      for (int i = 0; i < RADIATIONFIELDACCUMULATOR_NUMVALUE; ++i) {
+        new (&_grid._accumulated_radiation_field
+                  [RADIATIONFIELDACCUMULATOR_NUMVALUE * index + i])
+            DensityGridAccumulatedValue(0.);
+      }
+#ifndef USE_LOCKFREE
+      new (&_grid._lock[index]) Lock();
+#endif
+#endif
+    }
+  };
+
+  void first_touch(unsigned long begin, unsigned long end, int worksize = -1);
+
+  /**
+   * @brief Update the packed array of opacity variables for all cells.
+   */
+  inline void update_opacity_variables() {
+    resize_transport_arrays();
+    for (auto it = begin(); it != end(); ++it) {
+      update_opacity_variables(it.get_index());
+    }
+  }
+
+  /**
+   * @brief Mark all cells as dirty, so that their state is recomputed during
+   * the next ionization state or temperature calculation, irrespective of the
+   * change in their mean intensity.
+   */
+  inline void mark_all_cells_dirty() {
+    std::fill(_mean_intensity_H_old.begin(), _mean_intensity_H_old.end(), 0.);
+  }
+
+  /**
+   * @brief Reset the mean intensity counters, update the reemission
+   * probabilities and update the opacity variables for all cells.
    */
   virtual void reset_grid() {
+    resize_transport_arrays();
     for (auto it = begin(); it != end(); ++it) {
-      set_reemission_probabilities(it.get_ionization_variables());
+      set_reemission_probabilities(_reemission_probability_table,
+                                   it.get_ionization_variables());
       it.reset_mean_intensities();
+      update_opacity_variables(it.get_index());
     }
   }
 
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file DensityGridChunkTraversalJob.hpp
+ *
+ * @brief Job that should be performed on a contiguous chunk of cells of the
+ * DensityGrid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef DENSITYGRIDCHUNKTRAVERSALJOB_HPP
+#define DENSITYGRIDCHUNKTRAVERSALJOB_HPP
+
+#include "DensityGrid.hpp"
+
+#include <sstream>
+#include <typeinfo>
+
+/**
+ * @brief Job that should be performed on a contiguous chunk of cells of the
+ * DensityGrid.
+ *
+ * Contrary to the DensityGridTraversalJob, the template function is called
+ * once for the entire chunk, so that it can process multiple cells at the same
+ * time.
+ */
+template < typename _function_ > class DensityGridChunkTraversalJob {
+private:
+  /*! @brief Iterator to the first cell that should be visited. */
+  DensityGrid::iterator _begin;
+
+  /*! @brief Iterator to the cell beyond the last cell that should be visited.
+   */
+  DensityGrid::iterator _end;
+
+  /*! @brief Template function that should be executed for the chunk. This
+   *  function can be a function or a functor, and should take two
+   *  DensityGrid::iterators (begin and end of the chunk) as parameters. */
+  _function_ &_function;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param begin Iterator to the first cell that should be visited.
+   * @param end Iterator to the cell beyond the last cell that should be
+   * visited.
+   * @param function Template function that should be executed for the chunk.
+   * This function can be a function or a functor, and should take two
+   * DensityGrid::iterators (begin and end of the chunk) as parameters.
+   */
+  DensityGridChunkTraversalJob(DensityGrid::iterator begin,
+                               DensityGrid::iterator end, _function_ &function)
+      : _begin(begin), _end(end), _function(function) {}
+
+  /**
+   * @brief Set the range of cells that should be visited.
+   *
+   * @param begin Iterator to the first cell that should be visited.
+   * @param end Iterator to the cell beyond the last cell that should be
+   * visited.
+   */
+  inline void set_chunk(DensityGrid::iterator begin,
+                        DensityGrid::iterator end) {
+    _begin = begin;
+    _end = end;
+  }
+
+  /**
+   * @brief Should the Job be deleted by the Worker when it is finished?
+   *
+   * @return False, since the jobs are owned and reused by the
+   * DensityGridTraversalJobMarket.
+   */
+  inline bool do_cleanup() const { return false; }
+
+  /**
+   * @brief Call the template _function on the internal range.
+   */
+  inline void execute() { _function(_begin, _end); }
+
+  /**
+   * @brief Get a name tag for this job.
+   *
+   * @return "densitygrid_chunk_traversal".
+   */
+  inline std::string get_tag() const {
+    std::stringstream tag;
+    tag << "densitygrid_chunk_traversal<" << typeid(_function_).name() << ">";
+    return tag.str();
+  }
+};
+
+#endif // DENSITYGRIDCHUNKTRAVERSALJOB_HPP
@@ -63,12 +63,26 @@ public:
                           DensityGrid::iterator end, _function_ &function)
       : _begin(begin), _end(end), _function(function) {}
 
+  /**
+   * @brief Set the range of cells that should be visited.
+   *
+   * @param begin Iterator to the first cell that should be visited.
+   * @param end Iterator to the cell beyond the last cell that should be
+   * visited.
+   */
+  inline void set_chunk(DensityGrid::iterator begin,
+                        DensityGrid::iterator end) {
+    _begin = begin;
+    _end = end;
+  }
+
   /**
    * @brief Should the Job be deleted by the Worker when it is finished?
    *
-   * @return True.
+   * @return False, since the jobs are owned and reused by the
+   * DensityGridTraversalJobMarket.
    */
-  inline bool do_cleanup() const { return true; }
+  inline bool do_cleanup() const { return false; }
 
   /**
    * @brief Call the template _function on each cell in the internal range.
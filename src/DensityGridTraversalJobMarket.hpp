@@ -29,18 +29,26 @@
 
 #include "DensityGrid.hpp"
 #include "DensityGridTraversalJob.hpp"
-#include "Lock.hpp"
-#include "Timer.hpp"
+#include "WorkStealingScheduler.hpp"
+
+#include <vector>
 
 /**
  * @brief JobMarket used to spawn DensityGridTraversalJobs that should be
  * executed for every cell of the DensityGrid, possibly in parallel.
+ *
+ * The cells are distributed over the threads using a WorkStealingScheduler,
+ * and every thread reuses the same DensityGridTraversalJob for all its chunks,
+ * so that no memory is allocated while the jobs are executed.
+ *
+ * The optional second template argument can be used to replace the
+ * DensityGridTraversalJob with another job type that has the same interface,
+ * e.g. a DensityGridChunkTraversalJob that processes an entire chunk at once.
  */
-template < typename _function_ > class DensityGridTraversalJobMarket {
+template < typename _function_,
+           typename _job_ = DensityGridTraversalJob< _function_ > >
+class DensityGridTraversalJobMarket {
 private:
-  /*! @brief Fraction of the grid that was already processed. */
-  double _fraction_done;
-
   /*! @brief Template _function_ that should be executed for every cell of the
    *  grid. This function can be a function or a functor, and should take a
    *  DensityGrid::iterator as single parameter. */
@@ -52,8 +60,14 @@ private:
   /*! @brief Block that is traversed by the local MPI process. */
   std::pair< unsigned long, unsigned long > _block;
 
-  /*! @brief Lock used to ensure safe access to the internal counters. */
-  Lock _lock;
+  /*! @brief Number of cells in a single chunk. */
+  unsigned int _chunksize;
+
+  /*! @brief Scheduler that distributes the cells over the threads. */
+  WorkStealingScheduler _scheduler;
+
+  /*! @brief Per thread DensityGridTraversalJob. */
+  std::vector< _job_ > _jobs;
 
 public:
   /**
@@ -68,7 +82,7 @@ public:
   inline DensityGridTraversalJobMarket(
       DensityGrid &grid, _function_ &function,
       std::pair< unsigned long, unsigned long > &block)
-      : _fraction_done(0.), _function(function), _grid(grid), _block(block) {
+      : _function(function), _grid(grid), _block(block), _chunksize(1) {
     // make sure the second element of _block contains the size and not the end
     // index
     _block.second -= _block.first;
@@ -78,9 +92,24 @@ public:
    * @brief Set the number of parallel threads that will be used to execute
    * the jobs.
    *
+   * This routine is called at the start of the parallel run, and distributes
+   * the cells over the threads.
+   *
    * @param worksize Number of parallel threads that will be used.
    */
-  inline void set_worksize(int worksize) {}
+  inline void set_worksize(int worksize) {
+    _scheduler.reset(_block.second, worksize);
+    // every thread processes its own part of the block in about 20 chunks, so
+    // that there is enough opportunity to steal work from slow threads
+    _chunksize = std::max(_block.second / (20 * worksize), 1ul);
+    _jobs.clear();
+    _jobs.reserve(worksize);
+    const std::pair< DensityGrid::iterator, DensityGrid::iterator > chunk =
+        _grid.get_chunk(_block.first, _block.first);
+    for (int i = 0; i < worksize; ++i) {
+      _jobs.push_back(_job_(chunk.first, chunk.second, _function));
+    }
+  }
 
   /**
    * @brief Get a DensityGridTraversalJob.
@@ -89,30 +118,16 @@ public:
    * @return Pointer to a unique and thread safe DensityGridTraversalJob
    * instance.
    */
-  inline DensityGridTraversalJob< _function_ > *get_job(int thread_id) {
-    if (_fraction_done == 1.) {
-      return nullptr;
-    }
-    _lock.lock();
-    // _fraction_done could be 1. now, as another thread might have changed it
-    if (_fraction_done == 1.) {
-      _lock.unlock();
+  inline _job_ *get_job(int thread_id) {
+    unsigned long begin, end;
+    if (_scheduler.get_range(thread_id, _chunksize, begin, end)) {
+      std::pair< DensityGrid::iterator, DensityGrid::iterator > chunk =
+          _grid.get_chunk(_block.first + begin, _block.first + end);
+      _jobs[thread_id].set_chunk(chunk.first, chunk.second);
+      return &_jobs[thread_id];
+    } else {
       return nullptr;
     }
-    double begin_fraction = _fraction_done;
-    double end_fraction =
-        _fraction_done + std::max(0.05 * (1. - _fraction_done), 0.01);
-    end_fraction = std::min(end_fraction, 1.);
-    _fraction_done = end_fraction;
-    _lock.unlock();
-    unsigned long begin = _block.first + begin_fraction * _block.second;
-    unsigned long end = _block.first + end_fraction * _block.second;
-    std::pair< DensityGrid::iterator, DensityGrid::iterator > chunk =
-        _grid.get_chunk(begin, end);
-    DensityGridTraversalJob< _function_ > *job =
-        new DensityGridTraversalJob< _function_ >(chunk.first, chunk.second,
-                                                  _function);
-    return job;
   }
 };
 
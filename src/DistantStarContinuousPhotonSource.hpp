@@ -33,6 +33,7 @@
 #include "ParameterFile.hpp"
 #include "PhotonSource.hpp"
 #include "RandomGenerator.hpp"
+#include "SphericalRectangle.hpp"
 
 /**
  * @brief ContinuousPhotonSource implementation for a distant star (outside the
@@ -59,6 +60,14 @@ private:
   /*! @brief Top anchor of the box (in m). */
   CoordinateVector<> _top_anchor;
 
+  /*! @brief Exposed faces of the box, as seen from the star, for each
+   *  coordinate direction. */
+  SphericalRectangle _faces[3];
+
+  /*! @brief Cumulative solid angle subtended by the exposed faces, for each
+   *  coordinate direction (in sr). */
+  double _cumulative_solid_angle[3];
+
 public:
   /**
    * @brief Constructor.
@@ -81,6 +90,27 @@ public:
       num_exposed += (_exposed_faces[i] != 0);
     }
 
+    // the exposed faces do not overlap when seen from the star, so that the
+    // solid angle subtended by the box is the sum of the face solid angles
+    const CoordinateVector<> &sides = _box.get_sides();
+    double total_solid_angle = 0.;
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (_exposed_faces[i] != 0) {
+        const unsigned int j1 = (i + 1) % 3;
+        const unsigned int j2 = (i + 2) % 3;
+        CoordinateVector<> corner = _bottom_anchor;
+        if (_exposed_faces[i] > 0) {
+          corner[i] = _top_anchor[i];
+        }
+        CoordinateVector<> side_x, side_y;
+        side_x[j1] = sides[j1];
+        side_y[j2] = sides[j2];
+        _faces[i] = SphericalRectangle(_position, corner, side_x, side_y);
+        total_solid_angle += _faces[i].get_solid_angle();
+      }
+      _cumulative_solid_angle[i] = total_solid_angle;
+    }
+
     // make sure we are really dealing with a distant star
     if (num_exposed == 0) {
       cmac_error("External stellar source lies inside the simulation box. This "
@@ -186,11 +216,12 @@ public:
   /**
    * @brief Get the entrance point and direction of a random incoming photon.
    *
-   * Since it is very hard to constrain the solid angle covered by the receiving
-   * part of the box, we use a rejection technique to sample a random outgoing
-   * direction from the star that ends up inside the box. The incoming direction
-   * is already given, while the entrance point on the surface of the box is
-   * calculated as part of the rejection technique.
+   * The photons leave the star isotropically, so that the directions that
+   * enter the box are uniformly distributed within the solid angle subtended
+   * by the exposed faces. We first pick an exposed face, with a probability
+   * proportional to its solid angle, and then directly sample a uniform
+   * direction within the solid angle of that face (see SphericalRectangle).
+   * The entrance point is the point on the face that is hit in that direction.
    *
    * @param random_generator RandomGenerator used to generate random numbers.
    * @return std::pair containing the position and direction of a random
@@ -198,27 +229,28 @@ public:
    */
   virtual std::pair< CoordinateVector<>, CoordinateVector<> >
   get_random_incoming_direction(RandomGenerator &random_generator) const {
-    CoordinateVector<> direction =
-        PhotonSource::get_random_direction(random_generator);
-    CoordinateVector<> position;
 
-    // we want to be a bit smarter about this to speed up things
-    // if the upper side of the box is exposed, we don't want photons that move
-    // in an upward direction, since these cannot hit the box. We can turn these
-    // photons around without affecting the istropic behaviour of the photons.
-    // The same goes for other directions.
-    for (unsigned int i = 0; i < 3; ++i) {
-      if (_exposed_faces[i] * direction[i] > 0.) {
-        direction[i] = -direction[i];
-      }
+    const double x = _cumulative_solid_angle[2] *
+                     random_generator.get_uniform_random_double();
+    unsigned int iface = 0;
+    while (iface < 2 && (_exposed_faces[iface] == 0 ||
+                         x >= _cumulative_solid_angle[iface])) {
+      ++iface;
     }
 
-    // check if the direction will enter the box at some point
-    while (!enters_box(direction, position)) {
-      // if not, resample
-      direction = PhotonSource::get_random_direction(random_generator);
+    const double u = random_generator.get_uniform_random_double();
+    const double v = random_generator.get_uniform_random_double();
+    CoordinateVector<> position = _faces[iface].get_point(u, v);
+    // remove round off: the point should lie exactly on the face
+    if (_exposed_faces[iface] < 0) {
+      position[iface] = _bottom_anchor[iface];
+    } else {
+      position[iface] = _top_anchor[iface];
     }
 
+    CoordinateVector<> direction = position - _position;
+    direction /= direction.norm();
+
     return std::make_pair(position, direction);
   }
 
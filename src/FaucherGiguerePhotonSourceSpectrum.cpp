@@ -152,6 +152,10 @@ FaucherGiguerePhotonSourceSpectrum::FaucherGiguerePhotonSourceSpectrum(
     _total_flux = 0.;
   }
 
+  // set up the guide table used to sample from the cumulative distribution
+  _guide_table.initialize(_cumulative_distribution,
+                          FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ);
+
   if (log) {
     log->write_status(
         "Constructed FaucherGiguerePhotonSourceSpectrum at redshift ", redshift,
@@ -223,8 +227,7 @@ double FaucherGiguerePhotonSourceSpectrum::get_total_flux() const {
 double FaucherGiguerePhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
   double x = random_generator.get_uniform_random_double();
-  unsigned int inu = Utilities::locate(
-      x, _cumulative_distribution, FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ);
+  unsigned int inu = _guide_table.locate(x, _cumulative_distribution);
   double frequency =
       _frequencies[inu] +
       (_frequencies[inu + 1] - _frequencies[inu]) *
@@ -27,6 +27,7 @@
 #ifndef FAUCHERGIGUEREPHOTONSOURCESPECTRUM_HPP
 #define FAUCHERGIGUEREPHOTONSOURCESPECTRUM_HPP
 
+#include "GuideTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 
 #include <string>
@@ -50,6 +51,9 @@ private:
   /*! @brief Cumulative distribution of the spectrum. */
   double _cumulative_distribution[FAUCHERGIGUEREPHOTONSOURCESPECTRUM_NUMFREQ];
 
+  /*! @brief GuideTable used to sample from the cumulative distribution. */
+  GuideTable _guide_table;
+
   /*! @brief Total ionizing flux of the spectrum (in m^-2 s^-1). */
   double _total_flux;
 
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file FirstTouchAllocator.hpp
+ *
+ * @brief Allocator that does not touch the memory of default constructed
+ * elements.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef FIRSTTOUCHALLOCATOR_HPP
+#define FIRSTTOUCHALLOCATOR_HPP
+
+#include <memory>
+
+/**
+ * @brief Allocator that does not touch the memory of default constructed
+ * elements.
+ *
+ * On NUMA systems, a memory page is physically placed on the NUMA node of the
+ * thread that first writes to it (first touch policy). A std::vector
+ * constructs all its elements when it is resized, so that all memory ends up
+ * on the node of the thread that resizes it.
+ *
+ * A std::vector that uses this allocator does not construct elements when it
+ * is resized without an explicit value: the memory is only allocated. The
+ * owner of the vector is then responsible for constructing every new element
+ * (using placement new), which can be done in parallel by the threads that
+ * will later use the elements. Elements that are added by copy (e.g. using
+ * push_back or resize with an explicit value) are constructed as usual.
+ */
+template < typename _datatype_ >
+class FirstTouchAllocator : public std::allocator< _datatype_ > {
+public:
+  /**
+   * @brief Rebind the allocator to another type.
+   */
+  template < typename _other_datatype_ > struct rebind {
+    /*! @brief Type of the rebound allocator. */
+    typedef FirstTouchAllocator< _other_datatype_ > other;
+  };
+
+  /**
+   * @brief Empty constructor.
+   */
+  inline FirstTouchAllocator() {}
+
+  /**
+   * @brief Copy constructor from an allocator for another type.
+   *
+   * @param allocator Allocator to copy.
+   */
+  template < typename _other_datatype_ >
+  inline FirstTouchAllocator(
+      const FirstTouchAllocator< _other_datatype_ > &allocator) {}
+
+  /**
+   * @brief Default construct an element: do nothing.
+   *
+   * @param pointer Pointer to the element.
+   */
+  template < typename _other_datatype_ >
+  inline void construct(_other_datatype_ *pointer) {}
+
+  /**
+   * @brief Construct an element from the given arguments.
+   *
+   * @param pointer Pointer to the element.
+   * @param arguments Constructor arguments.
+   */
+  template < typename _other_datatype_, typename... _arguments_ >
+  inline void construct(_other_datatype_ *pointer,
+                        _arguments_ &&... arguments) {
+    ::new (static_cast< void * >(pointer))
+        _other_datatype_(std::forward< _arguments_ >(arguments)...);
+  }
+};
+
+#endif // FIRSTTOUCHALLOCATOR_HPP
@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file GuideTable.hpp
+ *
+ * @brief Guide table that speeds up searches in an ordered array.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef GUIDETABLE_HPP
+#define GUIDETABLE_HPP
+
+#include "Error.hpp"
+#include "Utilities.hpp"
+
+#include <vector>
+
+/**
+ * @brief Guide table that speeds up searches in an ordered array.
+ *
+ * The range spanned by the array is divided into a number of equal size
+ * buckets, and for every bucket we store the index in the array that
+ * corresponds to the lower edge of the bucket. To locate a value, we look up
+ * its bucket and do a linear search starting from the stored index. If the
+ * number of buckets is comparable to the number of array elements, this search
+ * on average only takes a few steps, so that locate() effectively takes
+ * constant time, while Utilities::locate() needs a logarithmic number of steps.
+ *
+ * This is mainly useful for sampling from a tabulated cumulative distribution
+ * (inverse transform sampling), where the guide table replaces the binary
+ * search for the random number in the cumulative distribution.
+ *
+ * The guide table does not store the array itself, but only the bucket
+ * indices. The same array that was used to construct the table needs to be
+ * passed on to locate(). The result of locate() is always exactly the same as
+ * that of Utilities::locate().
+ */
+class GuideTable {
+private:
+  /*! @brief Lowest value in the array. */
+  double _minimum_value;
+
+  /*! @brief Inverse width of a single bucket. */
+  double _inverse_bucket_width;
+
+  /*! @brief Length of the array. */
+  unsigned int _length;
+
+  /*! @brief Array index corresponding to the lower edge of each bucket. */
+  std::vector< unsigned int > _guide;
+
+public:
+  /**
+   * @brief Empty constructor.
+   */
+  inline GuideTable()
+      : _minimum_value(0.), _inverse_bucket_width(0.), _length(0) {}
+
+  /**
+   * @brief Constructor.
+   *
+   * @param xarr Ordered array (should be monotonically increasing).
+   * @param length Length of the array (should be at least 2).
+   * @param size Number of buckets in the table (0 means we use the length of
+   * the array).
+   */
+  inline GuideTable(const double *xarr, unsigned int length,
+                    unsigned int size = 0) {
+    initialize(xarr, length, size);
+  }
+
+  /**
+   * @brief (Re)initialize the table for the given array.
+   *
+   * @param xarr Ordered array (should be monotonically increasing).
+   * @param length Length of the array (should be at least 2).
+   * @param size Number of buckets in the table (0 means we use the length of
+   * the array).
+   */
+  inline void initialize(const double *xarr, unsigned int length,
+                         unsigned int size = 0) {
+    if (length < 2) {
+      cmac_error("Cannot construct a GuideTable for an array with less than 2 "
+                 "elements!");
+    }
+    if (size == 0) {
+      size = length;
+    }
+
+    _length = length;
+    _minimum_value = xarr[0];
+    const double bucket_width = (xarr[length - 1] - xarr[0]) / size;
+    if (bucket_width > 0.) {
+      _inverse_bucket_width = 1. / bucket_width;
+    } else {
+      // degenerate array: a single bucket
+      _inverse_bucket_width = 0.;
+      size = 1;
+    }
+    _guide.resize(size);
+    for (unsigned int i = 0; i < size; ++i) {
+      _guide[i] =
+          Utilities::locate(_minimum_value + i * bucket_width, xarr, length);
+    }
+  }
+
+  /**
+   * @brief Locate the given value in the given array.
+   *
+   * @param x Value to locate.
+   * @param xarr Array in which to search (should be the array that was used to
+   * initialize the table).
+   * @return Index of the last element in the ordered array that is smaller than
+   * the given value, i.e. value is in between xarr[index] and xarr[index+1].
+   * Values outside the range of the array are mapped to the first or last
+   * interval, just as in Utilities::locate().
+   */
+  inline unsigned int locate(double x, const double *xarr) const {
+    cmac_assert(_length > 1);
+
+    const double u = (x - _minimum_value) * _inverse_bucket_width;
+    unsigned int i;
+    if (u > 0.) {
+      const unsigned int ibucket =
+          (u < _guide.size()) ? static_cast< unsigned int >(u)
+                              : _guide.size() - 1;
+      i = _guide[ibucket];
+    } else {
+      i = _guide[0];
+    }
+    // correct for the position of the value within the bucket (and for round
+    // off in the bucket index)
+    while (i > 0 && x <= xarr[i]) {
+      --i;
+    }
+    while (i < _length - 2 && x > xarr[i + 1]) {
+      ++i;
+    }
+    return i;
+  }
+};
+
+#endif // GUIDETABLE_HPP
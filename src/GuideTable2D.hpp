@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file GuideTable2D.hpp
+ *
+ * @brief Guide tables for sampling from a temperature dependent tabulated
+ * spectrum.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef GUIDETABLE2D_HPP
+#define GUIDETABLE2D_HPP
+
+#include "GuideTable.hpp"
+
+#include <vector>
+
+/**
+ * @brief Guide tables for sampling from a temperature dependent tabulated
+ * spectrum.
+ *
+ * The spectrum is given as a set of cumulative distributions, one for every
+ * temperature in a temperature table, on a common frequency grid. We store a
+ * GuideTable for the temperature table and for every cumulative distribution,
+ * so that a random frequency for an arbitrary temperature can be found using
+ * only constant time table lookups.
+ *
+ * Just as the tables themselves, the sampled frequency is linearly
+ * interpolated in temperature.
+ */
+class GuideTable2D {
+private:
+  /*! @brief Number of temperature values. */
+  unsigned int _number_of_temperatures;
+
+  /*! @brief Number of frequency values. */
+  unsigned int _number_of_frequencies;
+
+  /*! @brief GuideTable for the temperature table. */
+  GuideTable _temperature_guide;
+
+  /*! @brief GuideTable for the cumulative distribution at every
+   *  temperature. */
+  std::vector< GuideTable > _cumulative_distribution_guides;
+
+public:
+  /**
+   * @brief Empty constructor.
+   */
+  inline GuideTable2D()
+      : _number_of_temperatures(0), _number_of_frequencies(0) {}
+
+  /**
+   * @brief Constructor.
+   *
+   * @param temperatures Temperature table (should be monotonically increasing,
+   * in K).
+   * @param number_of_temperatures Number of temperature values.
+   * @param cumulative_distributions Cumulative distributions for all
+   * temperatures, stored contiguously, temperature by temperature.
+   * @param number_of_frequencies Number of frequency values.
+   */
+  inline GuideTable2D(const double *temperatures,
+                      unsigned int number_of_temperatures,
+                      const double *cumulative_distributions,
+                      unsigned int number_of_frequencies) {
+    initialize(temperatures, number_of_temperatures, cumulative_distributions,
+               number_of_frequencies);
+  }
+
+  /**
+   * @brief (Re)initialize the tables.
+   *
+   * @param temperatures Temperature table (should be monotonically increasing,
+   * in K).
+   * @param number_of_temperatures Number of temperature values.
+   * @param cumulative_distributions Cumulative distributions for all
+   * temperatures, stored contiguously, temperature by temperature.
+   * @param number_of_frequencies Number of frequency values.
+   */
+  inline void initialize(const double *temperatures,
+                         unsigned int number_of_temperatures,
+                         const double *cumulative_distributions,
+                         unsigned int number_of_frequencies) {
+    _number_of_temperatures = number_of_temperatures;
+    _number_of_frequencies = number_of_frequencies;
+    _temperature_guide.initialize(temperatures, number_of_temperatures);
+    _cumulative_distribution_guides.resize(number_of_temperatures);
+    for (unsigned int iT = 0; iT < number_of_temperatures; ++iT) {
+      _cumulative_distribution_guides[iT].initialize(
+          cumulative_distributions + iT * number_of_frequencies,
+          number_of_frequencies);
+    }
+  }
+
+  /**
+   * @brief Get the frequency corresponding to the given random number for the
+   * given temperature.
+   *
+   * We locate the given random number in the cumulative distributions of the
+   * two temperatures that bracket the given temperature, and linearly
+   * interpolate the corresponding frequencies in temperature.
+   *
+   * @param temperature Temperature (in K).
+   * @param x Uniform random number in the range [0, 1].
+   * @param temperatures Temperature table used to initialize the table (in K).
+   * @param frequencies Frequency table (in Hz).
+   * @param cumulative_distributions Cumulative distributions used to
+   * initialize the table.
+   * @return Random frequency (in Hz).
+   */
+  inline double sample(double temperature, double x,
+                       const double *temperatures, const double *frequencies,
+                       const double *cumulative_distributions) const {
+    cmac_assert(_number_of_temperatures > 1);
+
+    const unsigned int iT =
+        _temperature_guide.locate(temperature, temperatures);
+    const unsigned int inu1 = _cumulative_distribution_guides[iT].locate(
+        x, cumulative_distributions + iT * _number_of_frequencies);
+    const unsigned int inu2 = _cumulative_distribution_guides[iT + 1].locate(
+        x, cumulative_distributions + (iT + 1) * _number_of_frequencies);
+    return frequencies[inu1] +
+           (temperature - temperatures[iT]) *
+               (frequencies[inu2] - frequencies[inu1]) /
+               (temperatures[iT + 1] - temperatures[iT]);
+  }
+};
+
+#endif // GUIDETABLE2D_HPP
@@ -94,6 +94,11 @@ HeliumLymanContinuumSpectrum::HeliumLymanContinuumSpectrum(
                                   [HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ - 1];
     }
   }
+
+  // set up the guide tables used to sample from the cumulative distributions
+  _guide_table.initialize(_temperature, HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP,
+                          &_cumulative_distribution[0][0],
+                          HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ);
 }
 
 /**
@@ -105,18 +110,9 @@ HeliumLymanContinuumSpectrum::HeliumLymanContinuumSpectrum(
  */
 double HeliumLymanContinuumSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
-  unsigned int iT = Utilities::locate(temperature, _temperature,
-                                      HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP);
   double x = random_generator.get_uniform_random_double();
-  unsigned int inu1 = Utilities::locate(x, _cumulative_distribution[iT],
-                                        HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  unsigned int inu2 = Utilities::locate(x, _cumulative_distribution[iT + 1],
-                                        HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  double frequency = _frequency[inu1] +
-                     (temperature - _temperature[iT]) *
-                         (_frequency[inu2] - _frequency[inu1]) /
-                         (_temperature[iT + 1] - _temperature[iT]);
-  return frequency;
+  return _guide_table.sample(temperature, x, _temperature, _frequency,
+                             &_cumulative_distribution[0][0]);
 }
 
 /**
@@ -26,6 +26,7 @@
 #ifndef HELIUMLYMANCONTINUUMSPECTRUM_HPP
 #define HELIUMLYMANCONTINUUMSPECTRUM_HPP
 
+#include "GuideTable2D.hpp"
 #include "PhotonSourceSpectrum.hpp"
 #include "RandomGenerator.hpp"
 
@@ -52,6 +53,10 @@ private:
   double _cumulative_distribution[HELIUMLYMANCONTINUUMSPECTRUM_NUMTEMP]
                                  [HELIUMLYMANCONTINUUMSPECTRUM_NUMFREQ];
 
+  /*! @brief Guide tables used to sample from the cumulative distribution
+   *  functions. */
+  GuideTable2D _guide_table;
+
 public:
   HeliumLymanContinuumSpectrum(CrossSections &cross_sections);
 
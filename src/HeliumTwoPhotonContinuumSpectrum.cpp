@@ -82,6 +82,10 @@ HeliumTwoPhotonContinuumSpectrum::HeliumTwoPhotonContinuumSpectrum() {
     _cumulative_distribution[i] /=
         _cumulative_distribution[HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ - 1];
   }
+
+  // set up the guide table used to sample from the cumulative distribution
+  _guide_table.initialize(_cumulative_distribution,
+                          HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ);
 }
 
 /**
@@ -137,8 +141,7 @@ HeliumTwoPhotonContinuumSpectrum::get_integral(std::vector< double > &yHe2q,
 double HeliumTwoPhotonContinuumSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
   double x = random_generator.get_uniform_random_double();
-  unsigned int inu = Utilities::locate(
-      x, _cumulative_distribution, HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ);
+  unsigned int inu = _guide_table.locate(x, _cumulative_distribution);
   double frequency =
       _frequency[inu] +
       (_frequency[inu + 1] - _frequency[inu]) *
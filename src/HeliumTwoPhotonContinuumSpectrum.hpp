@@ -26,6 +26,7 @@
 #ifndef HELIUMTWOPHOTONCONTINUUMSPECTRUM_HPP
 #define HELIUMTWOPHOTONCONTINUUMSPECTRUM_HPP
 
+#include "GuideTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 #include "RandomGenerator.hpp"
 #include <vector>
@@ -44,6 +45,9 @@ private:
   /*! @brief Cumulative distribution function. */
   double _cumulative_distribution[HELIUMTWOPHOTONCONTINUUMSPECTRUM_NUMFREQ];
 
+  /*! @brief GuideTable used to sample from the cumulative distribution. */
+  GuideTable _guide_table;
+
 public:
   HeliumTwoPhotonContinuumSpectrum();
 
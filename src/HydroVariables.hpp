@@ -71,6 +71,29 @@ public:
    */
   inline double &primitives(unsigned char index) { return _primitives[index]; }
 
+  /**
+   * @brief Pack the primitive variables into the given array, e.g. for MPI
+   * communication.
+   *
+   * @param values Array with 5 elements to fill.
+   */
+  inline void get_primitives(double *values) const {
+    for (unsigned char i = 0; i < 5; ++i) {
+      values[i] = _primitives[i];
+    }
+  }
+
+  /**
+   * @brief Unpack the primitive variables from the given array.
+   *
+   * @param values Array with 5 elements, as filled by get_primitives().
+   */
+  inline void set_primitives(const double *values) {
+    for (unsigned char i = 0; i < 5; ++i) {
+      _primitives[i] = values[i];
+    }
+  }
+
   /**
    * @brief Get the fluid density.
    *
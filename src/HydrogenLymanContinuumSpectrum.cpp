@@ -95,6 +95,11 @@ HydrogenLymanContinuumSpectrum::HydrogenLymanContinuumSpectrum(
                                   [HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ - 1];
     }
   }
+
+  // set up the guide tables used to sample from the cumulative distributions
+  _guide_table.initialize(_temperature, HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP,
+                          &_cumulative_distribution[0][0],
+                          HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ);
 }
 
 /**
@@ -106,18 +111,9 @@ HydrogenLymanContinuumSpectrum::HydrogenLymanContinuumSpectrum(
  */
 double HydrogenLymanContinuumSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
-  unsigned int iT = Utilities::locate(temperature, _temperature,
-                                      HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP);
   double x = random_generator.get_uniform_random_double();
-  unsigned int inu1 = Utilities::locate(x, _cumulative_distribution[iT],
-                                        HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  unsigned int inu2 = Utilities::locate(x, _cumulative_distribution[iT + 1],
-                                        HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ);
-  double frequency = _frequency[inu1] +
-                     (temperature - _temperature[iT]) *
-                         (_frequency[inu2] - _frequency[inu1]) /
-                         (_temperature[iT + 1] - _temperature[iT]);
-  return frequency;
+  return _guide_table.sample(temperature, x, _temperature, _frequency,
+                             &_cumulative_distribution[0][0]);
 }
 
 /**
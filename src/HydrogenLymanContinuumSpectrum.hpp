@@ -27,6 +27,7 @@
 #ifndef HYDROGENLYMANCONTINUUMSPECTRUM_HPP
 #define HYDROGENLYMANCONTINUUMSPECTRUM_HPP
 
+#include "GuideTable2D.hpp"
 #include "PhotonSourceSpectrum.hpp"
 #include "RandomGenerator.hpp"
 
@@ -53,6 +54,10 @@ private:
   double _cumulative_distribution[HYDROGENLYMANCONTINUUMSPECTRUM_NUMTEMP]
                                  [HYDROGENLYMANCONTINUUMSPECTRUM_NUMFREQ];
 
+  /*! @brief Guide tables used to sample from the cumulative distribution
+   *  functions. */
+  GuideTable2D _guide_table;
+
 public:
   HydrogenLymanContinuumSpectrum(CrossSections &cross_sections);
 
@@ -44,14 +44,18 @@
  * calculation.
  * @param charge_transfer_rates ChargeTransferRate used in ionization balance
  * calculation for coolants.
+ * @param dirty_cell_threshold Relative change in the hydrogen mean intensity
+ * below which the ionization state of a cell is not recomputed by the grid
+ * version of calculate_ionization_state() (0 to always recompute).
  */
 IonizationStateCalculator::IonizationStateCalculator(
     double luminosity, Abundances &abundances,
     RecombinationRates &recombination_rates,
-    ChargeTransferRates &charge_transfer_rates)
+    ChargeTransferRates &charge_transfer_rates, double dirty_cell_threshold)
     : _luminosity(luminosity), _abundances(abundances),
       _recombination_rates(recombination_rates),
-      _charge_transfer_rates(charge_transfer_rates) {}
+      _charge_transfer_rates(charge_transfer_rates),
+      _dirty_cell_threshold(dirty_cell_threshold) {}
 
 /**
  * @brief Does the ionization state calculation for a single cell.
@@ -91,19 +95,15 @@ void IonizationStateCalculator::calculate_ionization_state(
     // coolants
     const double ne =
         ntot * (1. - h0 + _abundances.get_abundance(ELEMENT_He) * (1. - he0));
-    const double T4 = T * 1.e-4;
     const double nhp = ntot * (1. - h0);
 
     // carbon
     const double C21 = jfac *
                        ionization_variables.get_mean_intensity(ION_C_p1) / ne /
                        _recombination_rates.get_recombination_rate(ION_C_p1, T);
-    // as can be seen below, CTHerecom has the same units as a recombination
-    // rate: m^3s^-1
-    // in Kenny's code, recombination rates are in cm^3s^-1
-    // to put them in m^3s^-1 as well, we hence need to multiply Kenny's
-    // original factor 1.e-9 with 1.e-6
-    double CTHerecom = 1.e-15 * 0.046 * T4 * T4;
+    double CTHerecom =
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(4, 6,
+                                                                         T);
     const double C32 =
         jfac * ionization_variables.get_mean_intensity(ION_C_p2) /
         (ne * _recombination_rates.get_recombination_rate(ION_C_p2, T) +
@@ -126,9 +126,9 @@ void IonizationStateCalculator::calculate_ionization_state(
          ntot * h0 *
              _charge_transfer_rates.get_charge_transfer_recombination_rate(2, 7,
                                                                            T));
-    // multiplied Kenny's value with 1.e-6
     CTHerecom =
-        1.e-15 * 0.33 * std::pow(T4, 0.29) * (1. + 1.3 * std::exp(-4.5 / T4));
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(3, 7,
+                                                                         T);
     const double N32 =
         jfac * ionization_variables.get_mean_intensity(ION_N_p1) /
         (ne * _recombination_rates.get_recombination_rate(ION_N_p1, T) +
@@ -136,8 +136,9 @@ void IonizationStateCalculator::calculate_ionization_state(
              _charge_transfer_rates.get_charge_transfer_recombination_rate(3, 7,
                                                                            T) +
          ntot * he0 * _abundances.get_abundance(ELEMENT_He) * CTHerecom);
-    // multiplied Kenny's value with 1.e-6
-    CTHerecom = 1.e-15 * 0.15;
+    CTHerecom =
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(4, 7,
+                                                                         T);
     const double N43 =
         jfac * ionization_variables.get_mean_intensity(ION_N_p2) /
         (ne * _recombination_rates.get_recombination_rate(ION_N_p2, T) +
@@ -159,8 +160,9 @@ void IonizationStateCalculator::calculate_ionization_state(
          ntot * h0 *
              _charge_transfer_rates.get_charge_transfer_recombination_rate(
                  3, 16, T));
-    // multiplied Kenny's value with 1.e-6
-    CTHerecom = 1.e-15 * 1.1 * std::pow(T4, 0.56);
+    CTHerecom =
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(4, 16,
+                                                                         T);
     const double S32 =
         jfac * ionization_variables.get_mean_intensity(ION_S_p2) /
         (ne * _recombination_rates.get_recombination_rate(ION_S_p2, T) +
@@ -168,9 +170,9 @@ void IonizationStateCalculator::calculate_ionization_state(
              _charge_transfer_rates.get_charge_transfer_recombination_rate(
                  4, 16, T) +
          ntot * he0 * _abundances.get_abundance(ELEMENT_He) * CTHerecom);
-    // multiplied Kenny's value with 1.e-6
-    CTHerecom = 1.e-15 * 7.6e-4 * std::pow(T4, 0.32) *
-                (1. + 3.4 * std::exp(-5.25 * T4));
+    CTHerecom =
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(5, 16,
+                                                                         T);
     const double S43 =
         jfac * ionization_variables.get_mean_intensity(ION_S_p3) /
         (ne * _recombination_rates.get_recombination_rate(ION_S_p3, T) +
@@ -189,8 +191,9 @@ void IonizationStateCalculator::calculate_ionization_state(
     const double Ne21 =
         jfac * ionization_variables.get_mean_intensity(ION_Ne_n) /
         (ne * _recombination_rates.get_recombination_rate(ION_Ne_n, T));
-    // multiplied Kenny's value with 1.e-6
-    CTHerecom = 1.e-15 * 1.e-5;
+    CTHerecom =
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(3, 10,
+                                                                         T);
     const double Ne32 =
         jfac * ionization_variables.get_mean_intensity(ION_Ne_p1) /
         (ne * _recombination_rates.get_recombination_rate(ION_Ne_p1, T) +
@@ -213,8 +216,9 @@ void IonizationStateCalculator::calculate_ionization_state(
          ntot * h0 *
              _charge_transfer_rates.get_charge_transfer_recombination_rate(2, 8,
                                                                            T));
-    // multiplied Kenny's value with 1.e-6
-    CTHerecom = 0.2e-15 * std::pow(T4, 0.95);
+    CTHerecom =
+        _charge_transfer_rates.get_charge_transfer_recombination_rate_He(3, 8,
+                                                                         T);
     const double O32 =
         jfac * ionization_variables.get_mean_intensity(ION_O_p1) /
         (ne * _recombination_rates.get_recombination_rate(ION_O_p1, T) +
@@ -268,11 +272,14 @@ void IonizationStateCalculator::calculate_ionization_state(
  * @brief Solves the ionization and temperature equations based on the values of
  * the mean intensity integrals in each cell.
  *
+ * Only dirty cells are updated (see is_dirty()).
+ *
  * @param totweight Total weight off all photons used.
  * @param grid DensityGrid for which the calculation is done.
  * @param block Block that should be traversed by the local MPI process.
+ * @return Number of cells for which the ionization state was recomputed.
  */
-void IonizationStateCalculator::calculate_ionization_state(
+unsigned long IonizationStateCalculator::calculate_ionization_state(
     double totweight, DensityGrid &grid,
     std::pair< unsigned long, unsigned long > &block) const {
   // Kenny's jfac contains a lot of unit conversion factors. These drop out
@@ -286,6 +293,7 @@ void IonizationStateCalculator::calculate_ionization_state(
   DensityGridTraversalJobMarket< IonizationStateCalculatorFunction > jobs(
       grid, do_calculation, block);
   workers.do_in_parallel(jobs);
+  return do_calculation.get_number_of_updated_cells();
 }
 
 /**
@@ -27,8 +27,11 @@
 #ifndef IONIZATIONSTATECALCULATOR_HPP
 #define IONIZATIONSTATECALCULATOR_HPP
 
+#include "Atomic.hpp"
 #include "DensityGrid.hpp"
 
+#include <cmath>
+
 class Abundances;
 class ChargeTransferRates;
 class RecombinationRates;
@@ -52,10 +55,41 @@ private:
    *  calculation for coolants. */
   ChargeTransferRates &_charge_transfer_rates;
 
+  /*! @brief Relative change in the hydrogen mean intensity below which the
+   *  ionization state of a cell is not recomputed (0 to always recompute). */
+  double _dirty_cell_threshold;
+
 public:
   IonizationStateCalculator(double luminosity, Abundances &abundances,
                             RecombinationRates &recombination_rates,
-                            ChargeTransferRates &charge_transfer_rates);
+                            ChargeTransferRates &charge_transfer_rates,
+                            double dirty_cell_threshold = 0.);
+
+  /**
+   * @brief Check if the state of the given cell needs to be recomputed, given
+   * its current normalized hydrogen mean intensity.
+   *
+   * A cell is dirty if its hydrogen mean intensity changed by more than the
+   * given relative threshold since the last time its state was computed, or if
+   * it has no reference mean intensity (e.g. because it is new or because the
+   * reference values were reset). If the cell is dirty, the given mean
+   * intensity becomes the new reference value for the cell.
+   *
+   * @param jH Normalized hydrogen mean intensity of the cell (in s^-1).
+   * @param threshold Relative change threshold (0 to always recompute).
+   * @param cell DensityGrid::iterator pointing to the cell.
+   * @return True if the state of the cell needs to be recomputed.
+   */
+  inline static bool is_dirty(double jH, double threshold,
+                              DensityGrid::iterator &cell) {
+    const double jH_old = cell.get_mean_intensity_H_old();
+    if (threshold > 0. && jH_old > 0. &&
+        std::abs(jH - jH_old) <= threshold * jH_old) {
+      return false;
+    }
+    cell.set_mean_intensity_H_old(jH);
+    return true;
+  }
 
   void calculate_ionization_state(double jfac,
                                   DensityGrid::iterator &cell) const;
@@ -78,6 +112,10 @@ public:
      */
     double _jfac;
 
+    /*! @brief Number of cells for which the ionization state was recomputed.
+     */
+    unsigned long _number_of_updated_cells;
+
   public:
     /**
      * @brief Constructor.
@@ -89,19 +127,36 @@ public:
      */
     IonizationStateCalculatorFunction(
         const IonizationStateCalculator &calculator, double jfac)
-        : _calculator(calculator), _jfac(jfac) {}
+        : _calculator(calculator), _jfac(jfac), _number_of_updated_cells(0) {}
+
+    /**
+     * @brief Get the number of cells for which the ionization state was
+     * recomputed.
+     *
+     * @return Number of updated cells.
+     */
+    inline unsigned long get_number_of_updated_cells() const {
+      return _number_of_updated_cells;
+    }
 
     /**
-     * @brief Do the ionization state calculation for a single cell.
+     * @brief Do the ionization state calculation for a single cell, if the
+     * cell is dirty.
      *
      * @param cell DensityGrid::iterator pointing to a single cell in the grid.
      */
     inline void operator()(DensityGrid::iterator &cell) {
-      _calculator.calculate_ionization_state(_jfac / cell.get_volume(), cell);
+      const double jfac = _jfac / cell.get_volume();
+      const double jH =
+          jfac * cell.get_ionization_variables().get_mean_intensity(ION_H_n);
+      if (is_dirty(jH, _calculator._dirty_cell_threshold, cell)) {
+        _calculator.calculate_ionization_state(jfac, cell);
+        Atomic::add(_number_of_updated_cells, 1ul);
+      }
     }
   };
 
-  void calculate_ionization_state(
+  unsigned long calculate_ionization_state(
       double totweight, DensityGrid &grid,
       std::pair< unsigned long, unsigned long > &block) const;
 };
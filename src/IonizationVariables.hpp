@@ -66,6 +66,20 @@ enum HeatingTermName {
   NUMBER_OF_HEATINGTERMS
 };
 
+/*! @brief Number of values that make up the radiation field of a cell: one mean
+ *  intensity integral per ion, followed by the heating terms. */
+#define IONIZATIONVARIABLES_NUMRADIATIONFIELDVALUE                             \
+  (NUMBER_OF_IONNAMES + NUMBER_OF_HEATINGTERMS)
+
+/*! @brief Number of values that make up the ionization state of a cell: one
+ *  ionic fraction per ion, followed by the temperature. */
+#define IONIZATIONVARIABLES_NUMSTATEVALUE (NUMBER_OF_IONNAMES + 1)
+
+/*! @brief Number of values that make up the full state of a cell: the
+ *  ionization state, followed by the number density. */
+#define IONIZATIONVARIABLES_NUMFULLSTATEVALUE                                  \
+  (IONIZATIONVARIABLES_NUMSTATEVALUE + 1)
+
 /**
  * @brief Variables used in the ionization calculation.
  */
@@ -256,6 +270,87 @@ public:
     _heating[name] += increment;
 #endif
   }
+
+  /**
+   * @brief Pack the radiation field (mean intensity integrals and heating
+   * terms) into the given array, e.g. for MPI communication.
+   *
+   * @param values Array with IONIZATIONVARIABLES_NUMRADIATIONFIELDVALUE
+   * elements to fill.
+   */
+  inline void get_radiation_field(double *values) const {
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      values[i] = _mean_intensity[i];
+    }
+    for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+      values[NUMBER_OF_IONNAMES + i] = _heating[i];
+    }
+  }
+
+  /**
+   * @brief Unpack the radiation field from the given array.
+   *
+   * @param values Array with IONIZATIONVARIABLES_NUMRADIATIONFIELDVALUE
+   * elements, as filled by get_radiation_field().
+   */
+  inline void set_radiation_field(const double *values) {
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      _mean_intensity[i] = values[i];
+    }
+    for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+      _heating[i] = values[NUMBER_OF_IONNAMES + i];
+    }
+  }
+
+  /**
+   * @brief Pack the ionization state (ionic fractions and temperature) into
+   * the given array, e.g. for MPI communication.
+   *
+   * @param values Array with IONIZATIONVARIABLES_NUMSTATEVALUE elements to
+   * fill.
+   */
+  inline void get_state(double *values) const {
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      values[i] = _ionic_fractions[i];
+    }
+    values[NUMBER_OF_IONNAMES] = _temperature;
+  }
+
+  /**
+   * @brief Unpack the ionization state from the given array.
+   *
+   * @param values Array with IONIZATIONVARIABLES_NUMSTATEVALUE elements, as
+   * filled by get_state().
+   */
+  inline void set_state(const double *values) {
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      _ionic_fractions[i] = values[i];
+    }
+    _temperature = values[NUMBER_OF_IONNAMES];
+  }
+
+  /**
+   * @brief Pack the full state (ionic fractions, temperature and number
+   * density) into the given array, e.g. for MPI communication.
+   *
+   * @param values Array with IONIZATIONVARIABLES_NUMFULLSTATEVALUE elements to
+   * fill.
+   */
+  inline void get_full_state(double *values) const {
+    get_state(values);
+    values[IONIZATIONVARIABLES_NUMSTATEVALUE] = _number_density;
+  }
+
+  /**
+   * @brief Unpack the full state from the given array.
+   *
+   * @param values Array with IONIZATIONVARIABLES_NUMFULLSTATEVALUE elements, as
+   * filled by get_full_state().
+   */
+  inline void set_full_state(const double *values) {
+    set_state(values);
+    _number_density = values[IONIZATIONVARIABLES_NUMSTATEVALUE];
+  }
 };
 
 #endif // IONIZATIONVARIABLES_HPP
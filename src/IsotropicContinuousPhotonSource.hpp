@@ -34,7 +34,7 @@
 #include "ParameterFile.hpp"
 #include "RandomGenerator.hpp"
 
-#include <cfloat>
+#include <cmath>
 #include <limits>
 
 /**
@@ -85,96 +85,74 @@ public:
   /**
    * @brief Get the entrance position and direction of a random external photon.
    *
+   * For an isotropic radiation field, the number of photons that cross a
+   * surface element is the same everywhere on the surface of the box, and is
+   * proportional to the cosine of the angle between the photon direction and
+   * the surface normal. We hence directly sample a face with a probability
+   * proportional to its area, a uniform position on that face, and a cosine
+   * weighted inward direction w.r.t. the face normal.
+   *
    * @param random_generator RandomGenerator to use.
    * @return std::pair of CoordinateVector instances, specifying a starting
    * position and direction for an incoming photon.
    */
   std::pair< CoordinateVector<>, CoordinateVector<> >
   get_random_incoming_direction(RandomGenerator &random_generator) const {
-    // we randomly sample a focus point in the box
-    CoordinateVector<> focus;
-    focus[0] =
-        _box.get_anchor().x() +
-        _box.get_sides().x() * random_generator.get_uniform_random_double();
-    focus[1] =
-        _box.get_anchor().y() +
-        _box.get_sides().y() * random_generator.get_uniform_random_double();
-    focus[2] =
-        _box.get_anchor().z() +
-        _box.get_sides().z() * random_generator.get_uniform_random_double();
-
-    // random incoming direction for the focus point
-    double cost = 2. * random_generator.get_uniform_random_double() - 1.;
-    double sint = 1. - cost * cost;
-    sint = std::sqrt(std::max(sint, 0.));
-    double phi = 2. * M_PI * random_generator.get_uniform_random_double();
-    double cosp = std::cos(phi);
-    double sinp = std::sin(phi);
-    CoordinateVector<> direction(sint * cosp, sint * sinp, cost);
-
-    // the direction and the focus point define a line:
-    //   line = focus + t * direction.
-    // with t a parameter.
-    // find the intersection points of this line with the walls of the box
-    // the origin of the random photon is the intersection point with negative
-    // t value
-    CoordinateVector<> anchor_bottom = _box.get_anchor();
-    CoordinateVector<> anchor_top = _box.get_top_anchor();
-
-    // the box has 6 faces, each of which has an intersection point with the
-    // line. If the focus point is inside the box (which it should be), then
-    // 3 intersection points will have a negative parameter value, and 3 will
-    // have a positive value
-    // we record all 3 negative values, and then pick the one with the largest
-    // parameter value (smallest absolute value), since this intersection point
-    // is the closest
-    double lx, ly, lz;
-    if (direction.x() < 0.) {
-      lx = (anchor_top.x() - focus.x()) / direction.x();
-    } else if (direction.x() > 0.) {
-      lx = (anchor_bottom.x() - focus.x()) / direction.x();
-    } else {
-      // the line is parallel to the x faces
-      // make sure this intersection point has the largest absolute parameter
-      // value
-      lx = -DBL_MAX;
-    }
 
-    if (direction.y() < 0.) {
-      ly = (anchor_top.y() - focus.y()) / direction.y();
-    } else if (direction.y() > 0.) {
-      ly = (anchor_bottom.y() - focus.y()) / direction.y();
-    } else {
-      ly = -DBL_MAX;
+    const CoordinateVector<> &anchor = _box.get_anchor();
+    const CoordinateVector<> &sides = _box.get_sides();
+
+    // pick a face: there are two faces perpendicular to each coordinate
+    // direction, and their area is the product of the other two sides
+    const double face_area[3] = {sides.y() * sides.z(), sides.x() * sides.z(),
+                                 sides.x() * sides.y()};
+    double x = 0.5 * get_total_surface_area() *
+               random_generator.get_uniform_random_double();
+    unsigned int iface = 0;
+    while (iface < 2 && x >= face_area[iface]) {
+      x -= face_area[iface];
+      ++iface;
     }
-
-    if (direction.z() < 0.) {
-      lz = (anchor_top.z() - focus.z()) / direction.z();
-    } else if (direction.z() > 0.) {
-      lz = (anchor_bottom.z() - focus.z()) / direction.z();
-    } else {
-      lz = -DBL_MAX;
+    const bool top = (random_generator.get_uniform_random_double() >= 0.5);
+    const unsigned int j1 = (iface + 1) % 3;
+    const unsigned int j2 = (iface + 2) % 3;
+
+    // uniform position on the face
+    CoordinateVector<> position;
+    position[iface] = anchor[iface];
+    if (top) {
+      position[iface] += sides[iface];
     }
-
-    double maxl = std::max(lx, ly);
-    maxl = std::max(maxl, lz);
-
-    CoordinateVector<> position = focus + maxl * direction;
+    position[j1] =
+        anchor[j1] + sides[j1] * random_generator.get_uniform_random_double();
+    position[j2] =
+        anchor[j2] + sides[j2] * random_generator.get_uniform_random_double();
+
+    // cosine weighted direction: the cosine of the angle with the inward
+    // normal is the square root of a uniform random number
+    const double cost =
+        std::sqrt(random_generator.get_uniform_random_double());
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    const double phi = 2. * M_PI * random_generator.get_uniform_random_double();
+    CoordinateVector<> direction;
+    direction[iface] = top ? -cost : cost;
+    direction[j1] = sint * std::cos(phi);
+    direction[j2] = sint * std::sin(phi);
 
     // make sure the photon is inside the box
+    // we cannot simply take the top anchor of the box as upper limit, since
+    // the top anchor itself strictly speaking lies outside the box (lower
+    // limits are inclusive, upper limits exclusive due to the way we
+    // calculate grid indices)
+    // we therefore take the closest value that is still in the box
+    // epsilon is the difference between 1.0 and the next floating point value
+    // larger than 1.0 that can be represented as a 64-bit floating point.
+    const CoordinateVector<> anchor_top = _box.get_top_anchor();
     for (unsigned int i = 0; i < 3; ++i) {
-      // we cannot simply take the top anchor of the box as upper limit, since
-      // the top anchor itself strictly speaking lies outside the box (lower
-      // limits are inclusive, upper limits exclusive due to the way we
-      // calculate grid indices)
-      // we therefore take the closest value that is still in the box
-      // epsilon is the difference between 1.0 and the next floating point value
-      // larger than 1.0 that can be represented as a 64-bit floating point.
       position[i] =
           std::min(position[i], anchor_top[i] -
                                     std::numeric_limits< double >::epsilon() *
-                                        _box.get_sides()[i]);
-      position[i] = std::max(position[i], anchor_bottom[i]);
+                                        sides[i]);
     }
 
     return std::make_pair(position, direction);
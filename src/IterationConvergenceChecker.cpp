@@ -0,0 +1,214 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file IterationConvergenceChecker.cpp
+ *
+ * @brief IterationConvergenceChecker implementation.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "IterationConvergenceChecker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Constructor.
+ *
+ * @param tolerance Relative change below which the iterations are considered
+ * to be converged.
+ * @param stagnation_ratio Maximum ratio of the change during the current
+ * iteration and the change during the previous iteration for which the
+ * iterations are still considered to be converging.
+ * @param photon_number_increase_factor Factor by which the number of photons
+ * is increased if the change is dominated by Monte Carlo noise.
+ * @param maximum_number_of_photons Maximum number of photons.
+ * @param log Log to write logging info to.
+ */
+IterationConvergenceChecker::IterationConvergenceChecker(
+    double tolerance, double stagnation_ratio,
+    double photon_number_increase_factor,
+    unsigned int maximum_number_of_photons, Log *log)
+    : _tolerance(tolerance), _stagnation_ratio(stagnation_ratio),
+      _photon_number_increase_factor(photon_number_increase_factor),
+      _maximum_number_of_photons(maximum_number_of_photons),
+      _previous_change(-1.), _log(log) {
+
+  if (_photon_number_increase_factor < 1.) {
+    cmac_error("The photon number increase factor should be at least 1 (got "
+               "%g)!",
+               _photon_number_increase_factor);
+  }
+
+  if (_log) {
+    _log->write_status("Constructed IterationConvergenceChecker with "
+                       "tolerance ",
+                       _tolerance, ", stagnation ratio ", _stagnation_ratio,
+                       ", photon number increase factor ",
+                       _photon_number_increase_factor,
+                       " and maximum number of photons ",
+                       _maximum_number_of_photons, ".");
+  }
+}
+
+/**
+ * @brief ParameterFile constructor.
+ *
+ * @param params ParameterFile to read from.
+ * @param number_of_photons Number of photons used during a single iteration
+ * (the default maximum number of photons is 100 times this value).
+ * @param log Log to write logging info to.
+ */
+IterationConvergenceChecker::IterationConvergenceChecker(
+    ParameterFile &params, unsigned int number_of_photons, Log *log)
+    : IterationConvergenceChecker(
+          params.get_value< double >("iterationconvergencechecker:tolerance",
+                                     0.01),
+          params.get_value< double >(
+              "iterationconvergencechecker:stagnation_ratio", 0.8),
+          params.get_value< double >(
+              "iterationconvergencechecker:photon_number_increase_factor", 2.),
+          params.get_value< unsigned int >(
+              "iterationconvergencechecker:maximum_number_of_photons",
+              std::min(100. * number_of_photons,
+                       double(std::numeric_limits< unsigned int >::max()))),
+          log) {}
+
+/**
+ * @brief Forget about the change during the previous iteration.
+ *
+ * This routine should be called before the first iteration of a new series of
+ * iterations (e.g. after a hydro step).
+ */
+void IterationConvergenceChecker::reset() { _previous_change = -1.; }
+
+/**
+ * @brief Store the current neutral fraction of hydrogen and the temperature of
+ * all cells in the given block, so that they can be compared with the values
+ * after the next iteration.
+ *
+ * @param grid DensityGrid to operate on.
+ * @param block Block that should be traversed by the local MPI process.
+ */
+void IterationConvergenceChecker::store_old_values(
+    DensityGrid &grid, std::pair< unsigned long, unsigned long > &block) const {
+  const std::pair< DensityGrid::iterator, DensityGrid::iterator > chunk =
+      grid.get_chunk(block.first, block.second);
+  for (DensityGrid::iterator it = chunk.first; it != chunk.second; ++it) {
+    const IonizationVariables &ionization_variables =
+        it.get_ionization_variables();
+    it.set_neutral_fraction_H_old(
+        ionization_variables.get_ionic_fraction(ION_H_n));
+    it.set_temperature_old(ionization_variables.get_temperature());
+  }
+}
+
+/**
+ * @brief Compute the partial sums that are needed to get the change in the
+ * neutral fraction of hydrogen and the temperature of all cells in the given
+ * block.
+ *
+ * The partial sums of different MPI processes can be combined before calling
+ * is_converged().
+ *
+ * @param grid DensityGrid to operate on.
+ * @param block Block that should be traversed by the local MPI process.
+ * @param changes Array of ITERATIONCONVERGENCECHECKER_NUMSUM partial sums to
+ * fill.
+ */
+void IterationConvergenceChecker::compute_changes(
+    DensityGrid &grid, std::pair< unsigned long, unsigned long > &block,
+    ReproducibleSum *changes) const {
+  for (int i = 0; i < ITERATIONCONVERGENCECHECKER_NUMSUM; ++i) {
+    changes[i] = ReproducibleSum();
+  }
+  const std::pair< DensityGrid::iterator, DensityGrid::iterator > chunk =
+      grid.get_chunk(block.first, block.second);
+  for (DensityGrid::iterator it = chunk.first; it != chunk.second; ++it) {
+    const IonizationVariables &ionization_variables =
+        it.get_ionization_variables();
+    const double xH = ionization_variables.get_ionic_fraction(ION_H_n);
+    const double xH_old = it.get_neutral_fraction_H_old();
+    if (xH + xH_old > 0.) {
+      changes[0] += 2. * std::abs(xH - xH_old) / (xH + xH_old);
+      changes[1] += 1.;
+    }
+    const double T = ionization_variables.get_temperature();
+    const double T_old = it.get_temperature_old();
+    if (T + T_old > 0.) {
+      changes[2] += 2. * std::abs(T - T_old) / (T + T_old);
+      changes[3] += 1.;
+    }
+  }
+}
+
+/**
+ * @brief Check if the iterations have converged, based on the given partial
+ * sums, and increase the number of photons if the change is dominated by Monte
+ * Carlo noise.
+ *
+ * @param changes Partial sums computed by compute_changes() (and summed over
+ * all MPI processes).
+ * @param number_of_photons Number of photons used during the last iteration.
+ * This value is increased if more photons are needed during the next iteration.
+ * @return True if the iterations have converged.
+ */
+bool IterationConvergenceChecker::is_converged(
+    const ReproducibleSum *changes, unsigned int &number_of_photons) {
+
+  double change_xH = 0.;
+  if (changes[1].get_value() > 0.) {
+    change_xH = changes[0].get_value() / changes[1].get_value();
+  }
+  double change_T = 0.;
+  if (changes[3].get_value() > 0.) {
+    change_T = changes[2].get_value() / changes[3].get_value();
+  }
+  const double change = std::max(change_xH, change_T);
+
+  if (_log) {
+    _log->write_status("Average relative change in the neutral fraction of "
+                       "hydrogen: ",
+                       change_xH, ", in the temperature: ", change_T,
+                       " (tolerance: ", _tolerance, ").");
+  }
+
+  if (change < _tolerance) {
+    return true;
+  }
+
+  if (_previous_change >= 0. && change > _stagnation_ratio * _previous_change &&
+      number_of_photons < _maximum_number_of_photons) {
+    // the change no longer decreases: it is dominated by Monte Carlo noise
+    const double new_number_of_photons =
+        std::min(double(_maximum_number_of_photons),
+                 std::ceil(_photon_number_increase_factor * number_of_photons));
+    if (_log) {
+      _log->write_status("Change is dominated by Monte Carlo noise, increasing "
+                         "the number of photons from ",
+                         number_of_photons, " to ", new_number_of_photons,
+                         ".");
+    }
+    number_of_photons = new_number_of_photons;
+  }
+
+  _previous_change = change;
+  return false;
+}
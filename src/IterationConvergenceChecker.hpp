@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file IterationConvergenceChecker.hpp
+ *
+ * @brief Convergence monitor for the photon propagation iterations.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef ITERATIONCONVERGENCECHECKER_HPP
+#define ITERATIONCONVERGENCECHECKER_HPP
+
+#include "DensityGrid.hpp"
+#include "Log.hpp"
+#include "ParameterFile.hpp"
+#include "ReproducibleSum.hpp"
+
+/*! @brief Number of partial sums used to compute the change between two
+ *  iterations: the sum of the relative changes in the neutral fraction of
+ *  hydrogen and the number of cells that contribute to it, followed by the same
+ *  values for the temperature. */
+#define ITERATIONCONVERGENCECHECKER_NUMSUM 4
+
+/**
+ * @brief Convergence monitor for the photon propagation iterations.
+ *
+ * After every iteration, we compute the average relative change in the neutral
+ * fraction of hydrogen and the temperature of all cells w.r.t. the values
+ * during the previous iteration. If the largest of these changes is below a
+ * given tolerance, the iterations have converged.
+ *
+ * If the change does not decrease significantly between two successive
+ * iterations, the remaining change is dominated by Monte Carlo noise rather
+ * than by the convergence of the solution, and doing more iterations with the
+ * same number of photons will not help. In this case, the number of photons is
+ * increased by a given factor (up to a given maximum).
+ *
+ * The checker is used if the parameter iterationconvergencechecker:type is set
+ * to Adaptive.
+ */
+class IterationConvergenceChecker {
+private:
+  /*! @brief Relative change below which the iterations are considered to be
+   *  converged. */
+  double _tolerance;
+
+  /*! @brief Maximum ratio of the change during the current iteration and the
+   *  change during the previous iteration for which the iterations are still
+   *  considered to be converging. */
+  double _stagnation_ratio;
+
+  /*! @brief Factor by which the number of photons is increased if the change
+   *  is dominated by Monte Carlo noise. */
+  double _photon_number_increase_factor;
+
+  /*! @brief Maximum number of photons. */
+  unsigned int _maximum_number_of_photons;
+
+  /*! @brief Change during the previous iteration (negative if there was no
+   *  previous iteration). */
+  double _previous_change;
+
+  /*! @brief Log to write logging info to. */
+  Log *_log;
+
+public:
+  IterationConvergenceChecker(double tolerance, double stagnation_ratio,
+                              double photon_number_increase_factor,
+                              unsigned int maximum_number_of_photons,
+                              Log *log = nullptr);
+
+  IterationConvergenceChecker(ParameterFile &params,
+                              unsigned int number_of_photons,
+                              Log *log = nullptr);
+
+  void reset();
+
+  void store_old_values(DensityGrid &grid,
+                        std::pair< unsigned long, unsigned long > &block) const;
+
+  void compute_changes(DensityGrid &grid,
+                       std::pair< unsigned long, unsigned long > &block,
+                       ReproducibleSum *changes) const;
+
+  bool is_converged(const ReproducibleSum *changes,
+                    unsigned int &number_of_photons);
+};
+
+#endif // ITERATIONCONVERGENCECHECKER_HPP
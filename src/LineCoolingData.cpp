@@ -26,6 +26,7 @@
  */
 #include "LineCoolingData.hpp"
 #include "Error.hpp"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <fstream>
@@ -71,7 +72,10 @@ bool LineCoolingData::read_values(string line, double *array,
  *
  * Reads the data file and stores the necessary quantities in internal arrays.
  */
-LineCoolingData::LineCoolingData() {
+LineCoolingData::LineCoolingData()
+    : _table_number_of_temperatures(0), _table_number_of_electron_densities(0),
+      _table_log_T_min(0.), _table_inverse_log_T_step(0.),
+      _table_log_ne_min(0.), _table_inverse_log_ne_step(0.) {
   double enlev[5];
 
   ifstream file(LINECOOLINGDATALOCATION);
@@ -283,22 +287,23 @@ int LineCoolingData::simq(double A[5][5], double B[5]) {
 }
 
 /**
- * @brief Get the radiative energy losses due to line cooling at the given
- * temperature, electron density and coolant abundances.
+ * @brief Get the radiative energy losses due to line cooling per unit coolant
+ * abundance for all cooling channels, at the given temperature and electron
+ * density.
+ *
+ * The first LINECOOLINGDATA_NUMELEMENTS channels correspond to the 5 level
+ * elements, the last two channels to the 2 level ions N III and Ne II. The
+ * total cooling is the sum of the channel values, weighted with the
+ * corresponding coolant abundances.
  *
  * @param temperature Temperature (in K).
  * @param electron_density Electron density (in m^-3).
- * @param abundances Abdunances of coolants.
- * @return Radiative cooling per hydrogen atom (in kg m^2s^-3).
+ * @param channels Array to store the cooling per unit abundance for all
+ * LINECOOLINGDATA_NUMCHANNELS channels in (in kg m^2s^-3).
  */
-double LineCoolingData::get_cooling(double temperature, double electron_density,
-                                    const double *abundances) const {
-
-  if (electron_density == 0.) {
-    // we cannot return a 0 cooling rate, because that crashes our iterative
-    // temperature finding scheme
-    return 1.e-99;
-  }
+void LineCoolingData::get_cooling_channels(double temperature,
+                                           double electron_density,
+                                           double *channels) const {
 
   double EnNIII = 251.;
   double EaNIII = 4.77e-5;
@@ -350,7 +355,6 @@ double LineCoolingData::get_cooling(double temperature, double electron_density,
   cs[2][8] = T2 / 9.;
   cs[2][9] = 0.105 * std::pow(T4, 0.52);
 
-  double cooling = 0.;
   double alev[5][5], lev[5];
   for (unsigned int j = 0; j < 10; ++j) {
     for (unsigned int mm = 0; mm < 5; ++mm) {
@@ -420,36 +424,205 @@ double LineCoolingData::get_cooling(double temperature, double electron_density,
       cmac_error("We better stop!");
     }
 
-    double cl2 = abundances[j] * kb * lev[1] * _ea[j][0] * _en[j][0];
-    double cl3 = abundances[j] * kb * lev[2] *
-                 (_ea[j][1] * _en[j][1] + _ea[j][4] * _en[j][4]);
+    double cl2 = kb * lev[1] * _ea[j][0] * _en[j][0];
+    double cl3 =
+        kb * lev[2] * (_ea[j][1] * _en[j][1] + _ea[j][4] * _en[j][4]);
     double cl4 =
-        abundances[j] * kb * lev[3] *
+        kb * lev[3] *
         (_ea[j][2] * _en[j][2] + _ea[j][5] * _en[j][5] + _ea[j][7] * _en[j][7]);
-    double cl5 = abundances[j] * kb * lev[4] *
+    double cl5 = kb * lev[4] *
                  (_ea[j][3] * _en[j][3] + _ea[j][6] * _en[j][6] +
                   _ea[j][8] * _en[j][8] + _ea[j][9] * _en[j][9]);
 
-    double coolj = cl2 + cl3 + cl4 + cl5;
-    cooling += coolj;
+    channels[j] = cl2 + cl3 + cl4 + cl5;
   }
 
   // 2 level atoms
   double sw1 = 2.;
   double sw2 = 4.;
   T1 = std::exp(-EnNIII / temperature);
-  double CNIII = abundances[10] * kb * cfac * EnNIII * OmNIII * T1 * EaNIII /
-                 (sw1 * (EaNIII + cfac * OmNIII * (1. / sw2 + T1 / sw1)));
+  channels[LINECOOLINGDATA_NUMELEMENTS] =
+      kb * cfac * EnNIII * OmNIII * T1 * EaNIII /
+      (sw1 * (EaNIII + cfac * OmNIII * (1. / sw2 + T1 / sw1)));
   sw1 = 4.;
   sw2 = 2.;
   T1 = std::exp(-EnNeII / temperature);
-  double CNeII = abundances[11] * kb * cfac * OmNeII * EnNeII * T1 * EaNeII /
-                 (sw1 * (EaNeII + cfac * OmNeII * (1. / sw2 + T1 / sw1)));
-  cooling += CNIII + CNeII;
+  channels[LINECOOLINGDATA_NUMELEMENTS + 1] =
+      kb * cfac * OmNeII * EnNeII * T1 * EaNeII /
+      (sw1 * (EaNeII + cfac * OmNeII * (1. / sw2 + T1 / sw1)));
+}
+
+/**
+ * @brief Get the radiative energy losses due to line cooling at the given
+ * temperature, electron density and coolant abundances, by solving for the
+ * level populations.
+ *
+ * @param temperature Temperature (in K).
+ * @param electron_density Electron density (in m^-3).
+ * @param abundances Abdunances of coolants.
+ * @return Radiative cooling per hydrogen atom (in kg m^2s^-3).
+ */
+double LineCoolingData::get_exact_cooling(double temperature,
+                                          double electron_density,
+                                          const double *abundances) const {
+
+  if (electron_density == 0.) {
+    // we cannot return a 0 cooling rate, because that crashes our iterative
+    // temperature finding scheme
+    return 1.e-99;
+  }
 
+  double channels[LINECOOLINGDATA_NUMCHANNELS];
+  get_cooling_channels(temperature, electron_density, channels);
+
+  double cooling = 0.;
+  for (unsigned int j = 0; j < LINECOOLINGDATA_NUMCHANNELS; ++j) {
+    cooling += abundances[j] * channels[j];
+  }
   return cooling;
 }
 
+/**
+ * @brief Precompute the line cooling per unit abundance for all channels on a
+ * grid that is uniform in log(T) and log(n_e).
+ *
+ * After this function has been called, get_cooling() bilinearly interpolates
+ * the logarithm of the channel values on this grid, and only falls back to
+ * get_exact_cooling() outside the range of the grid.
+ *
+ * @param minimum_temperature Lower limit of the temperature range (in K).
+ * @param maximum_temperature Upper limit of the temperature range (in K).
+ * @param minimum_electron_density Lower limit of the electron density range
+ * (in m^-3).
+ * @param maximum_electron_density Upper limit of the electron density range
+ * (in m^-3).
+ * @param temperature_points_per_decade Number of temperature values per factor
+ * 10 in temperature.
+ * @param electron_density_points_per_decade Number of electron density values
+ * per factor 10 in electron density.
+ */
+void LineCoolingData::tabulate_cooling(
+    double minimum_temperature, double maximum_temperature,
+    double minimum_electron_density, double maximum_electron_density,
+    unsigned int temperature_points_per_decade,
+    unsigned int electron_density_points_per_decade) {
+
+  if (minimum_temperature <= 0. ||
+      maximum_temperature <= minimum_temperature) {
+    cmac_error("Invalid temperature range for the line cooling table: [%g K, "
+               "%g K]!",
+               minimum_temperature, maximum_temperature);
+  }
+  if (minimum_electron_density <= 0. ||
+      maximum_electron_density <= minimum_electron_density) {
+    cmac_error("Invalid electron density range for the line cooling table: "
+               "[%g m^-3, %g m^-3]!",
+               minimum_electron_density, maximum_electron_density);
+  }
+  if (temperature_points_per_decade == 0 ||
+      electron_density_points_per_decade == 0) {
+    cmac_error("The line cooling table needs at least 1 point per decade!");
+  }
+
+  const double log_T_min = std::log(minimum_temperature);
+  const double log_T_max = std::log(maximum_temperature);
+  const double log_ne_min = std::log(minimum_electron_density);
+  const double log_ne_max = std::log(maximum_electron_density);
+
+  // make sure the grid covers the entire requested range with the requested
+  // resolution
+  _table_number_of_temperatures =
+      std::ceil((log_T_max - log_T_min) * temperature_points_per_decade /
+                std::log(10.)) +
+      1;
+  _table_number_of_electron_densities =
+      std::ceil((log_ne_max - log_ne_min) * electron_density_points_per_decade /
+                std::log(10.)) +
+      1;
+  _table_log_T_min = log_T_min;
+  _table_log_ne_min = log_ne_min;
+  const double log_T_step =
+      (log_T_max - log_T_min) / (_table_number_of_temperatures - 1);
+  const double log_ne_step =
+      (log_ne_max - log_ne_min) / (_table_number_of_electron_densities - 1);
+  _table_inverse_log_T_step = 1. / log_T_step;
+  _table_inverse_log_ne_step = 1. / log_ne_step;
+
+  _cooling_table.resize(_table_number_of_temperatures *
+                        _table_number_of_electron_densities *
+                        LINECOOLINGDATA_NUMCHANNELS);
+  for (unsigned int iT = 0; iT < _table_number_of_temperatures; ++iT) {
+    const double T = std::exp(log_T_min + iT * log_T_step);
+    for (unsigned int ine = 0; ine < _table_number_of_electron_densities;
+         ++ine) {
+      const double ne = std::exp(log_ne_min + ine * log_ne_step);
+      double *values =
+          &_cooling_table[(iT * _table_number_of_electron_densities + ine) *
+                          LINECOOLINGDATA_NUMCHANNELS];
+      get_cooling_channels(T, ne, values);
+      for (unsigned int j = 0; j < LINECOOLINGDATA_NUMCHANNELS; ++j) {
+        // make sure we can safely take the logarithm
+        values[j] = std::log(std::max(values[j], 1.e-300));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the radiative energy losses due to line cooling at the given
+ * temperature, electron density and coolant abundances.
+ *
+ * If a table was computed using tabulate_cooling() and the temperature and
+ * electron density are within its range, the cooling is interpolated from the
+ * table. Otherwise, we solve for the level populations.
+ *
+ * @param temperature Temperature (in K).
+ * @param electron_density Electron density (in m^-3).
+ * @param abundances Abdunances of coolants.
+ * @return Radiative cooling per hydrogen atom (in kg m^2s^-3).
+ */
+double LineCoolingData::get_cooling(double temperature, double electron_density,
+                                    const double *abundances) const {
+
+  if (_cooling_table.size() > 0 && temperature > 0. &&
+      electron_density > 0.) {
+    const double xT =
+        (std::log(temperature) - _table_log_T_min) * _table_inverse_log_T_step;
+    const double xne = (std::log(electron_density) - _table_log_ne_min) *
+                       _table_inverse_log_ne_step;
+    if (xT >= 0. && xT <= _table_number_of_temperatures - 1 && xne >= 0. &&
+        xne <= _table_number_of_electron_densities - 1) {
+      const unsigned int iT =
+          std::min(static_cast< unsigned int >(xT),
+                   _table_number_of_temperatures - 2);
+      const unsigned int ine =
+          std::min(static_cast< unsigned int >(xne),
+                   _table_number_of_electron_densities - 2);
+      const double fT = xT - iT;
+      const double fne = xne - ine;
+      const double w00 = (1. - fT) * (1. - fne);
+      const double w01 = (1. - fT) * fne;
+      const double w10 = fT * (1. - fne);
+      const double w11 = fT * fne;
+      const double *v00 =
+          &_cooling_table[(iT * _table_number_of_electron_densities + ine) *
+                          LINECOOLINGDATA_NUMCHANNELS];
+      const double *v01 = v00 + LINECOOLINGDATA_NUMCHANNELS;
+      const double *v10 = v00 + _table_number_of_electron_densities *
+                                    LINECOOLINGDATA_NUMCHANNELS;
+      const double *v11 = v10 + LINECOOLINGDATA_NUMCHANNELS;
+      double cooling = 0.;
+      for (unsigned int j = 0; j < LINECOOLINGDATA_NUMCHANNELS; ++j) {
+        cooling += abundances[j] * std::exp(w00 * v00[j] + w01 * v01[j] +
+                                            w10 * v10[j] + w11 * v11[j]);
+      }
+      return cooling;
+    }
+  }
+
+  return get_exact_cooling(temperature, electron_density, abundances);
+}
+
 /**
  * @brief Calculate the strength of a number of emission lines for the given
  * temperature, electron density and ion abundances.
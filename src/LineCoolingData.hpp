@@ -29,6 +29,7 @@
 
 #include "LineCoolingDataLocation.hpp"
 #include <string>
+#include <vector>
 
 /**
  * @brief Names of supported elements
@@ -58,6 +59,10 @@ enum LineCoolingDataElements {
   LINECOOLINGDATA_NUMELEMENTS
 };
 
+/*! @brief Number of line cooling channels: the 5 level elements, plus the
+ *  2 level ions N III and Ne II. */
+#define LINECOOLINGDATA_NUMCHANNELS (LINECOOLINGDATA_NUMELEMENTS + 2)
+
 /**
  * @brief Internal representation of the line cooling data in "atom4.dat"
  */
@@ -78,6 +83,32 @@ private:
   /*! @brief sw values */
   double _sw[LINECOOLINGDATA_NUMELEMENTS][5];
 
+  /*! @brief Logarithm of the cooling per unit abundance for all channels on a
+   *  regular grid in log(T) and log(n_e) (empty if no table was computed). */
+  std::vector< double > _cooling_table;
+
+  /*! @brief Number of temperature values in the cooling table. */
+  unsigned int _table_number_of_temperatures;
+
+  /*! @brief Number of electron density values in the cooling table. */
+  unsigned int _table_number_of_electron_densities;
+
+  /*! @brief Natural logarithm of the lowest temperature in the cooling table
+   *  (in log(K)). */
+  double _table_log_T_min;
+
+  /*! @brief Inverse of the natural logarithmic temperature step of the cooling
+   *  table (in log(K)^-1). */
+  double _table_inverse_log_T_step;
+
+  /*! @brief Natural logarithm of the lowest electron density in the cooling
+   *  table (in log(m^-3)). */
+  double _table_log_ne_min;
+
+  /*! @brief Inverse of the natural logarithmic electron density step of the
+   *  cooling table (in log(m^-3)^-1). */
+  double _table_inverse_log_ne_step;
+
   static bool read_values(std::string line, double *array, unsigned int size);
 
 public:
@@ -91,6 +122,26 @@ public:
 
   static int simq(double A[5][5], double B[5]);
 
+  void get_cooling_channels(double temperature, double electron_density,
+                            double *channels) const;
+
+  double get_exact_cooling(double temperature, double electron_density,
+                           const double *abundances) const;
+
+  void tabulate_cooling(double minimum_temperature = 1000.,
+                        double maximum_temperature = 1.e6,
+                        double minimum_electron_density = 100.,
+                        double maximum_electron_density = 1.e14,
+                        unsigned int temperature_points_per_decade = 100,
+                        unsigned int electron_density_points_per_decade = 20);
+
+  /**
+   * @brief Check if the line cooling is interpolated from a table.
+   *
+   * @return True if tabulate_cooling() was called.
+   */
+  inline bool is_tabulated() const { return _cooling_table.size() > 0; }
+
   double get_cooling(double temperature, double electron_density,
                      const double *abundances) const;
 
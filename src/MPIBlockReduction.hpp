@@ -0,0 +1,255 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file MPIBlockReduction.hpp
+ *
+ * @brief Pipelined, non-blocking sum of per-cell values across all processes.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef MPIBLOCKREDUCTION_HPP
+#define MPIBLOCKREDUCTION_HPP
+
+#include "Configuration.hpp"
+#include "Error.hpp"
+#include "MPICommunicator.hpp"
+#include "Timer.hpp"
+
+#include <climits>
+#include <vector>
+
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+/**
+ * @brief Pipelined, non-blocking sum of per-cell values across all processes.
+ *
+ * Every process owns a contiguous block of cells (the same block that is
+ * returned by MPICommunicator::distribute_block()). Every block is subdivided
+ * into a number of chunks. start() packs the values of all cells in a single
+ * buffer and posts a non-blocking MPI_Ireduce for every chunk, with the owner
+ * of the chunk as root. get_next_chunk() then hands out the local chunks in the
+ * order in which their reductions complete, so that work on a chunk can start
+ * while the reductions of other chunks are still in flight.
+ *
+ * Only the cells owned by the local process receive the reduced values; the
+ * other cells keep their local contributions.
+ *
+ * If start() was not called (or if there is only one process), get_next_chunk()
+ * simply hands out the local chunks in order.
+ *
+ * Whether communication actually progresses while the calling process does
+ * other work depends on the asynchronous progress support of the MPI library.
+ * The time spent waiting for reductions to complete is recorded and can be
+ * retrieved with get_blocked_time().
+ */
+template < unsigned int _numvalue_ > class MPIBlockReduction {
+private:
+  /*! @brief Rank of the local process. */
+  int _rank;
+
+  /*! @brief Total number of processes. */
+  int _size;
+
+  /*! @brief Cell ranges of all chunks on all processes. */
+  std::vector< std::pair< unsigned long, unsigned long > > _chunks;
+
+  /*! @brief Index of the first chunk owned by the local process. */
+  unsigned int _first_local_chunk;
+
+  /*! @brief Number of chunks owned by every process. */
+  unsigned int _number_of_local_chunks;
+
+  /*! @brief Number of local chunks that have been handed out. */
+  unsigned int _number_of_finished_local_chunks;
+
+  /*! @brief Flag signaling whether a reduction is in flight. */
+  bool _active;
+
+  /*! @brief Buffer containing the packed values of all cells. */
+  std::vector< double > _buffer;
+
+#ifdef HAVE_MPI
+  /*! @brief Requests for the reductions of all chunks. */
+  std::vector< MPI_Request > _requests;
+#endif
+
+  /*! @brief Timer that measures the time spent waiting for reductions. */
+  Timer _blocked_timer;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param comm MPICommunicator.
+   * @param numcell Total number of cells.
+   * @param numchunk Number of chunks in every block.
+   */
+  inline MPIBlockReduction(const MPICommunicator &comm, unsigned long numcell,
+                           unsigned int numchunk)
+      : _rank(comm.get_rank()), _size(comm.get_size()),
+        _first_local_chunk(comm.get_rank() * numchunk),
+        _number_of_local_chunks(numchunk), _number_of_finished_local_chunks(0),
+        _active(false) {
+
+    for (int irank = 0; irank < _size; ++irank) {
+      const std::pair< unsigned long, unsigned long > block =
+          MPICommunicator::distribute_block(irank, _size, 0, numcell);
+      for (unsigned int ichunk = 0; ichunk < numchunk; ++ichunk) {
+        const std::pair< unsigned long, unsigned long > chunk =
+            MPICommunicator::distribute_block(ichunk, numchunk, block.first,
+                                              block.second);
+        if ((chunk.second - chunk.first) * _numvalue_ > INT_MAX) {
+          cmac_error("Chunk too large for a single MPI reduction!");
+        }
+        _chunks.push_back(chunk);
+      }
+    }
+
+    _blocked_timer.reset();
+  }
+
+  /**
+   * @brief Pack the values of all cells and post the reductions for all
+   * chunks.
+   *
+   * @param begin Iterator to the first cell.
+   * @param getter Member function that stores the values of a cell in the
+   * given array.
+   */
+  template < typename _classtype_, typename _iteratortype_ >
+  inline void start(_iteratortype_ begin,
+                    void (_classtype_::*getter)(double *) const) {
+    cmac_assert(!_active);
+#ifdef HAVE_MPI
+    if (_size > 1) {
+      const unsigned long numcell = _chunks.back().second;
+      _buffer.resize(numcell * _numvalue_);
+      _iteratortype_ it = begin;
+      for (unsigned long i = 0; i < numcell; ++i, ++it) {
+        ((*it).*getter)(&_buffer[i * _numvalue_]);
+      }
+
+      // all processes post the reductions in the same order
+      _requests.resize(_chunks.size());
+      for (unsigned int ichunk = 0; ichunk < _chunks.size(); ++ichunk) {
+        const int root = ichunk / _number_of_local_chunks;
+        const int count =
+            (_chunks[ichunk].second - _chunks[ichunk].first) * _numvalue_;
+        double *data = _buffer.data() + _chunks[ichunk].first * _numvalue_;
+        int status;
+        if (root == _rank) {
+          status = MPI_Ireduce(MPI_IN_PLACE, data, count, MPI_DOUBLE, MPI_SUM,
+                               root, MPI_COMM_WORLD, &_requests[ichunk]);
+        } else {
+          status = MPI_Ireduce(data, nullptr, count, MPI_DOUBLE, MPI_SUM, root,
+                               MPI_COMM_WORLD, &_requests[ichunk]);
+        }
+        if (status != MPI_SUCCESS) {
+          cmac_error("Error in MPI_Ireduce!");
+        }
+      }
+      _active = true;
+    }
+#endif
+  }
+
+  /**
+   * @brief Get the next local chunk for which the reduction has completed.
+   *
+   * The reduced values are stored in the cells of the chunk before it is
+   * returned.
+   *
+   * @param begin Iterator to the first cell.
+   * @param setter Member function that reads the values of a cell from the
+   * given array.
+   * @param chunk Variable to store the cell range of the chunk in.
+   * @return False if all local chunks have been handed out.
+   */
+  template < typename _classtype_, typename _iteratortype_ >
+  inline bool get_next_chunk(_iteratortype_ begin,
+                             void (_classtype_::*setter)(const double *),
+                             std::pair< unsigned long, unsigned long > &chunk) {
+    if (_number_of_finished_local_chunks == _number_of_local_chunks) {
+      return false;
+    }
+    unsigned int ichunk =
+        _first_local_chunk + _number_of_finished_local_chunks;
+#ifdef HAVE_MPI
+    if (_active) {
+      int index;
+      _blocked_timer.start();
+      int status =
+          MPI_Waitany(_number_of_local_chunks, &_requests[_first_local_chunk],
+                      &index, MPI_STATUS_IGNORE);
+      _blocked_timer.stop();
+      if (status != MPI_SUCCESS) {
+        cmac_error("Error in MPI_Waitany!");
+      }
+      ichunk = _first_local_chunk + index;
+      _iteratortype_ it = begin + _chunks[ichunk].first;
+      for (unsigned long i = _chunks[ichunk].first; i < _chunks[ichunk].second;
+           ++i, ++it) {
+        ((*it).*setter)(&_buffer[i * _numvalue_]);
+      }
+    }
+#endif
+    ++_number_of_finished_local_chunks;
+    chunk = _chunks[ichunk];
+    return true;
+  }
+
+  /**
+   * @brief Wait for the reductions of the chunks owned by other processes to
+   * complete.
+   *
+   * This needs to be called after all local chunks have been handed out, and
+   * before the next round of start() and get_next_chunk() calls.
+   */
+  inline void finish() {
+    _number_of_finished_local_chunks = 0;
+#ifdef HAVE_MPI
+    if (_active) {
+      _blocked_timer.start();
+      int status =
+          MPI_Waitall(_requests.size(), &_requests[0], MPI_STATUSES_IGNORE);
+      _blocked_timer.stop();
+      if (status != MPI_SUCCESS) {
+        cmac_error("Error in MPI_Waitall!");
+      }
+      _active = false;
+    }
+#endif
+  }
+
+  /**
+   * @brief Get the total time spent waiting for reductions to complete.
+   *
+   * @return Time spent waiting (in s).
+   */
+  inline double get_blocked_time() const { return _blocked_timer.value(); }
+
+  /**
+   * @brief Reset the time spent waiting for reductions to complete.
+   */
+  inline void reset_blocked_time() { _blocked_timer.reset(); }
+};
+
+#endif // MPIBLOCKREDUCTION_HPP
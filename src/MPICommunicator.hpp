@@ -33,7 +33,10 @@
 #include "MPIMessage.hpp"
 #include "MPIMessageBox.hpp"
 #include "MPIUtilities.hpp"
+#include "ReproducibleSum.hpp"
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 #include <vector>
 
@@ -74,7 +77,9 @@
  */
 enum MPIOperatorType {
   /*! @brief Take the sum of a variable across all processes. */
-  MPI_SUM_OF_ALL_PROCESSES = 0
+  MPI_SUM_OF_ALL_PROCESSES = 0,
+  /*! @brief Take the maximum of a variable across all processes. */
+  MPI_MAX_OF_ALL_PROCESSES
 };
 
 /**
@@ -218,6 +223,27 @@ public:
 #endif
   }
 
+  /**
+   * @brief Get the offset of the part of the given number that is assigned to
+   * this process by distribute().
+   *
+   * @param number Number to distribute.
+   * @return Sum of the parts assigned to all processes with a lower rank.
+   */
+  inline unsigned int distribute_offset(unsigned int number) const {
+#ifdef HAVE_MPI
+    if (_size > 1) {
+      unsigned int quotient = number / _size;
+      int remainder = number % _size;
+      return _rank * quotient + std::min(_rank, remainder);
+    } else {
+      return 0;
+    }
+#else
+    return 0;
+#endif
+  }
+
   /**
    * @brief Distribute the continuous block of indices with given begin and end
    * index across a given number of processes, and get the part for the process
@@ -243,8 +269,8 @@ public:
     // total size _rank*quotient + the number of blocks with 1 element more
     // the end of the block is the beginning of the next block, which means we
     // have the same logic for _rank+1
-    block_begin = rank * quotient + std::min(rank, remainder);
-    block_end = (rank + 1) * quotient + std::min(rank + 1, remainder);
+    block_begin = begin + rank * quotient + std::min(rank, remainder);
+    block_end = begin + (rank + 1) * quotient + std::min(rank + 1, remainder);
     return std::make_pair(block_begin, block_end);
   }
 
@@ -281,6 +307,8 @@ public:
     switch (type) {
     case MPI_SUM_OF_ALL_PROCESSES:
       return MPI_SUM;
+    case MPI_MAX_OF_ALL_PROCESSES:
+      return MPI_MAX;
     default:
       cmac_error("Unknown MPIOperatorType: %i!", type);
       return 0;
@@ -410,6 +438,59 @@ public:
 #endif
   }
 
+  /**
+   * @brief Reduce a fixed number of values for every element pointed to by the
+   * given begin and end iterator, using a single communication.
+   *
+   * The given getter member function packs the values of a single element into
+   * an array of the given template size. All arrays are stored in a single
+   * buffer that is reduced in one MPI_Allreduce, after which the given setter
+   * member function unpacks the reduced values again.
+   *
+   * @param begin Iterator to the first element that should be reduced.
+   * @param end Iterator to the first element that should not be reduced, or the
+   * end of the list.
+   * @param getter Member function of the given template class type that stores
+   * the values that should be reduced in the given array.
+   * @param setter Member function of the given template class type that reads
+   * the reduced values from the given array and stores them in the class type
+   * object.
+   */
+  template < MPIOperatorType _operatortype_, unsigned int _numvalue_,
+             typename _datatype_, typename _classtype_,
+             typename _iteratortype_ >
+  void reduce(_iteratortype_ begin, _iteratortype_ end,
+              void (_classtype_::*getter)(_datatype_ *) const,
+              void (_classtype_::*setter)(const _datatype_ *)) const {
+#ifdef HAVE_MPI
+    if (_size > 1) {
+      const unsigned long size = (end - begin) * _numvalue_;
+      if (size >
+          static_cast< unsigned long >(std::numeric_limits< int >::max())) {
+        cmac_error("Too many values for a single MPI_Allreduce (%lu)!", size);
+      }
+      std::vector< _datatype_ > buffer(size);
+      unsigned long offset = 0;
+      for (_iteratortype_ it = begin; it != end; ++it) {
+        ((*it).*(getter))(&buffer[offset]);
+        offset += _numvalue_;
+      }
+      MPI_Datatype dtype = MPIUtilities::get_datatype< _datatype_ >();
+      MPI_Op otype = get_operator(_operatortype_);
+      int status = MPI_Allreduce(MPI_IN_PLACE, buffer.data(), size, dtype,
+                                 otype, MPI_COMM_WORLD);
+      if (status != MPI_SUCCESS) {
+        cmac_error("Error in MPI_Allreduce!");
+      }
+      offset = 0;
+      for (_iteratortype_ it = begin; it != end; ++it) {
+        ((*it).*(setter))(&buffer[offset]);
+        offset += _numvalue_;
+      }
+    }
+#endif
+  }
+
   /**
    * @brief Reduce the given variable across all processes.
    *
@@ -476,6 +557,42 @@ public:
 #endif
   }
 
+  /**
+   * @brief Reduce the given array of ReproducibleSum values across all
+   * processes.
+   *
+   * All processes first anchor their sums on the same bins, after which the
+   * integer bins can be summed. The result hence does not depend on the number
+   * of processes.
+   *
+   * @param sums Array to reduce.
+   * @param size Size of the array.
+   */
+  inline void reduce(ReproducibleSum *sums, unsigned int size) {
+#ifdef HAVE_MPI
+    if (_size > 1) {
+      std::vector< int > bins(size);
+      for (unsigned int i = 0; i < size; ++i) {
+        bins[i] = sums[i].get_bin();
+      }
+      reduce< MPI_MAX_OF_ALL_PROCESSES >(bins);
+      std::vector< int64_t > slices(size * REPRODUCIBLESUM_NUMBIN);
+      for (unsigned int i = 0; i < size; ++i) {
+        sums[i].align(bins[i]);
+        for (unsigned int j = 0; j < REPRODUCIBLESUM_NUMBIN; ++j) {
+          slices[i * REPRODUCIBLESUM_NUMBIN + j] = sums[i].get_slices()[j];
+        }
+      }
+      reduce< MPI_SUM_OF_ALL_PROCESSES >(slices);
+      for (unsigned int i = 0; i < size; ++i) {
+        for (unsigned int j = 0; j < REPRODUCIBLESUM_NUMBIN; ++j) {
+          sums[i].get_slices()[j] = slices[i * REPRODUCIBLESUM_NUMBIN + j];
+        }
+      }
+    }
+#endif
+  }
+
   /**
    * @brief Ensure the given std::vector is up to date on all processes,
    * assuming that MPI process i holds the block returned by
@@ -532,6 +649,70 @@ public:
 #endif
   }
 
+  /**
+   * @brief Ensure the elements pointed to by the given begin and end iterator
+   * are up to date on all processes, assuming that MPI process i holds the
+   * block returned by distribute_block(i, size, 0, end - begin).
+   *
+   * The given getter member function packs a fixed number of values of a
+   * single element into an array. The packed values of the local block are
+   * exchanged in a single MPI_Allgatherv, after which the given setter member
+   * function unpacks the values of all elements that are not part of the local
+   * block.
+   *
+   * @param begin Iterator to the first element.
+   * @param end Iterator to the first element that is not part of the range.
+   * @param getter Member function of the given template class type that stores
+   * the values that should be gathered in the given array.
+   * @param setter Member function of the given template class type that reads
+   * the gathered values from the given array and stores them in the class type
+   * object.
+   */
+  template < unsigned int _numvalue_, typename _datatype_, typename _classtype_,
+             typename _iteratortype_ >
+  void gather(_iteratortype_ begin, _iteratortype_ end,
+              void (_classtype_::*getter)(_datatype_ *) const,
+              void (_classtype_::*setter)(const _datatype_ *)) const {
+#ifdef HAVE_MPI
+    if (_size > 1) {
+      const unsigned long numelement = end - begin;
+      if (numelement * _numvalue_ >
+          static_cast< unsigned long >(std::numeric_limits< int >::max())) {
+        cmac_error("Too many values for a single MPI_Allgatherv (%lu)!",
+                   numelement * _numvalue_);
+      }
+      std::vector< int > counts(_size);
+      std::vector< int > displacements(_size);
+      for (int i = 0; i < _size; ++i) {
+        const std::pair< unsigned long, unsigned long > block =
+            distribute_block(i, _size, 0, numelement);
+        counts[i] = (block.second - block.first) * _numvalue_;
+        displacements[i] = block.first * _numvalue_;
+      }
+      const std::pair< unsigned long, unsigned long > local_block =
+          distribute_block(_rank, _size, 0, numelement);
+      std::vector< _datatype_ > buffer(numelement * _numvalue_);
+      for (unsigned long i = local_block.first; i < local_block.second; ++i) {
+        ((*(begin + i)).*(getter))(&buffer[i * _numvalue_]);
+      }
+      MPI_Datatype dtype = MPIUtilities::get_datatype< _datatype_ >();
+      // MPI_IN_PLACE: the local contribution is already in the right place in
+      // the receive buffer
+      int status = MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                                  buffer.data(), counts.data(),
+                                  displacements.data(), dtype, MPI_COMM_WORLD);
+      if (status != MPI_SUCCESS) {
+        cmac_error("Error in MPI_Allgatherv!");
+      }
+      for (unsigned long i = 0; i < numelement; ++i) {
+        if (i < local_block.first || i >= local_block.second) {
+          ((*(begin + i)).*(setter))(&buffer[i * _numvalue_]);
+        }
+      }
+    }
+#endif
+  }
+
   /**
    * @brief Send the given message to the given process.
    *
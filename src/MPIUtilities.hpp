@@ -29,6 +29,7 @@
 #include "Configuration.hpp"
 
 #ifdef HAVE_MPI
+#include <cstdint>
 #include <mpi.h>
 
 /**
@@ -67,6 +68,18 @@ template <> inline MPI_Datatype get_datatype< unsigned int >() {
   return MPI_UNSIGNED;
 }
 
+/**
+ * @brief Template function that returns the MPI_Datatype corresponding to the
+ * given template data type.
+ *
+ * Specialization for an unsigned long integer value.
+ *
+ * @return MPI_UNSIGNED_LONG.
+ */
+template <> inline MPI_Datatype get_datatype< unsigned long >() {
+  return MPI_UNSIGNED_LONG;
+}
+
 /**
  * @brief Template function that returns the MPI_Datatype corresponding to the
  * given template data type.
@@ -76,6 +89,18 @@ template <> inline MPI_Datatype get_datatype< unsigned int >() {
  * @return MPI_INT.
  */
 template <> inline MPI_Datatype get_datatype< int >() { return MPI_INT; }
+
+/**
+ * @brief Template function that returns the MPI_Datatype corresponding to the
+ * given template data type.
+ *
+ * Specialization for a signed 64-bit integer value.
+ *
+ * @return MPI_INT64_T.
+ */
+template <> inline MPI_Datatype get_datatype< int64_t >() {
+  return MPI_INT64_T;
+}
 }
 
 #endif // HAVE_MPI
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file NUMATools.hpp
+ *
+ * @brief Tools to inspect the placement of memory on NUMA systems.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef NUMATOOLS_HPP
+#define NUMATOOLS_HPP
+
+#include "Configuration.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#ifdef HAVE_AFFINITY
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Tools to inspect the placement of memory on NUMA systems.
+ */
+namespace NUMATools {
+
+/**
+ * @brief Find out on which NUMA nodes the memory pages of the given memory
+ * region are placed.
+ *
+ * We only inspect a sample of at most the given number of pages, evenly spread
+ * over the region. Pages that are not (yet) placed on a node are ignored.
+ *
+ * @param data Start of the memory region.
+ * @param size Size of the memory region (in bytes).
+ * @param pages_per_node Number of sampled pages on every NUMA node. The vector
+ * is grown if necessary, and the counts are added to the existing values.
+ * @param max_num_pages Maximum number of pages to sample.
+ * @return Number of sampled pages for which the NUMA node was found (0 if the
+ * system does not support querying the NUMA node of a memory page).
+ */
+inline unsigned int get_memory_placement(const void *data, size_t size,
+                                         std::vector< unsigned long >
+                                             &pages_per_node,
+                                         unsigned int max_num_pages = 1000) {
+#ifdef HAVE_AFFINITY
+  if (data == nullptr || size == 0) {
+    return 0;
+  }
+
+  const size_t pagesize = sysconf(_SC_PAGESIZE);
+  const size_t first_page = reinterpret_cast< size_t >(data) / pagesize;
+  const size_t last_page =
+      (reinterpret_cast< size_t >(data) + size - 1) / pagesize;
+  const size_t num_page = last_page - first_page + 1;
+  const size_t num_sample = std::min(num_page, size_t(max_num_pages));
+
+  std::vector< void * > pages(num_sample);
+  for (size_t i = 0; i < num_sample; ++i) {
+    pages[i] = reinterpret_cast< void * >(
+        (first_page + (i * num_page) / num_sample) * pagesize);
+  }
+  // if no target nodes are given, move_pages does not move anything, but
+  // returns the node on which every page currently resides (or a negative
+  // error code if the page is not placed yet)
+  std::vector< int > status(num_sample, -1);
+  if (syscall(SYS_move_pages, 0, num_sample, &pages[0], nullptr, &status[0],
+              0) != 0) {
+    return 0;
+  }
+
+  unsigned int num_found = 0;
+  for (size_t i = 0; i < num_sample; ++i) {
+    if (status[i] >= 0) {
+      const size_t node = status[i];
+      if (node >= pages_per_node.size()) {
+        pages_per_node.resize(node + 1, 0);
+      }
+      ++pages_per_node[node];
+      ++num_found;
+    }
+  }
+  return num_found;
+#else
+  return 0;
+#endif
+}
+}
+
+#endif // NUMATOOLS_HPP
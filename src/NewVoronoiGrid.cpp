@@ -113,6 +113,64 @@ NewVoronoiGrid::compute_cell(unsigned int index,
   return cell;
 }
 
+/**
+ * @brief Recompute the cell with the given index after the generator positions
+ * have changed.
+ *
+ * We first add the neighbours of the cell in the previous grid. These are very
+ * likely to still be neighbours, so that the cell and its maximal influence
+ * radius are close to their final values after this step. The other
+ * generators are then added in the same order as in compute_cell().
+ *
+ * @param index Index of the cell to compute.
+ * @param constructor NewVoronoiCellConstructor to use.
+ * @return NewVoronoiCell.
+ */
+NewVoronoiCell
+NewVoronoiGrid::update_cell(unsigned int index,
+                            NewVoronoiCellConstructor &constructor) const {
+
+  constructor.setup(index, _real_generator_positions, _real_voronoi_box,
+                    _real_rescaled_positions, _real_rescaled_box, true);
+
+  const std::vector< VoronoiFace > &old_faces = _cells[index].get_faces();
+  for (auto faceit = old_faces.begin(); faceit != old_faces.end(); ++faceit) {
+    const unsigned int j = faceit->get_neighbour();
+    if (j < NEWVORONOICELL_MAX_INDEX) {
+      constructor.intersect(j, _real_rescaled_box, _real_rescaled_positions,
+                            _real_voronoi_box, _real_generator_positions);
+      newvoronoigrid_check_cell(cell_constructor);
+    }
+  }
+
+  auto it = _point_locations.get_neighbours(index);
+  do {
+    const PointLocations::ngbrange ngbs = it.get_neighbours();
+    for (auto ngbit = ngbs.begin(); ngbit != ngbs.end(); ++ngbit) {
+      const unsigned int j = *ngbit;
+      if (j == index) {
+        continue;
+      }
+      // skip the old neighbours, as they were already added
+      auto faceit = old_faces.begin();
+      while (faceit != old_faces.end() && faceit->get_neighbour() != j) {
+        ++faceit;
+      }
+      if (faceit == old_faces.end()) {
+        constructor.intersect(j, _real_rescaled_box, _real_rescaled_positions,
+                              _real_voronoi_box, _real_generator_positions);
+        newvoronoigrid_check_cell(cell_constructor);
+      }
+    }
+  } while (it.increase_range() &&
+           it.get_max_radius2() < constructor.get_max_radius_squared());
+
+  NewVoronoiCell cell =
+      constructor.get_cell(_real_voronoi_box, _real_generator_positions);
+
+  return cell;
+}
+
 /**
  * @brief Constructor.
  *
@@ -151,6 +209,8 @@ NewVoronoiGrid::NewVoronoiGrid(
   // (notice that the first range is closed, while the other range is half open)
   max_anchor -= min_anchor;
   max_anchor *= (1. + DBL_EPSILON);
+  _rescaling_anchor = min_anchor;
+  _rescaling_sides = max_anchor;
 
   const double box_bottom_anchor_x =
       1. + (box.get_anchor().x() - min_anchor.x()) / max_anchor.x();
@@ -181,10 +241,7 @@ NewVoronoiGrid::NewVoronoiGrid(
   const unsigned int psize = positions.size();
   _real_rescaled_positions.resize(psize);
   for (unsigned int i = 0; i < psize; ++i) {
-    const double x = 1. + (positions[i].x() - min_anchor.x()) / max_anchor.x();
-    const double y = 1. + (positions[i].y() - min_anchor.y()) / max_anchor.y();
-    const double z = 1. + (positions[i].z() - min_anchor.z()) / max_anchor.z();
-    _real_rescaled_positions[i] = CoordinateVector<>(x, y, z);
+    _real_rescaled_positions[i] = get_rescaled_position(positions[i]);
   }
 }
 
@@ -203,6 +260,7 @@ void NewVoronoiGrid::compute_grid(int worksize) {
 
   const unsigned int psize = _real_generator_positions.size();
   _cells.resize(psize);
+  _max_radius2.resize(psize);
 
   WorkDistributor< NewVoronoiGridConstructionJobMarket,
                    NewVoronoiGridConstructionJob >
@@ -213,6 +271,79 @@ void NewVoronoiGrid::compute_grid(int worksize) {
   newvoronoigrid_check_volume();
 }
 
+/**
+ * @brief Update the Voronoi grid after the generator positions have changed.
+ *
+ * Only the cells that could have changed are recomputed: cells whose generator
+ * moved, cells with a neighbour that moved, and cells for which a generator
+ * that moved now lies within the maximal influence radius. The PointLocations
+ * grid is updated rather than reconstructed, and the neighbours in the
+ * previous grid are used as the initial candidates for the new cells (see
+ * update_cell()).
+ *
+ * This assumes the number of generators did not change and compute_grid()
+ * was called before.
+ *
+ * @param worksize Number of shared memory threads to use during the grid
+ * update.
+ * @return True, since the grid can always be updated.
+ */
+bool NewVoronoiGrid::update_grid(int worksize) {
+
+  const unsigned int psize = _real_generator_positions.size();
+  cmac_assert(psize == _cells.size());
+
+  std::vector< bool > moved(psize, false);
+  for (unsigned int i = 0; i < psize; ++i) {
+    const CoordinateVector<> rescaled_position =
+        get_rescaled_position(_real_generator_positions[i]);
+    if (!(rescaled_position == _real_rescaled_positions[i])) {
+      _real_rescaled_positions[i] = rescaled_position;
+      moved[i] = true;
+    }
+  }
+
+  _point_locations.update_positions();
+
+  _update_indices.clear();
+  for (unsigned int i = 0; i < psize; ++i) {
+    bool update = moved[i];
+    const std::vector< VoronoiFace > &faces = _cells[i].get_faces();
+    for (auto faceit = faces.begin(); faceit != faces.end() && !update;
+         ++faceit) {
+      const unsigned int j = faceit->get_neighbour();
+      update = (j < NEWVORONOICELL_MAX_INDEX && moved[j]);
+    }
+    if (!update) {
+      // a generator that moved could have entered the region of influence of
+      // the cell, in which case it might have become a new neighbour
+      auto it = _point_locations.get_neighbours(i);
+      do {
+        const PointLocations::ngbrange ngbs = it.get_neighbours();
+        for (unsigned int k = 0; k < ngbs.size() && !update; ++k) {
+          update = moved[ngbs.get_index(k)] &&
+                   (ngbs.get_position(k) - _real_generator_positions[i])
+                           .norm2() < _max_radius2[i];
+        }
+      } while (!update && it.increase_range() &&
+               it.get_max_radius2() < _max_radius2[i]);
+    }
+    if (update) {
+      _update_indices.push_back(i);
+    }
+  }
+
+  WorkDistributor< NewVoronoiGridConstructionJobMarket,
+                   NewVoronoiGridConstructionJob >
+      workers(worksize);
+  NewVoronoiGridConstructionJobMarket jobs(*this, 100, true);
+  workers.do_in_parallel(jobs);
+
+  newvoronoigrid_check_volume();
+
+  return true;
+}
+
 /**
  * @brief Get the volume of the cell with the given index.
  *
@@ -62,14 +62,44 @@ private:
    *  [1,2[). */
   NewVoronoiBox _real_rescaled_box;
 
+  /*! @brief Anchor of the region that is mapped to the range [1,2[ (in m). */
+  CoordinateVector<> _rescaling_anchor;
+
+  /*! @brief Side lengths of the region that is mapped to the range [1,2[ (in
+   *  m). */
+  CoordinateVector<> _rescaling_sides;
+
   /*! @brief Voronoi cells. */
   std::vector< NewVoronoiCell > _cells;
 
+  /*! @brief Maximum distance (squared) between the generator of each cell and
+   *  another generator that could still change the cell (in m^2). */
+  std::vector< double > _max_radius2;
+
+  /*! @brief Indices of the cells that are recomputed during a grid update. */
+  std::vector< unsigned int > _update_indices;
+
   /*! @brief PointLocations object used to speed up neighbour searching. */
   PointLocations _point_locations;
 
+  /**
+   * @brief Get the rescaled representation of the given position.
+   *
+   * @param position Position (in m).
+   * @return Rescaled position (in the range [1,2[).
+   */
+  inline CoordinateVector<>
+  get_rescaled_position(const CoordinateVector<> &position) const {
+    return CoordinateVector<>(
+        1. + (position.x() - _rescaling_anchor.x()) / _rescaling_sides.x(),
+        1. + (position.y() - _rescaling_anchor.y()) / _rescaling_sides.y(),
+        1. + (position.z() - _rescaling_anchor.z()) / _rescaling_sides.z());
+  }
+
   NewVoronoiCell compute_cell(unsigned int index,
                               NewVoronoiCellConstructor &constructor) const;
+  NewVoronoiCell update_cell(unsigned int index,
+                             NewVoronoiCellConstructor &constructor) const;
 
   /**
    * @brief Job that constructs part of the Voronoi grid.
@@ -85,6 +115,10 @@ private:
     /*! @brief Index of the beyond last cell that this job will construct. */
     unsigned int _last_index;
 
+    /*! @brief Are we updating the grid? If so, the cell range refers to
+     *  NewVoronoiGrid::_update_indices instead of to the cells. */
+    const bool _update;
+
     /*! @brief NewVoronoiCellConstructor object used by this thread. */
     NewVoronoiCellConstructor _constructor;
 
@@ -93,9 +127,10 @@ private:
      * @brief Constructor.
      *
      * @param grid Reference to the NewVoronoiGrid we are constructing.
+     * @param update Are we updating the grid?
      */
-    inline NewVoronoiGridConstructionJob(NewVoronoiGrid &grid)
-        : _grid(grid), _first_index(0), _last_index(0) {}
+    inline NewVoronoiGridConstructionJob(NewVoronoiGrid &grid, bool update)
+        : _grid(grid), _first_index(0), _last_index(0), _update(update) {}
 
     /**
      * @brief Update the cell range that will be constructed during the next run
@@ -124,7 +159,14 @@ private:
      */
     inline void execute() {
       for (unsigned int i = _first_index; i < _last_index; ++i) {
-        _grid._cells[i] = _grid.compute_cell(i, _constructor);
+        if (_update) {
+          const unsigned int index = _grid._update_indices[i];
+          _grid._cells[index] = _grid.update_cell(index, _constructor);
+          _grid._max_radius2[index] = _constructor.get_max_radius_squared();
+        } else {
+          _grid._cells[i] = _grid.compute_cell(i, _constructor);
+          _grid._max_radius2[i] = _constructor.get_max_radius_squared();
+        }
       }
     }
 
@@ -156,16 +198,22 @@ private:
     /*! @brief Lock used to ensure safe access to the internal index. */
     Lock _lock;
 
+    /*! @brief Are we updating the grid? */
+    const bool _update;
+
   public:
     /**
      * @brief Constructor.
      *
      * @param grid NewVoronoiGrid we want to construct.
      * @param jobsize Number of cell constructed by a single job.
+     * @param update Are we updating the grid? If so, only the cells in
+     * NewVoronoiGrid::_update_indices are recomputed.
      */
     inline NewVoronoiGridConstructionJobMarket(NewVoronoiGrid &grid,
-                                               unsigned int jobsize)
-        : _grid(grid), _current_index(0), _jobsize(jobsize) {
+                                               unsigned int jobsize,
+                                               bool update = false)
+        : _grid(grid), _current_index(0), _jobsize(jobsize), _update(update) {
 
       for (unsigned int i = 0; i < MAX_NUM_THREADS; ++i) {
         _jobs[i] = nullptr;
@@ -191,7 +239,7 @@ private:
      */
     inline void set_worksize(int worksize) {
       for (int i = 0; i < worksize; ++i) {
-        _jobs[i] = new NewVoronoiGridConstructionJob(_grid);
+        _jobs[i] = new NewVoronoiGridConstructionJob(_grid, _update);
       }
     }
 
@@ -203,7 +251,8 @@ private:
      * NewVoronoiGridConstructionJob.
      */
     inline NewVoronoiGridConstructionJob *get_job(int thread_id) {
-      const unsigned int cellsize = _grid._cells.size();
+      const unsigned int cellsize =
+          _update ? _grid._update_indices.size() : _grid._cells.size();
       if (_current_index == cellsize) {
         return nullptr;
       }
@@ -235,6 +284,7 @@ public:
   /// grid computation methods
 
   virtual void compute_grid(int worksize = -1);
+  virtual bool update_grid(int worksize = -1);
 
   /// cell/grid property access
 
@@ -0,0 +1,244 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PhiloxRandomGenerator.hpp
+ *
+ * @brief Counter-based Philox4x32-10 random number generator.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef PHILOXRANDOMGENERATOR_HPP
+#define PHILOXRANDOMGENERATOR_HPP
+
+#include <cstdint>
+
+/*! @brief First Philox4x32 multiplier. */
+#define PHILOXRANDOMGENERATOR_M0 0xD2511F53u
+
+/*! @brief Second Philox4x32 multiplier. */
+#define PHILOXRANDOMGENERATOR_M1 0xCD9E8D57u
+
+/*! @brief First Philox4x32 key increment (golden ratio). */
+#define PHILOXRANDOMGENERATOR_W0 0x9E3779B9u
+
+/*! @brief Second Philox4x32 key increment (sqrt(3) - 1). */
+#define PHILOXRANDOMGENERATOR_W1 0xBB67AE85u
+
+/*! @brief Number of rounds of the Philox4x32 bijection. */
+#define PHILOXRANDOMGENERATOR_NUMROUND 10
+
+/**
+ * @brief Counter-based random number generator, based on the Philox4x32-10
+ * bijection of Salmon et al. (2011).
+ *
+ * Every random number is a pure function of a key (the seed), a stream index
+ * and a draw index within that stream. There is no sequential state apart from
+ * the draw counter, so that the random numbers for a given photon do not depend
+ * on which thread or process handles that photon, or on how many photons were
+ * handled before.
+ *
+ * A single evaluation of the bijection yields 128 random bits, which are
+ * converted into two double precision values with the full 53 bits of
+ * precision.
+ */
+class PhiloxRandomGenerator {
+private:
+  /*! @brief Key (derived from the seed). */
+  uint32_t _key[2];
+
+  /*! @brief Index of the current stream. */
+  uint64_t _stream;
+
+  /*! @brief Index of the next block of 128 bits within the current stream. */
+  uint64_t _block;
+
+  /*! @brief Second value of the last generated block, if it was not used
+   *  yet. */
+  double _buffer;
+
+  /*! @brief Is _buffer still available? */
+  bool _has_buffer;
+
+  /**
+   * @brief Convert 64 random bits into a uniform random double in the open
+   * interval (0., 1.).
+   *
+   * We use the upper 53 bits and center the value in its bin, so that 0 and 1
+   * can never be returned.
+   *
+   * @param high Upper 32 random bits.
+   * @param low Lower 32 random bits.
+   * @return Uniform random double precision value.
+   */
+  static inline double to_double(uint32_t high, uint32_t low) {
+    const uint64_t bits = ((static_cast< uint64_t >(high) << 32) | low) >> 11;
+    return (bits + 0.5) * (1. / 9007199254740992.);
+  }
+
+public:
+  /**
+   * @brief Apply the Philox4x32-10 bijection to the given counter.
+   *
+   * @param counter Counter (4 32-bit words).
+   * @param key Key (2 32-bit words).
+   * @param result Array to store the resulting 4 random 32-bit words in.
+   */
+  static inline void philox(const uint32_t counter[4], const uint32_t key[2],
+                            uint32_t result[4]) {
+    uint32_t x0 = counter[0];
+    uint32_t x1 = counter[1];
+    uint32_t x2 = counter[2];
+    uint32_t x3 = counter[3];
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (unsigned int i = 0; i < PHILOXRANDOMGENERATOR_NUMROUND; ++i) {
+      const uint64_t p0 =
+          static_cast< uint64_t >(PHILOXRANDOMGENERATOR_M0) * x0;
+      const uint64_t p1 =
+          static_cast< uint64_t >(PHILOXRANDOMGENERATOR_M1) * x2;
+      x0 = static_cast< uint32_t >(p1 >> 32) ^ x1 ^ k0;
+      x1 = static_cast< uint32_t >(p1);
+      x2 = static_cast< uint32_t >(p0 >> 32) ^ x3 ^ k1;
+      x3 = static_cast< uint32_t >(p0);
+      k0 += PHILOXRANDOMGENERATOR_W0;
+      k1 += PHILOXRANDOMGENERATOR_W1;
+    }
+    result[0] = x0;
+    result[1] = x1;
+    result[2] = x2;
+    result[3] = x3;
+  }
+
+  /**
+   * @brief Get the two uniform random doubles that correspond to the given
+   * seed, stream and block.
+   *
+   * This routine is stateless and can be called from any thread.
+   *
+   * @param key Key (2 32-bit words).
+   * @param stream Index of the stream.
+   * @param block Index of the block within the stream.
+   * @param values Array to store the two random values in.
+   */
+  static inline void get_block(const uint32_t key[2], uint64_t stream,
+                               uint64_t block, double values[2]) {
+    const uint32_t counter[4] = {static_cast< uint32_t >(block),
+                                 static_cast< uint32_t >(block >> 32),
+                                 static_cast< uint32_t >(stream),
+                                 static_cast< uint32_t >(stream >> 32)};
+    uint32_t result[4];
+    philox(counter, key, result);
+    values[0] = to_double(result[0], result[1]);
+    values[1] = to_double(result[2], result[3]);
+  }
+
+  /**
+   * @brief Set a new seed for the random generator.
+   *
+   * This also resets the stream to 0.
+   *
+   * @param seed New seed.
+   */
+  inline void set_seed(int seed) {
+    _key[0] = static_cast< uint32_t >(seed);
+    _key[1] = 0;
+    set_stream(0);
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param seed Initial seed for the random number generator.
+   */
+  inline PhiloxRandomGenerator(int seed = 42) { set_seed(seed); }
+
+  /**
+   * @brief Select the random stream with the given index and restart at its
+   * first draw.
+   *
+   * @param stream Index of the stream (e.g. the index of a photon).
+   */
+  inline void set_stream(unsigned long stream) {
+    _stream = stream;
+    _block = 0;
+    _has_buffer = false;
+  }
+
+  /**
+   * @brief Get a uniform random double precision floating point value in the
+   * range (0., 1.).
+   *
+   * Note that this function changes the internal draw counter of the
+   * RandomGenerator.
+   *
+   * @return Random double precision floating point value.
+   */
+  inline double get_uniform_random_double() {
+    if (_has_buffer) {
+      _has_buffer = false;
+      return _buffer;
+    }
+    double values[2];
+    get_block(_key, _stream, _block, values);
+    ++_block;
+    _buffer = values[1];
+    _has_buffer = true;
+    return values[0];
+  }
+
+  /**
+   * @brief Fill the given array with uniform random double precision floating
+   * point values in the range (0., 1.).
+   *
+   * The result is the same as for the corresponding number of calls to
+   * get_uniform_random_double(), but the blocks are generated in a tight loop
+   * without branches, which the compiler can vectorize.
+   *
+   * @param values Array to fill.
+   * @param number Number of values to generate.
+   */
+  inline void get_uniform_random_doubles(double *values, unsigned int number) {
+    unsigned int i = 0;
+    if (_has_buffer && number > 0) {
+      values[0] = _buffer;
+      _has_buffer = false;
+      i = 1;
+    }
+    const unsigned int numblock = (number - i) / 2;
+    for (unsigned int j = 0; j < numblock; ++j) {
+      get_block(_key, _stream, _block + j, values + i + 2 * j);
+    }
+    _block += numblock;
+    i += 2 * numblock;
+    if (i < number) {
+      values[i] = get_uniform_random_double();
+    }
+  }
+
+  /**
+   * @brief Get a random integer value.
+   *
+   * @return Random integer value in the range [0, 2^24].
+   */
+  inline int get_random_integer() {
+    return get_uniform_random_double() * 16777216.0;
+  }
+};
+
+#endif // PHILOXRANDOMGENERATOR_HPP
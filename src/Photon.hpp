@@ -29,6 +29,10 @@
 #include "CoordinateVector.hpp"
 #include "ElementNames.hpp"
 
+/*! @brief Source index of a Photon that is not located at the position of a
+ *  discrete photon source. */
+#define PHOTON_NO_SOURCE 0xffffffff
+
 /**
  * @brief Photon types.
  *
@@ -75,6 +79,11 @@ private:
   /*! @brief Weight of the photon. */
   double _weight;
 
+  /*! @brief Index of the discrete photon source at whose position the photon
+   *  currently is (PHOTON_NO_SOURCE if the photon was not emitted by a
+   *  discrete source or has moved since). */
+  unsigned int _source_index;
+
 public:
   /**
    * @brief Constructor.
@@ -86,7 +95,8 @@ public:
   inline Photon(CoordinateVector<> position, CoordinateVector<> direction,
                 double energy)
       : _position(position), _direction(direction), _energy(energy),
-        _cross_section_He_corr(0.), _type(PHOTONTYPE_PRIMARY), _weight(1.) {
+        _cross_section_He_corr(0.), _type(PHOTONTYPE_PRIMARY), _weight(1.),
+        _source_index(PHOTON_NO_SOURCE) {
     for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
       _cross_sections[i] = 0.;
     }
@@ -142,10 +152,13 @@ public:
   /**
    * @brief Set the position of the photon.
    *
+   * The photon is no longer located at its discrete source.
+   *
    * @param position New position of the photon (in m).
    */
   inline void set_position(CoordinateVector<> position) {
     _position = position;
+    _source_index = PHOTON_NO_SOURCE;
   }
 
   /**
@@ -204,6 +217,24 @@ public:
    * @return Weight of the Photon.
    */
   inline double get_weight() const { return _weight; }
+
+  /**
+   * @brief Set the index of the discrete photon source that emitted the
+   * Photon.
+   *
+   * @param source_index Index of the discrete photon source.
+   */
+  inline void set_source_index(unsigned int source_index) {
+    _source_index = source_index;
+  }
+
+  /**
+   * @brief Get the index of the discrete photon source at whose position the
+   * Photon currently is.
+   *
+   * @return Index of the discrete photon source, or PHOTON_NO_SOURCE.
+   */
+  inline unsigned int get_source_index() const { return _source_index; }
 };
 
 #endif // PHOTON_HPP
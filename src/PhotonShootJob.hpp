@@ -30,6 +30,7 @@
 #include "Photon.hpp"
 #include "PhotonSource.hpp"
 #include "RandomGenerator.hpp"
+#include "ReproducibleSum.hpp"
 
 /**
  * @brief Job implementation that shoots photons through a DensityGrid.
@@ -46,14 +47,18 @@ private:
   DensityGrid &_density_grid;
 
   /*! @brief Total weight of all photons. */
-  double _totweight;
+  ReproducibleSum _totweight;
 
   /*! @brief Total weights per photon type. */
-  double _typecount[PHOTONTYPE_NUMBER];
+  ReproducibleSum _typecount[PHOTONTYPE_NUMBER];
 
   /*! @brief Number of photons to propagate through the DensityGrid. */
   unsigned int _numphoton;
 
+  /*! @brief Global index of the first photon to propagate (used to select the
+   *  random stream of each photon). */
+  unsigned long _first_photon_index;
+
 public:
   /**
    * @brief Constructor.
@@ -66,8 +71,7 @@ public:
   inline PhotonShootJob(PhotonSource &photon_source, int random_seed,
                         DensityGrid &density_grid)
       : _photon_source(photon_source), _random_generator(random_seed),
-        _density_grid(density_grid), _totweight(0.), _typecount{0.},
-        _numphoton(0) {}
+        _density_grid(density_grid), _numphoton(0), _first_photon_index(0) {}
 
   /**
    * @brief Set the number of photons for the next execution of the job.
@@ -76,18 +80,32 @@ public:
    */
   inline void set_numphoton(unsigned int numphoton) { _numphoton = numphoton; }
 
+  /**
+   * @brief Set the global index of the first photon for the next execution of
+   * the job.
+   *
+   * @param first_photon_index Global index of the first photon.
+   */
+  inline void set_first_photon_index(unsigned long first_photon_index) {
+    _first_photon_index = first_photon_index;
+  }
+
   /**
    * @brief Update the given weight counters and reset the internal counters.
    *
+   * The counters are order independent sums, so that the result does not
+   * depend on how the photons were distributed over the jobs.
+   *
    * @param totweight Total weight of all photons.
    * @param typecount Total weights per photon type.
    */
-  inline void update_counters(double &totweight, double *typecount) {
+  inline void update_counters(ReproducibleSum &totweight,
+                              ReproducibleSum *typecount) {
     totweight += _totweight;
-    _totweight = 0.;
+    _totweight = ReproducibleSum();
     for (int i = 0; i < PHOTONTYPE_NUMBER; ++i) {
       typecount[i] += _typecount[i];
-      _typecount[i] = 0.;
+      _typecount[i] = ReproducibleSum();
     }
   }
 
@@ -103,6 +121,7 @@ public:
    */
   inline void execute() {
     for (unsigned int i = 0; i < _numphoton; ++i) {
+      _random_generator.set_stream(_first_photon_index + i);
       Photon photon = _photon_source.get_random_photon(_random_generator);
       double tau = -std::log(_random_generator.get_uniform_random_double());
       DensityGrid::iterator it = _density_grid.interact(photon, tau);
@@ -110,7 +129,8 @@ public:
              _photon_source.reemit(photon, it.get_ionization_variables(),
                                    _random_generator)) {
         tau = -std::log(_random_generator.get_uniform_random_double());
-        it = _density_grid.interact(photon, tau);
+        // the reemitted photon starts from the cell where it was absorbed
+        it = _density_grid.interact_from_cell(photon, tau, it);
       }
       _totweight += photon.get_weight();
       _typecount[photon.get_type()] += photon.get_weight();
@@ -26,8 +26,9 @@
 #ifndef PHOTONSHOOTJOBMARKET_HPP
 #define PHOTONSHOOTJOBMARKET_HPP
 
-#include "Lock.hpp"
+#include "Configuration.hpp"
 #include "PhotonShootJob.hpp"
+#include "WorkStealingScheduler.hpp"
 
 class PhotonSource;
 class RandomGenerator;
@@ -50,12 +51,17 @@ private:
   /*! @brief Total number of photons to propagate through the grid. */
   unsigned int _numphoton;
 
+  /*! @brief Global index of the first photon of the next run. */
+  unsigned long _photon_index;
+
+  /*! @brief Global index of the first photon of the current run. */
+  unsigned long _first_photon_index;
+
   /*! @brief Number of photons to shoot during a single PhotonShootJob. */
   unsigned int _jobsize;
 
-  /*! @brief Lock used to ensure safe access to the internal photon number
-   *  counters. */
-  Lock _lock;
+  /*! @brief Scheduler that distributes the photons over the threads. */
+  WorkStealingScheduler _scheduler;
 
 public:
   /**
@@ -71,12 +77,19 @@ public:
   inline PhotonShootJobMarket(PhotonSource &photon_source, int random_seed,
                               DensityGrid &density_grid, unsigned int numphoton,
                               unsigned int jobsize, int worksize)
-      : _worksize(worksize), _numphoton(numphoton), _jobsize(jobsize) {
+      : _worksize(worksize), _numphoton(numphoton), _photon_index(0),
+        _first_photon_index(0), _jobsize(jobsize) {
     // create a separate RandomGenerator for each thread.
     // create a single PhotonShootJob for each thread.
     for (int i = 0; i < _worksize; ++i) {
+#ifdef USE_COUNTER_BASED_RANDOM
+      // every photon has its own random stream, so all threads use the same
+      // seed
+      _jobs[i] = new PhotonShootJob(photon_source, random_seed, density_grid);
+#else
       _jobs[i] =
           new PhotonShootJob(photon_source, random_seed + i, density_grid);
+#endif
     }
   }
 
@@ -95,9 +108,22 @@ public:
    * @brief Set the number of parallel threads that will be used to execute
    * the jobs.
    *
+   * This routine is called at the start of every parallel run, and
+   * distributes the photons over the threads.
+   *
    * @param worksize Number of parallel threads that will be used.
    */
-  inline void set_worksize(int worksize) {}
+  inline void set_worksize(int worksize) {
+    if (worksize > _worksize) {
+      cmac_error("More threads requested than PhotonShootJobs available (%i "
+                 "threads, %i jobs)!",
+                 worksize, _worksize);
+    }
+    _scheduler.reset(_numphoton, worksize);
+    _first_photon_index = _photon_index;
+    _photon_index += _numphoton;
+    _numphoton = 0;
+  }
 
   /**
    * @brief Set the number of photons.
@@ -109,13 +135,28 @@ public:
    */
   inline void set_numphoton(unsigned int numphoton) { _numphoton = numphoton; }
 
+  /**
+   * @brief Set the global index of the next photon that will be handed out.
+   *
+   * Photons are handed out in contiguous index ranges, and the index of a
+   * photon determines its random stream (if the counter-based random generator
+   * is used). Subsequent runs continue from the last index that was handed
+   * out.
+   *
+   * @param photon_index Global index of the next photon.
+   */
+  inline void set_photon_index(unsigned long photon_index) {
+    _photon_index = photon_index;
+  }
+
   /**
    * @brief Update the given weight counters.
    *
    * @param totweight Total weight of all photons.
    * @param typecount Total weights per photon type.
    */
-  inline void update_counters(double &totweight, double *typecount) {
+  inline void update_counters(ReproducibleSum &totweight,
+                              ReproducibleSum *typecount) {
     for (int i = 0; i < _worksize; ++i) {
       _jobs[i]->update_counters(totweight, typecount);
     }
@@ -129,15 +170,10 @@ public:
    * @return PhotonShootJob.
    */
   inline PhotonShootJob *get_job(int thread_id) {
-    unsigned int jobsize = std::max(_numphoton / (10 * _worksize), _jobsize);
-    _lock.lock();
-    if (jobsize >= _numphoton) {
-      jobsize = _numphoton;
-    }
-    _numphoton -= jobsize;
-    _lock.unlock();
-    if (jobsize > 0) {
-      _jobs[thread_id]->set_numphoton(jobsize);
+    unsigned long begin, end;
+    if (_scheduler.get_range(thread_id, _jobsize, begin, end)) {
+      _jobs[thread_id]->set_numphoton(end - begin);
+      _jobs[thread_id]->set_first_photon_index(_first_photon_index + begin);
       return _jobs[thread_id];
     } else {
       return nullptr;
@@ -67,23 +67,21 @@ PhotonSource::PhotonSource(PhotonSourceDistribution *distribution,
   double continuous_luminosity = 0.;
   if (distribution != nullptr) {
     _discrete_positions.resize(distribution->get_number_of_sources());
-    _discrete_probabilities.resize(distribution->get_number_of_sources());
+    std::vector< double > weights(distribution->get_number_of_sources());
+    double total_weight = 0.;
     for (unsigned int i = 0; i < _discrete_positions.size(); ++i) {
       _discrete_positions[i] = distribution->get_position(i);
-      if (i > 0) {
-        _discrete_probabilities[i] =
-            _discrete_probabilities[i - 1] + distribution->get_weight(i);
-      } else {
-        _discrete_probabilities[i] = distribution->get_weight(i);
-      }
+      weights[i] = distribution->get_weight(i);
+      total_weight += weights[i];
     }
-    if (_discrete_probabilities.size() > 0) {
-      if (std::abs(_discrete_probabilities.back() - 1.) > 1.e-9) {
+    if (weights.size() > 0) {
+      if (std::abs(total_weight - 1.) > 1.e-9) {
         cmac_error("Discrete source weights do not sum to 1.0 (%g)!",
-                   _discrete_probabilities.back());
-      } else {
-        _discrete_probabilities.back() = 1.;
+                   total_weight);
       }
+      // the alias table allows us to sample a source in constant time,
+      // independent of the number of sources
+      _discrete_probabilities = AliasTable(weights);
     }
     discrete_luminosity = distribution->get_total_luminosity();
 
@@ -145,10 +143,11 @@ PhotonSource::PhotonSource(PhotonSourceDistribution *distribution,
  * @param energy Energy of the photon (in Hz).
  */
 void PhotonSource::set_cross_sections(Photon &photon, double energy) const {
+  double cross_sections[NUMBER_OF_IONNAMES];
+  _cross_sections.get_cross_sections(energy, cross_sections);
   for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
     IonName ion = static_cast< IonName >(i);
-    photon.set_cross_section(ion,
-                             _cross_sections.get_cross_section(ion, energy));
+    photon.set_cross_section(ion, cross_sections[i]);
   }
   photon.set_cross_section_He_corr(_abundances.get_abundance(ELEMENT_He) *
                                    photon.get_cross_section(ION_He_n));
@@ -167,19 +166,16 @@ PhotonSource::get_random_photon(RandomGenerator &random_generator) const {
   CoordinateVector<> position, direction;
   double energy;
   double weight;
+  unsigned int source_index = PHOTON_NO_SOURCE;
 
   double x = random_generator.get_uniform_random_double();
   if (x >= _continuous_probability) {
     cmac_assert(_discrete_probabilities.size() > 0);
-    cmac_assert(_discrete_probabilities.back() == 1.);
     // discrete photon
     x = random_generator.get_uniform_random_double();
-    unsigned int i = 0;
-    while (x > _discrete_probabilities[i]) {
-      ++i;
-      cmac_assert(i < _discrete_probabilities.size());
-    }
+    const unsigned int i = _discrete_probabilities.sample(x);
     position = _discrete_positions[i];
+    source_index = i;
     direction = get_random_direction(random_generator);
     energy = _discrete_spectrum->get_random_frequency(random_generator);
     weight = _discrete_photon_weight;
@@ -198,6 +194,7 @@ PhotonSource::get_random_photon(RandomGenerator &random_generator) const {
   set_cross_sections(photon, energy);
 
   photon.set_weight(weight);
+  photon.set_source_index(source_index);
 
   return photon;
 }
@@ -26,6 +26,7 @@
 #ifndef PHOTONSOURCE_HPP
 #define PHOTONSOURCE_HPP
 
+#include "AliasTable.hpp"
 #include "CoordinateVector.hpp"
 #include "DensityGrid.hpp"
 #include "HeliumLymanContinuumSpectrum.hpp"
@@ -68,9 +69,9 @@ private:
   /*! @brief Weight of discrete photons. */
   double _discrete_photon_weight;
 
-  /*! @brief Probabilities that a photon is emitted by a specific discrete
-   *  source. */
-  std::vector< double > _discrete_probabilities;
+  /*! @brief Alias table containing the probabilities that a photon is
+   *  emitted by a specific discrete source. */
+  AliasTable _discrete_probabilities;
 
   /// continuous sources
 
@@ -142,6 +143,16 @@ public:
 
   double get_total_luminosity() const;
 
+  /**
+   * @brief Get the positions of the discrete photon sources.
+   *
+   * @return Positions of the discrete photon sources (in m).
+   */
+  inline const std::vector< CoordinateVector<> > &
+  get_discrete_positions() const {
+    return _discrete_positions;
+  }
+
   bool reemit(Photon &photon, const IonizationVariables &ionization_variables,
               RandomGenerator &random_generator) const;
 };
@@ -90,6 +90,10 @@ PlanckPhotonSourceSpectrum::PlanckPhotonSourceSpectrum(double temperature,
     _log_frequency[i] = log10(_frequency[i]);
   }
 
+  // set up the guide table used to sample from the cumulative distribution
+  _guide_table.initialize(_cumulative_distribution,
+                          PLANCKPHOTONSOURCESPECTRUM_NUMFREQ);
+
   if (log) {
     log->write_status("Set up a Planck black body spectrum with temperature ",
                       temperature, " K.");
@@ -129,8 +133,7 @@ double PlanckPhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
   double x = random_generator.get_uniform_random_double();
 
-  unsigned int ix = Utilities::locate(x, _cumulative_distribution,
-                                      PLANCKPHOTONSOURCESPECTRUM_NUMFREQ);
+  unsigned int ix = _guide_table.locate(x, _cumulative_distribution);
   double log_random_frequency =
       (log10(x) - _log_cumulative_distribution[ix]) /
           (_log_cumulative_distribution[ix + 1] -
@@ -27,6 +27,7 @@
 #ifndef PLANCKPHOTONSOURCESPECTRUM_HPP
 #define PLANCKPHOTONSOURCESPECTRUM_HPP
 
+#include "GuideTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 
 #include <string>
@@ -59,6 +60,9 @@ private:
   /*! @brief Cumulative distribution in each bin. */
   double _cumulative_distribution[PLANCKPHOTONSOURCESPECTRUM_NUMFREQ];
 
+  /*! @brief GuideTable used to sample from the cumulative distribution. */
+  GuideTable _guide_table;
+
   /*! @brief Base 10 logarithm of the cumulative distribution in each bin. */
   double _log_cumulative_distribution[PLANCKPHOTONSOURCESPECTRUM_NUMFREQ];
 
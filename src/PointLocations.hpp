@@ -30,6 +30,7 @@
 #include "CoordinateVector.hpp"
 #include "Error.hpp"
 
+#include <algorithm>
 #include <tuple>
 #include <vector>
 
@@ -38,9 +39,19 @@
  */
 class PointLocations {
 private:
-  /*! @brief Grid containing indices. */
-  std::vector< std::vector< std::vector< std::vector< unsigned int > > > >
-      _grid;
+  /*! @brief Number of grid cells in each dimension. */
+  unsigned int _ncell_1D;
+
+  /*! @brief Offset of the first index of each grid cell in _grid_indices (the
+   *  number of grid cells plus one values). */
+  std::vector< unsigned int > _grid_offsets;
+
+  /*! @brief Indices of the positions, stored contiguously per grid cell. */
+  std::vector< unsigned int > _grid_indices;
+
+  /*! @brief Copy of the positions, in the same order as _grid_indices (in
+   *  m). */
+  std::vector< CoordinateVector<> > _grid_positions;
 
   /*! @brief Map that maps indices to grid cells. */
   std::vector< std::tuple< unsigned int, unsigned int, unsigned int > >
@@ -55,6 +66,80 @@ private:
   /*! @brief Reference to the underlying positions. */
   const std::vector< CoordinateVector<> > &_positions;
 
+  /**
+   * @brief Get the indices of the grid cell that contains the given position.
+   *
+   * Positions on or beyond the upper edge of the grid are put in the last grid
+   * cell.
+   *
+   * @param position Position (in m).
+   * @return Indices of the grid cell that contains the position.
+   */
+  inline std::tuple< unsigned int, unsigned int, unsigned int >
+  get_grid_cell(const CoordinateVector<> &position) const {
+    const unsigned int ix =
+        (position.x() - _grid_anchor.x()) / _grid_cell_sides.x();
+    const unsigned int iy =
+        (position.y() - _grid_anchor.y()) / _grid_cell_sides.y();
+    const unsigned int iz =
+        (position.z() - _grid_anchor.z()) / _grid_cell_sides.z();
+    return std::tuple< unsigned int, unsigned int, unsigned int >(
+        std::min(ix, _ncell_1D - 1), std::min(iy, _ncell_1D - 1),
+        std::min(iz, _ncell_1D - 1));
+  }
+
+  /**
+   * @brief Get the linear index of the grid cell with the given indices.
+   *
+   * @param ix X index of the grid cell.
+   * @param iy Y index of the grid cell.
+   * @param iz Z index of the grid cell.
+   * @return Linear index of the grid cell.
+   */
+  inline unsigned int get_grid_index(unsigned int ix, unsigned int iy,
+                                     unsigned int iz) const {
+    return (ix * _ncell_1D + iy) * _ncell_1D + iz;
+  }
+
+  /**
+   * @brief Sort the position indices and the copies of the positions per grid
+   * cell, using a counting sort on the grid cell of every position.
+   *
+   * Within a grid cell, the positions are stored in the order of their index.
+   */
+  inline void sort_positions() {
+    const unsigned int positions_size = _positions.size();
+    const unsigned int grid_size = _ncell_1D * _ncell_1D * _ncell_1D;
+
+    // count the number of positions in each grid cell and convert the counts
+    // into offsets
+    _grid_offsets.assign(grid_size + 1, 0);
+    for (unsigned int i = 0; i < positions_size; ++i) {
+      ++_grid_offsets[get_grid_index(std::get< 0 >(_cell_map[i]),
+                                     std::get< 1 >(_cell_map[i]),
+                                     std::get< 2 >(_cell_map[i])) +
+                      1];
+    }
+    for (unsigned int i = 0; i < grid_size; ++i) {
+      _grid_offsets[i + 1] += _grid_offsets[i];
+    }
+
+    // now put every position in its place
+    std::vector< unsigned int > next_free(_grid_offsets.begin(),
+                                          _grid_offsets.end() - 1);
+    _grid_indices.resize(positions_size);
+    _grid_positions.resize(positions_size);
+    for (unsigned int i = 0; i < positions_size; ++i) {
+      const unsigned int igrid = get_grid_index(std::get< 0 >(_cell_map[i]),
+                                                std::get< 1 >(_cell_map[i]),
+                                                std::get< 2 >(_cell_map[i]));
+      const unsigned int iplace = next_free[igrid];
+      ++next_free[igrid];
+      _grid_indices[iplace] = i;
+      _grid_positions[iplace] = _positions[i];
+    }
+  }
+
 public:
   /**
    * @brief Constructor.
@@ -101,18 +186,10 @@ public:
     const unsigned int ncell_1D = std::round(std::cbrt(desired_num_cell));
 
     // set up the geometrical quantities
+    _ncell_1D = ncell_1D;
     _grid_anchor = minpos;
     _grid_cell_sides = maxpos / ncell_1D;
 
-    // set up the positions grid
-    _grid.resize(ncell_1D);
-    for (unsigned int ix = 0; ix < ncell_1D; ++ix) {
-      _grid[ix].resize(ncell_1D);
-      for (unsigned int iy = 0; iy < ncell_1D; ++iy) {
-        _grid[ix][iy].resize(ncell_1D);
-      }
-    }
-
     // add the positions to the positions grid
     _cell_map.resize(positions_size);
     for (unsigned int i = 0; i < positions_size; ++i) {
@@ -122,13 +199,123 @@ public:
                   positions[i].y() <= maxpos.y());
       cmac_assert(positions[i].z() >= minpos.z() &&
                   positions[i].z() <= maxpos.z());
-      unsigned int ix = (positions[i].x() - minpos.x()) / maxpos.x() * ncell_1D;
-      unsigned int iy = (positions[i].y() - minpos.y()) / maxpos.y() * ncell_1D;
-      unsigned int iz = (positions[i].z() - minpos.z()) / maxpos.z() * ncell_1D;
-      _grid[ix][iy][iz].push_back(i);
-      _cell_map[i] =
-          std::tuple< unsigned int, unsigned int, unsigned int >(ix, iy, iz);
+      _cell_map[i] = get_grid_cell(positions[i]);
     }
+    sort_positions();
+  }
+
+  /**
+   * @brief Update the grid after the positions have changed.
+   *
+   * The geometry of the grid is not changed, so this only works if the
+   * positions are still inside the original grid box. This avoids the
+   * reallocation of all internal arrays that constructing a new PointLocations
+   * object would imply.
+   *
+   * @return Number of positions that changed grid cell.
+   */
+  inline unsigned int update_positions() {
+    unsigned int num_moved = 0;
+    for (unsigned int i = 0; i < _positions.size(); ++i) {
+      const std::tuple< unsigned int, unsigned int, unsigned int > new_cell =
+          get_grid_cell(_positions[i]);
+      if (new_cell != _cell_map[i]) {
+        _cell_map[i] = new_cell;
+        ++num_moved;
+      }
+    }
+    // the copies of the positions always need to be updated
+    sort_positions();
+    return num_moved;
+  }
+
+  /**
+   * @brief Contiguous range of positions that belong to a single grid cell.
+   *
+   * The range only contains pointers into the PointLocations arrays, so that
+   * it can be copied without allocating memory.
+   */
+  class ngbrange {
+  private:
+    /*! @brief Pointer to the first index in the range. */
+    const unsigned int *_begin;
+
+    /*! @brief Pointer to the beyond last index in the range. */
+    const unsigned int *_end;
+
+    /*! @brief Pointer to the position corresponding to the first index in the
+     *  range (in m). */
+    const CoordinateVector<> *_positions;
+
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param begin Pointer to the first index in the range.
+     * @param end Pointer to the beyond last index in the range.
+     * @param positions Pointer to the position corresponding to the first
+     * index in the range (in m).
+     */
+    inline ngbrange(const unsigned int *begin, const unsigned int *end,
+                    const CoordinateVector<> *positions)
+        : _begin(begin), _end(end), _positions(positions) {}
+
+    /**
+     * @brief Get a pointer to the first index in the range.
+     *
+     * @return Pointer to the first index in the range.
+     */
+    inline const unsigned int *begin() const { return _begin; }
+
+    /**
+     * @brief Get a pointer to the beyond last index in the range.
+     *
+     * @return Pointer to the beyond last index in the range.
+     */
+    inline const unsigned int *end() const { return _end; }
+
+    /**
+     * @brief Get the number of indices in the range.
+     *
+     * @return Number of indices in the range.
+     */
+    inline unsigned int size() const { return _end - _begin; }
+
+    /**
+     * @brief Get the index with the given position in the range.
+     *
+     * @param i Position in the range.
+     * @return Corresponding index.
+     */
+    inline unsigned int get_index(unsigned int i) const { return _begin[i]; }
+
+    /**
+     * @brief Get the position corresponding to the index with the given
+     * position in the range.
+     *
+     * @param i Position in the range.
+     * @return Position corresponding to the index (in m).
+     */
+    inline const CoordinateVector<> &get_position(unsigned int i) const {
+      return _positions[i];
+    }
+  };
+
+  /**
+   * @brief Get the range of positions in the grid cell with the given indices.
+   *
+   * @param ix X index of the grid cell.
+   * @param iy Y index of the grid cell.
+   * @param iz Z index of the grid cell.
+   * @return ngbrange containing the positions in the grid cell.
+   */
+  inline ngbrange get_grid_cell_range(unsigned int ix, unsigned int iy,
+                                      unsigned int iz) const {
+    const unsigned int igrid = get_grid_index(ix, iy, iz);
+    const unsigned int first = _grid_offsets[igrid];
+    const unsigned int last = _grid_offsets[igrid + 1];
+    return ngbrange(_grid_indices.data() + first, _grid_indices.data() + last,
+                    _grid_positions.data() + first);
   }
 
   /**
@@ -234,9 +421,9 @@ public:
       const unsigned int ax = std::get< 0 >(_anchor);
       const unsigned int ay = std::get< 1 >(_anchor);
       const unsigned int az = std::get< 2 >(_anchor);
-      const unsigned int sx = _locations._grid.size();
-      const unsigned int sy = _locations._grid[0].size();
-      const unsigned int sz = _locations._grid[0][0].size();
+      const unsigned int sx = _locations._ncell_1D;
+      const unsigned int sy = _locations._ncell_1D;
+      const unsigned int sz = _locations._ncell_1D;
       int &mx = std::get< 0 >(_maxrange);
       int &my = std::get< 1 >(_maxrange);
       int &mz = std::get< 2 >(_maxrange);
@@ -263,16 +450,16 @@ public:
     }
 
     /**
-     * @brief Get a list of neighbours currently within the range of the
-     * iterator.
+     * @brief Get the neighbours currently within the range of the iterator.
      *
-     * @return std::vector containing the indices of neighbouring points.
+     * @return ngbrange containing the indices (and positions) of neighbouring
+     * points.
      */
-    inline const std::vector< unsigned int > &get_neighbours() const {
+    inline ngbrange get_neighbours() const {
       const unsigned int ix = std::get< 0 >(_anchor) + std::get< 0 >(_range);
       const unsigned int iy = std::get< 1 >(_anchor) + std::get< 1 >(_range);
       const unsigned int iz = std::get< 2 >(_anchor) + std::get< 2 >(_range);
-      return _locations._grid[ix][iy][iz];
+      return _locations.get_grid_cell_range(ix, iy, iz);
     }
 
     /**
@@ -321,9 +508,9 @@ public:
       const int ax = std::get< 0 >(_anchor);
       const int ay = std::get< 1 >(_anchor);
       const int az = std::get< 2 >(_anchor);
-      const int sx = _locations._grid.size();
-      const int sy = _locations._grid[0].size();
-      const int sz = _locations._grid[0][0].size();
+      const int sx = _locations._ncell_1D;
+      const int sy = _locations._ncell_1D;
+      const int sz = _locations._ncell_1D;
       return ax + rx >= 0 && ax + rx < sx && ay + ry >= 0 && ay + ry < sy &&
              az + rz >= 0 && az + rz < sz;
     }
@@ -359,9 +546,9 @@ public:
         //        const int ax = std::get< 0 >(_anchor);
         //        const int ay = std::get< 1 >(_anchor);
         //        const int az = std::get< 2 >(_anchor);
-        //        const int sx = _locations._grid.size();
-        //        const int sy = _locations._grid[0].size();
-        //        const int sz = _locations._grid[0][0].size();
+        //        const int sx = _locations._ncell_1D;
+        //        const int sy = _locations._ncell_1D;
+        //        const int sz = _locations._ncell_1D;
         //        if (oldlevel <= ax) {
         _lower_bound[0] -= _locations._grid_cell_sides.x();
         //        }
@@ -523,9 +710,9 @@ public:
            _locations._grid_cell_sides.y();
       az = (position.z() - _locations._grid_anchor.z()) /
            _locations._grid_cell_sides.z();
-      const unsigned int sx = _locations._grid.size();
-      const unsigned int sy = _locations._grid[0].size();
-      const unsigned int sz = _locations._grid[0][0].size();
+      const unsigned int sx = _locations._ncell_1D;
+      const unsigned int sy = _locations._ncell_1D;
+      const unsigned int sz = _locations._ncell_1D;
       int &mx = std::get< 0 >(_maxrange);
       int &my = std::get< 1 >(_maxrange);
       int &mz = std::get< 2 >(_maxrange);
@@ -552,16 +739,16 @@ public:
     }
 
     /**
-     * @brief Get a list of neighbours currently within the range of the
-     * iterator.
+     * @brief Get the neighbours currently within the range of the iterator.
      *
-     * @return std::vector containing the indices of neighbouring points.
+     * @return ngbrange containing the indices (and positions) of neighbouring
+     * points.
      */
-    inline const std::vector< unsigned int > &get_neighbours() const {
+    inline ngbrange get_neighbours() const {
       const unsigned int ix = std::get< 0 >(_anchor) + std::get< 0 >(_range);
       const unsigned int iy = std::get< 1 >(_anchor) + std::get< 1 >(_range);
       const unsigned int iz = std::get< 2 >(_anchor) + std::get< 2 >(_range);
-      return _locations._grid[ix][iy][iz];
+      return _locations.get_grid_cell_range(ix, iy, iz);
     }
 
     /**
@@ -610,9 +797,9 @@ public:
       const int ax = std::get< 0 >(_anchor);
       const int ay = std::get< 1 >(_anchor);
       const int az = std::get< 2 >(_anchor);
-      const int sx = _locations._grid.size();
-      const int sy = _locations._grid[0].size();
-      const int sz = _locations._grid[0][0].size();
+      const int sx = _locations._ncell_1D;
+      const int sy = _locations._ncell_1D;
+      const int sz = _locations._ncell_1D;
       return ax + rx >= 0 && ax + rx < sx && ay + ry >= 0 && ay + ry < sy &&
              az + rz >= 0 && az + rz < sz;
     }
@@ -639,30 +826,16 @@ public:
       }
       if (level > oldlevel) {
         // increase exclusion range
-        const int ax = std::get< 0 >(_anchor);
-        const int ay = std::get< 1 >(_anchor);
-        const int az = std::get< 2 >(_anchor);
-        const int sx = _locations._grid.size();
-        const int sy = _locations._grid[0].size();
-        const int sz = _locations._grid[0][0].size();
-        if (oldlevel <= ax) {
-          _lower_bound[0] -= _locations._grid_cell_sides.x();
-        }
-        if (oldlevel <= ay) {
-          _lower_bound[1] -= _locations._grid_cell_sides.y();
-        }
-        if (oldlevel <= az) {
-          _lower_bound[2] -= _locations._grid_cell_sides.z();
-        }
-        if (oldlevel + ax < sx) {
-          _upper_bound[0] += _locations._grid_cell_sides.x();
-        }
-        if (oldlevel + ay < sy) {
-          _upper_bound[1] += _locations._grid_cell_sides.y();
-        }
-        if (oldlevel + az < sz) {
-          _upper_bound[2] += _locations._grid_cell_sides.z();
-        }
+        // all positions are inside the grid, so the part of the covered region
+        // that lies outside the grid is covered as well. Limiting the covered
+        // region to the grid would make searches close to the edge of the grid
+        // loop over (almost) the entire grid (see ngbiterator)
+        _lower_bound[0] -= _locations._grid_cell_sides.x();
+        _lower_bound[1] -= _locations._grid_cell_sides.y();
+        _lower_bound[2] -= _locations._grid_cell_sides.z();
+        _upper_bound[0] += _locations._grid_cell_sides.x();
+        _upper_bound[1] += _locations._grid_cell_sides.y();
+        _upper_bound[2] += _locations._grid_cell_sides.z();
       }
       return true;
     }
@@ -697,44 +870,44 @@ public:
   get_closest_neighbour(const CoordinateVector<> cpos) const {
     cmac_assert_message(cpos.x() >= _grid_anchor.x() &&
                             cpos.x() < _grid_anchor.x() +
-                                           _grid.size() * _grid_cell_sides.x(),
+                                           _ncell_1D * _grid_cell_sides.x(),
                         "%g [%g %g]", cpos.x(), _grid_anchor.x(),
-                        _grid_anchor.x() + _grid.size() * _grid_cell_sides.x());
+                        _grid_anchor.x() + _ncell_1D * _grid_cell_sides.x());
     cmac_assert_message(
         cpos.y() >= _grid_anchor.y() &&
             cpos.y() <
-                _grid_anchor.y() + _grid[0].size() * _grid_cell_sides.y(),
+                _grid_anchor.y() + _ncell_1D * _grid_cell_sides.y(),
         "%g [%g %g]", cpos.y(), _grid_anchor.y(),
-        _grid_anchor.y() + _grid[0].size() * _grid_cell_sides.y());
+        _grid_anchor.y() + _ncell_1D * _grid_cell_sides.y());
     cmac_assert_message(
         cpos.z() >= _grid_anchor.z() &&
             cpos.z() <
-                _grid_anchor.z() + _grid[0][0].size() * _grid_cell_sides.z(),
+                _grid_anchor.z() + _ncell_1D * _grid_cell_sides.z(),
         "%g [%g %g]", cpos.z(), _grid_anchor.z(),
-        _grid_anchor.z() + _grid[0][0].size() * _grid_cell_sides.z());
+        _grid_anchor.z() + _ncell_1D * _grid_cell_sides.z());
 
     generalngbiterator it(*this, cpos);
 
+    // the positions of the neighbours are stored contiguously per grid cell,
+    // so we can read them without going through the indices
     double minr2 = -1.;
     unsigned int minindex = 0;
-    auto ngbs = it.get_neighbours();
-    for (auto ngbit = ngbs.begin(); ngbit != ngbs.end(); ++ngbit) {
-      const CoordinateVector<> &ngbpos = _positions[*ngbit];
-      const double ngbr2 = (ngbpos - cpos).norm2();
+    ngbrange ngbs = it.get_neighbours();
+    for (unsigned int i = 0; i < ngbs.size(); ++i) {
+      const double ngbr2 = (ngbs.get_position(i) - cpos).norm2();
       if (minr2 < 0. || ngbr2 < minr2) {
         minr2 = ngbr2;
-        minindex = *ngbit;
+        minindex = ngbs.get_index(i);
       }
     }
     while (it.increase_range() &&
            (minr2 < 0 || minr2 >= it.get_max_radius2())) {
       ngbs = it.get_neighbours();
-      for (auto ngbit = ngbs.begin(); ngbit != ngbs.end(); ++ngbit) {
-        const CoordinateVector<> &ngbpos = _positions[*ngbit];
-        const double ngbr2 = (ngbpos - cpos).norm2();
+      for (unsigned int i = 0; i < ngbs.size(); ++i) {
+        const double ngbr2 = (ngbs.get_position(i) - cpos).norm2();
         if (minr2 < 0. || ngbr2 < minr2) {
           minr2 = ngbr2;
-          minindex = *ngbit;
+          minindex = ngbs.get_index(i);
         }
       }
     }
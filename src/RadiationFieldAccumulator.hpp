@@ -0,0 +1,436 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file RadiationFieldAccumulator.hpp
+ *
+ * @brief Thread private accumulation buffers for the mean intensity and heating
+ * integrals.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef RADIATIONFIELDACCUMULATOR_HPP
+#define RADIATIONFIELDACCUMULATOR_HPP
+
+#include "Atomic.hpp"
+#include "Configuration.hpp"
+#include "Error.hpp"
+#include "IonizationVariables.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+/*! @brief Number of cells in a single accumulator tile. */
+#define RADIATIONFIELDACCUMULATOR_TILESIZE 4096
+
+/*! @brief Number of accumulated values per cell: one mean intensity integral
+ *  per ion, followed by the heating terms. */
+#define RADIATIONFIELDACCUMULATOR_NUMVALUE                                     \
+  (NUMBER_OF_IONNAMES + NUMBER_OF_HEATINGTERMS)
+
+/*! @brief Minimum number of private copies of the grid that all threads
+ *  together can allocate by default, before threads fall back to the shared
+ *  tiles. */
+#define RADIATIONFIELDACCUMULATOR_MIN_PRIVATE_COPIES 4
+
+/*! @brief Number of threads per additional private copy of the grid that all
+ *  threads together can allocate by default. */
+#define RADIATIONFIELDACCUMULATOR_THREADS_PER_PRIVATE_COPY 4
+
+/**
+ * @brief Thread private accumulation buffers for the mean intensity and heating
+ * integrals.
+ *
+ * Every thread accumulates its contributions into its own buffer, so that no
+ * locking is required during photon propagation. The buffers are sharded into
+ * tiles of RADIATIONFIELDACCUMULATOR_TILESIZE cells, and a tile is only
+ * allocated when the owning thread first writes to it. This way, a thread only
+ * pays for the part of the grid that it actually visits, and the memory is
+ * first touched by the thread that uses it.
+ *
+ * A photon field that covers the entire grid (e.g. a central source) makes
+ * every thread visit every tile, so that the private buffers would grow to
+ * (number of threads) x (number of cells) x RADIATIONFIELDACCUMULATOR_NUMVALUE
+ * doubles (128 bytes per cell per thread; 69 GB for a 256^3 grid and 32
+ * threads). To bound this, the number of private tiles per thread is capped so
+ * that all threads together never hold more than a given number of private
+ * copies of the grid. By default, this number scales with the number of
+ * threads: one copy per RADIATIONFIELDACCUMULATOR_THREADS_PER_PRIVATE_COPY
+ * threads, with a minimum of RADIATIONFIELDACCUMULATOR_MIN_PRIVATE_COPIES
+ * copies (8 copies for 32 threads). Once a thread has used up its share, it
+ * adds its contributions for new tiles to a single shared copy of that tile
+ * instead, using atomic additions, so that threads that share a tile never
+ * wait for each other. The total memory usage is hence at most
+ * (maximum number of private copies + 1) x (number of cells) x 128 bytes.
+ *
+ * After all photons have been propagated, the buffers are summed into the
+ * IonizationVariables of the cells using reduce(), which also resets the
+ * buffers for the next iteration. Different cells can be reduced in parallel.
+ */
+class RadiationFieldAccumulator {
+private:
+  /*! @brief Number of cells in the grid. */
+  unsigned long _numcell;
+
+  /*! @brief Tiles for every thread (a tile is a nullptr until the thread first
+   *  writes to it). */
+  std::vector< std::vector< double * > > _tiles;
+
+  /*! @brief Number of private tiles allocated by every thread. */
+  std::vector< unsigned long > _number_of_private_tiles;
+
+  /*! @brief Number of threads that actually write to the buffers. */
+  int _number_of_threads;
+
+  /*! @brief Requested maximum number of private copies of the grid (0 means
+   *  the number of copies scales with the number of threads). */
+  unsigned int _requested_private_copies;
+
+  /*! @brief Maximum number of private copies of the grid shared out over all
+   *  threads. */
+  unsigned int _max_private_copies;
+
+  /*! @brief Maximum number of private tiles a single thread can allocate. */
+  unsigned long _max_private_tiles;
+
+  /*! @brief Shared tiles that are used by threads that exceeded their private
+   *  tile budget (a tile is a nullptr until it is first used). */
+  std::vector< std::atomic< double * > > _shared_tiles;
+
+  /**
+   * @brief Allocate a new zeroed tile.
+   *
+   * @return Pointer to the new tile.
+   */
+  inline static double *allocate_tile() {
+    double *tile = reinterpret_cast< double * >(
+        calloc(RADIATIONFIELDACCUMULATOR_TILESIZE *
+                   RADIATIONFIELDACCUMULATOR_NUMVALUE,
+               sizeof(double)));
+    if (tile == nullptr) {
+      cmac_error("Unable to allocate accumulator tile!");
+    }
+    return tile;
+  }
+
+  /**
+   * @brief Recompute the private tile budget of every thread for the current
+   * number of cells and threads.
+   */
+  inline void update_private_tile_budget() {
+    if (_requested_private_copies > 0) {
+      _max_private_copies = _requested_private_copies;
+    } else {
+      _max_private_copies =
+          std::max(RADIATIONFIELDACCUMULATOR_MIN_PRIVATE_COPIES,
+                   _number_of_threads /
+                       RADIATIONFIELDACCUMULATOR_THREADS_PER_PRIVATE_COPY);
+    }
+    // round up, so that a single thread can always hold all tiles if
+    // _max_private_copies is at least 1
+    _max_private_tiles =
+        (_max_private_copies * _shared_tiles.size() + _number_of_threads - 1) /
+        _number_of_threads;
+  }
+
+  /**
+   * @brief Get the shared tile with the given index, allocating it if it does
+   * not exist yet.
+   *
+   * Threads that race to allocate the same tile all allocate a new tile, but
+   * only one of them gets to store it; the others free theirs again.
+   *
+   * @param itile Index of the tile.
+   * @return Pointer to the shared tile.
+   */
+  inline double *get_shared_tile(unsigned long itile) {
+    double *shared_tile = _shared_tiles[itile].load();
+    if (shared_tile == nullptr) {
+      double *new_tile = allocate_tile();
+      if (_shared_tiles[itile].compare_exchange_strong(shared_tile, new_tile)) {
+        shared_tile = new_tile;
+      } else {
+        // another thread was faster: shared_tile now contains its tile
+        free(new_tile);
+      }
+    }
+    return shared_tile;
+  }
+
+  /**
+   * @brief Add the given contributions to the given tile.
+   *
+   * @param tile Tile.
+   * @param index Index of the cell.
+   * @param dmean_intensity Mean intensity integral contributions for all ions.
+   * @param dheating Heating integral contributions for all heating terms.
+   */
+  inline static void add_to_tile(double *tile, unsigned long index,
+                                 const double *dmean_intensity,
+                                 const double *dheating) {
+    double *values = tile +
+                     (index % RADIATIONFIELDACCUMULATOR_TILESIZE) *
+                         RADIATIONFIELDACCUMULATOR_NUMVALUE;
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      values[i] += dmean_intensity[i];
+    }
+    for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+      values[NUMBER_OF_IONNAMES + i] += dheating[i];
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param numcell Number of cells in the grid.
+   * @param numthread Maximum number of threads that will write to the buffers.
+   * @param max_private_copies Maximum number of private copies of the grid
+   * that all threads together can allocate (0 to scale the number of copies
+   * with the number of threads).
+   */
+  inline RadiationFieldAccumulator(unsigned long numcell = 0,
+                                   int numthread = MAX_NUM_THREADS,
+                                   unsigned int max_private_copies = 0)
+      : _numcell(0), _tiles(numthread), _number_of_private_tiles(numthread, 0),
+        _number_of_threads(numthread),
+        _requested_private_copies(max_private_copies), _max_private_copies(0),
+        _max_private_tiles(0) {
+    resize(numcell);
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Frees the tile memory.
+   */
+  inline ~RadiationFieldAccumulator() {
+    for (unsigned int ithread = 0; ithread < _tiles.size(); ++ithread) {
+      for (unsigned int itile = 0; itile < _tiles[ithread].size(); ++itile) {
+        free(_tiles[ithread][itile]);
+      }
+    }
+    for (unsigned int itile = 0; itile < _shared_tiles.size(); ++itile) {
+      free(_shared_tiles[itile].load());
+    }
+  }
+
+  /**
+   * @brief Set the number of cells in the grid.
+   *
+   * This routine only adds new (empty) tiles and should not be called while
+   * threads are accumulating contributions.
+   *
+   * @param numcell New number of cells (cannot be smaller than the current
+   * number of cells).
+   */
+  inline void resize(unsigned long numcell) {
+    if (numcell < _numcell) {
+      cmac_error("Cannot shrink a RadiationFieldAccumulator!");
+    }
+    _numcell = numcell;
+    const unsigned long numtile =
+        (_numcell + RADIATIONFIELDACCUMULATOR_TILESIZE - 1) /
+        RADIATIONFIELDACCUMULATOR_TILESIZE;
+    for (unsigned int ithread = 0; ithread < _tiles.size(); ++ithread) {
+      _tiles[ithread].resize(numtile, nullptr);
+    }
+    // std::atomic is not movable, so we cannot simply resize the vector
+    std::vector< std::atomic< double * > > shared_tiles(numtile);
+    for (unsigned int itile = 0; itile < numtile; ++itile) {
+      if (itile < _shared_tiles.size()) {
+        shared_tiles[itile].store(_shared_tiles[itile].load());
+      } else {
+        shared_tiles[itile].store(nullptr);
+      }
+    }
+    _shared_tiles.swap(shared_tiles);
+    update_private_tile_budget();
+  }
+
+  /**
+   * @brief Set the number of threads that will actually write to the buffers.
+   *
+   * The private tile budget of every thread is based on this number, so that
+   * the budget of threads that are not used is not lost. This routine should
+   * not be called while threads are accumulating contributions.
+   *
+   * @param numthread Number of threads (cannot be larger than the maximum
+   * number of threads set in the constructor).
+   */
+  inline void set_number_of_threads(int numthread) {
+    if (numthread < 1 || numthread > static_cast< int >(_tiles.size())) {
+      cmac_error("Invalid number of threads for RadiationFieldAccumulator (%i, "
+                 "maximum is %i)!",
+                 numthread, static_cast< int >(_tiles.size()));
+    }
+    _number_of_threads = numthread;
+    update_private_tile_budget();
+  }
+
+  /**
+   * @brief Get the number of cells in the grid.
+   *
+   * @return Number of cells.
+   */
+  inline unsigned long get_number_of_cells() const { return _numcell; }
+
+  /**
+   * @brief Get the number of threads that can write to the buffers.
+   *
+   * @return Number of threads.
+   */
+  inline int get_number_of_threads() const { return _tiles.size(); }
+
+  /**
+   * @brief Get the maximum number of private copies of the grid that all
+   * threads together can allocate.
+   *
+   * @return Maximum number of private copies.
+   */
+  inline unsigned int get_max_private_copies() const {
+    return _max_private_copies;
+  }
+
+  /**
+   * @brief Get the maximum number of private tiles a single thread can
+   * allocate.
+   *
+   * @return Maximum number of private tiles per thread.
+   */
+  inline unsigned long get_max_private_tiles() const {
+    return _max_private_tiles;
+  }
+
+  /**
+   * @brief Get the total size of the tiles that are currently allocated.
+   *
+   * @return Allocated memory (in bytes).
+   */
+  inline unsigned long get_allocated_size() const {
+    unsigned long size = 0;
+    for (unsigned int ithread = 0; ithread < _tiles.size(); ++ithread) {
+      for (unsigned int itile = 0; itile < _tiles[ithread].size(); ++itile) {
+        if (_tiles[ithread][itile] != nullptr) {
+          size += RADIATIONFIELDACCUMULATOR_TILESIZE *
+                  RADIATIONFIELDACCUMULATOR_NUMVALUE * sizeof(double);
+        }
+      }
+    }
+    for (unsigned int itile = 0; itile < _shared_tiles.size(); ++itile) {
+      if (_shared_tiles[itile].load() != nullptr) {
+        size += RADIATIONFIELDACCUMULATOR_TILESIZE *
+                RADIATIONFIELDACCUMULATOR_NUMVALUE * sizeof(double);
+      }
+    }
+    return size;
+  }
+
+  /**
+   * @brief Add the given contributions to the buffer of the given thread.
+   *
+   * Only the thread with the given rank should call this routine for that rank.
+   * If the thread has no private tile for the cell yet and has already used up
+   * its private tile budget, the contributions are atomically added to the
+   * shared tile.
+   *
+   * @param thread_id Rank of the calling thread.
+   * @param index Index of the cell.
+   * @param dmean_intensity Mean intensity integral contributions for all ions
+   * (without normalization factor, in m^3).
+   * @param dheating Heating integral contributions for all heating terms
+   * (without normalization factor, in m^3 s^-1).
+   */
+  inline void add(int thread_id, unsigned long index,
+                  const double *dmean_intensity, const double *dheating) {
+    const unsigned long itile = index / RADIATIONFIELDACCUMULATOR_TILESIZE;
+    double *&tile = _tiles[thread_id][itile];
+    if (tile == nullptr) {
+      if (_number_of_private_tiles[thread_id] < _max_private_tiles) {
+        tile = allocate_tile();
+        ++_number_of_private_tiles[thread_id];
+      } else {
+        // private budget exhausted: use the shared tile
+        double *values = get_shared_tile(itile) +
+                         (index % RADIATIONFIELDACCUMULATOR_TILESIZE) *
+                             RADIATIONFIELDACCUMULATOR_NUMVALUE;
+        for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+          Atomic::add(values[i], dmean_intensity[i]);
+        }
+        for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+          Atomic::add(values[NUMBER_OF_IONNAMES + i], dheating[i]);
+        }
+        return;
+      }
+    }
+    add_to_tile(tile, index, dmean_intensity, dheating);
+  }
+
+  /**
+   * @brief Add the contributions of all threads for the given cell to the
+   * given IonizationVariables and reset the buffers for that cell.
+   *
+   * Different cells can safely be reduced in parallel.
+   *
+   * @param index Index of the cell.
+   * @param ionization_variables IonizationVariables of the cell.
+   */
+  inline void reduce(unsigned long index,
+                     IonizationVariables &ionization_variables) {
+    const unsigned long itile = index / RADIATIONFIELDACCUMULATOR_TILESIZE;
+    const unsigned long offset = (index % RADIATIONFIELDACCUMULATOR_TILESIZE) *
+                                 RADIATIONFIELDACCUMULATOR_NUMVALUE;
+    double sum[RADIATIONFIELDACCUMULATOR_NUMVALUE] = {0.};
+    bool touched = false;
+    for (unsigned int ithread = 0; ithread < _tiles.size(); ++ithread) {
+      double *tile = _tiles[ithread][itile];
+      if (tile != nullptr) {
+        touched = true;
+        double *values = tile + offset;
+        for (int i = 0; i < RADIATIONFIELDACCUMULATOR_NUMVALUE; ++i) {
+          sum[i] += values[i];
+          values[i] = 0.;
+        }
+      }
+    }
+    double *shared_tile = _shared_tiles[itile].load();
+    if (shared_tile != nullptr) {
+      touched = true;
+      double *values = shared_tile + offset;
+      for (int i = 0; i < RADIATIONFIELDACCUMULATOR_NUMVALUE; ++i) {
+        sum[i] += values[i];
+        values[i] = 0.;
+      }
+    }
+    if (touched) {
+      for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+        const IonName ion = static_cast< IonName >(i);
+        ionization_variables.increase_mean_intensity(ion, sum[i]);
+      }
+      for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+        const HeatingTermName name = static_cast< HeatingTermName >(i);
+        ionization_variables.increase_heating(name,
+                                              sum[NUMBER_OF_IONNAMES + i]);
+      }
+    }
+  }
+};
+
+#endif // RADIATIONFIELDACCUMULATOR_HPP
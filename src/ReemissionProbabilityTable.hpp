@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file ReemissionProbabilityTable.hpp
+ *
+ * @brief Tabulated probabilities for the different reemission channels of
+ * absorbed ionizing photons.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef REEMISSIONPROBABILITYTABLE_HPP
+#define REEMISSIONPROBABILITYTABLE_HPP
+
+#include "IonizationVariables.hpp"
+#include "TemperatureTable.hpp"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Tabulated probabilities for the different reemission channels of
+ * absorbed ionizing photons.
+ *
+ * The probabilities are evaluated once on the grid points of a
+ * TemperatureTable. Temperatures outside the table range use the exact fits.
+ */
+class ReemissionProbabilityTable {
+private:
+  /*! @brief Temperature grid. */
+  const TemperatureTable _table;
+
+  /*! @brief Tabulated probabilities, for every reemission channel. */
+  std::vector< double > _values;
+
+public:
+  /**
+   * @brief Get the exact reemission probabilities at the given temperature.
+   *
+   * The helium probabilities are cumulative, so that they can be directly
+   * compared with a uniform random number.
+   *
+   * @param temperature Temperature (in K).
+   * @param probabilities Array to store the NUMBER_OF_REEMISSIONPROBABILITIES
+   * probabilities in.
+   */
+  inline static void get_exact_probabilities(double temperature,
+                                             double *probabilities) {
+    const double T4 = temperature * 1.e-4;
+
+    const double alpha_1_H = 1.58e-13 * std::pow(T4, -0.53);
+    const double alpha_A_agn = 4.18e-13 * std::pow(T4, -0.7);
+    probabilities[REEMISSIONPROBABILITY_HYDROGEN] = alpha_1_H / alpha_A_agn;
+
+    const double alpha_1_He = 1.54e-13 * std::pow(T4, -0.486);
+    const double alpha_e_2tS = 2.1e-13 * std::pow(T4, -0.381);
+    const double alpha_e_2sS = 2.06e-14 * std::pow(T4, -0.451);
+    const double alpha_e_2sP = 4.17e-14 * std::pow(T4, -0.695);
+    // We make sure the sum of all probabilities is 1...
+    const double alphaHe = alpha_1_He + alpha_e_2tS + alpha_e_2sS + alpha_e_2sP;
+
+    const double He_LyC = alpha_1_He / alphaHe;
+    const double He_NpEEv = He_LyC + alpha_e_2tS / alphaHe;
+    const double He_TPC = He_NpEEv + alpha_e_2sS / alphaHe;
+    const double He_LyA = He_TPC + alpha_e_2sP / alphaHe;
+    // make cumulative
+    probabilities[REEMISSIONPROBABILITY_HELIUM_LYC] = He_LyC;
+    probabilities[REEMISSIONPROBABILITY_HELIUM_NPEEV] = He_NpEEv;
+    probabilities[REEMISSIONPROBABILITY_HELIUM_TPC] = He_TPC;
+    probabilities[REEMISSIONPROBABILITY_HELIUM_LYA] = He_LyA;
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param table Temperature grid.
+   */
+  inline ReemissionProbabilityTable(const TemperatureTable &table)
+      : _table(table), _values(NUMBER_OF_REEMISSIONPROBABILITIES *
+                               table.get_number_of_points()) {
+
+    const unsigned int numpoint = _table.get_number_of_points();
+    for (unsigned int i = 0; i < numpoint; ++i) {
+      double probabilities[NUMBER_OF_REEMISSIONPROBABILITIES];
+      get_exact_probabilities(_table.get_temperature(i), probabilities);
+      for (int j = 0; j < NUMBER_OF_REEMISSIONPROBABILITIES; ++j) {
+        _values[j * numpoint + i] = probabilities[j];
+      }
+    }
+  }
+
+  /**
+   * @brief Get the reemission probabilities at the given temperature.
+   *
+   * @param temperature Temperature (in K).
+   * @param probabilities Array to store the NUMBER_OF_REEMISSIONPROBABILITIES
+   * probabilities in.
+   */
+  inline void get_probabilities(double temperature,
+                                double *probabilities) const {
+    unsigned int index;
+    double fraction;
+    if (_table.get_interpolation(temperature, index, fraction)) {
+      const unsigned int numpoint = _table.get_number_of_points();
+      for (int j = 0; j < NUMBER_OF_REEMISSIONPROBABILITIES; ++j) {
+        probabilities[j] = TemperatureTable::interpolate(
+            &_values[j * numpoint], index, fraction);
+      }
+    } else {
+      get_exact_probabilities(temperature, probabilities);
+    }
+  }
+};
+
+#endif // REEMISSIONPROBABILITYTABLE_HPP
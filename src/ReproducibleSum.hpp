@@ -0,0 +1,248 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file ReproducibleSum.hpp
+ *
+ * @brief Floating point sum whose result does not depend on the order of the
+ * additions.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef REPRODUCIBLESUM_HPP
+#define REPRODUCIBLESUM_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*! @brief Number of bins that are used to store the sum. */
+#define REPRODUCIBLESUM_NUMBIN 3
+
+/*! @brief Number of bits in a single bin. Every addition adds less than
+ *  2^REPRODUCIBLESUM_BINWIDTH to the integer value of a bin, so that a sum can
+ *  safely hold 2^(63 - REPRODUCIBLESUM_BINWIDTH) values. */
+#define REPRODUCIBLESUM_BINWIDTH 30
+
+/*! @brief Bin index of an empty sum (lower than the bin index of any double
+ *  precision value). */
+#define REPRODUCIBLESUM_EMPTYBIN -100000
+
+/**
+ * @brief Floating point sum whose result does not depend on the order of the
+ * additions.
+ *
+ * Floating point addition is not associative, so that the result of a sum
+ * over values that are added by different threads or processes changes with
+ * the order in which the values arrive. This class instead stores the sum in
+ * REPRODUCIBLESUM_NUMBIN integer bins that each cover REPRODUCIBLESUM_BINWIDTH
+ * bits of a fixed binary grid (the binned summation of Demmel & Nguyen, 2013).
+ * The bins are anchored on the largest value in the sum, and every value is
+ * split into its parts in each bin, which are added to the integer bins
+ * exactly. When a larger value arrives, the lowest bins are dropped, which is
+ * equivalent to truncating all earlier values on the new grid. The result
+ * therefore only depends on the set of values that were added, and has a
+ * precision of about REPRODUCIBLESUM_NUMBIN * REPRODUCIBLESUM_BINWIDTH - 2
+ * bits relative to the largest value.
+ *
+ * Sums can also be combined, again independently of the order in which this
+ * happens.
+ */
+class ReproducibleSum {
+private:
+  /*! @brief Index of the highest bin: bin i covers the values in
+   *  [2^(i*REPRODUCIBLESUM_BINWIDTH), 2^((i+1)*REPRODUCIBLESUM_BINWIDTH)[. */
+  int _bin;
+
+  /*! @brief Integer contents of the bins, starting with the highest bin. */
+  int64_t _slices[REPRODUCIBLESUM_NUMBIN];
+
+  /**
+   * @brief Get the index of the bin that contains the most significant bit of
+   * the given non zero value.
+   *
+   * @param value Non zero value.
+   * @return Bin index.
+   */
+  static inline int get_value_bin(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(double));
+    int exponent = (bits >> 52) & 0x7ff;
+    if (exponent > 0) {
+      // normal number: same convention as std::frexp
+      exponent -= 1022;
+    } else {
+      std::frexp(value, &exponent);
+    }
+    // integer division that rounds towards minus infinity
+    return (exponent >= 0) ? exponent / REPRODUCIBLESUM_BINWIDTH
+                           : -((REPRODUCIBLESUM_BINWIDTH - 1 - exponent) /
+                               REPRODUCIBLESUM_BINWIDTH);
+  }
+
+  /**
+   * @brief Multiply the given value with 2 to the power of the given exponent.
+   *
+   * @param value Value.
+   * @param exponent Exponent.
+   * @return value x 2^exponent.
+   */
+  static inline double scale(double value, int exponent) {
+    if (exponent > -1023 && exponent < 1024) {
+      // construct the power of 2 directly from its bit representation
+      const uint64_t bits = static_cast< uint64_t >(exponent + 1023) << 52;
+      double factor;
+      std::memcpy(&factor, &bits, sizeof(double));
+      return value * factor;
+    } else {
+      return std::ldexp(value, exponent);
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param value Initial value of the sum.
+   */
+  inline ReproducibleSum(double value = 0.) : _bin(REPRODUCIBLESUM_EMPTYBIN) {
+    for (unsigned int i = 0; i < REPRODUCIBLESUM_NUMBIN; ++i) {
+      _slices[i] = 0;
+    }
+    add(value);
+  }
+
+  /**
+   * @brief Get the index of the highest bin.
+   *
+   * @return Index of the highest bin.
+   */
+  inline int get_bin() const { return _bin; }
+
+  /**
+   * @brief Access the integer contents of the bins.
+   *
+   * @return Pointer to the REPRODUCIBLESUM_NUMBIN bins, starting with the
+   * highest bin.
+   */
+  inline int64_t *get_slices() { return _slices; }
+
+  /**
+   * @brief Anchor the sum on the given bin, if that is higher than the
+   * current highest bin.
+   *
+   * This drops the contents of the bins that fall below the new lowest bin.
+   *
+   * @param bin New highest bin.
+   */
+  inline void align(int bin) {
+    if (bin > _bin) {
+      const int shift = bin - _bin;
+      for (int i = REPRODUCIBLESUM_NUMBIN - 1; i >= 0; --i) {
+        _slices[i] = (i >= shift) ? _slices[i - shift] : 0;
+      }
+      _bin = bin;
+    }
+  }
+
+  /**
+   * @brief Add the given value to the sum.
+   *
+   * @param value Value to add.
+   */
+  inline void add(double value) {
+    if (value == 0.) {
+      return;
+    }
+    align(get_value_bin(value));
+    // express the value in units of the highest bin: the integer part then
+    // fits in the highest bin, and every multiplication with
+    // 2^REPRODUCIBLESUM_BINWIDTH moves the next bin into the integer part
+    // all operations below are exact
+    double remainder =
+        scale(std::abs(value), -_bin * REPRODUCIBLESUM_BINWIDTH);
+    const int64_t sign = (value < 0.) ? -1 : 1;
+    for (int i = 0; i < REPRODUCIBLESUM_NUMBIN; ++i) {
+      // the remainder is positive and smaller than 2^REPRODUCIBLESUM_BINWIDTH,
+      // so that truncation is the same as rounding down
+      const int64_t slice = static_cast< int64_t >(remainder);
+      _slices[i] += sign * slice;
+      remainder = (remainder - slice) * (1 << REPRODUCIBLESUM_BINWIDTH);
+    }
+  }
+
+  /**
+   * @brief Add the given sum to this sum.
+   *
+   * @param sum Other sum.
+   */
+  inline void add(const ReproducibleSum &sum) {
+    ReproducibleSum aligned(sum);
+    aligned.align(_bin);
+    align(aligned._bin);
+    for (int i = 0; i < REPRODUCIBLESUM_NUMBIN; ++i) {
+      _slices[i] += aligned._slices[i];
+    }
+  }
+
+  /**
+   * @brief Add the given value to the sum.
+   *
+   * @param value Value to add.
+   * @return Reference to the updated sum.
+   */
+  inline ReproducibleSum &operator+=(double value) {
+    add(value);
+    return *this;
+  }
+
+  /**
+   * @brief Add the given sum to this sum.
+   *
+   * @param sum Other sum.
+   * @return Reference to the updated sum.
+   */
+  inline ReproducibleSum &operator+=(const ReproducibleSum &sum) {
+    add(sum);
+    return *this;
+  }
+
+  /**
+   * @brief Get the value of the sum, rounded to double precision.
+   *
+   * @return Value of the sum.
+   */
+  inline double get_value() const {
+    // we start with the lowest bin to minimize round off
+    double value = 0.;
+    for (int i = REPRODUCIBLESUM_NUMBIN - 1; i >= 0; --i) {
+      value += scale(static_cast< double >(_slices[i]),
+                     (_bin - i) * REPRODUCIBLESUM_BINWIDTH);
+    }
+    return value;
+  }
+
+  /**
+   * @brief Get the value of the sum, rounded to double precision.
+   *
+   * @return Value of the sum.
+   */
+  inline operator double() const { return get_value(); }
+};
+
+#endif // REPRODUCIBLESUM_HPP
@@ -0,0 +1,228 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SphericalRectangle.hpp
+ *
+ * @brief Solid angle subtended by a rectangle as seen from an external point,
+ * with uniform sampling of directions within that solid angle.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef SPHERICALRECTANGLE_HPP
+#define SPHERICALRECTANGLE_HPP
+
+#include "CoordinateVector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Solid angle subtended by a rectangle as seen from an external point,
+ * with uniform sampling of directions within that solid angle.
+ *
+ * Points on the rectangle are sampled so that the directions from the
+ * observer towards them are uniformly distributed in solid angle, using the
+ * closed form inversion of Urena, Fajardo & King, 2013, Computer Graphics
+ * Forum, 32, 59. No rejection is involved.
+ */
+class SphericalRectangle {
+private:
+  /*! @brief Position of the observer (in m). */
+  CoordinateVector<> _observer;
+
+  /*! @brief Unit vector along the first side of the rectangle. */
+  CoordinateVector<> _ex;
+
+  /*! @brief Unit vector along the second side of the rectangle. */
+  CoordinateVector<> _ey;
+
+  /*! @brief Unit normal of the rectangle, pointing away from the observer. */
+  CoordinateVector<> _ez;
+
+  /*! @brief Lower coordinate of the rectangle along the first side, in the
+   *  reference frame of the observer (in m). */
+  double _x0;
+
+  /*! @brief Upper coordinate of the rectangle along the first side, in the
+   *  reference frame of the observer (in m). */
+  double _x1;
+
+  /*! @brief Lower coordinate of the rectangle along the second side, in the
+   *  reference frame of the observer (in m). */
+  double _y0;
+
+  /*! @brief Upper coordinate of the rectangle along the second side, in the
+   *  reference frame of the observer (in m). */
+  double _y1;
+
+  /*! @brief (Negative) distance between the observer and the plane of the
+   *  rectangle (in m). */
+  double _z0;
+
+  /*! @brief Vertical component of the normal of the first edge plane. */
+  double _b0;
+
+  /*! @brief Vertical component of the normal of the third edge plane. */
+  double _b1;
+
+  /*! @brief Constant offset of the inverted cumulative solid angle. */
+  double _k;
+
+  /*! @brief Solid angle subtended by the rectangle (in sr). */
+  double _solid_angle;
+
+  /**
+   * @brief Get the unit normal of the plane through the observer and the two
+   * given rectangle corners.
+   *
+   * @param a First corner (relative to the observer).
+   * @param b Second corner (relative to the observer).
+   * @return Unit normal.
+   */
+  static inline CoordinateVector<> edge_normal(const CoordinateVector<> &a,
+                                               const CoordinateVector<> &b) {
+    const CoordinateVector<> n = CoordinateVector<>::cross_product(a, b);
+    return n / n.norm();
+  }
+
+  /**
+   * @brief Get the interior angle between two edge planes.
+   *
+   * @param na Normal of the first plane.
+   * @param nb Normal of the second plane.
+   * @return Interior angle (in radians).
+   */
+  static inline double interior_angle(const CoordinateVector<> &na,
+                                      const CoordinateVector<> &nb) {
+    const double cosg = -CoordinateVector<>::dot_product(na, nb);
+    return std::acos(std::max(-1., std::min(1., cosg)));
+  }
+
+public:
+  /**
+   * @brief Empty constructor.
+   */
+  inline SphericalRectangle()
+      : _x0(0.), _x1(0.), _y0(0.), _y1(0.), _z0(0.), _b0(0.), _b1(0.), _k(0.),
+        _solid_angle(0.) {}
+
+  /**
+   * @brief Constructor.
+   *
+   * @param observer Position of the observer (in m). Should not lie in the
+   * plane of the rectangle.
+   * @param corner Corner of the rectangle (in m).
+   * @param side_x First side of the rectangle, starting from the corner
+   * (in m).
+   * @param side_y Second side of the rectangle, starting from the corner and
+   * perpendicular to the first side (in m).
+   */
+  inline SphericalRectangle(const CoordinateVector<> &observer,
+                            const CoordinateVector<> &corner,
+                            const CoordinateVector<> &side_x,
+                            const CoordinateVector<> &side_y)
+      : _observer(observer) {
+
+    const double lx = side_x.norm();
+    const double ly = side_y.norm();
+    _ex = side_x / lx;
+    _ey = side_y / ly;
+    _ez = CoordinateVector<>::cross_product(_ex, _ey);
+
+    const CoordinateVector<> d = corner - observer;
+    _x0 = CoordinateVector<>::dot_product(d, _ex);
+    _y0 = CoordinateVector<>::dot_product(d, _ey);
+    _z0 = CoordinateVector<>::dot_product(d, _ez);
+    // the sampling algorithm expects the rectangle to lie below the observer
+    if (_z0 > 0.) {
+      _z0 = -_z0;
+      _ez = -1. * _ez;
+    }
+    _x1 = _x0 + lx;
+    _y1 = _y0 + ly;
+
+    const CoordinateVector<> v00(_x0, _y0, _z0);
+    const CoordinateVector<> v01(_x0, _y1, _z0);
+    const CoordinateVector<> v10(_x1, _y0, _z0);
+    const CoordinateVector<> v11(_x1, _y1, _z0);
+    const CoordinateVector<> n0 = edge_normal(v00, v10);
+    const CoordinateVector<> n1 = edge_normal(v10, v11);
+    const CoordinateVector<> n2 = edge_normal(v11, v01);
+    const CoordinateVector<> n3 = edge_normal(v01, v00);
+    const double g0 = interior_angle(n0, n1);
+    const double g1 = interior_angle(n1, n2);
+    const double g2 = interior_angle(n2, n3);
+    const double g3 = interior_angle(n3, n0);
+
+    _b0 = n0.z();
+    _b1 = n2.z();
+    _k = 2. * M_PI - g2 - g3;
+    // the solid angle is the spherical excess of the spherical quadrilateral
+    _solid_angle = std::max(g0 + g1 - _k, 0.);
+  }
+
+  /**
+   * @brief Get the solid angle subtended by the rectangle.
+   *
+   * @return Solid angle (in sr).
+   */
+  inline double get_solid_angle() const { return _solid_angle; }
+
+  /**
+   * @brief Get the point on the rectangle corresponding to the given pair of
+   * uniform random numbers.
+   *
+   * If both random numbers are uniformly distributed in [0, 1], the direction
+   * from the observer towards the returned point is uniformly distributed
+   * within the solid angle subtended by the rectangle.
+   *
+   * @param u First uniform random number.
+   * @param v Second uniform random number.
+   * @return Point on the rectangle (in m).
+   */
+  inline CoordinateVector<> get_point(double u, double v) const {
+
+    // invert the cumulative solid angle to find the x coordinate
+    const double au = u * _solid_angle + _k;
+    const double fu = (std::cos(au) * _b0 - _b1) / std::sin(au);
+    double cu = 1. / std::sqrt(fu * fu + _b0 * _b0);
+    if (fu <= 0.) {
+      cu = -cu;
+    }
+    cu = std::max(-1., std::min(1., cu));
+    double xu = -(cu * _z0) / std::sqrt(std::max(1. - cu * cu, 0.));
+    xu = std::max(_x0, std::min(_x1, xu));
+
+    // now sample the y coordinate along the line with fixed x
+    const double d2 = xu * xu + _z0 * _z0;
+    const double h0 = _y0 / std::sqrt(d2 + _y0 * _y0);
+    const double h1 = _y1 / std::sqrt(d2 + _y1 * _y1);
+    const double hv = h0 + v * (h1 - h0);
+    const double hv2 = hv * hv;
+    double yv = _y1;
+    if (hv2 < 1. - 1.e-12) {
+      yv = hv * std::sqrt(d2) / std::sqrt(1. - hv2);
+    }
+    yv = std::max(_y0, std::min(_y1, yv));
+
+    return _observer + xu * _ex + yv * _ey + _z0 * _ez;
+  }
+};
+
+#endif // SPHERICALRECTANGLE_HPP
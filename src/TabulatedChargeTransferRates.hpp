@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TabulatedChargeTransferRates.hpp
+ *
+ * @brief ChargeTransferRates that are interpolated on a temperature grid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef TABULATEDCHARGETRANSFERRATES_HPP
+#define TABULATEDCHARGETRANSFERRATES_HPP
+
+#include "ChargeTransferRates.hpp"
+#include "TemperatureTable.hpp"
+
+#include <vector>
+
+/*! @brief Highest ionization stage that is tabulated. */
+#define TABULATEDCHARGETRANSFERRATES_MAXSTAGE 5
+
+/*! @brief Highest atomic number that is tabulated. */
+#define TABULATEDCHARGETRANSFERRATES_MAXATOM 30
+
+/**
+ * @brief Types of charge transfer rates.
+ */
+enum ChargeTransferRateType {
+  /*! @brief Charge transfer recombination with neutral hydrogen. */
+  CHARGETRANSFERRATETYPE_RECOMBINATION = 0,
+  /*! @brief Charge transfer ionization by ionized hydrogen. */
+  CHARGETRANSFERRATETYPE_IONIZATION,
+  /*! @brief Charge transfer recombination with neutral helium. */
+  CHARGETRANSFERRATETYPE_RECOMBINATION_HE,
+  /*! @brief Number of charge transfer rate types. */
+  NUMBER_OF_CHARGETRANSFERRATETYPES
+};
+
+/**
+ * @brief ChargeTransferRates that are interpolated on a temperature grid.
+ *
+ * All rates for ionization stages up to TABULATEDCHARGETRANSFERRATES_MAXSTAGE
+ * and atomic numbers up to TABULATEDCHARGETRANSFERRATES_MAXATOM are evaluated
+ * once on the grid points of a TemperatureTable when the object is
+ * constructed. Rates that are zero for all temperatures in the table are not
+ * stored. Temperatures, stages and atoms outside the table are handled by the
+ * exact fits.
+ */
+class TabulatedChargeTransferRates : public ChargeTransferRates {
+private:
+  /*! @brief Temperature grid. */
+  const TemperatureTable _table;
+
+  /*! @brief Offset of the tabulated values for each rate type, stage and
+   *  atom in the value array (-1 if the rate is zero). */
+  int _offsets[NUMBER_OF_CHARGETRANSFERRATETYPES]
+              [TABULATEDCHARGETRANSFERRATES_MAXSTAGE]
+              [TABULATEDCHARGETRANSFERRATES_MAXATOM];
+
+  /*! @brief Tabulated rates (in m^3s^-1). */
+  std::vector< double > _values;
+
+  /**
+   * @brief Get the exact rate of the given type.
+   *
+   * @param type ChargeTransferRateType.
+   * @param stage Stage of ionization.
+   * @param atom Atomic number.
+   * @param temperature Temperature (in K).
+   * @return Exact charge transfer rate (in m^3s^-1).
+   */
+  inline double get_exact_rate(int type, unsigned char stage,
+                               unsigned char atom, double temperature) const {
+    switch (type) {
+    case CHARGETRANSFERRATETYPE_RECOMBINATION:
+      return ChargeTransferRates::get_charge_transfer_recombination_rate(
+          stage, atom, temperature);
+    case CHARGETRANSFERRATETYPE_IONIZATION:
+      return ChargeTransferRates::get_charge_transfer_ionization_rate(
+          stage, atom, temperature);
+    default:
+      return ChargeTransferRates::get_charge_transfer_recombination_rate_He(
+          stage, atom, temperature);
+    }
+  }
+
+  /**
+   * @brief Get the rate of the given type.
+   *
+   * @param type ChargeTransferRateType.
+   * @param stage Stage of ionization.
+   * @param atom Atomic number.
+   * @param temperature Temperature (in K).
+   * @return Charge transfer rate (in m^3s^-1).
+   */
+  inline double get_rate(int type, unsigned char stage, unsigned char atom,
+                         double temperature) const {
+    if (stage < 1 || stage > TABULATEDCHARGETRANSFERRATES_MAXSTAGE ||
+        atom < 1 || atom > TABULATEDCHARGETRANSFERRATES_MAXATOM) {
+      return get_exact_rate(type, stage, atom, temperature);
+    }
+    const int offset = _offsets[type][stage - 1][atom - 1];
+    if (offset < 0) {
+      return 0.;
+    }
+    unsigned int index;
+    double fraction;
+    if (_table.get_interpolation(temperature, index, fraction)) {
+      return TemperatureTable::interpolate(&_values[offset], index, fraction);
+    } else {
+      return get_exact_rate(type, stage, atom, temperature);
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * Reads in the data file and tabulates all rates.
+   *
+   * @param table Temperature grid.
+   */
+  inline TabulatedChargeTransferRates(const TemperatureTable &table)
+      : _table(table) {
+
+    const unsigned int numpoint = _table.get_number_of_points();
+    std::vector< double > row(numpoint);
+    for (int type = 0; type < NUMBER_OF_CHARGETRANSFERRATETYPES; ++type) {
+      for (unsigned char stage = 1;
+           stage <= TABULATEDCHARGETRANSFERRATES_MAXSTAGE; ++stage) {
+        for (unsigned char atom = 1;
+             atom <= TABULATEDCHARGETRANSFERRATES_MAXATOM; ++atom) {
+          int &offset = _offsets[type][stage - 1][atom - 1];
+          offset = -1;
+          // the Kingdon & Ferland data only contain ionization rates up to
+          // stage 4, higher stages have no charge transfer ionization
+          if (type == CHARGETRANSFERRATETYPE_IONIZATION &&
+              stage == TABULATEDCHARGETRANSFERRATES_MAXSTAGE) {
+            continue;
+          }
+          bool is_zero = true;
+          for (unsigned int i = 0; i < numpoint; ++i) {
+            row[i] =
+                get_exact_rate(type, stage, atom, _table.get_temperature(i));
+            is_zero &= (row[i] == 0.);
+          }
+          if (!is_zero) {
+            offset = _values.size();
+            _values.insert(_values.end(), row.begin(), row.end());
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Virtual destructor.
+   */
+  virtual ~TabulatedChargeTransferRates() {}
+
+  /**
+   * @brief Get the charge transfer recombination rate.
+   *
+   * @param stage Stage of ionization.
+   * @param atom Atomic number.
+   * @param temperature Temperature (in K).
+   * @return Charge transfer recombination rate (in m^3s^-1).
+   */
+  virtual double get_charge_transfer_recombination_rate(
+      unsigned char stage, unsigned char atom, double temperature) const {
+    return get_rate(CHARGETRANSFERRATETYPE_RECOMBINATION, stage, atom,
+                    temperature);
+  }
+
+  /**
+   * @brief Get the charge transfer ionization rate.
+   *
+   * @param stage Stage of ionization.
+   * @param atom Atomic number.
+   * @param temperature Temperature (in K).
+   * @return Charge transfer ionization rate (in m^3s^-1).
+   */
+  virtual double get_charge_transfer_ionization_rate(unsigned char stage,
+                                                     unsigned char atom,
+                                                     double temperature) const {
+    return get_rate(CHARGETRANSFERRATETYPE_IONIZATION, stage, atom,
+                    temperature);
+  }
+
+  /**
+   * @brief Get the charge transfer recombination rate with neutral helium.
+   *
+   * @param stage Stage of ionization.
+   * @param atom Atomic number.
+   * @param temperature Temperature (in K).
+   * @return Charge transfer recombination rate with neutral helium
+   * (in m^3s^-1).
+   */
+  virtual double get_charge_transfer_recombination_rate_He(
+      unsigned char stage, unsigned char atom, double temperature) const {
+    return get_rate(CHARGETRANSFERRATETYPE_RECOMBINATION_HE, stage, atom,
+                    temperature);
+  }
+
+  /**
+   * @brief Get the memory used by the tabulated rates.
+   *
+   * @return Size of the tables (in bytes).
+   */
+  inline unsigned long get_table_size() const {
+    return _values.size() * sizeof(double);
+  }
+};
+
+#endif // TABULATEDCHARGETRANSFERRATES_HPP
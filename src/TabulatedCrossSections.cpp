@@ -0,0 +1,266 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TabulatedCrossSections.cpp
+ *
+ * @brief Photoionization cross sections that are interpolated on a
+ * precomputed table: implementation.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "TabulatedCrossSections.hpp"
+#include "Error.hpp"
+#include "Log.hpp"
+#include "ParameterFile.hpp"
+#include <algorithm>
+
+/*! @brief Logarithmic frequency step used to scan for ionization edges. */
+#define TABULATEDCROSSSECTIONS_SCANSTEP 1.e-3
+
+/*! @brief Minimum relative change in the cross section over a single scan step
+ *  that is considered to be a candidate ionization edge. */
+#define TABULATEDCROSSSECTIONS_EDGEJUMP 0.01
+
+/*! @brief Initial number of intervals in a segment. */
+#define TABULATEDCROSSSECTIONS_MININTERVAL 16
+
+/*! @brief Maximum number of intervals in a segment. */
+#define TABULATEDCROSSSECTIONS_MAXINTERVAL (1u << 20)
+
+/**
+ * @brief Constructor.
+ *
+ * @param exact_cross_sections CrossSections to tabulate. The pointer is owned
+ * by this object and is deleted by its destructor.
+ * @param tolerance Maximum relative difference between the interpolated and
+ * the exact cross sections.
+ * @param minimum_frequency Minimum tabulated frequency (in Hz).
+ * @param maximum_frequency Maximum tabulated frequency (in Hz).
+ * @param log Log to write logging info to.
+ */
+TabulatedCrossSections::TabulatedCrossSections(
+    CrossSections *exact_cross_sections, double tolerance,
+    double minimum_frequency, double maximum_frequency, Log *log)
+    : _exact_cross_sections(exact_cross_sections),
+      _log_frequency_min(std::log(minimum_frequency)),
+      _log_frequency_max(std::log(maximum_frequency)) {
+
+  if (tolerance <= 0.) {
+    cmac_error("Tolerance for tabulated cross sections should be positive "
+               "(got %g)!",
+               tolerance);
+  }
+  if (minimum_frequency <= 0. || maximum_frequency <= minimum_frequency) {
+    cmac_error("Invalid frequency range for tabulated cross sections: [%g Hz, "
+               "%g Hz]!",
+               minimum_frequency, maximum_frequency);
+  }
+
+  for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+    tabulate(static_cast< IonName >(i), tolerance);
+  }
+
+  if (log) {
+    log->write_status("Tabulated cross sections in the range [",
+                      minimum_frequency, " Hz, ", maximum_frequency,
+                      " Hz] with relative tolerance ", tolerance, ", using ",
+                      _table.size(), " values.");
+  }
+}
+
+/**
+ * @brief ParameterFile constructor.
+ *
+ * Parameters are:
+ *  - tolerance: Maximum relative interpolation error (default: 1.e-4)
+ *  - minimum_frequency: Minimum tabulated frequency (default: 13. eV)
+ *  - maximum_frequency: Maximum tabulated frequency (default: 60. eV)
+ *
+ * @param exact_cross_sections CrossSections to tabulate. The pointer is owned
+ * by this object and is deleted by its destructor.
+ * @param params ParameterFile to read from.
+ * @param log Log to write logging info to.
+ */
+TabulatedCrossSections::TabulatedCrossSections(
+    CrossSections *exact_cross_sections, ParameterFile &params, Log *log)
+    : TabulatedCrossSections(
+          exact_cross_sections,
+          params.get_value< double >("crosssections:tolerance", 1.e-4),
+          params.get_physical_value< QUANTITY_FREQUENCY >(
+              "crosssections:minimum_frequency", "13. eV"),
+          params.get_physical_value< QUANTITY_FREQUENCY >(
+              "crosssections:maximum_frequency", "60. eV"),
+          log) {}
+
+/**
+ * @brief Destructor.
+ *
+ * Deletes the underlying CrossSections.
+ */
+TabulatedCrossSections::~TabulatedCrossSections() {
+  delete _exact_cross_sections;
+}
+
+/**
+ * @brief Set up the table for the given ion.
+ *
+ * We first scan the tabulated range for discontinuities in the cross section
+ * and locate them up to machine precision using bisection. The continuous
+ * parts in between are then tabulated on uniform logarithmic grids, whose
+ * resolution is doubled until the linear interpolation error at the interval
+ * midpoints is below the tolerance.
+ *
+ * @param ion IonName for a valid ion.
+ * @param tolerance Maximum relative interpolation error.
+ */
+void TabulatedCrossSections::tabulate(IonName ion, double tolerance) {
+
+  // locate the ionization edges
+  // every edge is stored as a pair of logarithmic frequencies that bracket the
+  // discontinuity as closely as possible
+  std::vector< double > left_limits;
+  std::vector< double > right_limits;
+  const unsigned int numscan =
+      std::ceil((_log_frequency_max - _log_frequency_min) /
+                TABULATEDCROSSSECTIONS_SCANSTEP);
+  const double scanstep = (_log_frequency_max - _log_frequency_min) / numscan;
+  double x_prev = _log_frequency_min;
+  double f_prev = _exact_cross_sections->get_cross_section(ion, std::exp(x_prev));
+  for (unsigned int i = 1; i < numscan + 1; ++i) {
+    const double x_next = _log_frequency_min + i * scanstep;
+    const double f_next =
+        _exact_cross_sections->get_cross_section(ion, std::exp(x_next));
+    const double fmax = std::max(std::abs(f_prev), std::abs(f_next));
+    if (std::abs(f_next - f_prev) > TABULATEDCROSSSECTIONS_EDGEJUMP * fmax) {
+      double xa = x_prev;
+      double fa = f_prev;
+      double xb = x_next;
+      double fb = f_next;
+      double xm = 0.5 * (xa + xb);
+      while (xm > xa && xm < xb) {
+        const double fm =
+            _exact_cross_sections->get_cross_section(ion, std::exp(xm));
+        if (std::abs(fm - fa) <= std::abs(fb - fm)) {
+          xa = xm;
+          fa = fm;
+        } else {
+          xb = xm;
+          fb = fm;
+        }
+        xm = 0.5 * (xa + xb);
+      }
+      // a steep but continuous part of the cross section converges to a zero
+      // jump and is handled by the refinement below
+      if (std::abs(fb - fa) >
+          tolerance * std::max(std::abs(fa), std::abs(fb))) {
+        left_limits.push_back(xa);
+        right_limits.push_back(xb);
+      }
+    }
+    x_prev = x_next;
+    f_prev = f_next;
+  }
+
+  // tabulate the continuous segments
+  const unsigned int numsegment = left_limits.size() + 1;
+  for (unsigned int iseg = 0; iseg < numsegment; ++iseg) {
+    const double xmin = (iseg == 0) ? _log_frequency_min : right_limits[iseg - 1];
+    const double xmax =
+        (iseg + 1 == numsegment) ? _log_frequency_max : left_limits[iseg];
+
+    std::vector< double > values;
+    unsigned int numinterval = TABULATEDCROSSSECTIONS_MININTERVAL;
+    bool converged = false;
+    while (!converged) {
+      const double dx = (xmax - xmin) / numinterval;
+      values.resize(numinterval + 1);
+      for (unsigned int i = 0; i < numinterval; ++i) {
+        values[i] =
+            _exact_cross_sections->get_cross_section(ion, std::exp(xmin + i * dx));
+      }
+      values[numinterval] =
+          _exact_cross_sections->get_cross_section(ion, std::exp(xmax));
+
+      converged = true;
+      for (unsigned int i = 0; i < numinterval && converged; ++i) {
+        const double exact = _exact_cross_sections->get_cross_section(
+            ion, std::exp(xmin + (i + 0.5) * dx));
+        const double interpolated = 0.5 * (values[i] + values[i + 1]);
+        converged = std::abs(interpolated - exact) <= tolerance * std::abs(exact);
+      }
+      if (!converged) {
+        if (numinterval == TABULATEDCROSSSECTIONS_MAXINTERVAL) {
+          cmac_error("Unable to tabulate cross sections with relative "
+                     "tolerance %g!",
+                     tolerance);
+        }
+        numinterval <<= 1;
+      }
+    }
+
+    TabulatedCrossSectionsSegment segment;
+    segment._log_frequency_min = xmin;
+    segment._inverse_log_frequency_step = numinterval / (xmax - xmin);
+    segment._offset = _table.size();
+    segment._last_interval = numinterval - 1;
+    _segments[ion].push_back(segment);
+    _table.insert(_table.end(), values.begin(), values.end());
+  }
+}
+
+/**
+ * @brief Get the photoionization cross section for the given ion at the given
+ * photon energy.
+ *
+ * @param ion IonName for a valid ion.
+ * @param energy Photon frequency (in Hz).
+ * @return Photoionization cross section (in m^2).
+ */
+double TabulatedCrossSections::get_cross_section(IonName ion,
+                                                 double energy) const {
+  const double log_frequency = std::log(energy);
+  if (log_frequency < _log_frequency_min ||
+      log_frequency > _log_frequency_max) {
+    return _exact_cross_sections->get_cross_section(ion, energy);
+  }
+  return interpolate(ion, log_frequency);
+}
+
+/**
+ * @brief Get the photoionization cross sections for all ions at the given
+ * photon energy.
+ *
+ * The logarithm of the frequency is only computed once for all ions.
+ *
+ * @param energy Photon frequency (in Hz).
+ * @param cross_sections Array to store the photoionization cross sections in
+ * (in m^2).
+ */
+void TabulatedCrossSections::get_cross_sections(double energy,
+                                                double *cross_sections) const {
+  const double log_frequency = std::log(energy);
+  if (log_frequency < _log_frequency_min ||
+      log_frequency > _log_frequency_max) {
+    _exact_cross_sections->get_cross_sections(energy, cross_sections);
+    return;
+  }
+  for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+    cross_sections[i] = interpolate(static_cast< IonName >(i), log_frequency);
+  }
+}
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TabulatedCrossSections.hpp
+ *
+ * @brief Photoionization cross sections that are interpolated on a
+ * precomputed table: header.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef TABULATEDCROSSSECTIONS_HPP
+#define TABULATEDCROSSSECTIONS_HPP
+
+#include "CrossSections.hpp"
+
+#include <cmath>
+#include <vector>
+
+class Log;
+class ParameterFile;
+
+/**
+ * @brief Part of the table for a single ion in which the cross section is a
+ * continuous function of the frequency.
+ */
+struct TabulatedCrossSectionsSegment {
+  /*! @brief Natural logarithm of the lower frequency limit of the segment. */
+  double _log_frequency_min;
+
+  /*! @brief Inverse of the logarithmic frequency spacing of the table values
+   *  in the segment. */
+  double _inverse_log_frequency_step;
+
+  /*! @brief Index of the first table value of the segment. */
+  unsigned int _offset;
+
+  /*! @brief Index of the last interval of the segment (number of table values
+   *  minus two). */
+  unsigned int _last_interval;
+};
+
+/**
+ * @brief CrossSections implementation that linearly interpolates the cross
+ * sections of another CrossSections implementation on a precomputed table.
+ *
+ * At construction, the cross sections for all ions are tabulated on a uniform
+ * grid in the logarithm of the frequency. Ionization edges are located
+ * automatically and split the table for an ion into segments in which the
+ * cross section is continuous. The resolution of every segment is doubled
+ * until the linear interpolation is accurate to within the requested relative
+ * tolerance. Frequencies outside the tabulated range are passed on to the
+ * underlying CrossSections.
+ */
+class TabulatedCrossSections : public CrossSections {
+private:
+  /*! @brief CrossSections that are tabulated (owned by this object). */
+  CrossSections *_exact_cross_sections;
+
+  /*! @brief Natural logarithm of the minimum tabulated frequency. */
+  double _log_frequency_min;
+
+  /*! @brief Natural logarithm of the maximum tabulated frequency. */
+  double _log_frequency_max;
+
+  /*! @brief Continuous segments of the table for every ion. */
+  std::vector< TabulatedCrossSectionsSegment > _segments[NUMBER_OF_IONNAMES];
+
+  /*! @brief Tabulated cross section values for all segments (in m^2). */
+  std::vector< double > _table;
+
+  void tabulate(IonName ion, double tolerance);
+
+  /**
+   * @brief Get the interpolated cross section for the given ion at the given
+   * logarithmic frequency inside the tabulated range.
+   *
+   * @param ion IonName for a valid ion.
+   * @param log_frequency Natural logarithm of the photon frequency.
+   * @return Photoionization cross section (in m^2).
+   */
+  inline double interpolate(IonName ion, double log_frequency) const {
+    const std::vector< TabulatedCrossSectionsSegment > &segments =
+        _segments[ion];
+    unsigned int iseg = 0;
+    while (iseg + 1 < segments.size() &&
+           log_frequency >= segments[iseg + 1]._log_frequency_min) {
+      ++iseg;
+    }
+    const TabulatedCrossSectionsSegment &segment = segments[iseg];
+    double u = (log_frequency - segment._log_frequency_min) *
+               segment._inverse_log_frequency_step;
+    if (u < 0.) {
+      u = 0.;
+    }
+    unsigned int i = u;
+    if (i > segment._last_interval) {
+      i = segment._last_interval;
+    }
+    const double f = u - i;
+    const double *values = &_table[segment._offset + i];
+    return (1. - f) * values[0] + f * values[1];
+  }
+
+public:
+  TabulatedCrossSections(CrossSections *exact_cross_sections,
+                         double tolerance = 1.e-4,
+                         double minimum_frequency = 3.14e15,
+                         double maximum_frequency = 1.45e16,
+                         Log *log = nullptr);
+
+  TabulatedCrossSections(CrossSections *exact_cross_sections,
+                         ParameterFile &params, Log *log = nullptr);
+
+  virtual ~TabulatedCrossSections();
+
+  /**
+   * @brief Get the size of the table.
+   *
+   * @return Total number of tabulated values for all ions.
+   */
+  inline unsigned int get_table_size() const { return _table.size(); }
+
+  /**
+   * @brief Get the number of continuous segments in the table for the given
+   * ion.
+   *
+   * @param ion IonName for a valid ion.
+   * @return Number of segments (number of ionization edges in the tabulated
+   * range plus one).
+   */
+  inline unsigned int get_number_of_segments(IonName ion) const {
+    return _segments[ion].size();
+  }
+
+  virtual double get_cross_section(IonName ion, double energy) const;
+
+  virtual void get_cross_sections(double energy, double *cross_sections) const;
+};
+
+#endif // TABULATEDCROSSSECTIONS_HPP
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TabulatedRecombinationRates.hpp
+ *
+ * @brief RecombinationRates implementation that interpolates the rates of
+ * another RecombinationRates implementation on a temperature grid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef TABULATEDRECOMBINATIONRATES_HPP
+#define TABULATEDRECOMBINATIONRATES_HPP
+
+#include "RecombinationRates.hpp"
+#include "TemperatureTable.hpp"
+
+#include <vector>
+
+/**
+ * @brief RecombinationRates implementation that interpolates the rates of
+ * another RecombinationRates implementation on a temperature grid.
+ *
+ * The rates for all ions are evaluated once on the grid points of a
+ * TemperatureTable when the object is constructed. Temperatures outside the
+ * table range are passed on to the underlying RecombinationRates.
+ */
+class TabulatedRecombinationRates : public RecombinationRates {
+private:
+  /*! @brief RecombinationRates that are tabulated. */
+  const RecombinationRates &_rates;
+
+  /*! @brief Temperature grid. */
+  const TemperatureTable _table;
+
+  /*! @brief Tabulated rates, for every ion (in m^3s^-1). */
+  std::vector< double > _values;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param rates RecombinationRates to tabulate.
+   * @param table Temperature grid.
+   */
+  inline TabulatedRecombinationRates(const RecombinationRates &rates,
+                                     const TemperatureTable &table)
+      : _rates(rates), _table(table),
+        _values(NUMBER_OF_IONNAMES * table.get_number_of_points(), 0.) {
+
+    const unsigned int numpoint = _table.get_number_of_points();
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      for (unsigned int i = 0; i < numpoint; ++i) {
+        _values[ion * numpoint + i] = _rates.get_recombination_rate(
+            static_cast< IonName >(ion), _table.get_temperature(i));
+      }
+    }
+  }
+
+  /**
+   * @brief Virtual destructor.
+   */
+  virtual ~TabulatedRecombinationRates() {}
+
+  /**
+   * @brief Get the recombination rate for the given ion at the given
+   * temperature.
+   *
+   * @param ion IonName for a valid ion.
+   * @param temperature Temperature (in K).
+   * @return Recombination rate (in m^3s^-1).
+   */
+  virtual double get_recombination_rate(IonName ion,
+                                        double temperature) const {
+    unsigned int index;
+    double fraction;
+    if (_table.get_interpolation(temperature, index, fraction)) {
+      return TemperatureTable::interpolate(
+          &_values[ion * _table.get_number_of_points()], index, fraction);
+    } else {
+      return _rates.get_recombination_rate(ion, temperature);
+    }
+  }
+};
+
+#endif // TABULATEDRECOMBINATIONRATES_HPP
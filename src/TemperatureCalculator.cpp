@@ -27,6 +27,7 @@
 #include "Abundances.hpp"
 #include "ChargeTransferRates.hpp"
 #include "DensityGrid.hpp"
+#include "DensityGridChunkTraversalJob.hpp"
 #include "DensityGridTraversalJobMarket.hpp"
 #include "DensityValues.hpp"
 #include "IonizationStateCalculator.hpp"
@@ -52,18 +53,23 @@
  * fractions.
  * @param charge_transfer_rates ChargeTransferRates used to calculate ionic
  * fractions.
+ * @param dirty_cell_threshold Relative change in the hydrogen mean intensity
+ * below which the temperature and ionization state of a cell are not
+ * recomputed by the batched temperature calculation (0 to always recompute).
  * @param log Log to write logging info to.
  */
 TemperatureCalculator::TemperatureCalculator(
     double luminosity, Abundances &abundances, double pahfac, double crfac,
     double crlim, double crscale, LineCoolingData &line_cooling_data,
     RecombinationRates &recombination_rates,
-    ChargeTransferRates &charge_transfer_rates, Log *log)
+    ChargeTransferRates &charge_transfer_rates, double dirty_cell_threshold,
+    Log *log)
     : _luminosity(luminosity), _abundances(abundances), _pahfac(pahfac),
       _crfac(crfac), _crlim(crlim), _crscale(crscale),
       _line_cooling_data(line_cooling_data),
       _recombination_rates(recombination_rates),
-      _charge_transfer_rates(charge_transfer_rates) {
+      _charge_transfer_rates(charge_transfer_rates),
+      _dirty_cell_threshold(dirty_cell_threshold), _log(log) {
 
   if (log) {
     log->write_status("Set up TemperatureCalculator with total luminosity ",
@@ -103,240 +109,380 @@ void TemperatureCalculator::ioneng(double &h0, double &he0, double &gain,
                                    RecombinationRates &rates,
                                    ChargeTransferRates &ctr) {
 
-  const double alphaH = rates.get_recombination_rate(ION_H_n, T);
-  const double alphaHe = rates.get_recombination_rate(ION_He_n, T);
-  double alphaC[2];
-  alphaC[0] = rates.get_recombination_rate(ION_C_p1, T);
-  alphaC[1] = rates.get_recombination_rate(ION_C_p2, T);
-  double alphaN[3];
-  alphaN[0] = rates.get_recombination_rate(ION_N_n, T);
-  alphaN[1] = rates.get_recombination_rate(ION_N_p1, T);
-  alphaN[2] = rates.get_recombination_rate(ION_N_p2, T);
-  double alphaO[2];
-  alphaO[0] = rates.get_recombination_rate(ION_O_n, T);
-  alphaO[1] = rates.get_recombination_rate(ION_O_p1, T);
-  double alphaNe[2];
-  alphaNe[0] = rates.get_recombination_rate(ION_Ne_n, T);
-  alphaNe[1] = rates.get_recombination_rate(ION_Ne_p1, T);
-  double alphaS[3];
-  alphaS[0] = rates.get_recombination_rate(ION_S_p1, T);
-  alphaS[1] = rates.get_recombination_rate(ION_S_p2, T);
-  alphaS[2] = rates.get_recombination_rate(ION_S_p3, T);
-
   IonizationVariables &ionization_variables = cell.get_ionization_variables();
 
-  const double T4 = T * 1.e-4;
-  const double alpha_e_2sP = 4.27e-14 * std::pow(T4, -0.695);
-  const double n = ionization_variables.get_number_density();
+  // a block with a single lane
+  TemperatureCalculatorBlock block = {};
+  block._size = 1;
+  block._number_density[0] = ionization_variables.get_number_density();
+  for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+    block._mean_intensity[ion][0] =
+        jfac *
+        ionization_variables.get_mean_intensity(static_cast< IonName >(ion));
+  }
+  block._hfac[0] = hfac;
+  block._heating[HEATINGTERM_H][0] =
+      ionization_variables.get_heating(HEATINGTERM_H);
+  block._heating[HEATINGTERM_He][0] =
+      ionization_variables.get_heating(HEATINGTERM_He);
+  block._z[0] = cell.get_cell_midpoint().z();
+
+  const bool active = true;
+  ioneng_block(block, &active, &T, &h0, &he0, &gain, &loss, abundances,
+               pahfac, crfac, crscale, data, rates, ctr);
+
+  for (int ion = ION_C_p1; ion < NUMBER_OF_IONNAMES; ++ion) {
+    ionization_variables.set_ionic_fraction(static_cast< IonName >(ion),
+                                            block._ionic_fraction[ion][0]);
+  }
+}
+
+/**
+ * @brief Function that calculates the cooling and heating rate for all active
+ * cells in the given block.
+ *
+ * This is the only implementation of the cooling and heating rates: ioneng()
+ * calls this function for a block with a single cell.
+ *
+ * The active cells are first compacted into a dense range of lanes. For these
+ * lanes, the atomic rates, the hydrogen and helium neutral fractions and the
+ * line cooling are evaluated cell by cell, while all other arithmetic is done
+ * in loops over the lanes that can be vectorized by the compiler. Results are
+ * only written to the output arrays and the block for active cells.
+ *
+ * @param block TemperatureCalculatorBlock containing the cell variables. The
+ * ionic fractions of the metals are stored in this block.
+ * @param active Flags indicating which cells of the block are active.
+ * @param T Temperature of every cell (in K).
+ * @param h0 Array to store the hydrogen neutral fractions in.
+ * @param he0 Array to store the helium neutral fractions in.
+ * @param gain Array to store the total energy gain due to heating in.
+ * @param loss Array to store the total energy loss due to cooling in.
+ * @param abundances Abundances.
+ * @param pahfac Normalization factor for PAH heating.
+ * @param crfac Normalization factor for cosmic ray heating.
+ * @param crscale Scale height of the cosmic ray heating term (0 for a constant
+ * heating term; in m).
+ * @param data LineCoolingData used to calculate line cooling.
+ * @param rates RecombinationRates used to calculate ionic fractions.
+ * @param ctr ChargeTransferRates used to calculate ionic fractions.
+ */
+void TemperatureCalculator::ioneng_block(
+    TemperatureCalculatorBlock &block, const bool *active, const double *T,
+    double *h0, double *he0, double *gain, double *loss,
+    Abundances &abundances, double pahfac, double crfac, double crscale,
+    LineCoolingData &data, RecombinationRates &rates,
+    ChargeTransferRates &ctr) {
+
+  // compact the active cells
+  unsigned int lanes[TEMPERATURECALCULATOR_BLOCKSIZE];
+  unsigned int size = 0;
+  for (unsigned int i = 0; i < block._size; ++i) {
+    if (active[i]) {
+      lanes[size] = i;
+      ++size;
+    }
+  }
+  if (size == 0) {
+    return;
+  }
 
-  const double jH = jfac * ionization_variables.get_mean_intensity(ION_H_n);
-  const double jHe = jfac * ionization_variables.get_mean_intensity(ION_He_n);
   const double AHe = abundances.get_abundance(ELEMENT_He);
-  IonizationStateCalculator::find_H0(alphaH, alphaHe, jH, jHe, n, AHe, T, h0,
-                                     he0);
-
-  const double ne = n * (1. - h0 + AHe * (1. - he0));
-  cmac_assert(ne == ne);
-  const double nhp = n * (1. - h0);
-  const double nhep = (1. - he0) * n * AHe;
-  const double pHots = 1. / (1. + 77. / std::sqrt(T) * he0 / h0);
-
-  // we multiplied Kenny's value with 1.e-12 to convert densities to m^-3
-  // we then multiplied with 0.1 to convert to J m^-3s^-1
-  const double heatHeLa = pHots * 1.2196e-12 * alpha_e_2sP * ne * nhep * 1.e-12;
-  gain =
-      hfac * n * (ionization_variables.get_heating(HEATINGTERM_H) * h0 +
-                  ionization_variables.get_heating(HEATINGTERM_He) * AHe * he0);
-  // pahs
-  // we multiplied Kenny's value with 1.e-12 to convert densities to m^-3
-  // we then multiplied with 0.1 to convert to J m^-3s^-1
-  const double heatpah = 3.e-38 * 5. * n * ne * pahfac;
-
-  // cosmic rays
-  // erg/cm^(9/2)/s --> J/m^(9/2)/s ==> 1.2e-27 --> 1.2e-25
-  // value comes from equation (53) in Wiener, Zweibel & Oh, 2013, ApJ, 767, 87
-  double heatcr = 0.;
-  if (crfac > 0.) {
-    heatcr = crfac * 1.2e-25 / std::sqrt(ne);
-    if (crscale > 0.) {
-      heatcr *= std::exp(-std::abs(cell.get_cell_midpoint().z()) / crscale);
+  const double AC = abundances.get_abundance(ELEMENT_C);
+  const double AN = abundances.get_abundance(ELEMENT_N);
+  const double AO = abundances.get_abundance(ELEMENT_O);
+  const double ANe = abundances.get_abundance(ELEMENT_Ne);
+  const double AS = abundances.get_abundance(ELEMENT_S);
+
+  // gather the cell variables and evaluate the atomic rates and the hydrogen
+  // and helium neutral fractions (these cannot be vectorized)
+  double Tl[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double n[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double j[NUMBER_OF_IONNAMES][TEMPERATURECALCULATOR_BLOCKSIZE];
+  double alpha[NUMBER_OF_IONNAMES][TEMPERATURECALCULATOR_BLOCKSIZE];
+  // charge transfer recombination rates with hydrogen
+  double ctC32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctN21[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctN32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctN43[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctS21[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctS32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctS43[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctNe32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctO21[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctO32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  // charge transfer ionization rates with hydrogen
+  double ctiN[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctiO[TEMPERATURECALCULATOR_BLOCKSIZE];
+  // charge transfer recombination rates with helium
+  double ctHeC32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctHeN32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctHeN43[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctHeS32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctHeS43[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctHeNe32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double ctHeO32[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double h0l[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double he0l[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double heatH[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double heatHe[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double hfac[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double z[TEMPERATURECALCULATOR_BLOCKSIZE];
+  for (unsigned int l = 0; l < size; ++l) {
+    const unsigned int i = lanes[l];
+    const double Ti = T[i];
+    Tl[l] = Ti;
+    n[l] = block._number_density[i];
+    hfac[l] = block._hfac[i];
+    heatH[l] = block._heating[HEATINGTERM_H][i];
+    heatHe[l] = block._heating[HEATINGTERM_He][i];
+    z[l] = block._z[i];
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      j[ion][l] = block._mean_intensity[ion][i];
+      alpha[ion][l] = rates.get_recombination_rate(
+          static_cast< IonName >(ion), Ti);
     }
+
+        ctC32[l] = ctr.get_charge_transfer_recombination_rate(4, 6, Ti);
+    ctN21[l] = ctr.get_charge_transfer_recombination_rate(2, 7, Ti);
+    ctN32[l] = ctr.get_charge_transfer_recombination_rate(3, 7, Ti);
+    ctN43[l] = ctr.get_charge_transfer_recombination_rate(4, 7, Ti);
+    ctS21[l] = ctr.get_charge_transfer_recombination_rate(3, 16, Ti);
+    ctS32[l] = ctr.get_charge_transfer_recombination_rate(4, 16, Ti);
+    ctS43[l] = ctr.get_charge_transfer_recombination_rate(5, 16, Ti);
+    ctNe32[l] = ctr.get_charge_transfer_recombination_rate(3, 10, Ti);
+    ctO21[l] = ctr.get_charge_transfer_recombination_rate(2, 8, Ti);
+    ctO32[l] = ctr.get_charge_transfer_recombination_rate(3, 8, Ti);
+    ctiN[l] = ctr.get_charge_transfer_ionization_rate(1, 7, Ti);
+    ctiO[l] = ctr.get_charge_transfer_ionization_rate(1, 8, Ti);
+    ctHeC32[l] = ctr.get_charge_transfer_recombination_rate_He(4, 6, Ti);
+    ctHeN32[l] = ctr.get_charge_transfer_recombination_rate_He(3, 7, Ti);
+    ctHeN43[l] = ctr.get_charge_transfer_recombination_rate_He(4, 7, Ti);
+    ctHeS32[l] = ctr.get_charge_transfer_recombination_rate_He(4, 16, Ti);
+    ctHeS43[l] = ctr.get_charge_transfer_recombination_rate_He(5, 16, Ti);
+    ctHeNe32[l] = ctr.get_charge_transfer_recombination_rate_He(3, 10, Ti);
+    ctHeO32[l] = ctr.get_charge_transfer_recombination_rate_He(3, 8, Ti);
+
+    IonizationStateCalculator::find_H0(alpha[ION_H_n][l], alpha[ION_He_n][l],
+                                       j[ION_H_n][l], j[ION_He_n][l], n[l],
+                                       AHe, Ti, h0l[l], he0l[l]);
   }
 
-  gain += heatpah;
-  gain += heatHeLa;
-  gain += heatcr;
-
-  // coolants
-
-  // carbon
-  const double C21 =
-      jfac * ionization_variables.get_mean_intensity(ION_C_p1) / ne / alphaC[0];
-  // as can be seen below, CTHerecom has the same units as a recombination
-  // rate: m^3s^-1
-  // in Kenny's code, recombination rates are in cm^3s^-1
-  // to put them in m^3s^-1 as well, we hence need to multiply Kenny's
-  // original factor 1.e-9 with 1.e-6
-  double CTHerecom = 1.e-15 * 0.046 * T4 * T4;
-  const double C32 =
-      jfac * ionization_variables.get_mean_intensity(ION_C_p2) /
-      (ne * alphaC[1] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(4, 6, T) +
-       n * he0 * AHe * CTHerecom);
-  const double C31 = C32 * C21;
-  const double sumC = C21 + C31;
-  ionization_variables.set_ionic_fraction(ION_C_p1, C21 / (1. + sumC));
-  ionization_variables.set_ionic_fraction(ION_C_p2, C31 / (1. + sumC));
-
-  // nitrogen
-  const double N21 =
-      (jfac * ionization_variables.get_mean_intensity(ION_N_n) +
-       nhp * ctr.get_charge_transfer_ionization_rate(1, 7, T)) /
-      (ne * alphaN[0] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(2, 7, T));
-  // multiplied Kenny's value with 1.e-6
-  CTHerecom =
-      1.e-15 * 0.33 * std::pow(T4, 0.29) * (1. + 1.3 * std::exp(-4.5 / T4));
-  const double N32 =
-      jfac * ionization_variables.get_mean_intensity(ION_N_p1) /
-      (ne * alphaN[1] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(3, 7, T) +
-       n * he0 * AHe * CTHerecom);
-  // multiplied Kenny's value with 1.e-6
-  CTHerecom = 1.e-15 * 0.15;
-  const double N43 =
-      jfac * ionization_variables.get_mean_intensity(ION_N_p2) /
-      (ne * alphaN[2] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(4, 7, T) +
-       n * he0 * AHe * CTHerecom);
-  const double N31 = N32 * N21;
-  const double N41 = N43 * N31;
-  const double sumN = N21 + N31 + N41;
-  ionization_variables.set_ionic_fraction(ION_N_n, N21 / (1. + sumN));
-  ionization_variables.set_ionic_fraction(ION_N_p1, N31 / (1. + sumN));
-  ionization_variables.set_ionic_fraction(ION_N_p2, N41 / (1. + sumN));
-
-  // Sulphur
-  const double S21 =
-      jfac * ionization_variables.get_mean_intensity(ION_S_p1) /
-      (ne * alphaS[0] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(3, 16, T));
-  // multiplied Kenny's value with 1.e-6
-  CTHerecom = 1.e-15 * 1.1 * std::pow(T4, 0.56);
-  const double S32 =
-      jfac * ionization_variables.get_mean_intensity(ION_S_p2) /
-      (ne * alphaS[1] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(4, 16, T) +
-       n * he0 * AHe * CTHerecom);
-  // multiplied Kenny's value with 1.e-6
-  CTHerecom =
-      1.e-15 * 7.6e-4 * std::pow(T4, 0.32) * (1. + 3.4 * std::exp(-5.25 * T4));
-  const double S43 =
-      jfac * ionization_variables.get_mean_intensity(ION_S_p3) /
-      (ne * alphaS[2] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(5, 16, T) +
-       n * he0 * AHe * CTHerecom);
-  const double S31 = S32 * S21;
-  const double S41 = S43 * S31;
-  const double sumS = S21 + S31 + S41;
-  ionization_variables.set_ionic_fraction(ION_S_p1, S21 / (1. + sumS));
-  ionization_variables.set_ionic_fraction(ION_S_p2, S31 / (1. + sumS));
-  ionization_variables.set_ionic_fraction(ION_S_p3, S41 / (1. + sumS));
-
-  // Neon
-  const double Ne21 = jfac * ionization_variables.get_mean_intensity(ION_Ne_n) /
-                      (ne * alphaNe[0]);
-  // multiplied Kenny's value with 1.e-6
-  CTHerecom = 1.e-15 * 1.e-5;
-  const double Ne32 =
-      jfac * ionization_variables.get_mean_intensity(ION_Ne_p1) /
-      (ne * alphaNe[1] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(3, 10, T) +
-       n * he0 * AHe * CTHerecom);
-  const double Ne31 = Ne32 * Ne21;
-  const double sumNe = Ne21 + Ne31;
-  ionization_variables.set_ionic_fraction(ION_Ne_n, Ne21 / (1. + sumNe));
-  ionization_variables.set_ionic_fraction(ION_Ne_p1, Ne31 / (1. + sumNe));
-
-  // Oxygen
-  const double O21 =
-      (jfac * ionization_variables.get_mean_intensity(ION_O_n) +
-       nhp * ctr.get_charge_transfer_ionization_rate(1, 8, T)) /
-      (ne * alphaO[0] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(2, 8, T));
-  // multiplied Kenny's value with 1.e-6
-  CTHerecom = 0.2e-15 * std::pow(T4, 0.95);
-  const double O32 =
-      jfac * ionization_variables.get_mean_intensity(ION_O_p1) /
-      (ne * alphaO[1] +
-       n * h0 * ctr.get_charge_transfer_recombination_rate(3, 8, T) +
-       n * he0 * AHe * CTHerecom);
-  const double O31 = O32 * O21;
-  const double sumO = O21 + O31;
-  ionization_variables.set_ionic_fraction(ION_O_n, O21 / (1. + sumO));
-  ionization_variables.set_ionic_fraction(ION_O_p1, O31 / (1. + sumO));
-
-  double abund[12];
-  abund[0] = abundances.get_abundance(ELEMENT_N) *
-             (1. - ionization_variables.get_ionic_fraction(ION_N_n) -
-              ionization_variables.get_ionic_fraction(ION_N_p1) -
-              ionization_variables.get_ionic_fraction(ION_N_p2));
-  abund[1] = abundances.get_abundance(ELEMENT_N) *
-             ionization_variables.get_ionic_fraction(ION_N_n);
-  abund[2] = abundances.get_abundance(ELEMENT_O) *
-             (1. - ionization_variables.get_ionic_fraction(ION_O_n) -
-              ionization_variables.get_ionic_fraction(ION_O_p1));
-  abund[3] = abundances.get_abundance(ELEMENT_O) *
-             ionization_variables.get_ionic_fraction(ION_O_n);
-  abund[4] = abundances.get_abundance(ELEMENT_O) *
-             ionization_variables.get_ionic_fraction(ION_O_p1);
-  abund[5] = abundances.get_abundance(ELEMENT_Ne) *
-             ionization_variables.get_ionic_fraction(ION_Ne_p1);
-  abund[6] = abundances.get_abundance(ELEMENT_S) *
-             (1. - ionization_variables.get_ionic_fraction(ION_S_p1) -
-              ionization_variables.get_ionic_fraction(ION_S_p2) -
-              ionization_variables.get_ionic_fraction(ION_S_p3));
-  abund[7] = abundances.get_abundance(ELEMENT_S) *
-             ionization_variables.get_ionic_fraction(ION_S_p1);
-  abund[8] = abundances.get_abundance(ELEMENT_C) *
-             (1. - ionization_variables.get_ionic_fraction(ION_C_p1) -
-              ionization_variables.get_ionic_fraction(ION_C_p2));
-  abund[9] = abundances.get_abundance(ELEMENT_C) *
-             ionization_variables.get_ionic_fraction(ION_C_p1);
-  abund[10] = abundances.get_abundance(ELEMENT_N) *
-              ionization_variables.get_ionic_fraction(ION_N_p1);
-  abund[11] = abundances.get_abundance(ELEMENT_Ne) *
-              ionization_variables.get_ionic_fraction(ION_Ne_n);
-
-  // FFcool
-  const double c = 5.5 - std::log(T);
-  const double gff = 1.1 + 0.34 * std::exp(-c * c / 3.);
-  // we multiplied Kenny's value with 1.e-12 to convert the densities into m^-3
-  // we then multiplied with 0.1 to convert them to J m^-3s^-1
-  const double Lff = 1.42e-40 * gff * std::sqrt(T) * (nhp + nhep) * ne;
-
-  // RECcool
-  // we multiplied Kenny's value with 1.e-12 to convert the densities into m^-3
-  // we then multiplied with 0.1 to convert them to J m^-3s^-1
-  const double Lhp =
-      2.85e-14 * ne * nhp * std::sqrt(T) *
-      (5.914 - 0.5 * std::log(T) + 0.01184 * std::pow(T, 0.33333));
-  const double Lhep = 2.6e-13 * ne * nhep * std::pow(T, 0.32);
-  const double LRec = 1.e-26 * (Lhp + Lhep);
-
-  const double Lc = data.get_cooling(T, ne, abund) * n;
-
-  loss = Lc + Lff + LRec;
+  // heating, ionic fractions and continuum cooling: vectorizable loop
+  double nel[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double gainl[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double Lcont[TEMPERATURECALCULATOR_BLOCKSIZE];
+  double fraction[NUMBER_OF_IONNAMES][TEMPERATURECALCULATOR_BLOCKSIZE];
+  double abund[TEMPERATURECALCULATOR_BLOCKSIZE][12];
+  for (unsigned int l = 0; l < size; ++l) {
+    const double Ti = Tl[l];
+    const double nl = n[l];
+    const double h0i = h0l[l];
+    const double he0i = he0l[l];
+
+    const double T4 = Ti * 1.e-4;
+    const double alpha_e_2sP = 4.27e-14 * std::pow(T4, -0.695);
+    const double ne = nl * (1. - h0i + AHe * (1. - he0i));
+    const double nhp = nl * (1. - h0i);
+    const double nhep = (1. - he0i) * nl * AHe;
+    const double pHots = 1. / (1. + 77. / std::sqrt(Ti) * he0i / h0i);
+
+    // we multiplied Kenny's value with 1.e-12 to convert densities to m^-3
+    // we then multiplied with 0.1 to convert to J m^-3s^-1
+    const double heatHeLa =
+        pHots * 1.2196e-12 * alpha_e_2sP * ne * nhep * 1.e-12;
+    double gaini = hfac[l] * nl * (heatH[l] * h0i + heatHe[l] * AHe * he0i);
+    // pahs
+    // we multiplied Kenny's value with 1.e-12 to convert densities to m^-3
+    // we then multiplied with 0.1 to convert to J m^-3s^-1
+    const double heatpah = 3.e-38 * 5. * nl * ne * pahfac;
+    // cosmic rays
+    // erg/cm^(9/2)/s --> J/m^(9/2)/s ==> 1.2e-27 --> 1.2e-25
+    // value comes from equation (53) in Wiener, Zweibel & Oh, 2013, ApJ, 767,
+    // 87
+    double heatcr = 0.;
+    if (crfac > 0.) {
+      heatcr = crfac * 1.2e-25 / std::sqrt(ne);
+      if (crscale > 0.) {
+        heatcr *= std::exp(-std::abs(z[l]) / crscale);
+      }
+    }
+    gaini += heatpah;
+    gaini += heatHeLa;
+    gaini += heatcr;
+    gainl[l] = gaini;
+    nel[l] = ne;
+
+    const double nh0 = nl * h0i;
+    const double nhe0 = nl * he0i * AHe;
+
+    // carbon
+    const double C21 = j[ION_C_p1][l] / ne / alpha[ION_C_p1][l];
+    const double C32 = j[ION_C_p2][l] / (ne * alpha[ION_C_p2][l] +
+                                         nh0 * ctC32[l] + nhe0 * ctHeC32[l]);
+    const double C31 = C32 * C21;
+    const double sumC = 1. / (1. + C21 + C31);
+    fraction[ION_C_p1][l] = C21 * sumC;
+    fraction[ION_C_p2][l] = C31 * sumC;
+
+    // nitrogen
+    const double N21 = (j[ION_N_n][l] + nhp * ctiN[l]) /
+                       (ne * alpha[ION_N_n][l] + nh0 * ctN21[l]);
+    const double N32 = j[ION_N_p1][l] / (ne * alpha[ION_N_p1][l] +
+                                         nh0 * ctN32[l] + nhe0 * ctHeN32[l]);
+    const double N43 = j[ION_N_p2][l] / (ne * alpha[ION_N_p2][l] +
+                                         nh0 * ctN43[l] + nhe0 * ctHeN43[l]);
+    const double N31 = N32 * N21;
+    const double N41 = N43 * N31;
+    const double sumN = 1. / (1. + N21 + N31 + N41);
+    fraction[ION_N_n][l] = N21 * sumN;
+    fraction[ION_N_p1][l] = N31 * sumN;
+    fraction[ION_N_p2][l] = N41 * sumN;
+
+    // sulphur
+    const double S21 =
+        j[ION_S_p1][l] / (ne * alpha[ION_S_p1][l] + nh0 * ctS21[l]);
+    const double S32 = j[ION_S_p2][l] / (ne * alpha[ION_S_p2][l] +
+                                         nh0 * ctS32[l] + nhe0 * ctHeS32[l]);
+    const double S43 = j[ION_S_p3][l] / (ne * alpha[ION_S_p3][l] +
+                                         nh0 * ctS43[l] + nhe0 * ctHeS43[l]);
+    const double S31 = S32 * S21;
+    const double S41 = S43 * S31;
+    const double sumS = 1. / (1. + S21 + S31 + S41);
+    fraction[ION_S_p1][l] = S21 * sumS;
+    fraction[ION_S_p2][l] = S31 * sumS;
+    fraction[ION_S_p3][l] = S41 * sumS;
+
+    // neon
+    const double Ne21 = j[ION_Ne_n][l] / (ne * alpha[ION_Ne_n][l]);
+    const double Ne32 =
+        j[ION_Ne_p1][l] /
+        (ne * alpha[ION_Ne_p1][l] + nh0 * ctNe32[l] + nhe0 * ctHeNe32[l]);
+    const double Ne31 = Ne32 * Ne21;
+    const double sumNe = 1. / (1. + Ne21 + Ne31);
+    fraction[ION_Ne_n][l] = Ne21 * sumNe;
+    fraction[ION_Ne_p1][l] = Ne31 * sumNe;
+
+    // oxygen
+    const double O21 = (j[ION_O_n][l] + nhp * ctiO[l]) /
+                       (ne * alpha[ION_O_n][l] + nh0 * ctO21[l]);
+    const double O32 = j[ION_O_p1][l] / (ne * alpha[ION_O_p1][l] +
+                                         nh0 * ctO32[l] + nhe0 * ctHeO32[l]);
+    const double O31 = O32 * O21;
+    const double sumO = 1. / (1. + O21 + O31);
+    fraction[ION_O_n][l] = O21 * sumO;
+    fraction[ION_O_p1][l] = O31 * sumO;
+
+    abund[l][0] = AN * (1. - fraction[ION_N_n][l] - fraction[ION_N_p1][l] -
+                        fraction[ION_N_p2][l]);
+    abund[l][1] = AN * fraction[ION_N_n][l];
+    abund[l][2] = AO * (1. - fraction[ION_O_n][l] - fraction[ION_O_p1][l]);
+    abund[l][3] = AO * fraction[ION_O_n][l];
+    abund[l][4] = AO * fraction[ION_O_p1][l];
+    abund[l][5] = ANe * fraction[ION_Ne_p1][l];
+    abund[l][6] = AS * (1. - fraction[ION_S_p1][l] - fraction[ION_S_p2][l] -
+                        fraction[ION_S_p3][l]);
+    abund[l][7] = AS * fraction[ION_S_p1][l];
+    abund[l][8] = AC * (1. - fraction[ION_C_p1][l] - fraction[ION_C_p2][l]);
+    abund[l][9] = AC * fraction[ION_C_p1][l];
+    abund[l][10] = AN * fraction[ION_N_p1][l];
+    abund[l][11] = ANe * fraction[ION_Ne_n][l];
+
+    // free-free and recombination cooling
+    // we multiplied Kenny's value with 1.e-12 to convert the densities into
+    // m^-3
+    // we then multiplied with 0.1 to convert them to J m^-3s^-1
+    const double logT = std::log(Ti);
+    const double sqrtT = std::sqrt(Ti);
+    const double c = 5.5 - logT;
+    const double gff = 1.1 + 0.34 * std::exp(-c * c / 3.);
+    const double Lff = 1.42e-40 * gff * sqrtT * (nhp + nhep) * ne;
+    const double Lhp = 2.85e-14 * ne * nhp * sqrtT *
+                       (5.914 - 0.5 * logT + 0.01184 * std::pow(Ti, 0.33333));
+    const double Lhep = 2.6e-13 * ne * nhep * std::pow(Ti, 0.32);
+    Lcont[l] = Lff + 1.e-26 * (Lhp + Lhep);
+  }
+
+  // line cooling (cannot be vectorized) and scatter of the results
+  for (unsigned int l = 0; l < size; ++l) {
+    cmac_assert(nel[l] == nel[l]);
+    const unsigned int i = lanes[l];
+    const double Lc = data.get_cooling(Tl[l], nel[l], abund[l]) *
+                      n[l];
+    h0[i] = h0l[l];
+    he0[i] = he0l[l];
+    gain[i] = gainl[l];
+    loss[i] = Lc + Lcont[l];
+    for (int ion = ION_C_p1; ion < NUMBER_OF_IONNAMES; ++ion) {
+      block._ionic_fraction[ion][i] = fraction[ion][l];
+    }
+  }
+}
+
+/**
+ * @brief Get the next temperature in the iterative solution of the thermal
+ * balance.
+ *
+ * We look for the root of F(T) = ln(gain(T) / loss(T)) as a function of ln(T),
+ * using a Newton step. The slope of F is estimated from the current and the
+ * previous iteration (a secant), so that every iteration only requires a
+ * single ioneng() evaluation.
+ *
+ * The step is safeguarded by a bracket of the root: F > 0 implies that the root
+ * lies at a higher temperature, F < 0 that it lies at a lower temperature. If
+ * the slope has the wrong sign or the Newton step leaves the bracket, we
+ * bisect the bracket in ln(T) instead, or expand the search by a factor 2 if
+ * the bracket is not yet closed.
+ *
+ * @param T0 Current temperature (in K).
+ * @param F0 ln(gain / loss) at the current temperature.
+ * @param Tprev Previous temperature (in K).
+ * @param Fprev ln(gain / loss) at the previous temperature.
+ * @param Tlow Lower limit of the bracket (in K; 0 if unknown). Is updated.
+ * @param Thigh Upper limit of the bracket (in K; 0 if unknown). Is updated.
+ * @return Next temperature (in K).
+ */
+double TemperatureCalculator::get_next_temperature(double T0, double F0,
+                                                   double Tprev, double Fprev,
+                                                   double &Tlow,
+                                                   double &Thigh) {
+  if (F0 > 0.) {
+    Tlow = T0;
+  } else {
+    Thigh = T0;
+  }
+
+  const double slope = (F0 - Fprev) / std::log(T0 / Tprev);
+  double Tnext = 0.;
+  if (slope < 0.) {
+    Tnext = T0 * std::exp(-F0 / slope);
+  }
+  if (!(slope < 0.) || (Tlow > 0. && Tnext <= Tlow) ||
+      (Thigh > 0. && Tnext >= Thigh)) {
+    if (Tlow > 0. && Thigh > 0.) {
+      Tnext = std::sqrt(Tlow * Thigh);
+    } else if (F0 > 0.) {
+      Tnext = 2. * T0;
+    } else {
+      Tnext = 0.5 * T0;
+    }
+  }
+  return Tnext;
 }
 
 /**
  * @brief Calculate a new temperature for the given cell.
  *
+ * The thermal balance is solved using get_next_temperature(), starting from
+ * the temperature of the previous iteration if the cell was ionized.
+ *
  * @param jfac Normalization factor for the mean intensity integrals.
  * @param hfac Normalization factor for the heating integrals.
  * @param cell DensityGrid::iterator pointing to a cell.
+ * @return Number of thermal balance iterations (0 for cells that are assumed
+ * to be neutral).
  */
-void TemperatureCalculator::calculate_temperature(
+unsigned int TemperatureCalculator::calculate_temperature(
     double jfac, double hfac, DensityGrid::iterator &cell) const {
   const double eps = 1.e-3;
   const unsigned int max_iterations = 100;
@@ -369,7 +515,7 @@ void TemperatureCalculator::calculate_temperature(
     ionization_variables.set_ionic_fraction(ION_S_p2, 0.);
     ionization_variables.set_ionic_fraction(ION_S_p3, 0.);
 
-    return;
+    return 0;
   }
 
   double h0, he0;
@@ -406,7 +552,7 @@ void TemperatureCalculator::calculate_temperature(
       ionization_variables.set_ionic_fraction(ION_S_p1, 0.);
       ionization_variables.set_ionic_fraction(ION_S_p2, 0.);
       ionization_variables.set_ionic_fraction(ION_S_p3, 0.);
-      return;
+      return 0;
     }
   }
 
@@ -417,6 +563,23 @@ void TemperatureCalculator::calculate_temperature(
     T0 = 8000.;
   }
 
+  // the initial slope of the thermal balance is estimated from an additional
+  // evaluation at a slightly higher temperature
+  double Tprev = 1.1 * T0;
+  double Fprev;
+  {
+    double h0prev, he0prev, gainprev, lossprev;
+    ioneng(h0prev, he0prev, gainprev, lossprev, Tprev, cell, jfac, _abundances,
+           hfac, _pahfac, _crfac, _crscale, _line_cooling_data,
+           _recombination_rates, _charge_transfer_rates);
+    Fprev = std::log(gainprev / lossprev);
+  }
+
+  // bracket of the equilibrium temperature (0 if not known yet)
+  double Tlow = 0.;
+  double Thigh = 0.;
+  // false if the iteration ended in one of the neutral or ionized limits
+  bool solved = true;
   unsigned int niter = 0;
   double gain0 = 1.;
   double loss0 = 0.;
@@ -424,35 +587,24 @@ void TemperatureCalculator::calculate_temperature(
   he0 = 0.;
   while (std::abs(gain0 - loss0) > eps * gain0 && niter < max_iterations) {
     ++niter;
-    const double T1 = 1.1 * T0;
-    // ioneng
-    double h01, he01, gain1, loss1;
-    ioneng(h01, he01, gain1, loss1, T1, cell, jfac, _abundances, hfac, _pahfac,
-           _crfac, _crscale, _line_cooling_data, _recombination_rates,
-           _charge_transfer_rates);
-
-    const double T2 = 0.9 * T0;
-    // ioneng
-    double h02, he02, gain2, loss2;
-    ioneng(h02, he02, gain2, loss2, T2, cell, jfac, _abundances, hfac, _pahfac,
-           _crfac, _crscale, _line_cooling_data, _recombination_rates,
-           _charge_transfer_rates);
-
     // ioneng - this one sets h0, he0, gain0 and loss0
     ioneng(h0, he0, gain0, loss0, T0, cell, jfac, _abundances, hfac, _pahfac,
            _crfac, _crscale, _line_cooling_data, _recombination_rates,
            _charge_transfer_rates);
 
-    const double logtt = std::log(T1 / T2);
-    const double expgain = std::log(gain1 / gain2) / logtt;
-    const double exploss = std::log(loss1 / loss2) / logtt;
-    T0 *= std::pow(loss0 / gain0, 1. / (expgain - exploss));
+    const double F0 = std::log(gain0 / loss0);
+    const double Tnext =
+        get_next_temperature(T0, F0, Tprev, Fprev, Tlow, Thigh);
+    Tprev = T0;
+    Fprev = F0;
+    T0 = Tnext;
 
     if (T0 < 4000.) {
       // gas is neutral, temperature is 500 K
       T0 = 500.;
       h0 = 1.;
       he0 = 1.;
+      solved = false;
       // force exit out of loop
       gain0 = 1.;
       loss0 = 1.;
@@ -464,6 +616,7 @@ void TemperatureCalculator::calculate_temperature(
       T0 = 1.e10;
       h0 = 1.e-10;
       he0 = 1.e-10;
+      solved = false;
       // force exit out of loop
       gain0 = 1.;
       loss0 = 1.;
@@ -475,6 +628,14 @@ void TemperatureCalculator::calculate_temperature(
                  T0, std::abs(loss0 - gain0) / gain0, eps);
   }
 
+  // the last ioneng() call used the temperature before the final step:
+  // re-evaluate the ionic fractions at the converged temperature
+  if (solved) {
+    ioneng(h0, he0, gain0, loss0, T0, cell, jfac, _abundances, hfac, _pahfac,
+           _crfac, _crscale, _line_cooling_data, _recombination_rates,
+           _charge_transfer_rates);
+  }
+
   // cap the temperature at 30,000 K
   T0 = std::min(30000., T0);
 
@@ -526,17 +687,314 @@ void TemperatureCalculator::calculate_temperature(
     ionization_variables.set_ionic_fraction(ION_S_p2, 0.);
     ionization_variables.set_ionic_fraction(ION_S_p3, 0.);
   }
+
+  return niter;
+}
+
+/**
+ * @brief Calculate a new temperature for a block of at most
+ * TEMPERATURECALCULATOR_BLOCKSIZE consecutive cells.
+ *
+ * This is a batched version of calculate_temperature() that gives the same
+ * result for every cell (up to round off). The cell variables are gathered in
+ * a TemperatureCalculatorBlock, and the thermal balance iteration is done for
+ * all cells simultaneously. Cells that take the neutral shortcut or that have
+ * converged are masked out of subsequent evaluations.
+ *
+ * Cells that are not dirty (see IonizationStateCalculator::is_dirty()) keep
+ * their current temperature and ionic fractions.
+ *
+ * @param jfac Normalization factor for the mean intensity integrals (without
+ * the cell volume).
+ * @param hfac Normalization factor for the heating integrals (without the cell
+ * volume).
+ * @param first DensityGrid::iterator pointing to the first cell of the block.
+ * @param size Number of cells in the block.
+ * @param number_of_updated_cells Counter that is increased with the number of
+ * cells for which the temperature was recomputed (if not a nullptr).
+ * @return Total number of thermal balance iterations for all cells in the
+ * block.
+ */
+unsigned int TemperatureCalculator::calculate_temperature_block(
+    double jfac, double hfac, DensityGrid::iterator first, unsigned int size,
+    unsigned int *number_of_updated_cells) const {
+  const double eps = 1.e-3;
+  const unsigned int max_iterations = 100;
+
+  cmac_assert(size <= TEMPERATURECALCULATOR_BLOCKSIZE);
+
+  TemperatureCalculatorBlock block = {};
+  block._size = size;
+  bool dirty[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  bool active[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double T0[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double h0[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double he0[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double gain0[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double loss0[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  unsigned int niter[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  unsigned int numactive = 0;
+  unsigned int numdirty = 0;
+  for (unsigned int i = 0; i < size; ++i) {
+    DensityGrid::iterator cell = first + i;
+    const IonizationVariables &ionization_variables =
+        cell.get_ionization_variables();
+    const double volume = cell.get_volume();
+    const double jfac_cell = jfac / volume;
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      block._mean_intensity[ion][i] =
+          jfac_cell *
+          ionization_variables.get_mean_intensity(static_cast< IonName >(ion));
+    }
+    block._hfac[i] = hfac / volume;
+    block._heating[HEATINGTERM_H][i] =
+        ionization_variables.get_heating(HEATINGTERM_H);
+    block._heating[HEATINGTERM_He][i] =
+        ionization_variables.get_heating(HEATINGTERM_He);
+    block._number_density[i] = ionization_variables.get_number_density();
+    block._z[i] = cell.get_cell_midpoint().z();
+
+    dirty[i] = IonizationStateCalculator::is_dirty(
+        block._mean_intensity[ION_H_n][i], _dirty_cell_threshold, cell);
+    if (dirty[i]) {
+      ++numdirty;
+    }
+
+    active[i] =
+        dirty[i] &&
+        !((ionization_variables.get_mean_intensity(ION_H_n) == 0. &&
+           ionization_variables.get_mean_intensity(ION_He_n) == 0.) ||
+          ionization_variables.get_number_density() == 0.);
+    if (active[i] && _crfac > 0.) {
+      const double alphaH =
+          _recombination_rates.get_recombination_rate(ION_H_n, 8000.);
+      const double alphaHe =
+          _recombination_rates.get_recombination_rate(ION_He_n, 8000.);
+      const double AHe = _abundances.get_abundance(ELEMENT_He);
+      IonizationStateCalculator::find_H0(
+          alphaH, alphaHe, block._mean_intensity[ION_H_n][i],
+          block._mean_intensity[ION_He_n][i], block._number_density[i], AHe,
+          8000., h0[i], he0[i]);
+      // assume fully neutral
+      active[i] = (h0[i] <= _crlim);
+    }
+
+    if (active[i]) {
+      if (ionization_variables.get_temperature() > 4000.) {
+        T0[i] = ionization_variables.get_temperature();
+      } else {
+        T0[i] = 8000.;
+      }
+      ++numactive;
+    } else {
+      // the neutral shortcut: the values below are turned into neutral ionic
+      // fractions when the results are written back
+      T0[i] = 500.;
+    }
+    niter[i] = 0;
+    gain0[i] = 1.;
+    loss0[i] = 0.;
+    h0[i] = 1.;
+    he0[i] = 1.;
+  }
+
+  // initial slope estimate, see calculate_temperature()
+  double Tprev[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double Fprev[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double Tlow[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  double Thigh[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  // false for cells that take a shortcut or end in the neutral or ionized
+  // limits
+  bool solved[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+  {
+    double h0prev[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+    double he0prev[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+    double gainprev[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+    double lossprev[TEMPERATURECALCULATOR_BLOCKSIZE] = {};
+    for (unsigned int i = 0; i < size; ++i) {
+      Tprev[i] = 1.1 * T0[i];
+      Tlow[i] = 0.;
+      Thigh[i] = 0.;
+      solved[i] = active[i];
+    }
+    ioneng_block(block, active, Tprev, h0prev, he0prev, gainprev, lossprev,
+                 _abundances, _pahfac, _crfac, _crscale, _line_cooling_data,
+                 _recombination_rates, _charge_transfer_rates);
+    for (unsigned int i = 0; i < size; ++i) {
+      if (active[i]) {
+        Fprev[i] = std::log(gainprev[i] / lossprev[i]);
+      }
+    }
+  }
+
+  while (numactive > 0) {
+    // this one sets h0, he0, gain0, loss0 and the ionic fractions
+    ioneng_block(block, active, T0, h0, he0, gain0, loss0, _abundances,
+                 _pahfac, _crfac, _crscale, _line_cooling_data,
+                 _recombination_rates, _charge_transfer_rates);
+
+    numactive = 0;
+    for (unsigned int i = 0; i < size; ++i) {
+      if (!active[i]) {
+        continue;
+      }
+      ++niter[i];
+
+      const double F0 = std::log(gain0[i] / loss0[i]);
+      const double Tnext = get_next_temperature(T0[i], F0, Tprev[i], Fprev[i],
+                                                Tlow[i], Thigh[i]);
+      Tprev[i] = T0[i];
+      Fprev[i] = F0;
+      T0[i] = Tnext;
+
+      if (T0[i] < 4000.) {
+        // gas is neutral, temperature is 500 K
+        T0[i] = 500.;
+        h0[i] = 1.;
+        he0[i] = 1.;
+        solved[i] = false;
+        // force exit out of loop
+        gain0[i] = 1.;
+        loss0[i] = 1.;
+      }
+
+      if (T0[i] > 1.e10) {
+        // gas is ionized, temperature is 10^10 K
+        T0[i] = 1.e10;
+        h0[i] = 1.e-10;
+        he0[i] = 1.e-10;
+        solved[i] = false;
+        // force exit out of loop
+        gain0[i] = 1.;
+        loss0[i] = 1.;
+      }
+
+      active[i] = (std::abs(gain0[i] - loss0[i]) > eps * gain0[i] &&
+                   niter[i] < max_iterations);
+      if (active[i]) {
+        ++numactive;
+      } else if (niter[i] == max_iterations) {
+        cmac_warning("Maximum number of iterations reached (temperature: %g, "
+                     "relative difference cooling/heating: %g, aim: %g)!",
+                     T0[i], std::abs(loss0[i] - gain0[i]) / gain0[i], eps);
+      }
+    }
+  }
+
+  // re-evaluate the ionic fractions at the converged temperature, see
+  // calculate_temperature()
+  ioneng_block(block, solved, T0, h0, he0, gain0, loss0, _abundances, _pahfac,
+               _crfac, _crscale, _line_cooling_data, _recombination_rates,
+               _charge_transfer_rates);
+
+  // write back the results
+  for (unsigned int i = 0; i < size; ++i) {
+    if (!dirty[i]) {
+      continue;
+    }
+
+    // cap the temperature at 30,000 K
+    T0[i] = std::min(30000., T0[i]);
+
+    block._ionic_fraction[ION_H_n][i] = h0[i];
+    block._ionic_fraction[ION_He_n][i] = he0[i];
+    if (block._mean_intensity[ION_H_n][i] == 0.) {
+      block._ionic_fraction[ION_H_n][i] = 1.;
+    }
+    if (block._mean_intensity[ION_He_n][i] == 0.) {
+      block._ionic_fraction[ION_He_n][i] = 1.;
+    }
+
+    if (h0[i] == 1.) {
+      block._ionic_fraction[ION_C_p1][i] = 0.;
+      block._ionic_fraction[ION_C_p2][i] = 0.;
+      block._ionic_fraction[ION_N_n][i] = 1.;
+      block._ionic_fraction[ION_N_p1][i] = 0.;
+      block._ionic_fraction[ION_N_p2][i] = 0.;
+      block._ionic_fraction[ION_O_n][i] = 1.;
+      block._ionic_fraction[ION_O_p1][i] = 0.;
+      block._ionic_fraction[ION_Ne_n][i] = 1.;
+      block._ionic_fraction[ION_Ne_p1][i] = 0.;
+      block._ionic_fraction[ION_S_p1][i] = 0.;
+      block._ionic_fraction[ION_S_p2][i] = 0.;
+      block._ionic_fraction[ION_S_p3][i] = 0.;
+    }
+
+    if (h0[i] <= 1.e-10) {
+      for (int ion = ION_C_p1; ion < NUMBER_OF_IONNAMES; ++ion) {
+        block._ionic_fraction[ion][i] = 0.;
+      }
+    }
+
+    DensityGrid::iterator cell = first + i;
+    IonizationVariables &ionization_variables = cell.get_ionization_variables();
+    ionization_variables.set_temperature(T0[i]);
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      ionization_variables.set_ionic_fraction(static_cast< IonName >(ion),
+                                              block._ionic_fraction[ion][i]);
+    }
+  }
+
+  if (number_of_updated_cells != nullptr) {
+    *number_of_updated_cells += numdirty;
+  }
+
+  unsigned int total_niter = 0;
+  for (unsigned int i = 0; i < size; ++i) {
+    total_niter += niter[i];
+  }
+  return total_niter;
+}
+
+/**
+ * @brief Calculate a new temperature for all cells in the given range, using
+ * the batched temperature calculation.
+ *
+ * @param jfac Normalization factor for the mean intensity integrals (without
+ * the cell volume).
+ * @param hfac Normalization factor for the heating integrals (without the cell
+ * volume).
+ * @param begin DensityGrid::iterator pointing to the first cell in the range.
+ * @param end DensityGrid::iterator pointing beyond the last cell in the range.
+ * @param number_of_updated_cells Counter that is increased with the number of
+ * cells for which the temperature was recomputed (if not a nullptr).
+ * @return Total number of thermal balance iterations for all cells in the
+ * range.
+ */
+unsigned long TemperatureCalculator::calculate_temperature(
+    double jfac, double hfac, DensityGrid::iterator begin,
+    DensityGrid::iterator end, unsigned long *number_of_updated_cells) const {
+  const unsigned long numcell = end.get_index() - begin.get_index();
+  unsigned long total_niter = 0;
+  unsigned int numupdated = 0;
+  for (unsigned long offset = 0; offset < numcell;
+       offset += TEMPERATURECALCULATOR_BLOCKSIZE) {
+    const unsigned int size =
+        std::min(numcell - offset,
+                 static_cast< unsigned long >(TEMPERATURECALCULATOR_BLOCKSIZE));
+    numupdated = 0;
+    total_niter += calculate_temperature_block(jfac, hfac, begin + offset,
+                                               size, &numupdated);
+    if (number_of_updated_cells != nullptr) {
+      *number_of_updated_cells += numupdated;
+    }
+  }
+  return total_niter;
 }
 
 /**
  * @brief Calculate a new temperature for each cell after shooting the given
  * number of photons.
  *
+ * The average number of thermal balance iterations per cell is written to the
+ * Log, if present.
+ *
  * @param totweight Total weight of all photons that were used.
  * @param grid DensityGrid on which to operate.
  * @param block Block that should be traversed by the local MPI process.
+ * @return Number of cells for which the temperature was recomputed.
  */
-void TemperatureCalculator::calculate_temperature(
+unsigned long TemperatureCalculator::calculate_temperature(
     double totweight, DensityGrid &grid,
     std::pair< unsigned long, unsigned long > &block) const {
   double jfac = _luminosity / totweight;
@@ -546,11 +1004,26 @@ void TemperatureCalculator::calculate_temperature(
   double hfac = jfac * 6.626070040e-34;
 
   WorkDistributor<
-      DensityGridTraversalJobMarket< TemperatureCalculatorFunction >,
-      DensityGridTraversalJob< TemperatureCalculatorFunction > >
+      DensityGridTraversalJobMarket<
+          TemperatureCalculatorBlockFunction,
+          DensityGridChunkTraversalJob< TemperatureCalculatorBlockFunction > >,
+      DensityGridChunkTraversalJob< TemperatureCalculatorBlockFunction > >
       workers;
-  TemperatureCalculatorFunction do_calculation(*this, jfac, hfac);
-  DensityGridTraversalJobMarket< TemperatureCalculatorFunction > jobs(
-      grid, do_calculation, block);
+  TemperatureCalculatorBlockFunction do_calculation(*this, jfac, hfac);
+  DensityGridTraversalJobMarket<
+      TemperatureCalculatorBlockFunction,
+      DensityGridChunkTraversalJob< TemperatureCalculatorBlockFunction > >
+      jobs(grid, do_calculation, block);
   workers.do_in_parallel(jobs);
+
+  if (_log) {
+    const unsigned long numupdated =
+        do_calculation.get_number_of_updated_cells();
+    _log->write_info("Thermal balance took on average ",
+                     do_calculation.get_number_of_iterations() /
+                         static_cast< double >(std::max(numupdated, 1ul)),
+                     " iterations per updated cell.");
+  }
+
+  return do_calculation.get_number_of_updated_cells();
 }
@@ -27,6 +27,7 @@
 #ifndef TEMPERATURECALCULATOR_HPP
 #define TEMPERATURECALCULATOR_HPP
 
+#include "Atomic.hpp"
 #include "DensityGrid.hpp"
 
 class Abundances;
@@ -35,6 +36,41 @@ class LineCoolingData;
 class Log;
 class RecombinationRates;
 
+/*! @brief Number of cells that is processed simultaneously by the batched
+ *  temperature calculation. */
+#define TEMPERATURECALCULATOR_BLOCKSIZE 8
+
+/**
+ * @brief Structure-of-arrays copy of the variables of a block of cells that
+ * are used during the temperature calculation.
+ *
+ * All arrays are indexed on the position of the cell within the block (the
+ * lane), so that loops over the lanes can be vectorized by the compiler.
+ */
+struct TemperatureCalculatorBlock {
+  /*! @brief Number of cells in the block. */
+  unsigned int _size;
+
+  /*! @brief Number density of every cell (in m^-3). */
+  double _number_density[TEMPERATURECALCULATOR_BLOCKSIZE];
+
+  /*! @brief Normalized mean intensity integrals of every cell (in s^-1). */
+  double _mean_intensity[NUMBER_OF_IONNAMES][TEMPERATURECALCULATOR_BLOCKSIZE];
+
+  /*! @brief Normalization factor for the heating integrals of every cell. */
+  double _hfac[TEMPERATURECALCULATOR_BLOCKSIZE];
+
+  /*! @brief Heating integrals of every cell (without normalization factor). */
+  double _heating[NUMBER_OF_HEATINGTERMS][TEMPERATURECALCULATOR_BLOCKSIZE];
+
+  /*! @brief z coordinate of the midpoint of every cell (in m). */
+  double _z[TEMPERATURECALCULATOR_BLOCKSIZE];
+
+  /*! @brief Ionic fractions of every cell, as set by the last ioneng_block()
+   *  evaluation for that cell. */
+  double _ionic_fraction[NUMBER_OF_IONNAMES][TEMPERATURECALCULATOR_BLOCKSIZE];
+};
+
 /**
  * @brief Class that calculates the temperature for every cell of a grid after
  * the photon shoot loop.
@@ -70,13 +106,24 @@ private:
   /*! @brief ChargeTransferRates used to calculate ionic fractions. */
   ChargeTransferRates &_charge_transfer_rates;
 
+  /*! @brief Relative change in the hydrogen mean intensity below which the
+   *  temperature and ionization state of a cell are not recomputed by the
+   *  batched temperature calculation (0 to always recompute). */
+  double _dirty_cell_threshold;
+
+  /*! @brief Log to write logging info to. */
+  Log *_log;
+
+  static double get_next_temperature(double T0, double F0, double Tprev,
+                                     double Fprev, double &Tlow, double &Thigh);
+
 public:
   TemperatureCalculator(double luminosity, Abundances &abundances,
                         double pahfac, double crfac, double crlim,
                         double crscale, LineCoolingData &line_cooling_data,
                         RecombinationRates &recombination_rates,
                         ChargeTransferRates &charge_transfer_rates,
-                        Log *log = nullptr);
+                        double dirty_cell_threshold = 0., Log *log = nullptr);
 
   static void ioneng(double &h0, double &he0, double &gain, double &loss,
                      double T, DensityGrid::iterator &cell, double jfac,
@@ -84,8 +131,25 @@ public:
                      double crfac, double crscale, LineCoolingData &data,
                      RecombinationRates &rates, ChargeTransferRates &ctr);
 
-  void calculate_temperature(double jfac, double hfac,
-                             DensityGrid::iterator &cell) const;
+  static void ioneng_block(TemperatureCalculatorBlock &block,
+                           const bool *active, const double *T, double *h0,
+                           double *he0, double *gain, double *loss,
+                           Abundances &abundances, double pahfac,
+                           double crfac, double crscale, LineCoolingData &data,
+                           RecombinationRates &rates,
+                           ChargeTransferRates &ctr);
+
+  unsigned int calculate_temperature(double jfac, double hfac,
+                                     DensityGrid::iterator &cell) const;
+
+  unsigned int calculate_temperature_block(
+      double jfac, double hfac, DensityGrid::iterator first, unsigned int size,
+      unsigned int *number_of_updated_cells = nullptr) const;
+
+  unsigned long
+  calculate_temperature(double jfac, double hfac, DensityGrid::iterator begin,
+                        DensityGrid::iterator end,
+                        unsigned long *number_of_updated_cells = nullptr) const;
 
   /**
    * @brief Functor used to calculate the temperature of a single cell.
@@ -129,7 +193,84 @@ public:
     }
   };
 
-  void
+  /**
+   * @brief Functor used to calculate the temperature of a chunk of cells,
+   * using the batched temperature calculation.
+   */
+  class TemperatureCalculatorBlockFunction {
+  private:
+    /*! @brief TemperatureCalculator used to perform the calculation. */
+    const TemperatureCalculator &_calculator;
+
+    /*! @brief First normalization factor used in the TemperatureCalculator
+     * call. */
+    double _jfac;
+
+    /*! @brief Second normalization factor used in the TemperatureCalculator
+     * call. */
+    double _hfac;
+
+    /*! @brief Total number of thermal balance iterations. */
+    unsigned long _number_of_iterations;
+
+    /*! @brief Number of cells for which the temperature was recomputed. */
+    unsigned long _number_of_updated_cells;
+
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param calculator TemperatureCalculator used to perform the
+     * calculation.
+     * @param jfac First normalization factor used in the TemperatureCalculator
+     * call.
+     * @param hfac Second normalization factor used in the TemperatureCalculator
+     * call.
+     */
+    TemperatureCalculatorBlockFunction(const TemperatureCalculator &calculator,
+                                       double jfac, double hfac)
+        : _calculator(calculator), _jfac(jfac), _hfac(hfac),
+          _number_of_iterations(0), _number_of_updated_cells(0) {}
+
+    /**
+     * @brief Get the total number of thermal balance iterations for all
+     * chunks processed so far.
+     *
+     * @return Total number of iterations.
+     */
+    inline unsigned long get_number_of_iterations() const {
+      return _number_of_iterations;
+    }
+
+    /**
+     * @brief Get the number of cells for which the temperature was recomputed
+     * for all chunks processed so far.
+     *
+     * @return Number of updated cells.
+     */
+    inline unsigned long get_number_of_updated_cells() const {
+      return _number_of_updated_cells;
+    }
+
+    /**
+     * @brief Do the temperature calculation for a chunk of cells.
+     *
+     * @param begin DensityGrid::iterator pointing to the first cell of the
+     * chunk.
+     * @param end DensityGrid::iterator pointing beyond the last cell of the
+     * chunk.
+     */
+    inline void operator()(DensityGrid::iterator begin,
+                           DensityGrid::iterator end) {
+      unsigned long numupdated = 0;
+      const unsigned long niter = _calculator.calculate_temperature(
+          _jfac, _hfac, begin, end, &numupdated);
+      Atomic::add(_number_of_iterations, niter);
+      Atomic::add(_number_of_updated_cells, numupdated);
+    }
+  };
+
+  unsigned long
   calculate_temperature(double totweight, DensityGrid &grid,
                         std::pair< unsigned long, unsigned long > &block) const;
 };
@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TemperatureTable.hpp
+ *
+ * @brief Logarithmic temperature grid used to tabulate temperature dependent
+ * rates.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef TEMPERATURETABLE_HPP
+#define TEMPERATURETABLE_HPP
+
+#include "Error.hpp"
+
+#include <cmath>
+
+/**
+ * @brief Logarithmic temperature grid used to tabulate temperature dependent
+ * rates.
+ *
+ * The grid points are uniformly spaced in log10(T) between a minimum and a
+ * maximum temperature. Tabulated values are linearly interpolated in log10(T).
+ * The accuracy of the interpolation is set by the number of grid points per
+ * decade: the relative error on a power law T^a is roughly
+ * (a ln(10) / points_per_decade)^2 / 8.
+ *
+ * Classes that use the grid should fall back to the exact fits for
+ * temperatures outside the grid range.
+ */
+class TemperatureTable {
+private:
+  /*! @brief Minimum temperature in the table (in K). */
+  double _minimum_temperature;
+
+  /*! @brief Maximum temperature in the table (in K). */
+  double _maximum_temperature;
+
+  /*! @brief Logarithm of the minimum temperature (log10(T) with T in K). */
+  double _log_minimum_temperature;
+
+  /*! @brief Spacing of the grid in log10(T). */
+  double _log_step;
+
+  /*! @brief Inverse spacing of the grid in log10(T). */
+  double _inverse_log_step;
+
+  /*! @brief Number of grid points. */
+  unsigned int _number_of_points;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param minimum_temperature Minimum temperature in the table (in K).
+   * @param maximum_temperature Maximum temperature in the table (in K).
+   * @param points_per_decade Number of grid points per decade in temperature.
+   */
+  inline TemperatureTable(double minimum_temperature = 1000.,
+                          double maximum_temperature = 1.e6,
+                          unsigned int points_per_decade = 100)
+      : _minimum_temperature(minimum_temperature),
+        _maximum_temperature(maximum_temperature) {
+
+    if (minimum_temperature <= 0. ||
+        maximum_temperature <= minimum_temperature) {
+      cmac_error("Invalid temperature range for TemperatureTable: [%g K, "
+                 "%g K]!",
+                 minimum_temperature, maximum_temperature);
+    }
+    if (points_per_decade == 0) {
+      cmac_error("TemperatureTable needs at least one point per decade!");
+    }
+
+    _log_minimum_temperature = std::log10(_minimum_temperature);
+    const double log_range =
+        std::log10(_maximum_temperature) - _log_minimum_temperature;
+    _number_of_points = std::ceil(points_per_decade * log_range) + 1;
+    if (_number_of_points < 2) {
+      _number_of_points = 2;
+    }
+    _log_step = log_range / (_number_of_points - 1);
+    _inverse_log_step = 1. / _log_step;
+  }
+
+  /**
+   * @brief Get the number of grid points.
+   *
+   * @return Number of grid points.
+   */
+  inline unsigned int get_number_of_points() const {
+    return _number_of_points;
+  }
+
+  /**
+   * @brief Get the minimum temperature in the table.
+   *
+   * @return Minimum temperature (in K).
+   */
+  inline double get_minimum_temperature() const {
+    return _minimum_temperature;
+  }
+
+  /**
+   * @brief Get the maximum temperature in the table.
+   *
+   * @return Maximum temperature (in K).
+   */
+  inline double get_maximum_temperature() const {
+    return _maximum_temperature;
+  }
+
+  /**
+   * @brief Get the temperature of the grid point with the given index.
+   *
+   * @param index Index of a grid point.
+   * @return Temperature of that grid point (in K).
+   */
+  inline double get_temperature(unsigned int index) const {
+    if (index == 0) {
+      return _minimum_temperature;
+    }
+    if (index == _number_of_points - 1) {
+      return _maximum_temperature;
+    }
+    return std::pow(10., _log_minimum_temperature + index * _log_step);
+  }
+
+  /**
+   * @brief Get the interpolation index and fraction for the given temperature.
+   *
+   * @param temperature Temperature (in K).
+   * @param index Variable to store the index of the grid point just below the
+   * given temperature in.
+   * @param fraction Variable to store the relative position of the temperature
+   * between the grid points with indices index and index + 1 in.
+   * @return True if the temperature lies inside the table range. If not,
+   * index and fraction are not set.
+   */
+  inline bool get_interpolation(double temperature, unsigned int &index,
+                                double &fraction) const {
+    // this also catches NaN temperatures
+    if (!(temperature >= _minimum_temperature &&
+          temperature <= _maximum_temperature)) {
+      return false;
+    }
+    const double x =
+        (std::log10(temperature) - _log_minimum_temperature) *
+        _inverse_log_step;
+    index = x;
+    if (index > _number_of_points - 2) {
+      index = _number_of_points - 2;
+    }
+    fraction = x - index;
+    return true;
+  }
+
+  /**
+   * @brief Interpolate the given table.
+   *
+   * @param values Tabulated values (should contain get_number_of_points()
+   * elements).
+   * @param index Index returned by get_interpolation().
+   * @param fraction Fraction returned by get_interpolation().
+   * @return Interpolated value.
+   */
+  inline static double interpolate(const double *values, unsigned int index,
+                                   double fraction) {
+    return values[index] + fraction * (values[index + 1] - values[index]);
+  }
+};
+
+#endif // TEMPERATURETABLE_HPP
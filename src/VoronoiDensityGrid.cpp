@@ -191,10 +191,7 @@ void VoronoiDensityGrid::initialize(
       for (unsigned int i = 0; i < numcell; ++i) {
         _generator_positions[i] = _voronoi_grid->get_centroid(i);
       }
-      delete _voronoi_grid;
-      _voronoi_grid = VoronoiGridFactory::generate(
-          _voronoi_grid_type, _generator_positions, _box, _periodic);
-      _voronoi_grid->compute_grid();
+      update_voronoi_grid();
     }
 
     if (_log) {
@@ -202,6 +199,9 @@ void VoronoiDensityGrid::initialize(
     }
   }
 
+  compute_traversal_faces();
+  compute_source_cells();
+
   DensityGrid::initialize(block);
   DensityGrid::initialize(block, _density_function);
 }
@@ -228,14 +228,32 @@ void VoronoiDensityGrid::evolve(double timestep) {
 
     voronoidensitygrid_print_generators();
 
+    Timer timer;
+    timer.start();
+    update_voronoi_grid();
+    compute_traversal_faces();
+    compute_source_cells();
+    timer.stop();
+
+    if (_log) {
+      _log->write_status("Done evolving Voronoi grid (rebuild took ",
+                         Utilities::human_readable_time(timer.value()), ").");
+    }
+  }
+}
+
+/**
+ * @brief Update the VoronoiGrid after the generator positions have changed.
+ *
+ * If the VoronoiGrid implementation cannot reuse the previous grid, a new grid
+ * is constructed from scratch.
+ */
+void VoronoiDensityGrid::update_voronoi_grid() {
+  if (!_voronoi_grid->update_grid()) {
     delete _voronoi_grid;
     _voronoi_grid = VoronoiGridFactory::generate(
         _voronoi_grid_type, _generator_positions, _box, _periodic);
     _voronoi_grid->compute_grid();
-
-    if (_log) {
-      _log->write_status("Done evolving Voronoi grid.");
-    }
   }
 }
 
@@ -392,10 +410,185 @@ double VoronoiDensityGrid::get_cell_volume(unsigned long index) const {
   return _voronoi_grid->get_volume(index);
 }
 
+/**
+ * @brief Store the faces of all cells in a compact form that is used during
+ * photon traversal.
+ *
+ * Querying the faces of a cell from the VoronoiGrid returns a newly allocated
+ * list of faces, including their vertices. This routine stores the unit normal,
+ * the plane offset and the neighbour index of every face in a single
+ * contiguous array, so that the photon traversal only needs to read this
+ * array. This needs to be done every time the VoronoiGrid is recomputed.
+ */
+void VoronoiDensityGrid::compute_traversal_faces() {
+  const unsigned int numcell = get_number_of_cells();
+  _traversal_face_offsets.resize(numcell + 1);
+  _traversal_faces.clear();
+  for (unsigned int i = 0; i < numcell; ++i) {
+    _traversal_face_offsets[i] = _traversal_faces.size();
+    const std::vector< VoronoiFace > faces = _voronoi_grid->get_faces(i);
+    for (auto it = faces.begin(); it != faces.end(); ++it) {
+      const unsigned int ngb = it->get_neighbour();
+      VoronoiDensityGridFace face;
+      if (_voronoi_grid->is_real_neighbour(ngb)) {
+        face._normal = _generator_positions[ngb] - _generator_positions[i];
+        face._normal /= face._normal.norm();
+      } else {
+        face._normal = _voronoi_grid->get_wall_normal(ngb);
+      }
+      face._offset =
+          CoordinateVector<>::dot_product(face._normal, it->get_midpoint());
+      face._neighbour = ngb;
+      _traversal_faces.push_back(face);
+    }
+  }
+  _traversal_face_offsets[numcell] = _traversal_faces.size();
+}
+
+/**
+ * @brief Get the distance a photon travels before it leaves the cell with the
+ * given index, and the index of the cell (or wall) it enters next.
+ *
+ * @param index Index of the cell that contains the photon.
+ * @param photon_origin Current position of the photon (in m).
+ * @param photon_direction Direction of the photon.
+ * @param next_index Variable to store the index of the next cell in.
+ * @return Distance to the closest face in the direction of the photon (in m).
+ * A value of zero or less signals that no valid face could be found, which
+ * can happen if round off puts the photon outside the cell.
+ */
+double VoronoiDensityGrid::get_wall_distance(
+    unsigned int index, const CoordinateVector<> &photon_origin,
+    const CoordinateVector<> &photon_direction,
+    unsigned int &next_index) const {
+
+  double mins = -1.;
+  const unsigned int face_end = _traversal_face_offsets[index + 1];
+  for (unsigned int i = _traversal_face_offsets[index]; i < face_end; ++i) {
+    const VoronoiDensityGridFace &face = _traversal_faces[i];
+    const double nk =
+        CoordinateVector<>::dot_product(face._normal, photon_direction);
+    if (nk > 0) {
+      // round off can put the photon marginally outside the cell; taking the
+      // absolute value guarantees that the sign of 'sngb' is set by 'nk'
+      const double nx =
+          CoordinateVector<>::dot_product(face._normal, photon_origin);
+      const double sngb = std::abs(face._offset - nx) / nk;
+      if (mins < 0. || (sngb > 0. && sngb < mins)) {
+        mins = sngb;
+        next_index = face._neighbour;
+      }
+    }
+  }
+  return mins;
+}
+
+/**
+ * @brief Locate the cells that contain the discrete photon sources.
+ *
+ * This needs to be done every time the VoronoiGrid is recomputed.
+ */
+void VoronoiDensityGrid::compute_source_cells() {
+  _source_cells.resize(_source_positions.size());
+  for (unsigned int i = 0; i < _source_positions.size(); ++i) {
+    _source_cells[i] = _voronoi_grid->get_index(_source_positions[i]);
+  }
+}
+
+/**
+ * @brief Find the cell that contains the given position by walking through
+ * the grid, starting from the cell with the given index.
+ *
+ * At every step, we move to the neighbouring cell whose generator is closest
+ * to the position, until no neighbour is closer than the generator of the
+ * current cell. Since a position belongs to the cell with the closest
+ * generator, this is the cell that contains the position. If the starting
+ * cell is close to the position, this only takes a few steps and is much
+ * cheaper than a full point location.
+ *
+ * The walk does not know about periodic neighbours, so for periodic boxes and
+ * for positions outside the box we fall back to a full point location.
+ *
+ * @param position Position (in m).
+ * @param index Index of a cell close to the position.
+ * @return Index of the cell that contains the position.
+ */
+unsigned int
+VoronoiDensityGrid::locate_from_cell(const CoordinateVector<> &position,
+                                     unsigned int index) const {
+
+  if (_periodic.x() || _periodic.y() || _periodic.z() ||
+      !_box.inside(position)) {
+    return _voronoi_grid->get_index(position);
+  }
+
+  double mind2 = (_generator_positions[index] - position).norm2();
+  unsigned int next_index = index;
+  do {
+    index = next_index;
+    const unsigned int face_end = _traversal_face_offsets[index + 1];
+    for (unsigned int i = _traversal_face_offsets[index]; i < face_end; ++i) {
+      const unsigned int ngb = _traversal_faces[i]._neighbour;
+      if (_voronoi_grid->is_real_neighbour(ngb)) {
+        const double d2 = (_generator_positions[ngb] - position).norm2();
+        if (d2 < mind2) {
+          mind2 = d2;
+          next_index = ngb;
+        }
+      }
+    }
+  } while (next_index != index);
+  return index;
+}
+
+/**
+ * @brief Set the positions of the discrete photon sources.
+ *
+ * The cells that contain the sources are located once, so that freshly
+ * emitted photons do not require a full point location. The positions should
+ * be in the same order as PhotonSource::get_discrete_positions(), since
+ * photons only carry the index of their source.
+ *
+ * @param positions Positions of the discrete photon sources (in m).
+ */
+void VoronoiDensityGrid::set_source_positions(
+    const std::vector< CoordinateVector<> > &positions) {
+  _source_positions = positions;
+  if (_voronoi_grid != nullptr) {
+    compute_source_cells();
+  }
+}
+
+/**
+ * @brief Get the index of the cell that contains the discrete photon source
+ * with the given index.
+ *
+ * @param source_index Index of the discrete photon source, as stored in the
+ * Photon by PhotonSource::get_random_photon().
+ * @param index Variable to store the index of the cell in.
+ * @return True if the source index corresponds to one of the positions passed
+ * on to set_source_positions(), false otherwise (in which case the index is
+ * not set).
+ */
+bool VoronoiDensityGrid::get_source_cell(unsigned int source_index,
+                                         unsigned int &index) const {
+  if (source_index < _source_cells.size()) {
+    index = _source_cells[source_index];
+    return true;
+  }
+  return false;
+}
+
 /**
  * @brief Traverse the given Photon through the grid until the given optical
  * depth is reached (or the Photon leaves the system).
  *
+ * This version only uses the compact face information stored by
+ * compute_traversal_faces(). Photons that are emitted by a discrete photon
+ * source start from the cached cell of that source (looked up using the source
+ * index stored in the Photon); all other photons require a full point
+ * location.
+ *
  * @param photon Photon to use.
  * @param optical_depth Target optical depth.
  * @return DensityGrid::iterator to the cell that contains the Photon when it
@@ -405,6 +598,130 @@ double VoronoiDensityGrid::get_cell_volume(unsigned long index) const {
 DensityGrid::iterator VoronoiDensityGrid::interact(Photon &photon,
                                                    double optical_depth) {
 
+  CoordinateVector<> photon_origin = photon.get_position();
+  unsigned int index = 0;
+  const bool is_source = get_source_cell(photon.get_source_index(), index);
+  // move the photon a tiny bit to make sure it is inside the cell
+  photon_origin += _epsilon * photon.get_direction();
+  if (is_source) {
+    index = locate_from_cell(photon_origin, index);
+  } else {
+    index = _voronoi_grid->get_index(photon_origin);
+  }
+  return traverse(photon, optical_depth, photon_origin, index);
+}
+
+/**
+ * @brief Traverse the given Photon through the grid until the given optical
+ * depth is reached (or the Photon leaves the system), starting from the given
+ * cell.
+ *
+ * The Photon is located by walking through the grid from the given cell, which
+ * avoids a full point location for reemitted photons.
+ *
+ * @param photon Photon to use.
+ * @param optical_depth Target optical depth.
+ * @param cell DensityGrid::iterator to a cell that contains the Photon (or is
+ * close to it), usually the result of the previous interaction.
+ * @return DensityGrid::iterator to the cell that contains the Photon when it
+ * reaches the target optical depth, or VoronoiDensityGrid::end if the Photon
+ * leaves the system.
+ */
+DensityGrid::iterator
+VoronoiDensityGrid::interact_from_cell(Photon &photon, double optical_depth,
+                                       const DensityGrid::iterator &cell) {
+
+  cmac_assert(cell.get_index() < get_number_of_cells());
+
+  CoordinateVector<> photon_origin = photon.get_position();
+  // move the photon a tiny bit to make sure it is inside the cell
+  photon_origin += _epsilon * photon.get_direction();
+  const unsigned int index = locate_from_cell(photon_origin, cell.get_index());
+  return traverse(photon, optical_depth, photon_origin, index);
+}
+
+/**
+ * @brief Traverse the given Photon through the grid until the given optical
+ * depth is reached (or the Photon leaves the system), starting from the given
+ * position inside the cell with the given index.
+ *
+ * @param photon Photon to use.
+ * @param optical_depth Target optical depth.
+ * @param photon_origin Starting position of the photon (in m).
+ * @param index Index of the cell that contains the starting position.
+ * @return DensityGrid::iterator to the cell that contains the Photon when it
+ * reaches the target optical depth, or VoronoiDensityGrid::end if the Photon
+ * leaves the system.
+ */
+DensityGrid::iterator VoronoiDensityGrid::traverse(
+    Photon &photon, double optical_depth, CoordinateVector<> photon_origin,
+    unsigned int index) {
+
+  const CoordinateVector<> photon_direction = photon.get_direction();
+  while (_voronoi_grid->is_real_neighbour(index) && optical_depth > 0.) {
+    unsigned int next_index = 0;
+    double mins = get_wall_distance(index, photon_origin, photon_direction,
+                                    next_index);
+    unsigned int loopcount = 1;
+    while (mins <= 0.) {
+      photon_origin += _epsilon * photon_direction;
+      index = locate_from_cell(photon_origin, index);
+      mins = get_wall_distance(index, photon_origin, photon_direction,
+                               next_index);
+      ++loopcount;
+      cmac_assert_message(loopcount < 100, "mins: %g", mins);
+    }
+
+    DensityGrid::iterator it(index, *this);
+
+    const double tau = get_optical_depth(mins, it, photon);
+    optical_depth -= tau;
+
+    if (optical_depth < 0.) {
+      double Scorr = mins * optical_depth / tau;
+      mins += Scorr;
+    } else {
+      index = next_index;
+    }
+    photon_origin += mins * photon_direction;
+
+    cmac_assert_message(!_voronoi_grid->is_real_neighbour(index) ||
+                            _voronoi_grid->is_inside(photon_origin),
+                        "index: %u, mins: %g, position: %g %g %g, "
+                        "photon direction: %g %g %g",
+                        index, mins, photon_origin[0], photon_origin[1],
+                        photon_origin[2], photon_direction[0],
+                        photon_direction[1], photon_direction[2]);
+
+    update_integrals(mins, it, photon);
+  }
+
+  photon.set_position(photon_origin);
+  if (!_voronoi_grid->is_real_neighbour(index)) {
+    return end();
+  } else {
+    return DensityGrid::iterator(index, *this);
+  }
+}
+
+/**
+ * @brief Traverse the given Photon through the grid until the given optical
+ * depth is reached (or the Photon leaves the system), by querying the faces of
+ * every cell from the VoronoiGrid.
+ *
+ * This is the original traversal algorithm. It is kept as a reference for the
+ * traversal in interact() that uses the compact face information.
+ *
+ * @param photon Photon to use.
+ * @param optical_depth Target optical depth.
+ * @return DensityGrid::iterator to the cell that contains the Photon when it
+ * reaches the target optical depth, or VoronoiDensityGrid::end if the Photon
+ * leaves the system.
+ */
+DensityGrid::iterator
+VoronoiDensityGrid::interact_voronoi_grid(Photon &photon,
+                                          double optical_depth) {
+
   double S = 0.;
 
   CoordinateVector<> photon_origin = photon.get_position();
@@ -464,8 +781,7 @@ DensityGrid::iterator VoronoiDensityGrid::interact(Photon &photon,
 
     DensityGrid::iterator it(index, *this);
 
-    const double tau =
-        get_optical_depth(mins, it.get_ionization_variables(), photon);
+    const double tau = get_optical_depth(mins, it, photon);
     optical_depth -= tau;
 
     if (optical_depth < 0.) {
@@ -517,44 +833,15 @@ double VoronoiDensityGrid::get_total_emission(CoordinateVector<> origin,
 
   unsigned int index = _voronoi_grid->get_index(origin);
   while (_voronoi_grid->is_real_neighbour(index)) {
-    CoordinateVector<> ipos = _generator_positions[index];
     unsigned int next_index = 0;
-    unsigned int loopcount = 0;
-    double mins = -1.;
+    double mins = get_wall_distance(index, origin, direction, next_index);
+    unsigned int loopcount = 1;
     while (mins <= 0.) {
-      mins = -1;
-      auto faces = _voronoi_grid->get_faces(index);
-      for (auto it = faces.begin(); it != faces.end(); ++it) {
-        const VoronoiFace &face = *it;
-        const unsigned int ngb = face.get_neighbour();
-        CoordinateVector<> normal;
-        if (_voronoi_grid->is_real_neighbour(ngb)) {
-          normal = _generator_positions[ngb] - ipos;
-        } else {
-          normal = _voronoi_grid->get_wall_normal(ngb);
-        }
-        const double nk = CoordinateVector<>::dot_product(normal, direction);
-        if (nk > 0) {
-          const CoordinateVector<> point = face.get_midpoint();
-          const double sngb = std::abs(CoordinateVector<>::dot_product(
-                                  normal, (point - origin))) /
-                              nk;
-          if (mins < 0. || (sngb > 0. && sngb < mins)) {
-            mins = sngb;
-            next_index = ngb;
-          }
-        }
-      }
+      origin += _epsilon * direction;
+      index = _voronoi_grid->get_index(origin);
+      mins = get_wall_distance(index, origin, direction, next_index);
       ++loopcount;
       cmac_assert_message(loopcount < 100, "mins: %g", mins);
-      if (mins <= 0.) {
-        origin += _epsilon * direction;
-        index = _voronoi_grid->get_index(origin);
-        ipos = _generator_positions[index];
-      }
-    }
-    if (!_voronoi_grid->is_real_neighbour(index)) {
-      break;
     }
 
     DensityGrid::iterator it(index, *this);
@@ -31,6 +31,23 @@
 class VoronoiGeneratorDistribution;
 class VoronoiGrid;
 
+/**
+ * @brief Face of a Voronoi cell, reduced to the information that is needed to
+ * find the distance a photon travels before it leaves the cell.
+ */
+struct VoronoiDensityGridFace {
+  /*! @brief Unit normal of the face, pointing away from the cell. */
+  CoordinateVector<> _normal;
+
+  /*! @brief Offset of the plane of the face: dot product of the normal with a
+   *  point on the face (in m). */
+  double _offset;
+
+  /*! @brief Index of the neighbouring cell on the other side of the face (can
+   *  be a wall index). */
+  unsigned int _neighbour;
+};
+
 /**
  * @brief DensityGrid implementation that uses an unstructured Voronoi grid.
  */
@@ -69,6 +86,31 @@ private:
   /*! @brief Type of Voronoi grid to use. */
   std::string _voronoi_grid_type;
 
+  /*! @brief Offsets of the faces of every cell in _traversal_faces (number of
+   *  cells plus one values). */
+  std::vector< unsigned int > _traversal_face_offsets;
+
+  /*! @brief Faces of all cells, stored contiguously per cell. */
+  std::vector< VoronoiDensityGridFace > _traversal_faces;
+
+  /*! @brief Positions of the discrete photon sources (in m). */
+  std::vector< CoordinateVector<> > _source_positions;
+
+  /*! @brief Indices of the cells that contain the discrete photon sources. */
+  std::vector< unsigned int > _source_cells;
+
+  void update_voronoi_grid();
+  void compute_traversal_faces();
+  void compute_source_cells();
+
+  double get_wall_distance(unsigned int index,
+                           const CoordinateVector<> &photon_origin,
+                           const CoordinateVector<> &photon_direction,
+                           unsigned int &next_index) const;
+  DensityGrid::iterator traverse(Photon &photon, double optical_depth,
+                                 CoordinateVector<> photon_origin,
+                                 unsigned int index);
+
 public:
   VoronoiDensityGrid(
       VoronoiGeneratorDistribution *position_generator,
@@ -99,7 +141,17 @@ public:
   get_neighbours(unsigned long index);
   virtual std::vector< Face > get_faces(unsigned long index) const;
   virtual double get_cell_volume(unsigned long index) const;
+  virtual void
+  set_source_positions(const std::vector< CoordinateVector<> > &positions);
+  bool get_source_cell(unsigned int source_index, unsigned int &index) const;
+  unsigned int locate_from_cell(const CoordinateVector<> &position,
+                                unsigned int index) const;
   virtual DensityGrid::iterator interact(Photon &photon, double optical_depth);
+  virtual DensityGrid::iterator
+  interact_from_cell(Photon &photon, double optical_depth,
+                     const DensityGrid::iterator &cell);
+  DensityGrid::iterator interact_voronoi_grid(Photon &photon,
+                                              double optical_depth);
   virtual double get_total_emission(CoordinateVector<> origin,
                                     CoordinateVector<> direction,
                                     EmissionLine line);
@@ -48,6 +48,20 @@ public:
    */
   virtual void compute_grid(int worksize = -1) = 0;
 
+  /**
+   * @brief Update the Voronoi grid after the generator positions have changed.
+   *
+   * Implementations that can reuse the previous grid to speed up the
+   * construction of the new grid should override this method. The default
+   * implementation does nothing and returns false, in which case the caller
+   * should construct a new grid from scratch.
+   *
+   * @param worksize Number of shared memory threads to use during the grid
+   * update.
+   * @return True if the grid was updated.
+   */
+  virtual bool update_grid(int worksize = -1) { return false; }
+
   /**
    * @brief Get the volume of the Voronoi cell with the given index.
    *
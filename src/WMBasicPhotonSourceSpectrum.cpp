@@ -145,6 +145,10 @@ WMBasicPhotonSourceSpectrum::WMBasicPhotonSourceSpectrum(double temperature,
         _cumulative_distribution[WMBASICPHOTONSOURCESPECTRUM_NUMFREQ - 1];
   }
 
+  // set up the guide table used to sample from the cumulative distribution
+  _guide_table.initialize(_cumulative_distribution,
+                          WMBASICPHOTONSOURCESPECTRUM_NUMFREQ);
+
   if (log) {
     log->write_status(
         "Constructed WMBasicPhotonSourceSpectrum with temperature ",
@@ -217,8 +221,7 @@ std::string WMBasicPhotonSourceSpectrum::get_filename(double temperature,
 double WMBasicPhotonSourceSpectrum::get_random_frequency(
     RandomGenerator &random_generator, double temperature) const {
   double x = random_generator.get_uniform_random_double();
-  unsigned int inu = Utilities::locate(x, _cumulative_distribution,
-                                       WMBASICPHOTONSOURCESPECTRUM_NUMFREQ);
+  unsigned int inu = _guide_table.locate(x, _cumulative_distribution);
   double frequency =
       _frequencies[inu] +
       (_frequencies[inu + 1] - _frequencies[inu]) *
@@ -30,6 +30,7 @@
 #ifndef WMBASICPHOTONSOURCESPECTRUM_HPP
 #define WMBASICPHOTONSOURCESPECTRUM_HPP
 
+#include "GuideTable.hpp"
 #include "PhotonSourceSpectrum.hpp"
 
 #include <string>
@@ -55,6 +56,9 @@ private:
   /*! @brief Cumulative distribution of the spectrum. */
   double _cumulative_distribution[WMBASICPHOTONSOURCESPECTRUM_NUMFREQ];
 
+  /*! @brief GuideTable used to sample from the cumulative distribution. */
+  GuideTable _guide_table;
+
   /*! @brief Total ionizing flux of the spectrum (in m^-2 s^-1). */
   double _total_flux;
 
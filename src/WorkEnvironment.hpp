@@ -37,6 +37,11 @@
 #include <sstream>
 #endif
 
+#ifdef HAVE_AFFINITY
+#include <sched.h>
+#include <vector>
+#endif
+
 /**
  * @brief Class that is responsible for managing the global number of threads.
  */
@@ -62,6 +67,70 @@ public:
       filename << "jobtimes_" << i << ".txt";
       std::ofstream file(filename.str(), std::ofstream::trunc);
     }
+#endif
+  }
+
+  /**
+   * @brief Pin the threads to the CPUs the process is allowed to run on.
+   *
+   * Thread i is pinned to the i-th available CPU (modulo the number of
+   * available CPUs), so that a thread no longer migrates between CPUs (and
+   * NUMA nodes) and keeps using the memory it first touched. The OpenMP runtime
+   * reuses the same threads for later parallel regions with the same number of
+   * threads, so this routine should be called once, after
+   * set_max_num_threads(), and before any memory is allocated.
+   *
+   * @param max_num_threads Number of threads to pin.
+   * @return Number of threads that were successfully pinned (0 if the system
+   * does not support thread pinning).
+   */
+  inline static int pin_threads(int max_num_threads) {
+#ifdef HAVE_AFFINITY
+    cpu_set_t process_set;
+    CPU_ZERO(&process_set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &process_set) != 0) {
+      return 0;
+    }
+    std::vector< int > cpus;
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+      if (CPU_ISSET(i, &process_set)) {
+        cpus.push_back(i);
+      }
+    }
+    if (cpus.size() == 0) {
+      return 0;
+    }
+
+    int num_pinned = 0;
+#ifdef HAVE_OPENMP
+#pragma omp parallel num_threads(max_num_threads) reduction(+ : num_pinned)
+#endif
+    {
+      cpu_set_t thread_set;
+      CPU_ZERO(&thread_set);
+      CPU_SET(cpus[get_thread_id() % cpus.size()], &thread_set);
+      if (sched_setaffinity(0, sizeof(cpu_set_t), &thread_set) == 0) {
+        ++num_pinned;
+      }
+    }
+    return num_pinned;
+#else
+    return 0;
+#endif
+  }
+
+  /**
+   * @brief Get the rank of the calling thread within the current parallel
+   * region.
+   *
+   * @return Rank of the calling thread (0 if OpenMP is not available or if we
+   * are not in a parallel region).
+   */
+  inline static int get_thread_id() {
+#ifdef HAVE_OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
 #endif
   }
 };
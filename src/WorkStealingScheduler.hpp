@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file WorkStealingScheduler.hpp
+ *
+ * @brief Lock-free work stealing scheduler for index ranges.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef WORKSTEALINGSCHEDULER_HPP
+#define WORKSTEALINGSCHEDULER_HPP
+
+#include "Configuration.hpp"
+#include "Error.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock-free work stealing scheduler for index ranges.
+ *
+ * A JobMarket that needs to hand out a range of independent work items (e.g.
+ * photons or cells) can use this class to distribute the items over the
+ * threads. At the start of a parallel run, every thread receives an equal
+ * contiguous part of the range in its own queue. A thread takes chunks from the
+ * front of its own queue, and when its queue is empty, it steals the back half
+ * of the queue of another thread.
+ *
+ * Every queue is a single 64-bit atomic value that contains the begin (high 32
+ * bits) and end (low 32 bits) of the remaining range. Both taking a chunk and
+ * stealing are a single compare-and-swap on this value, so that no locks are
+ * needed. Since the value completely describes the state of the queue, a
+ * successful compare-and-swap is always valid (there is no ABA problem).
+ * Threads only touch the queues of other threads when they run out of work,
+ * and queues are padded to a cache line, so that there is no contention
+ * during most of the run.
+ *
+ * A thread that finds all queues empty stops, even if another thread is
+ * still in the process of moving stolen work into its own queue. That work is
+ * then executed by the thread that stole it.
+ */
+class WorkStealingScheduler {
+private:
+  /**
+   * @brief Queue of a single thread, padded to a cache line.
+   */
+  struct ThreadQueue {
+    /*! @brief Remaining range: begin in the high 32 bits, end in the low 32
+     *  bits. */
+    std::atomic< uint64_t > _range;
+
+    /*! @brief Padding that makes sure different queues do not share a cache
+     *  line. */
+    char _padding[64 - sizeof(std::atomic< uint64_t >)];
+  };
+
+  /*! @brief Queues for all threads. */
+  ThreadQueue _queues[MAX_NUM_THREADS];
+
+  /*! @brief Number of threads that share the work. */
+  int _worksize;
+
+  /**
+   * @brief Pack the given range into a single 64-bit value.
+   *
+   * @param begin Begin of the range.
+   * @param end End of the range.
+   * @return Packed range.
+   */
+  inline static uint64_t pack(uint64_t begin, uint64_t end) {
+    return (begin << 32) | end;
+  }
+
+  /**
+   * @brief Get the begin of a packed range.
+   *
+   * @param range Packed range.
+   * @return Begin of the range.
+   */
+  inline static uint64_t get_begin(uint64_t range) { return range >> 32; }
+
+  /**
+   * @brief Get the end of a packed range.
+   *
+   * @param range Packed range.
+   * @return End of the range.
+   */
+  inline static uint64_t get_end(uint64_t range) {
+    return range & 0xffffffffu;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * The scheduler initially has no work.
+   */
+  inline WorkStealingScheduler() : _worksize(0) {
+    for (int i = 0; i < MAX_NUM_THREADS; ++i) {
+      _queues[i]._range = 0;
+    }
+  }
+
+  /**
+   * @brief Distribute the range [0, size[ over the given number of threads.
+   *
+   * This routine should not be called while threads are getting work.
+   *
+   * @param size Number of work items.
+   * @param worksize Number of threads that will share the work.
+   */
+  inline void reset(unsigned long size, int worksize) {
+    if (size > 0xffffffffu) {
+      cmac_error("Too many work items for the WorkStealingScheduler (%lu)!",
+                 size);
+    }
+    if (worksize < 1 || worksize > MAX_NUM_THREADS) {
+      cmac_error("Invalid number of threads for the WorkStealingScheduler "
+                 "(%i, MAX_NUM_THREADS = %i)!",
+                 worksize, MAX_NUM_THREADS);
+    }
+    _worksize = worksize;
+    for (int i = 0; i < _worksize; ++i) {
+      const uint64_t begin = (i * size) / _worksize;
+      const uint64_t end = ((i + 1) * size) / _worksize;
+      _queues[i]._range = pack(begin, end);
+    }
+  }
+
+  /**
+   * @brief Get the next range of work items for the given thread.
+   *
+   * @param thread_id Rank of the calling thread.
+   * @param chunksize Maximum number of work items to return.
+   * @param begin Begin of the returned range (output).
+   * @param end End of the returned range (output).
+   * @return True if work was found, false if all work has been handed out.
+   */
+  inline bool get_range(int thread_id, unsigned int chunksize,
+                        unsigned long &begin, unsigned long &end) {
+    cmac_assert(thread_id < _worksize);
+    cmac_assert(chunksize > 0);
+
+    // take a chunk from the front of our own queue
+    std::atomic< uint64_t > &own_range = _queues[thread_id]._range;
+    uint64_t old_range = own_range.load();
+    while (get_begin(old_range) < get_end(old_range)) {
+      const uint64_t old_begin = get_begin(old_range);
+      const uint64_t new_begin = std::min(
+          old_begin + chunksize, static_cast< uint64_t >(get_end(old_range)));
+      if (own_range.compare_exchange_weak(
+              old_range, pack(new_begin, get_end(old_range)))) {
+        begin = old_begin;
+        end = new_begin;
+        return true;
+      }
+    }
+
+    // our own queue is empty: steal the back half of another queue
+    for (int i = 1; i < _worksize; ++i) {
+      std::atomic< uint64_t > &victim_range =
+          _queues[(thread_id + i) % _worksize]._range;
+      old_range = victim_range.load();
+      while (get_begin(old_range) < get_end(old_range)) {
+        const uint64_t old_end = get_end(old_range);
+        const uint64_t steal_begin =
+            old_end - (old_end - get_begin(old_range) + 1) / 2;
+        if (victim_range.compare_exchange_weak(
+                old_range, pack(get_begin(old_range), steal_begin))) {
+          // we now own [steal_begin, old_end[: keep a chunk and put the rest
+          // in our own queue. Our queue is empty, so no other thread can
+          // change it in the mean time.
+          begin = steal_begin;
+          end = std::min(steal_begin + chunksize, old_end);
+          own_range = pack(end, old_end);
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+};
+
+#endif // WORKSTEALINGSCHEDULER_HPP
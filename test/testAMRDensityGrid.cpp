@@ -25,7 +25,10 @@
  */
 #include "AMRDensityGrid.hpp"
 #include "Assert.hpp"
+#include "Photon.hpp"
 #include "TerminalLog.hpp"
+#include "Utilities.hpp"
+#include <cmath>
 
 /**
  * @brief Test implementation of DensityFunction.
@@ -52,6 +55,8 @@ public:
 
     values.set_number_density(density);
     values.set_temperature(4000.);
+    values.set_ionic_fraction(ION_H_n, 1.);
+    values.set_ionic_fraction(ION_He_n, 1.);
     return values;
   }
 };
@@ -136,5 +141,111 @@ int main(int argc, char **argv) {
   }
   assert_condition(ncell == grid.get_number_of_cells());
 
+  // check the linear cell tables: every cell midpoint should be located in the
+  // cell itself, and the neighbours of every face should cover that face
+  // exactly once (or not at all if the face is on the box boundary)
+  for (unsigned long i = 0; i < grid.get_number_of_cells(); ++i) {
+    assert_condition(grid.get_cell_index(grid.get_cell_midpoint(i)) == i);
+
+    const CoordinateVector<> midpoint = grid.get_cell_midpoint(i);
+    const double side = std::cbrt(grid.get_cell_volume(i));
+    for (unsigned int j = 0; j < 6; ++j) {
+      const AMRNgbPosition position = static_cast< AMRNgbPosition >(j);
+      const unsigned int axis = j / 2;
+      const double sign = (j % 2 == 0) ? -1. : 1.;
+      const std::vector< unsigned long > ngbs =
+          grid.get_face_neighbours(i, position);
+      if (ngbs.size() == 0) {
+        const double face_position = midpoint[axis] + 0.5 * sign * side;
+        const double box_boundary = 0.5 + 0.5 * sign;
+        assert_values_equal_tol(face_position, box_boundary, 1.e-14);
+      } else {
+        double area = 0.;
+        for (unsigned int k = 0; k < ngbs.size(); ++k) {
+          const CoordinateVector<> ngb_midpoint =
+              grid.get_cell_midpoint(ngbs[k]);
+          const double ngb_side = std::cbrt(grid.get_cell_volume(ngbs[k]));
+          const double distance = ngb_midpoint[axis] - midpoint[axis];
+          const double ref_distance = 0.5 * sign * (side + ngb_side);
+          assert_values_equal_tol(distance, ref_distance, 1.e-14);
+          for (unsigned int l = 1; l < 3; ++l) {
+            const unsigned int other_axis = (axis + l) % 3;
+            assert_condition(
+                std::abs(ngb_midpoint[other_axis] - midpoint[other_axis]) <=
+                0.5 * std::abs(side - ngb_side) + 1.e-14);
+          }
+          area += std::min(side, ngb_side) * std::min(side, ngb_side);
+        }
+        const double face_area = side * side;
+        assert_values_equal_rel(area, face_area, 1.e-12);
+      }
+    }
+  }
+
+  // compare the linear cell table traversal with the original traversal of
+  // the AMRGrid hierarchy, for both open and periodic boundaries
+  for (unsigned int iperiodic = 0; iperiodic < 2; ++iperiodic) {
+    const CoordinateVector< bool > periodic(iperiodic == 1);
+    AMRDensityGrid table_grid(
+        Box<>(CoordinateVector<>(0.), CoordinateVector<>(1.)), 16,
+        density_function, new TestAMRRefinementScheme(), 5, periodic);
+    AMRDensityGrid tree_grid(
+        Box<>(CoordinateVector<>(0.), CoordinateVector<>(1.)), 16,
+        density_function, new TestAMRRefinementScheme(), 5, periodic);
+    std::pair< unsigned long, unsigned long > test_block =
+        std::make_pair(0, table_grid.get_number_of_cells());
+    table_grid.initialize(test_block);
+    tree_grid.initialize(test_block);
+
+    unsigned int numescaped = 0;
+    for (unsigned int i = 0; i < 10000; ++i) {
+      const CoordinateVector<> origin(Utilities::random_double(),
+                                      Utilities::random_double(),
+                                      Utilities::random_double());
+      const double cost = 2. * Utilities::random_double() - 1.;
+      const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+      const double phi = 2. * M_PI * Utilities::random_double();
+      const CoordinateVector<> direction(sint * std::cos(phi),
+                                         sint * std::sin(phi), cost);
+      const double optical_depth = -std::log(Utilities::random_double());
+
+      Photon table_photon(origin, direction, 1.);
+      table_photon.set_cross_section(ION_H_n, 1.);
+      table_photon.set_cross_section(ION_He_n, 0.);
+      Photon tree_photon(table_photon);
+
+      DensityGrid::iterator table_cell =
+          table_grid.interact(table_photon, optical_depth);
+      DensityGrid::iterator tree_cell =
+          tree_grid.interact_tree(tree_photon, optical_depth);
+
+      if (tree_cell == tree_grid.end()) {
+        assert_condition(table_cell == table_grid.end());
+        ++numescaped;
+      } else {
+        assert_condition(table_cell.get_index() == tree_cell.get_index());
+      }
+      const CoordinateVector<> table_position = table_photon.get_position();
+      const CoordinateVector<> tree_position = tree_photon.get_position();
+      assert_values_equal_tol(table_position.x(), tree_position.x(), 1.e-9);
+      assert_values_equal_tol(table_position.y(), tree_position.y(), 1.e-9);
+      assert_values_equal_tol(table_position.z(), tree_position.z(), 1.e-9);
+    }
+    // make sure we tested both escaping and absorbed photons
+    if (iperiodic == 0) {
+      assert_condition(numescaped > 0 && numescaped < 10000);
+    }
+
+    table_grid.reduce_accumulators();
+    tree_grid.reduce_accumulators();
+    for (auto table_it = table_grid.begin(), tree_it = tree_grid.begin();
+         table_it != table_grid.end(); ++table_it, ++tree_it) {
+      assert_values_equal_rel(
+          table_it.get_ionization_variables().get_mean_intensity(ION_H_n),
+          tree_it.get_ionization_variables().get_mean_intensity(ION_H_n),
+          1.e-10);
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testAliasTable.cpp
+ *
+ * @brief Unit test for the AliasTable class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "AliasTable.hpp"
+#include "Assert.hpp"
+#include "Utilities.hpp"
+#include <vector>
+
+/**
+ * @brief Unit test for the AliasTable class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// single entry: always returned
+  {
+    AliasTable table(std::vector< double >(1, 1.));
+    assert_condition(table.size() == 1);
+    assert_condition(table.sample(0.) == 0);
+    assert_condition(table.sample(0.5) == 0);
+    assert_condition(table.sample(1.) == 0);
+  }
+
+  /// entries with zero weight are never returned
+  {
+    std::vector< double > weights(4, 0.);
+    weights[1] = 1.;
+    weights[3] = 3.;
+    AliasTable table(weights);
+    for (unsigned int i = 0; i < 1000; ++i) {
+      const unsigned int index = table.sample(Utilities::random_double());
+      assert_condition(index == 1 || index == 3);
+    }
+    assert_condition(table.sample(1.) == 3);
+  }
+
+  /// the sampled distribution matches the weights
+  {
+    const unsigned int numentry = 100;
+    std::vector< double > weights(numentry);
+    double total_weight = 0.;
+    for (unsigned int i = 0; i < numentry; ++i) {
+      weights[i] = Utilities::random_double();
+      total_weight += weights[i];
+    }
+    AliasTable table(weights);
+    assert_condition(table.size() == numentry);
+
+    // with a regular grid of random numbers, every entry should be sampled
+    // a number of times that is proportional to its weight, up to a
+    // discretization error of 2 samples per entry
+    const unsigned int numsample = 10000000;
+    std::vector< unsigned int > counts(numentry, 0);
+    for (unsigned int i = 0; i < numsample; ++i) {
+      ++counts[table.sample((i + 0.5) / numsample)];
+    }
+    for (unsigned int i = 0; i < numentry; ++i) {
+      const double expected = numsample * weights[i] / total_weight;
+      assert_condition(std::abs(counts[i] - expected) <= 2.);
+    }
+  }
+
+  return 0;
+}
@@ -28,6 +28,8 @@
 #include "DensityFunction.hpp"
 #include "HomogeneousDensityFunction.hpp"
 #include "Photon.hpp"
+#include "Utilities.hpp"
+#include <cmath>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -442,5 +444,76 @@ int main(int argc, char **argv) {
 
   assert_condition(inside == grid.end());
 
+  // compare the DDA traversal with the original wall intersection traversal,
+  // for both open and periodic boundaries
+  for (unsigned int iperiodic = 0; iperiodic < 2; ++iperiodic) {
+    const CoordinateVector< bool > periodic(iperiodic == 1);
+    CartesianDensityGrid dda_grid(box, CoordinateVector< int >(16, 8, 12),
+                                  testfunction, periodic);
+    CartesianDensityGrid wall_grid(box, CoordinateVector< int >(16, 8, 12),
+                                   testfunction, periodic);
+    std::pair< unsigned long, unsigned long > test_block =
+        std::make_pair(0, dda_grid.get_number_of_cells());
+    dda_grid.initialize(test_block);
+    wall_grid.initialize(test_block);
+
+    unsigned int numescaped = 0;
+    for (unsigned int i = 0; i < 10000; ++i) {
+      const CoordinateVector<> origin(Utilities::random_double(),
+                                      Utilities::random_double(),
+                                      Utilities::random_double());
+      const double cost = 2. * Utilities::random_double() - 1.;
+      const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+      const double phi = 2. * M_PI * Utilities::random_double();
+      CoordinateVector<> direction(sint * std::cos(phi), sint * std::sin(phi),
+                                   cost);
+      // make sure we also test paths parallel to the cell walls
+      if (i % 10 == 0) {
+        direction[i % 3] = 0.;
+        direction /= direction.norm();
+      }
+      const double optical_depth = -std::log(Utilities::random_double());
+
+      Photon dda_photon(origin, direction, 1.);
+      dda_photon.set_cross_section(ION_H_n, 1.e4);
+      dda_photon.set_cross_section(ION_He_n, 0.);
+      Photon wall_photon(dda_photon);
+
+      DensityGrid::iterator dda_cell =
+          dda_grid.interact(dda_photon, optical_depth);
+      DensityGrid::iterator wall_cell =
+          wall_grid.interact_wall_intersection(wall_photon, optical_depth);
+
+      if (wall_cell == wall_grid.end()) {
+        assert_condition(dda_cell == dda_grid.end());
+        ++numescaped;
+      } else {
+        assert_condition(dda_cell.get_index() == wall_cell.get_index());
+      }
+      // with periodic boundaries, photons can cross the box many times, and
+      // the round off accumulates over a large number of cells
+      const CoordinateVector<> dda_position = dda_photon.get_position();
+      const CoordinateVector<> wall_position = wall_photon.get_position();
+      assert_values_equal_tol(dda_position.x(), wall_position.x(), 1.e-9);
+      assert_values_equal_tol(dda_position.y(), wall_position.y(), 1.e-9);
+      assert_values_equal_tol(dda_position.z(), wall_position.z(), 1.e-9);
+    }
+    // make sure we tested both escaping and absorbed photons
+    if (iperiodic == 0) {
+      assert_condition(numescaped > 0 && numescaped < 10000);
+    }
+
+    // the path lengths are equal up to round off
+    dda_grid.reduce_accumulators();
+    wall_grid.reduce_accumulators();
+    for (auto dda_it = dda_grid.begin(), wall_it = wall_grid.begin();
+         dda_it != dda_grid.end(); ++dda_it, ++wall_it) {
+      assert_values_equal_rel(
+          dda_it.get_ionization_variables().get_mean_intensity(ION_H_n),
+          wall_it.get_ionization_variables().get_mean_intensity(ION_H_n),
+          1.e-10);
+    }
+  }
+
   return 0;
 }
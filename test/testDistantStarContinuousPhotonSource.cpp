@@ -28,10 +28,130 @@
 #include "RandomGenerator.hpp"
 #include "TerminalLog.hpp"
 
+#include <vector>
+
 /*! @brief Number of randomly generated points used to test the random position
  *  and direction generation routine. */
 #define NUMPOINTS 100000
 
+/*! @brief Number of bins per face side used to compare entrance point
+ *  distributions. */
+#define NUMFACEBIN 8
+
+/**
+ * @brief Reference rejection sampler that was used before the direct sampling
+ * was introduced.
+ *
+ * @param source DistantStarContinuousPhotonSource.
+ * @param star Position of the star (in m).
+ * @param box Simulation box (in m).
+ * @param rg RandomGenerator to use.
+ * @return Entrance point (in m) and direction of a random incoming photon.
+ */
+std::pair< CoordinateVector<>, CoordinateVector<> >
+get_reference_incoming_direction(
+    const DistantStarContinuousPhotonSource &source,
+    const CoordinateVector<> &star, const Box<> &box, RandomGenerator &rg) {
+  CoordinateVector<> direction = PhotonSource::get_random_direction(rg);
+  for (unsigned int i = 0; i < 3; ++i) {
+    if ((star[i] < box.get_anchor()[i] && direction[i] < 0.) ||
+        (star[i] > box.get_top_anchor()[i] && direction[i] > 0.)) {
+      direction[i] = -direction[i];
+    }
+  }
+  CoordinateVector<> position;
+  while (!source.enters_box(direction, position)) {
+    direction = PhotonSource::get_random_direction(rg);
+  }
+  return std::make_pair(position, direction);
+}
+
+/**
+ * @brief Bin the given entrance point on the surface of the box.
+ *
+ * @param position Entrance point (in m).
+ * @param box Simulation box (in m).
+ * @param bins Bins to update (6 faces with NUMFACEBIN x NUMFACEBIN bins each).
+ */
+void bin_entrance_point(const CoordinateVector<> &position, const Box<> &box,
+                        std::vector< unsigned int > &bins) {
+  // find the face that contains the point (the reference sampler does not
+  // put the point exactly on the face because of round off)
+  unsigned int iface = 6;
+  for (unsigned int i = 0; i < 3; ++i) {
+    const double tolerance = 1.e-10 * box.get_sides()[i];
+    if (std::abs(position[i] - box.get_anchor()[i]) < tolerance) {
+      iface = 2 * i;
+    } else if (std::abs(position[i] - box.get_top_anchor()[i]) < tolerance) {
+      iface = 2 * i + 1;
+    }
+  }
+  assert_condition(iface < 6);
+  const unsigned int i = iface / 2;
+  const unsigned int j1 = (i + 1) % 3;
+  const unsigned int j2 = (i + 2) % 3;
+  int b1 = NUMFACEBIN * (position[j1] - box.get_anchor()[j1]) /
+           box.get_sides()[j1];
+  int b2 = NUMFACEBIN * (position[j2] - box.get_anchor()[j2]) /
+           box.get_sides()[j2];
+  assert_condition(b1 >= 0 && b1 <= NUMFACEBIN);
+  assert_condition(b2 >= 0 && b2 <= NUMFACEBIN);
+  b1 = std::min(b1, NUMFACEBIN - 1);
+  b2 = std::min(b2, NUMFACEBIN - 1);
+  ++bins[(iface * NUMFACEBIN + b1) * NUMFACEBIN + b2];
+}
+
+/**
+ * @brief Check that the direct sampler and the reference rejection sampler
+ * produce the same distribution of entrance points for a star at the given
+ * position.
+ *
+ * We use a two sample chi squared test on the entrance point histograms. Since
+ * the direction is fully determined by the entrance point and the position of
+ * the star, this also tests the distribution of directions.
+ *
+ * @param star Position of the star (in m).
+ * @param box Simulation box (in m).
+ */
+void test_distribution(const CoordinateVector<> &star, const Box<> &box) {
+  DistantStarContinuousPhotonSource source(star, box);
+  RandomGenerator rg_direct(42);
+  RandomGenerator rg_reference(43);
+
+  std::vector< unsigned int > direct_bins(6 * NUMFACEBIN * NUMFACEBIN, 0);
+  std::vector< unsigned int > reference_bins(6 * NUMFACEBIN * NUMFACEBIN, 0);
+  for (unsigned int i = 0; i < NUMPOINTS; ++i) {
+    std::pair< CoordinateVector<>, CoordinateVector<> > posdir =
+        source.get_random_incoming_direction(rg_direct);
+    bin_entrance_point(posdir.first, box, direct_bins);
+    // the direction should point from the star towards the entrance point
+    CoordinateVector<> expected_direction = posdir.first - star;
+    expected_direction /= expected_direction.norm();
+    assert_values_equal_rel(posdir.second.x(), expected_direction.x(), 1.e-10);
+    assert_values_equal_rel(posdir.second.y(), expected_direction.y(), 1.e-10);
+    assert_values_equal_rel(posdir.second.z(), expected_direction.z(), 1.e-10);
+
+    posdir = get_reference_incoming_direction(source, star, box, rg_reference);
+    bin_entrance_point(posdir.first, box, reference_bins);
+  }
+
+  double chi2 = 0.;
+  unsigned int dof = 0;
+  for (unsigned int i = 0; i < direct_bins.size(); ++i) {
+    const double sum = direct_bins[i] + reference_bins[i];
+    if (sum > 0.) {
+      const double diff =
+          static_cast< double >(direct_bins[i]) - reference_bins[i];
+      chi2 += diff * diff / sum;
+      ++dof;
+    }
+  }
+  --dof;
+  cmac_status("chi2: %g (%u degrees of freedom)", chi2, dof);
+  // the chi squared statistic has mean dof and variance 2*dof
+  assert_condition(chi2 < dof + 5. * std::sqrt(2. * dof));
+}
+
 /**
  * @brief Unit test for the DistantStarContinuousPhotonSource class.
  *
@@ -99,5 +219,27 @@ int main(int argc, char **argv) {
     assert_condition(source.get_num_sides_exposed() == 1);
   }
 
+  /// direct sampling yields the same distribution as the rejection sampler
+  {
+    test_distribution(CoordinateVector<>(2.), box);
+    test_distribution(CoordinateVector<>(0.5, 0.5, 2.), box);
+    test_distribution(CoordinateVector<>(0.3, -0.8, 1.5), box);
+    test_distribution(CoordinateVector<>(-2., 3., -1.), box);
+  }
+
+  /// very distant star: most random directions miss the box
+  {
+    CoordinateVector<> position(0.5, 0.7, 1.e4);
+    DistantStarContinuousPhotonSource source(position, box, &log);
+    for (unsigned int i = 0; i < NUMPOINTS; ++i) {
+      std::pair< CoordinateVector<>, CoordinateVector<> > posdir =
+          source.get_random_incoming_direction(rg);
+      assert_condition(posdir.first.z() == 1.);
+      assert_condition(posdir.first.x() >= 0. && posdir.first.x() <= 1.);
+      assert_condition(posdir.first.y() >= 0. && posdir.first.y() <= 1.);
+      assert_values_equal_rel(posdir.second.z(), -1., 1.e-6);
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testGuideTable.cpp
+ *
+ * @brief Unit test for the GuideTable and GuideTable2D classes.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "GuideTable.hpp"
+#include "GuideTable2D.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Unit test for the GuideTable and GuideTable2D classes.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// GuideTable
+  {
+    // a cumulative distribution with a very non uniform spacing, a range of
+    // empty bins at the start and repeated values
+    const unsigned int length = 1000;
+    std::vector< double > cumulative_distribution(length, 0.);
+    for (unsigned int i = 100; i < length; ++i) {
+      cumulative_distribution[i] = std::pow(Utilities::random_double(), 4.);
+    }
+    for (unsigned int i = 500; i < 600; ++i) {
+      cumulative_distribution[i] = 0.5;
+    }
+    std::sort(cumulative_distribution.begin(), cumulative_distribution.end());
+    cumulative_distribution.back() = 1.;
+
+    // tables with the default number of buckets, and with too few and too
+    // many buckets
+    const unsigned int sizes[3] = {0, 10, 100000};
+    for (unsigned int isize = 0; isize < 3; ++isize) {
+      GuideTable table(&cumulative_distribution[0], length, sizes[isize]);
+      // random values, including values outside the range of the array
+      for (unsigned int i = 0; i < 100000; ++i) {
+        const double x = 1.2 * Utilities::random_double() - 0.1;
+        assert_condition(
+            table.locate(x, &cumulative_distribution[0]) ==
+            Utilities::locate(x, &cumulative_distribution[0], length));
+      }
+      // values that coincide with the array elements
+      for (unsigned int i = 0; i < length; ++i) {
+        const double x = cumulative_distribution[i];
+        assert_condition(
+            table.locate(x, &cumulative_distribution[0]) ==
+            Utilities::locate(x, &cumulative_distribution[0], length));
+      }
+    }
+  }
+
+  /// GuideTable2D
+  {
+    const unsigned int numtemp = 20;
+    const unsigned int numfreq = 100;
+    std::vector< double > temperatures(numtemp);
+    std::vector< double > frequencies(numfreq);
+    std::vector< double > cumulative_distributions(numtemp * numfreq);
+    for (unsigned int iT = 0; iT < numtemp; ++iT) {
+      temperatures[iT] = 1500. + (iT + 0.5) * 13500. / numtemp;
+      double *cumulative_distribution = &cumulative_distributions[iT * numfreq];
+      cumulative_distribution[0] = 0.;
+      for (unsigned int inu = 1; inu < numfreq; ++inu) {
+        cumulative_distribution[inu] =
+            cumulative_distribution[inu - 1] +
+            std::exp(-1.e-3 * inu * 15000. / temperatures[iT]);
+      }
+      for (unsigned int inu = 0; inu < numfreq; ++inu) {
+        cumulative_distribution[inu] /= cumulative_distribution[numfreq - 1];
+      }
+    }
+    for (unsigned int inu = 0; inu < numfreq; ++inu) {
+      frequencies[inu] = 1. + 3. * inu / (numfreq - 1.);
+    }
+
+    GuideTable2D table(&temperatures[0], numtemp, &cumulative_distributions[0],
+                       numfreq);
+    for (unsigned int i = 0; i < 100000; ++i) {
+      const double temperature = 1000. + 15000. * Utilities::random_double();
+      const double x = Utilities::random_double();
+
+      // reference result: the algorithm that was originally used in the
+      // temperature dependent Lyman continuum spectra
+      const unsigned int iT =
+          Utilities::locate(temperature, &temperatures[0], numtemp);
+      const unsigned int inu1 = Utilities::locate(
+          x, &cumulative_distributions[iT * numfreq], numfreq);
+      const unsigned int inu2 = Utilities::locate(
+          x, &cumulative_distributions[(iT + 1) * numfreq], numfreq);
+      const double reference =
+          frequencies[inu1] +
+          (temperature - temperatures[iT]) *
+              (frequencies[inu2] - frequencies[inu1]) /
+              (temperatures[iT + 1] - temperatures[iT]);
+
+      assert_condition(table.sample(temperature, x, &temperatures[0],
+                                    &frequencies[0],
+                                    &cumulative_distributions[0]) == reference);
+    }
+  }
+
+  return 0;
+}
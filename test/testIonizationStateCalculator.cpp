@@ -179,5 +179,61 @@ int main(int argc, char **argv) {
     assert_values_equal_tol(h0, h0s, 1.e-4);
   }
 
+  // test dirty cell tracking
+  {
+    IonizationStateCalculator dirty_calculator(1., abundances, rr, ctr, 0.1);
+    CartesianDensityGrid dirty_grid(box, 4, function);
+    std::pair< unsigned long, unsigned long > dirty_block =
+        std::make_pair(0, dirty_grid.get_number_of_cells());
+    dirty_grid.initialize(dirty_block);
+    for (auto it = dirty_grid.begin(); it != dirty_grid.end(); ++it) {
+      IonizationVariables &ionization_variables = it.get_ionization_variables();
+      ionization_variables.set_temperature(8000.);
+      ionization_variables.set_mean_intensity(ION_H_n, 1.e-2);
+    }
+
+    // all cells are new, so they are all dirty
+    assert_condition(dirty_calculator.calculate_ionization_state(
+                         1., dirty_grid, dirty_block) == 64);
+
+    // change the mean intensity of 16 cells by 50% and of all other cells by
+    // 5%, and overwrite the neutral fractions to check which cells are updated
+    for (auto it = dirty_grid.begin(); it != dirty_grid.end(); ++it) {
+      IonizationVariables &ionization_variables = it.get_ionization_variables();
+      if (it.get_index() % 4 == 0) {
+        ionization_variables.set_mean_intensity(ION_H_n, 1.5e-2);
+      } else {
+        ionization_variables.set_mean_intensity(ION_H_n, 1.05e-2);
+      }
+      ionization_variables.set_ionic_fraction(ION_H_n, 0.5);
+    }
+    assert_condition(dirty_calculator.calculate_ionization_state(
+                         1., dirty_grid, dirty_block) == 16);
+    for (auto it = dirty_grid.begin(); it != dirty_grid.end(); ++it) {
+      const double h0 =
+          it.get_ionization_variables().get_ionic_fraction(ION_H_n);
+      if (it.get_index() % 4 == 0) {
+        assert_condition(h0 != 0.5);
+      } else {
+        assert_condition(h0 == 0.5);
+      }
+    }
+
+    // the changes are measured w.r.t. the last update, so small changes
+    // accumulate until the cell is recomputed
+    for (auto it = dirty_grid.begin(); it != dirty_grid.end(); ++it) {
+      if (it.get_index() % 4 != 0) {
+        it.get_ionization_variables().set_mean_intensity(ION_H_n, 1.12e-2);
+      }
+    }
+    assert_condition(dirty_calculator.calculate_ionization_state(
+                         1., dirty_grid, dirty_block) == 48);
+
+    // marking the cells as dirty forces an update
+    dirty_grid.mark_all_cells_dirty();
+    assert_condition(dirty_calculator.calculate_ionization_state(
+                         1., dirty_grid, dirty_block) == 64);
+  }
+
   return 0;
 }
@@ -26,7 +26,11 @@
 #include "Assert.hpp"
 #include "IsotropicContinuousPhotonSource.hpp"
 #include "RandomGenerator.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <fstream>
+#include <vector>
 
 /*! @brief Number of angular bins. */
 #define NUMANGLEBIN 16
@@ -34,6 +38,213 @@
 /*! @brief Number of directional bins. */
 #define NUMDIRBIN 100
 
+/*! @brief Number of bins per face side used to test the entrance point
+ *  distribution. */
+#define NUMFACEBIN 4
+
+/*! @brief Number of bins used to test the distribution of incoming angles. */
+#define NUMCOSBIN 10
+
+/**
+ * @brief Get the chi squared statistic for the given histogram and expected
+ * bin probabilities.
+ *
+ * @param bins Histogram.
+ * @param probabilities Expected probability for each bin.
+ * @param number Total number of samples.
+ * @return Chi squared statistic.
+ */
+double get_chi2(const std::vector< unsigned int > &bins,
+                const std::vector< double > &probabilities,
+                unsigned int number) {
+  double chi2 = 0.;
+  for (unsigned int i = 0; i < bins.size(); ++i) {
+    const double expected = probabilities[i] * number;
+    const double diff = bins[i] - expected;
+    chi2 += diff * diff / expected;
+  }
+  return chi2;
+}
+
+/**
+ * @brief Test that the entrance points and directions of the given source
+ * follow the distribution of an isotropic radiation field.
+ *
+ * For an isotropic radiation field, the number of photons that enter through
+ * a surface element is the same for all surface elements, while the angle
+ * theta between the incoming direction and the inward normal is distributed
+ * as cos(theta) d(cos(theta)), so that cos^2(theta) is uniform. We use one
+ * sample chi squared tests on the face, the position on the face, and
+ * cos^2(theta).
+ *
+ * @param box Box in which the radiation enters (in m).
+ */
+void test_distribution(const Box<> &box) {
+  IsotropicContinuousPhotonSource source(box);
+  RandomGenerator random_generator(42);
+  const unsigned int numphoton = 100000;
+  const CoordinateVector<> &sides = box.get_sides();
+  const double face_area[3] = {sides.y() * sides.z(), sides.x() * sides.z(),
+                               sides.x() * sides.y()};
+
+  std::vector< unsigned int > face_bins(6 * NUMFACEBIN * NUMFACEBIN, 0);
+  std::vector< unsigned int > cos_bins(NUMCOSBIN, 0);
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    std::pair< CoordinateVector<>, CoordinateVector<> > posdir =
+        source.get_random_incoming_direction(random_generator);
+    const CoordinateVector<> &position = posdir.first;
+    const CoordinateVector<> &direction = posdir.second;
+    assert_values_equal_rel(direction.norm(), 1., 1.e-12);
+    assert_condition(box.inside(position));
+
+    // find the face through which the photon enters
+    unsigned int iface = 6;
+    for (unsigned int j = 0; j < 3; ++j) {
+      const double tolerance = 1.e-10 * sides[j];
+      if (position[j] == box.get_anchor()[j]) {
+        iface = 2 * j;
+      } else if (box.get_top_anchor()[j] - position[j] < tolerance) {
+        iface = 2 * j + 1;
+      }
+    }
+    assert_condition(iface < 6);
+    const unsigned int j = iface / 2;
+    const unsigned int j1 = (j + 1) % 3;
+    const unsigned int j2 = (j + 2) % 3;
+    const unsigned int b1 =
+        NUMFACEBIN * (position[j1] - box.get_anchor()[j1]) / sides[j1];
+    const unsigned int b2 =
+        NUMFACEBIN * (position[j2] - box.get_anchor()[j2]) / sides[j2];
+    assert_condition(b1 < NUMFACEBIN && b2 < NUMFACEBIN);
+    ++face_bins[(iface * NUMFACEBIN + b1) * NUMFACEBIN + b2];
+
+    // the direction should point inwards
+    const double cost = (iface % 2 == 0) ? direction[j] : -direction[j];
+    assert_condition(cost >= 0.);
+    const unsigned int cbin =
+        std::min(static_cast< unsigned int >(NUMCOSBIN * cost * cost),
+                 static_cast< unsigned int >(NUMCOSBIN - 1));
+    ++cos_bins[cbin];
+  }
+
+  const double total_area = source.get_total_surface_area();
+  std::vector< double > face_probabilities(face_bins.size());
+  for (unsigned int i = 0; i < face_bins.size(); ++i) {
+    const unsigned int iface = i / (NUMFACEBIN * NUMFACEBIN);
+    face_probabilities[i] =
+        face_area[iface / 2] / (total_area * NUMFACEBIN * NUMFACEBIN);
+  }
+  const double face_chi2 =
+      get_chi2(face_bins, face_probabilities, numphoton);
+  const unsigned int face_dof = face_bins.size() - 1;
+  cmac_status("face chi2: %g (%u degrees of freedom)", face_chi2, face_dof);
+  assert_condition(face_chi2 < face_dof + 5. * std::sqrt(2. * face_dof));
+
+  std::vector< double > cos_probabilities(NUMCOSBIN, 1. / NUMCOSBIN);
+  const double cos_chi2 = get_chi2(cos_bins, cos_probabilities, numphoton);
+  const unsigned int cos_dof = NUMCOSBIN - 1;
+  cmac_status("cos chi2: %g (%u degrees of freedom)", cos_chi2, cos_dof);
+  assert_condition(cos_chi2 < cos_dof + 5. * std::sqrt(2. * cos_dof));
+}
+
+/**
+ * @brief Get the length of the chord through the given box that starts at the
+ * given entrance point and has the given direction.
+ *
+ * @param box Box (in m).
+ * @param position Entrance point on the surface of the box (in m).
+ * @param direction Inward direction.
+ * @return Chord length (in m).
+ */
+double get_chord_length(const Box<> &box, const CoordinateVector<> &position,
+                        const CoordinateVector<> &direction) {
+  double length = DBL_MAX;
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (direction[i] > 0.) {
+      length = std::min(length, (box.get_top_anchor()[i] - position[i]) /
+                                    direction[i]);
+    } else if (direction[i] < 0.) {
+      length = std::min(length,
+                        (box.get_anchor()[i] - position[i]) / direction[i]);
+    }
+  }
+  return length;
+}
+
+/**
+ * @brief Get the length of the part of the given ray segment that lies inside
+ * the given box.
+ *
+ * @param box Box (in m).
+ * @param position Start point of the ray segment (in m).
+ * @param direction Direction of the ray segment.
+ * @param length Length of the ray segment (in m).
+ * @return Length of the part of the segment inside the box (in m).
+ */
+double get_track_length(const Box<> &box, const CoordinateVector<> &position,
+                        const CoordinateVector<> &direction,
+                        const double length) {
+  double tmin = 0.;
+  double tmax = length;
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (direction[i] != 0.) {
+      double t1 = (box.get_anchor()[i] - position[i]) / direction[i];
+      double t2 = (box.get_top_anchor()[i] - position[i]) / direction[i];
+      if (t1 > t2) {
+        std::swap(t1, t2);
+      }
+      tmin = std::max(tmin, t1);
+      tmax = std::min(tmax, t2);
+    } else if (position[i] < box.get_anchor()[i] ||
+               position[i] >= box.get_top_anchor()[i]) {
+      return 0.;
+    }
+  }
+  return std::max(tmax - tmin, 0.);
+}
+
+/**
+ * @brief Optically thin benchmark for the given source.
+ *
+ * In an optically thin box, an isotropic external radiation field produces a
+ * uniform mean intensity, which Monte Carlo radiative transfer estimates from
+ * the track length of photon packets in each cell. The average chord length
+ * through a convex volume V with surface area S is 4V/S (Cauchy's formula),
+ * and the fraction of the total track length inside a central sub-box with
+ * half the side lengths should be equal to its volume fraction, 1/8.
+ *
+ * @param box Box in which the radiation enters (in m).
+ */
+void test_optically_thin(const Box<> &box) {
+  IsotropicContinuousPhotonSource source(box);
+  RandomGenerator random_generator(45);
+  const unsigned int numphoton = 100000;
+  const Box<> central_box(box.get_anchor() + 0.25 * box.get_sides(),
+                          0.5 * box.get_sides());
+
+  double total_length = 0.;
+  double central_length = 0.;
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    std::pair< CoordinateVector<>, CoordinateVector<> > posdir =
+        source.get_random_incoming_direction(random_generator);
+    const double length =
+        get_chord_length(box, posdir.first, posdir.second);
+    total_length += length;
+    central_length += get_track_length(central_box, posdir.first,
+                                       posdir.second, length);
+  }
+
+  const double mean_chord = total_length / numphoton;
+  const double expected_chord =
+      4. * box.get_volume() / source.get_total_surface_area();
+  const double central_fraction = central_length / total_length;
+  cmac_status("mean chord: %g (expected: %g)", mean_chord, expected_chord);
+  cmac_status("central track length fraction: %g (expected: 0.125)",
+              central_fraction);
+  assert_values_equal_rel(mean_chord, expected_chord, 1.e-2);
+  assert_values_equal_rel(central_fraction, 0.125, 1.e-2);
+}
+
 /**
  * @brief Get the intersection point of the line through the given point and
  * with the given direction with the sphere surrounding the entire box.
@@ -75,6 +286,13 @@ CoordinateVector<> get_sphere_position(CoordinateVector<> f,
  * @return Exit code: 0 on success.
  */
 int main(int argc, char **argv) {
+  test_distribution(Box<>(CoordinateVector<>(-0.5), CoordinateVector<>(1.)));
+  test_distribution(
+      Box<>(CoordinateVector<>(1., -2., 0.), CoordinateVector<>(2., 1., 0.1)));
+  test_optically_thin(Box<>(CoordinateVector<>(-0.5), CoordinateVector<>(1.)));
+  test_optically_thin(
+      Box<>(CoordinateVector<>(1., -2., 0.), CoordinateVector<>(2., 1., 0.1)));
+
   Box<> box(CoordinateVector<>(-0.5), CoordinateVector<>(1.));
   RandomGenerator random_generator(44);
   IsotropicContinuousPhotonSource source(box);
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testIterationConvergenceChecker.cpp
+ *
+ * @brief Unit test for the IterationConvergenceChecker class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "CartesianDensityGrid.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "IterationConvergenceChecker.hpp"
+
+/**
+ * @brief Set the neutral fraction of hydrogen and the temperature of all cells
+ * in the given grid.
+ *
+ * @param grid DensityGrid.
+ * @param xH Neutral fraction of hydrogen.
+ * @param T Temperature (in K).
+ */
+void set_values(DensityGrid &grid, double xH, double T) {
+  for (auto it = grid.begin(); it != grid.end(); ++it) {
+    it.get_ionization_variables().set_ionic_fraction(ION_H_n, xH);
+    it.get_ionization_variables().set_temperature(T);
+  }
+}
+
+/**
+ * @brief Unit test for the IterationConvergenceChecker class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+  HomogeneousDensityFunction function(1.);
+  Box<> box(CoordinateVector<>(), CoordinateVector<>(1.));
+  CartesianDensityGrid grid(box, 4, function);
+  std::pair< unsigned long, unsigned long > block =
+      std::make_pair(0, grid.get_number_of_cells());
+  grid.initialize(block);
+
+  /// test the computation of the changes
+  {
+    IterationConvergenceChecker checker(0.01, 0.8, 2., 1000);
+    ReproducibleSum changes[ITERATIONCONVERGENCECHECKER_NUMSUM];
+
+    set_values(grid, 0.5, 8000.);
+    checker.store_old_values(grid, block);
+    set_values(grid, 0.55, 8000.);
+    checker.compute_changes(grid, block, changes);
+    assert_condition(changes[1].get_value() == grid.get_number_of_cells());
+    assert_condition(changes[3].get_value() == grid.get_number_of_cells());
+    assert_values_equal_rel(changes[0].get_value() / changes[1].get_value(),
+                            0.1 / 1.05, 1.e-10);
+    assert_condition(changes[2].get_value() == 0.);
+
+    set_values(grid, 0.5, 8000.);
+    checker.store_old_values(grid, block);
+    set_values(grid, 0.5, 10000.);
+    checker.compute_changes(grid, block, changes);
+    assert_condition(changes[0].get_value() == 0.);
+    assert_values_equal_rel(changes[2].get_value() / changes[3].get_value(),
+                            2000. / 9000., 1.e-10);
+  }
+
+  /// test the convergence criterion and the photon number increase
+  {
+    ReproducibleSum changes[ITERATIONCONVERGENCECHECKER_NUMSUM];
+    changes[0] = ReproducibleSum(1.);
+    changes[1] = ReproducibleSum(10.);
+    changes[2] = ReproducibleSum(0.5);
+    changes[3] = ReproducibleSum(10.);
+
+    // a constant change means the change is dominated by noise: the number of
+    // photons is doubled until it reaches the maximum
+    IterationConvergenceChecker checker(0.01, 0.8, 2., 1000);
+    unsigned int numphoton = 300;
+    assert_condition(!checker.is_converged(changes, numphoton));
+    assert_condition(numphoton == 300);
+    assert_condition(!checker.is_converged(changes, numphoton));
+    assert_condition(numphoton == 600);
+    assert_condition(!checker.is_converged(changes, numphoton));
+    assert_condition(numphoton == 1000);
+    assert_condition(!checker.is_converged(changes, numphoton));
+    assert_condition(numphoton == 1000);
+
+    // a decreasing change means we are still converging
+    checker.reset();
+    numphoton = 300;
+    assert_condition(!checker.is_converged(changes, numphoton));
+    changes[0] = ReproducibleSum(0.5);
+    assert_condition(!checker.is_converged(changes, numphoton));
+    assert_condition(numphoton == 300);
+
+    // a change below the tolerance means we have converged
+    changes[0] = ReproducibleSum(0.05);
+    changes[2] = ReproducibleSum(0.09);
+    assert_condition(checker.is_converged(changes, numphoton));
+    assert_condition(numphoton == 300);
+  }
+
+  return 0;
+}
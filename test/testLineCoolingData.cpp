@@ -286,5 +286,45 @@ int main(int argc, char **argv) {
     }
   }
 
+  // tabulated line cooling
+  {
+    // the default table uses 100 temperatures and 20 electron densities per
+    // decade, which bounds the relative interpolation error to below 0.1%
+    LineCoolingData tabulated_data;
+    tabulated_data.tabulate_cooling();
+    assert_condition(tabulated_data.is_tabulated());
+    assert_condition(!data.is_tabulated());
+
+    double max_error = 0.;
+    for (unsigned int i = 0; i < 10000; ++i) {
+      const double T = std::pow(10., 3. + 3. * Utilities::random_double());
+      const double ne = std::pow(10., 2. + 12. * Utilities::random_double());
+      double abundances[LINECOOLINGDATA_NUMCHANNELS];
+      for (unsigned int j = 0; j < LINECOOLINGDATA_NUMCHANNELS; ++j) {
+        abundances[j] = 1.e-4 * Utilities::random_double();
+      }
+
+      const double exact = data.get_exact_cooling(T, ne, abundances);
+      const double cool = tabulated_data.get_cooling(T, ne, abundances);
+      max_error =
+          std::max(max_error, std::abs(cool - exact) / std::abs(cool + exact));
+    }
+    cmac_status("Maximum relative line cooling interpolation error: %g",
+                2. * max_error);
+    assert_condition(2. * max_error < 1.e-3);
+
+    // outside the table range, we should get the exact result
+    double abundances[LINECOOLINGDATA_NUMCHANNELS];
+    for (unsigned int j = 0; j < LINECOOLINGDATA_NUMCHANNELS; ++j) {
+      abundances[j] = 1.e-4;
+    }
+    assert_condition(tabulated_data.get_cooling(500., 1.e8, abundances) ==
+                     data.get_exact_cooling(500., 1.e8, abundances));
+    assert_condition(tabulated_data.get_cooling(1.e4, 1.e16, abundances) ==
+                     data.get_exact_cooling(1.e4, 1.e16, abundances));
+    assert_condition(tabulated_data.get_cooling(1.e4, 0., abundances) ==
+                     data.get_exact_cooling(1.e4, 0., abundances));
+  }
+
   return 0;
 }
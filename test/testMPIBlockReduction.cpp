@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testMPIBlockReduction.cpp
+ *
+ * @brief Unit test for the MPIBlockReduction class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "MPIBlockReduction.hpp"
+#include "MPICommunicator.hpp"
+
+#include <vector>
+
+/**
+ * @brief Test class with three values per element.
+ */
+class TestMPIBlockReductionElement {
+private:
+  /*! @brief Values. */
+  double _values[3];
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param index Index of the element.
+   * @param rank Rank of the local process.
+   */
+  TestMPIBlockReductionElement(unsigned long index = 0, int rank = 0) {
+    _values[0] = index;
+    _values[1] = rank + 1.;
+    _values[2] = 0.5 * index * (rank + 1.);
+  }
+
+  /**
+   * @brief Store the values in the given array.
+   *
+   * @param values Array to store the values in.
+   */
+  void get_values(double *values) const {
+    values[0] = _values[0];
+    values[1] = _values[1];
+    values[2] = _values[2];
+  }
+
+  /**
+   * @brief Read the values from the given array.
+   *
+   * @param values Array to read the values from.
+   */
+  void set_values(const double *values) {
+    _values[0] = values[0];
+    _values[1] = values[1];
+    _values[2] = values[2];
+  }
+
+  /**
+   * @brief Get the value with the given index.
+   *
+   * @param i Index of a value.
+   * @return Value.
+   */
+  double get_value(unsigned int i) const { return _values[i]; }
+};
+
+/**
+ * @brief Unit test for the MPIBlockReduction class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+  MPICommunicator comm(argc, argv);
+
+  const int size = comm.get_size();
+  const double rank_sum = 0.5 * size * (size + 1.);
+  const unsigned long numcell = 1001;
+  const std::pair< unsigned long, unsigned long > block =
+      comm.distribute_block(0, numcell);
+
+  MPIBlockReduction< 3 > reduction(comm, numcell, 4);
+
+  // do two reductions with the same object
+  for (unsigned int iloop = 0; iloop < 2; ++iloop) {
+    std::vector< TestMPIBlockReductionElement > elements;
+    for (unsigned long i = 0; i < numcell; ++i) {
+      elements.push_back(TestMPIBlockReductionElement(i, comm.get_rank()));
+    }
+
+    reduction.start(elements.begin(),
+                    &TestMPIBlockReductionElement::get_values);
+
+    // check that every local cell is handed out exactly once and contains the
+    // reduced values
+    std::vector< unsigned int > count(numcell, 0);
+    std::pair< unsigned long, unsigned long > chunk;
+    while (reduction.get_next_chunk(
+        elements.begin(), &TestMPIBlockReductionElement::set_values, chunk)) {
+      assert_condition(chunk.first >= block.first);
+      assert_condition(chunk.second <= block.second);
+      for (unsigned long i = chunk.first; i < chunk.second; ++i) {
+        ++count[i];
+        assert_condition(elements[i].get_value(0) == i * size);
+        assert_condition(elements[i].get_value(1) == rank_sum);
+        assert_values_equal_rel(elements[i].get_value(2), 0.5 * i * rank_sum,
+                                1.e-14);
+      }
+    }
+    reduction.finish();
+
+    for (unsigned long i = 0; i < numcell; ++i) {
+      if (i >= block.first && i < block.second) {
+        assert_condition(count[i] == 1);
+      } else {
+        assert_condition(count[i] == 0);
+      }
+    }
+  }
+
+  // without a reduction, the local chunks are handed out in order
+  {
+    std::vector< TestMPIBlockReductionElement > elements(numcell);
+    unsigned long next = block.first;
+    std::pair< unsigned long, unsigned long > chunk;
+    while (reduction.get_next_chunk(
+        elements.begin(), &TestMPIBlockReductionElement::set_values, chunk)) {
+      assert_condition(chunk.first == next);
+      next = chunk.second;
+    }
+    assert_condition(next == block.second);
+    reduction.finish();
+  }
+
+  assert_condition(reduction.get_blocked_time() >= 0.);
+
+  return 0;
+}
@@ -27,6 +27,7 @@
 #include "CartesianDensityGrid.hpp"
 #include "HomogeneousDensityFunction.hpp"
 #include "MPICommunicator.hpp"
+#include <cmath>
 #include <vector>
 
 /**
@@ -157,28 +158,101 @@ int main(int argc, char **argv) {
     assert_condition(objects[i].get_variable() == ref);
   }
 
-  // we broke the code below and have disabled it for now...
-  return 0;
-
   HomogeneousDensityFunction testfunction(1., 2000.);
   CoordinateVector<> anchor;
   CoordinateVector<> sides(1., 1., 1.);
   Box<> box(anchor, sides);
   CartesianDensityGrid grid(box, 8, testfunction);
-  block = std::make_pair(0, grid.get_number_of_cells());
+  const unsigned int numcell = grid.get_number_of_cells();
+  block = std::make_pair(0, numcell);
   grid.initialize(block);
 
+  // packed reduction of the radiation field of the grid: every process adds
+  // the contributions of its share of a number of "photons" to the cells, and
+  // the result should match the result of a single process that adds the
+  // contributions of all photons
+  const unsigned int numphoton = 10007;
+  const unsigned int local_numphoton = comm.distribute(numphoton);
+  const unsigned int photon_offset = comm.distribute_offset(numphoton);
+  std::vector< double > reference_mean_intensity(numcell, 0.);
+  std::vector< double > reference_heating(numcell, 0.);
+  std::vector< ReproducibleSum > reproducible_sums(numcell);
+  std::vector< ReproducibleSum > reproducible_reference(numcell);
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    // deterministic, but irregular contributions
+    const unsigned int index = (i * 7919) % numcell;
+    const double contribution = std::abs(std::sin(1. + i)) * 1.e-10;
+    reference_mean_intensity[index] += contribution;
+    reference_heating[index] += 2. * contribution;
+    reproducible_reference[index] += contribution;
+    if (i >= photon_offset && i < photon_offset + local_numphoton) {
+      IonizationVariables &ionization_variables =
+          grid.get_ionization_variables_handle()[index];
+      ionization_variables.increase_mean_intensity(ION_H_n, contribution);
+      ionization_variables.increase_heating(HEATINGTERM_He,
+                                            2. * contribution);
+      reproducible_sums[index] += contribution;
+    }
+  }
+
+  comm.reduce< MPI_SUM_OF_ALL_PROCESSES,
+               IONIZATIONVARIABLES_NUMRADIATIONFIELDVALUE >(
+      grid.get_ionization_variables_handle().begin(),
+      grid.get_ionization_variables_handle().end(),
+      &IonizationVariables::get_radiation_field,
+      &IonizationVariables::set_radiation_field);
   for (auto it = grid.begin(); it != grid.end(); ++it) {
-    it.get_ionization_variables().increase_mean_intensity(ION_H_n, 1.);
+    const unsigned long index = it.get_index();
+    const IonizationVariables &ionization_variables =
+        it.get_ionization_variables();
+    // the order of the additions is different, so we cannot expect bitwise
+    // equal results
+    assert_values_equal_rel(ionization_variables.get_mean_intensity(ION_H_n),
+                            reference_mean_intensity[index], 1.e-12);
+    assert_values_equal_rel(ionization_variables.get_heating(HEATINGTERM_He),
+                            reference_heating[index], 1.e-12);
+    assert_condition(ionization_variables.get_mean_intensity(ION_He_n) == 0.);
+    assert_condition(ionization_variables.get_heating(HEATINGTERM_H) == 0.);
   }
 
-  // this part is broken...
-  //  comm.reduce< MPI_SUM_OF_ALL_PROCESSES >(
-  //      grid.get_mean_intensity_handle(ION_H_n));
+  // the order independent sums should be bitwise equal to the single process
+  // result
+  comm.reduce(reproducible_sums.data(), numcell);
+  for (unsigned int i = 0; i < numcell; ++i) {
+    assert_condition(reproducible_sums[i].get_value() ==
+                     reproducible_reference[i].get_value());
+  }
 
+  // packed gather of the ionization state: every process computes the state
+  // of its own block of cells, afterwards all processes should have the state
+  // of all cells
+  block = comm.distribute_block(0, numcell);
+  for (auto it = grid.begin(); it != grid.end(); ++it) {
+    const unsigned long index = it.get_index();
+    IonizationVariables &ionization_variables = it.get_ionization_variables();
+    if (index >= block.first && index < block.second) {
+      ionization_variables.set_ionic_fraction(ION_H_n, 1.e-3 * index);
+      ionization_variables.set_ionic_fraction(ION_S_p3, 2.e-3 * index);
+      ionization_variables.set_temperature(1000. + index);
+    } else {
+      ionization_variables.set_ionic_fraction(ION_H_n, -1.);
+      ionization_variables.set_ionic_fraction(ION_S_p3, -1.);
+      ionization_variables.set_temperature(-1.);
+    }
+  }
+  comm.gather< IONIZATIONVARIABLES_NUMSTATEVALUE >(
+      grid.get_ionization_variables_handle().begin(),
+      grid.get_ionization_variables_handle().end(),
+      &IonizationVariables::get_state, &IonizationVariables::set_state);
   for (auto it = grid.begin(); it != grid.end(); ++it) {
-    assert_condition(it.get_ionization_variables().get_mean_intensity(
-                         ION_H_n) == comm.get_size());
+    const unsigned long index = it.get_index();
+    const IonizationVariables &ionization_variables =
+        it.get_ionization_variables();
+    assert_condition(ionization_variables.get_ionic_fraction(ION_H_n) ==
+                     1.e-3 * index);
+    assert_condition(ionization_variables.get_ionic_fraction(ION_S_p3) ==
+                     2.e-3 * index);
+    assert_condition(ionization_variables.get_temperature() == 1000. + index);
   }
 
   return 0;
@@ -0,0 +1,51 @@
+################################################################################
+# This file is part of CMacIonize
+# Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+#
+# CMacIonize is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# CMacIonize is distributed in the hope that it will be useful,
+# but WITOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+################################################################################
+
+# End-to-end test that runs CMacIonize on testMPIRun.param using a single MPI
+# process and using 3 MPI processes, and compares the resulting snapshots using
+# testMPIRunComparison.
+# Required variables (set using -D on the command line):
+#  - MPIEXEC: MPI launcher
+#  - MPIEXEC_NUMPROC_FLAG: flag used to set the number of processes
+#  - CMACIONIZE: CMacIonize executable
+#  - COMPARISON: testMPIRunComparison executable
+#  - PARAMFILE: parameter file to use
+
+foreach(NUMPROC 1 3)
+  set(RUNDIR ${CMAKE_CURRENT_BINARY_DIR}/mpirun_${NUMPROC}proc)
+  file(REMOVE_RECURSE ${RUNDIR})
+  file(MAKE_DIRECTORY ${RUNDIR})
+  execute_process(COMMAND ${MPIEXEC} ${MPIEXEC_NUMPROC_FLAG} ${NUMPROC}
+                          ${CMACIONIZE} --params ${PARAMFILE} --dirty
+                          --logfile CMacIonize_run.log
+                  WORKING_DIRECTORY ${RUNDIR}
+                  RESULT_VARIABLE RUN_RESULT)
+  if(NOT RUN_RESULT EQUAL 0)
+    message(FATAL_ERROR
+            "CMacIonize run on ${NUMPROC} processes failed (${RUN_RESULT})!")
+  endif(NOT RUN_RESULT EQUAL 0)
+endforeach(NUMPROC)
+
+set(SNAPSHOT snapshot010.hdf5)
+execute_process(COMMAND ${COMPARISON}
+                        ${CMAKE_CURRENT_BINARY_DIR}/mpirun_1proc/${SNAPSHOT}
+                        ${CMAKE_CURRENT_BINARY_DIR}/mpirun_3proc/${SNAPSHOT}
+                RESULT_VARIABLE COMPARISON_RESULT)
+if(NOT COMPARISON_RESULT EQUAL 0)
+  message(FATAL_ERROR "Multi-process run does not match single process run!")
+endif(NOT COMPARISON_RESULT EQUAL 0)
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+/**
+ * @file testMPIRunComparison.cpp
+ *
+ * @brief Comparison of the output of a CMacIonize run on multiple MPI
+ * processes with the output of the same run on a single process.
+ *
+ * This program is run by testMPIRun.cmake, after it has run the program on
+ * testMPIRun.param using 1 and 3 processes.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "Configuration.hpp"
+#include "CoordinateVector.hpp"
+#include "HDF5Tools.hpp"
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read the given dataset from the gas particle group of the snapshot
+ * with the given name.
+ *
+ * @param filename Name of the snapshot file.
+ * @param name Name of the dataset.
+ * @return Contents of the dataset.
+ */
+template < typename _datatype_ >
+std::vector< _datatype_ > read_snapshot_dataset(std::string filename,
+                                                std::string name) {
+  HDF5Tools::HDF5File file =
+      HDF5Tools::open_file(filename, HDF5Tools::HDF5FILEMODE_READ);
+  HDF5Tools::HDF5Group group = HDF5Tools::open_group(file, "PartType0");
+  std::vector< _datatype_ > dataset =
+      HDF5Tools::read_dataset< _datatype_ >(group, name);
+  HDF5Tools::close_group(group);
+  HDF5Tools::close_file(file);
+  return dataset;
+}
+
+/**
+ * @brief Compare the output of a run on multiple MPI processes with the output
+ * of the same run on a single process.
+ *
+ * The initial densities need to be exactly the same: if the initial cell state
+ * is not gathered across all processes, the cells outside the block of the
+ * first process have no density.
+ *
+ * Different processes use different random number streams, so that the
+ * neutral fractions are only statistically the same (unless bitwise
+ * reproducible results were requested). We check that the average neutral
+ * fraction agrees to 1%, and that the average absolute difference of the
+ * neutral fractions of individual cells is comparable with the difference
+ * between two single process runs with a different random seed.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments: the name of the single process snapshot
+ * and the name of the multi-process snapshot.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    cmac_error("Usage: testMPIRunComparison SINGLE_SNAPSHOT MULTI_SNAPSHOT");
+  }
+  const std::string single_name(argv[1]);
+  const std::string multi_name(argv[2]);
+
+  HDF5Tools::initialize();
+
+  const std::vector< CoordinateVector<> > single_positions =
+      read_snapshot_dataset< CoordinateVector<> >(single_name, "Coordinates");
+  const std::vector< CoordinateVector<> > multi_positions =
+      read_snapshot_dataset< CoordinateVector<> >(multi_name, "Coordinates");
+  const std::vector< double > single_density =
+      read_snapshot_dataset< double >(single_name, "NumberDensity");
+  const std::vector< double > multi_density =
+      read_snapshot_dataset< double >(multi_name, "NumberDensity");
+  const std::vector< double > single_nfrac =
+      read_snapshot_dataset< double >(single_name, "NeutralFractionH");
+  const std::vector< double > multi_nfrac =
+      read_snapshot_dataset< double >(multi_name, "NeutralFractionH");
+
+  const size_t numcell = single_positions.size();
+  assert_condition(multi_positions.size() == numcell);
+  assert_condition(single_density.size() == numcell);
+  assert_condition(multi_density.size() == numcell);
+  assert_condition(single_nfrac.size() == numcell);
+  assert_condition(multi_nfrac.size() == numcell);
+
+  double single_nfrac_sum = 0.;
+  double multi_nfrac_sum = 0.;
+  double nfrac_difference_sum = 0.;
+  for (size_t i = 0; i < numcell; ++i) {
+    assert_condition(single_positions[i].x() == multi_positions[i].x());
+    assert_condition(single_positions[i].y() == multi_positions[i].y());
+    assert_condition(single_positions[i].z() == multi_positions[i].z());
+    assert_condition(single_density[i] == multi_density[i]);
+#ifdef USE_REPRODUCIBLE_RESULTS
+    assert_condition(single_nfrac[i] == multi_nfrac[i]);
+#endif
+    single_nfrac_sum += single_nfrac[i];
+    multi_nfrac_sum += multi_nfrac[i];
+    nfrac_difference_sum += std::abs(single_nfrac[i] - multi_nfrac[i]);
+  }
+
+  const double single_nfrac_average = single_nfrac_sum / numcell;
+  const double multi_nfrac_average = multi_nfrac_sum / numcell;
+  const double nfrac_difference_average = nfrac_difference_sum / numcell;
+  cmac_status("Average neutral fraction: %g (1 process), %g (multiple "
+              "processes).",
+              single_nfrac_average, multi_nfrac_average);
+  cmac_status("Average absolute neutral fraction difference: %g.",
+              nfrac_difference_average);
+
+  assert_values_equal_rel(single_nfrac_average, multi_nfrac_average, 0.01);
+  // two single process runs with a different random seed have an average
+  // absolute difference of 0.018
+  assert_condition(nfrac_difference_average < 0.05);
+
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include "Timer.hpp"
 #include "Utilities.hpp"
 
+#include <algorithm>
 #include <fstream>
 
 /**
@@ -1255,5 +1256,68 @@ int main(int argc, char **argv) {
         timer.value(), time_per_cell);
   }
 
+  /// test NewVoronoiGrid update: move part of the generators, and then all
+  /// generators, and compare with a grid constructed from scratch
+  {
+    const unsigned int ncell = 1000;
+    std::vector< CoordinateVector<> > positions(ncell);
+    for (unsigned int i = 0; i < ncell; ++i) {
+      // keep a safety margin, so that displaced generators stay in the box
+      positions[i] =
+          CoordinateVector<>(0.05 + 0.9 * Utilities::random_double(),
+                             0.05 + 0.9 * Utilities::random_double(),
+                             0.05 + 0.9 * Utilities::random_double());
+    }
+
+    Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+    NewVoronoiGrid grid(positions, box);
+    grid.compute_grid();
+
+    for (unsigned int istep = 0; istep < 2; ++istep) {
+      // first step: only move one in ten generators
+      const unsigned int stride = (istep == 0) ? 10 : 1;
+      for (unsigned int i = 0; i < ncell; i += stride) {
+        positions[i] += 0.01 * CoordinateVector<>(
+                                   Utilities::random_double() - 0.5,
+                                   Utilities::random_double() - 0.5,
+                                   Utilities::random_double() - 0.5);
+      }
+
+      assert_condition(grid.update_grid());
+
+      const std::vector< CoordinateVector<> > reference_positions(positions);
+      NewVoronoiGrid reference_grid(reference_positions, box);
+      reference_grid.compute_grid();
+
+      for (unsigned int i = 0; i < ncell; ++i) {
+        const double volume = grid.get_volume(i);
+        const double reference_volume = reference_grid.get_volume(i);
+        assert_values_equal_rel(volume, reference_volume, 1.e-10);
+        const CoordinateVector<> centroid = grid.get_centroid(i);
+        const CoordinateVector<> reference_centroid =
+            reference_grid.get_centroid(i);
+        assert_values_equal_rel(centroid.x(), reference_centroid.x(), 1.e-10);
+        assert_values_equal_rel(centroid.y(), reference_centroid.y(), 1.e-10);
+        assert_values_equal_rel(centroid.z(), reference_centroid.z(), 1.e-10);
+
+        const std::vector< VoronoiFace > faces = grid.get_faces(i);
+        const std::vector< VoronoiFace > reference_faces =
+            reference_grid.get_faces(i);
+        std::vector< unsigned int > ngbs, reference_ngbs;
+        for (unsigned int j = 0; j < faces.size(); ++j) {
+          ngbs.push_back(faces[j].get_neighbour());
+        }
+        for (unsigned int j = 0; j < reference_faces.size(); ++j) {
+          reference_ngbs.push_back(reference_faces[j].get_neighbour());
+        }
+        std::sort(ngbs.begin(), ngbs.end());
+        std::sort(reference_ngbs.begin(), reference_ngbs.end());
+        assert_condition(ngbs == reference_ngbs);
+      }
+    }
+
+    cmac_status("Grid update works!");
+  }
+
   return 0;
 }
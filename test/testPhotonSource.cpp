@@ -107,6 +107,8 @@ int main(int argc, char **argv) {
     assert_condition(photon.get_position().x() == 0.5);
     assert_condition(photon.get_position().y() == 0.5);
     assert_condition(photon.get_position().z() == 0.5);
+    // the photon knows which discrete source emitted it
+    assert_condition(photon.get_source_index() == 0);
   }
 
   // check if the returned directions are really isotropic
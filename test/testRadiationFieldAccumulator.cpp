@@ -0,0 +1,165 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testRadiationFieldAccumulator.cpp
+ *
+ * @brief Unit test for the RadiationFieldAccumulator class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "RadiationFieldAccumulator.hpp"
+#include <vector>
+
+/**
+ * @brief Unit test for the RadiationFieldAccumulator class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+  const unsigned long numcell = 3 * RADIATIONFIELDACCUMULATOR_TILESIZE + 10;
+  const int numthread = 4;
+  RadiationFieldAccumulator accumulator(numcell, numthread);
+
+  assert_condition(accumulator.get_number_of_cells() == numcell);
+  assert_condition(accumulator.get_number_of_threads() == numthread);
+  // no tiles are allocated before they are used
+  assert_condition(accumulator.get_allocated_size() == 0);
+
+  double dmean_intensity[NUMBER_OF_IONNAMES];
+  for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+    dmean_intensity[i] = i + 1.;
+  }
+  double dheating[NUMBER_OF_HEATINGTERMS];
+  for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+    dheating[i] = 0.5 * (i + 1.);
+  }
+
+  // every thread writes to the first cell, only thread 2 writes to the last
+  for (int ithread = 0; ithread < numthread; ++ithread) {
+    accumulator.add(ithread, 0, dmean_intensity, dheating);
+  }
+  accumulator.add(2, numcell - 1, dmean_intensity, dheating);
+  accumulator.add(2, numcell - 1, dmean_intensity, dheating);
+
+  // 4 tiles for the first cell, 1 tile for the last cell
+  assert_condition(accumulator.get_allocated_size() ==
+                   5 * RADIATIONFIELDACCUMULATOR_TILESIZE *
+                       RADIATIONFIELDACCUMULATOR_NUMVALUE * sizeof(double));
+
+  std::vector< IonizationVariables > cells(numcell);
+  for (unsigned long i = 0; i < numcell; ++i) {
+    accumulator.reduce(i, cells[i]);
+  }
+
+  for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+    const IonName ion = static_cast< IonName >(i);
+    assert_condition(cells[0].get_mean_intensity(ion) ==
+                     numthread * dmean_intensity[i]);
+    assert_condition(cells[1].get_mean_intensity(ion) == 0.);
+    assert_condition(cells[numcell - 1].get_mean_intensity(ion) ==
+                     2. * dmean_intensity[i]);
+  }
+  for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+    const HeatingTermName name = static_cast< HeatingTermName >(i);
+    assert_condition(cells[0].get_heating(name) == numthread * dheating[i]);
+    assert_condition(cells[1].get_heating(name) == 0.);
+    assert_condition(cells[numcell - 1].get_heating(name) == 2. * dheating[i]);
+  }
+
+  // the reduction resets the buffers: a second reduction does not change the
+  // cell values
+  accumulator.reduce(0, cells[0]);
+  assert_condition(cells[0].get_mean_intensity(ION_H_n) ==
+                   numthread * dmean_intensity[ION_H_n]);
+
+  // growing the accumulator keeps the existing tiles
+  accumulator.resize(numcell + RADIATIONFIELDACCUMULATOR_TILESIZE);
+  accumulator.add(1, numcell + 5, dmean_intensity, dheating);
+  IonizationVariables new_cell;
+  accumulator.reduce(numcell + 5, new_cell);
+  assert_condition(new_cell.get_mean_intensity(ION_H_n) ==
+                   dmean_intensity[ION_H_n]);
+  assert_condition(accumulator.get_allocated_size() ==
+                   6 * RADIATIONFIELDACCUMULATOR_TILESIZE *
+                       RADIATIONFIELDACCUMULATOR_NUMVALUE * sizeof(double));
+
+  // limit the private buffers to a single copy of the grid: every thread can
+  // only allocate a single private tile, and falls back to the shared tiles
+  // for all other tiles
+  {
+    RadiationFieldAccumulator capped_accumulator(numcell, numthread, 1);
+    assert_condition(capped_accumulator.get_max_private_tiles() == 1);
+
+    for (int ithread = 0; ithread < numthread; ++ithread) {
+      for (unsigned long i = 0; i < numcell;
+           i += RADIATIONFIELDACCUMULATOR_TILESIZE / 2) {
+        capped_accumulator.add(ithread, i, dmean_intensity, dheating);
+      }
+    }
+    // 1 private tile per thread and 3 shared tiles
+    assert_condition(capped_accumulator.get_allocated_size() ==
+                     (numthread + 3) * RADIATIONFIELDACCUMULATOR_TILESIZE *
+                         RADIATIONFIELDACCUMULATOR_NUMVALUE * sizeof(double));
+
+    std::vector< IonizationVariables > capped_cells(numcell);
+    for (unsigned long i = 0; i < numcell; ++i) {
+      capped_accumulator.reduce(i, capped_cells[i]);
+    }
+    for (unsigned long i = 0; i < numcell; ++i) {
+      const bool touched = (i % (RADIATIONFIELDACCUMULATOR_TILESIZE / 2) == 0);
+      const double ref_mean_intensity =
+          touched ? numthread * dmean_intensity[ION_H_n] : 0.;
+      const double ref_heating =
+          touched ? numthread * dheating[HEATINGTERM_H] : 0.;
+      assert_condition(capped_cells[i].get_mean_intensity(ION_H_n) ==
+                       ref_mean_intensity);
+      assert_condition(capped_cells[i].get_heating(HEATINGTERM_H) ==
+                       ref_heating);
+    }
+  }
+
+  // by default, the number of private copies scales with the number of
+  // threads that actually write to the buffers
+  {
+    const unsigned long numtile = 64;
+    RadiationFieldAccumulator scaled_accumulator(
+        numtile * RADIATIONFIELDACCUMULATOR_TILESIZE, 32);
+    assert_condition(scaled_accumulator.get_max_private_copies() == 8);
+    assert_condition(scaled_accumulator.get_max_private_tiles() == 16);
+
+    // a few threads always get at least the minimum number of copies
+    scaled_accumulator.set_number_of_threads(2);
+    assert_condition(scaled_accumulator.get_max_private_copies() ==
+                     RADIATIONFIELDACCUMULATOR_MIN_PRIVATE_COPIES);
+    assert_condition(scaled_accumulator.get_max_private_tiles() ==
+                     RADIATIONFIELDACCUMULATOR_MIN_PRIVATE_COPIES * numtile /
+                         2);
+
+    // an explicitly requested number of copies does not scale
+    RadiationFieldAccumulator fixed_accumulator(
+        numtile * RADIATIONFIELDACCUMULATOR_TILESIZE, 32, 2);
+    assert_condition(fixed_accumulator.get_max_private_copies() == 2);
+    assert_condition(fixed_accumulator.get_max_private_tiles() == 4);
+  }
+
+  return 0;
+}
@@ -24,7 +24,9 @@
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #include "Assert.hpp"
+#include "PhiloxRandomGenerator.hpp"
 #include "RandomGenerator.hpp"
+#include <cmath>
 
 /**
  * @brief Unit test for the RandomGenerator.
@@ -57,5 +59,87 @@ int main(int argc, char **argv) {
                      generator_B.get_uniform_random_double());
   }
 
+  /// Philox known answer test: reference values from the Random123 library
+  {
+    const uint32_t counter_A[4] = {0, 0, 0, 0};
+    const uint32_t key_A[2] = {0, 0};
+    const uint32_t reference_A[4] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                     0x9b00dbd8};
+    const uint32_t counter_B[4] = {0xffffffff, 0xffffffff, 0xffffffff,
+                                   0xffffffff};
+    const uint32_t key_B[2] = {0xffffffff, 0xffffffff};
+    const uint32_t reference_B[4] = {0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                     0x6d5451fd};
+    const uint32_t counter_C[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e,
+                                   0x03707344};
+    const uint32_t key_C[2] = {0xa4093822, 0x299f31d0};
+    const uint32_t reference_C[4] = {0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                                     0x24126ea1};
+    uint32_t result[4];
+    PhiloxRandomGenerator::philox(counter_A, key_A, result);
+    for (unsigned int i = 0; i < 4; ++i) {
+      assert_condition(result[i] == reference_A[i]);
+    }
+    PhiloxRandomGenerator::philox(counter_B, key_B, result);
+    for (unsigned int i = 0; i < 4; ++i) {
+      assert_condition(result[i] == reference_B[i]);
+    }
+    PhiloxRandomGenerator::philox(counter_C, key_C, result);
+    for (unsigned int i = 0; i < 4; ++i) {
+      assert_condition(result[i] == reference_C[i]);
+    }
+  }
+
+  /// Philox basic test: mean and precision of the generated values
+  {
+    PhiloxRandomGenerator generator(42);
+
+    double mean_random = 0.;
+    bool has_low_bits = false;
+    unsigned int num = 1000000;
+    double weight = 1. / num;
+    for (unsigned int i = 0; i < num; ++i) {
+      const double x = generator.get_uniform_random_double();
+      assert_condition(x > 0. && x < 1.);
+      mean_random += weight * x;
+      // single precision values are multiples of 2^-24
+      const double xscaled = x * 16777216.;
+      has_low_bits |= (xscaled != std::floor(xscaled));
+    }
+    assert_values_equal_tol(mean_random, 0.5, 1.e-3);
+    assert_condition(has_low_bits);
+  }
+
+  /// Philox stream test: the values for a stream only depend on the seed and
+  /// the stream index, and batches give the same values as single draws
+  {
+    PhiloxRandomGenerator generator_A(42);
+    PhiloxRandomGenerator generator_B(42);
+
+    double values_A[7];
+    generator_A.set_stream(1234);
+    for (unsigned int i = 0; i < 7; ++i) {
+      values_A[i] = generator_A.get_uniform_random_double();
+    }
+
+    // consume some values from other streams first
+    generator_B.set_stream(17);
+    generator_B.get_uniform_random_double();
+    generator_B.set_stream(1234);
+    double values_B[7];
+    values_B[0] = generator_B.get_uniform_random_double();
+    generator_B.get_uniform_random_doubles(values_B + 1, 6);
+    for (unsigned int i = 0; i < 7; ++i) {
+      assert_condition(values_A[i] == values_B[i]);
+    }
+
+    generator_B.set_stream(1235);
+    assert_condition(generator_B.get_uniform_random_double() != values_A[0]);
+
+    PhiloxRandomGenerator generator_C(43);
+    generator_C.set_stream(1234);
+    assert_condition(generator_C.get_uniform_random_double() != values_A[0]);
+  }
+
   return 0;
 }
@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testReproducibleSum.cpp
+ *
+ * @brief Unit test for the ReproducibleSum class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "ReproducibleSum.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Unit test for the ReproducibleSum class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// simple exact sums
+  {
+    ReproducibleSum sum;
+    assert_condition(sum.get_value() == 0.);
+    sum += 1.;
+    sum += 0.5;
+    sum += 1.e3;
+    assert_condition(sum.get_value() == 1001.5);
+    sum += -1001.5;
+    assert_condition(sum.get_value() == 0.);
+
+    // a value that is too small to be represented relative to the largest
+    // value in the sum is truncated
+    ReproducibleSum sum2(1.e30);
+    sum2 += 1.e-30;
+    assert_condition(sum2.get_value() == 1.e30);
+  }
+
+  /// order independence: a set of values with a large dynamic range summed in
+  /// different orders, and split over different partial sums, gives exactly
+  /// the same result
+  {
+    const unsigned int numvalue = 100000;
+    std::vector< double > values(numvalue);
+    double naive_sum = 0.;
+    for (unsigned int i = 0; i < numvalue; ++i) {
+      values[i] = Utilities::random_double() *
+                  std::pow(10., 20. * Utilities::random_double() - 10.);
+      naive_sum += values[i];
+    }
+
+    ReproducibleSum reference;
+    for (unsigned int i = 0; i < numvalue; ++i) {
+      reference += values[i];
+    }
+    assert_values_equal_rel(reference.get_value(), naive_sum, 1.e-12);
+
+    for (unsigned int ishuffle = 0; ishuffle < 10; ++ishuffle) {
+      std::random_shuffle(values.begin(), values.end());
+
+      // split the values over a number of partial sums (like the threads or
+      // processes would do)
+      const unsigned int numpart = ishuffle + 1;
+      std::vector< ReproducibleSum > parts(numpart);
+      for (unsigned int i = 0; i < numvalue; ++i) {
+        parts[i % numpart] += values[i];
+      }
+      ReproducibleSum sum;
+      for (unsigned int i = 0; i < numpart; ++i) {
+        sum += parts[numpart - i - 1];
+      }
+
+      assert_condition(sum.get_value() == reference.get_value());
+    }
+  }
+
+  /// bins: aligning two sums on the same bin and adding the integer bins gives
+  /// the same result as combining the sums (this is what happens during an MPI
+  /// reduction)
+  {
+    ReproducibleSum sum_A(3.14);
+    sum_A += 2.e-5;
+    ReproducibleSum sum_B(1.e12);
+    sum_B += 42.;
+
+    ReproducibleSum reference(sum_A);
+    reference += sum_B;
+
+    const int bin = std::max(sum_A.get_bin(), sum_B.get_bin());
+    sum_A.align(bin);
+    sum_B.align(bin);
+    for (unsigned int i = 0; i < REPRODUCIBLESUM_NUMBIN; ++i) {
+      sum_A.get_slices()[i] += sum_B.get_slices()[i];
+    }
+    assert_condition(sum_A.get_value() == reference.get_value());
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testTabulatedCrossSections.cpp
+ *
+ * @brief Unit test for the TabulatedCrossSections class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "ElementNames.hpp"
+#include "TabulatedCrossSections.hpp"
+#include "UnitConverter.hpp"
+#include "VernerCrossSections.hpp"
+#include <cmath>
+
+/**
+ * @brief Unit test for the TabulatedCrossSections class.
+ *
+ * We compare the interpolated cross sections with the analytic Verner fits on
+ * a fine frequency grid that covers the tabulated range.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+  VernerCrossSections verner_cross_sections;
+
+  const double minimum_frequency =
+      UnitConverter::to_SI< QUANTITY_FREQUENCY >(13., "eV");
+  const double maximum_frequency =
+      UnitConverter::to_SI< QUANTITY_FREQUENCY >(60., "eV");
+
+  const double tolerances[2] = {1.e-3, 1.e-5};
+  for (unsigned int itol = 0; itol < 2; ++itol) {
+    const double tolerance = tolerances[itol];
+    TabulatedCrossSections tabulated_cross_sections(
+        new VernerCrossSections(), tolerance, minimum_frequency,
+        maximum_frequency);
+
+    // every ion has its ionization threshold inside the tabulated range
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      const IonName ion = static_cast< IonName >(i);
+      assert_condition(tabulated_cross_sections.get_number_of_segments(ion) >=
+                       2);
+    }
+
+    const unsigned int numfreq = 100000;
+    for (unsigned int ifreq = 0; ifreq < numfreq; ++ifreq) {
+      const double frequency =
+          minimum_frequency *
+          std::pow(maximum_frequency / minimum_frequency,
+                   (ifreq + 0.5) / numfreq);
+      double cross_sections[NUMBER_OF_IONNAMES];
+      tabulated_cross_sections.get_cross_sections(frequency, cross_sections);
+      for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+        const IonName ion = static_cast< IonName >(i);
+        const double exact =
+            verner_cross_sections.get_cross_section(ion, frequency);
+        const double interpolated =
+            tabulated_cross_sections.get_cross_section(ion, frequency);
+        assert_condition(cross_sections[i] == interpolated);
+        if (exact == 0.) {
+          assert_condition(interpolated == 0.);
+        } else {
+          // the refinement criterion is only checked at the interval
+          // midpoints, so we allow for a small margin
+          assert_values_equal_rel(exact, interpolated, 2. * tolerance);
+        }
+      }
+    }
+
+    // frequencies outside the table are passed on to the Verner fits
+    const double high_frequency = 2. * maximum_frequency;
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      const IonName ion = static_cast< IonName >(i);
+      assert_condition(
+          tabulated_cross_sections.get_cross_section(ion, high_frequency) ==
+          verner_cross_sections.get_cross_section(ion, high_frequency));
+    }
+  }
+
+  return 0;
+}
@@ -36,6 +36,31 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+
+/**
+ * @brief Set the values of the given cell.
+ *
+ * @param cell DensityGrid::iterator pointing to a cell.
+ * @param input Mean intensity integrals for all ions (in s^-1), hydrogen and
+ * helium heating integrals (in J s^-1), temperature (in K) and number density
+ * (in m^-3).
+ */
+void set_cell_values(DensityGrid::iterator &cell,
+                     const std::vector< double > &input) {
+  IonizationVariables &ionization_variables = cell.get_ionization_variables();
+  cell.reset_mean_intensities();
+  for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+    ionization_variables.increase_mean_intensity(static_cast< IonName >(ion),
+                                                 input[ion]);
+  }
+  ionization_variables.increase_heating(HEATINGTERM_H,
+                                        input[NUMBER_OF_IONNAMES]);
+  ionization_variables.increase_heating(HEATINGTERM_He,
+                                        input[NUMBER_OF_IONNAMES + 1]);
+  ionization_variables.set_temperature(input[NUMBER_OF_IONNAMES + 2]);
+  ionization_variables.set_number_density(input[NUMBER_OF_IONNAMES + 3]);
+}
 
 /**
  * @brief Unit test for the TemperatureCalculator class.
@@ -275,7 +300,13 @@ int main(int argc, char **argv) {
       // since TemperatureCalculator::calculate_temperature() uses an iterative
       // scheme to find the temperature, small round off tends to accumulate and
       // cause quite large relative differences
-      double tolerance = 1.e-4;
+      // Kenny's code evaluates the ionic fractions at the temperature of the
+      // iteration before the last temperature update, which is only fixed up
+      // to the convergence criterion of the thermal balance (1.e-3), while we
+      // evaluate them at the converged temperature. This leads to relative
+      // differences in the ionic fractions of up to 4.e-4.
+      const double tolerance = 5.e-4;
+      const double temperature_tolerance = 1.e-4;
 
       cmac_status("h0: %g (%g), T: %g (%g)", h0, h0f, Tnew, Tnewf);
 
@@ -300,7 +331,184 @@ int main(int argc, char **argv) {
       assert_values_equal_rel(sp2, sp2f, tolerance);
       assert_values_equal_rel(sp3, sp3f, tolerance);
 
-      assert_values_equal_rel(Tnew, Tnewf, tolerance);
+      assert_values_equal_rel(Tnew, Tnewf, temperature_tolerance);
+
+      // for cells in thermal equilibrium (not in the neutral or ionized
+      // limits), the ionic fractions should be those at the converged
+      // temperature, as given by ioneng() (which is tested against Kenny's
+      // code above)
+      if (Tnew > 500. && Tnew < 30000.) {
+        double h0T, he0T, gainT, lossT;
+        TemperatureCalculator::ioneng(h0T, he0T, gainT, lossT, Tnew, cell, 1.,
+                                      abundances, 1., 1., 0., 0., data, rates,
+                                      ctr);
+
+        const double equilibrium_tolerance = 1.e-12;
+
+        assert_values_equal_rel(h0, h0T, equilibrium_tolerance);
+
+        assert_values_equal_rel(he0, he0T, equilibrium_tolerance);
+
+        assert_values_equal_rel(
+            cp1, ionization_variables.get_ionic_fraction(ION_C_p1),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            cp2, ionization_variables.get_ionic_fraction(ION_C_p2),
+            equilibrium_tolerance);
+
+        assert_values_equal_rel(
+            n, ionization_variables.get_ionic_fraction(ION_N_n),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            np1, ionization_variables.get_ionic_fraction(ION_N_p1),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            np2, ionization_variables.get_ionic_fraction(ION_N_p2),
+            equilibrium_tolerance);
+
+        assert_values_equal_rel(
+            o, ionization_variables.get_ionic_fraction(ION_O_n),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            op1, ionization_variables.get_ionic_fraction(ION_O_p1),
+            equilibrium_tolerance);
+
+        assert_values_equal_rel(
+            ne, ionization_variables.get_ionic_fraction(ION_Ne_n),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            nep1, ionization_variables.get_ionic_fraction(ION_Ne_p1),
+            equilibrium_tolerance);
+
+        assert_values_equal_rel(
+            sp1, ionization_variables.get_ionic_fraction(ION_S_p1),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            sp2, ionization_variables.get_ionic_fraction(ION_S_p2),
+            equilibrium_tolerance);
+        assert_values_equal_rel(
+            sp3, ionization_variables.get_ionic_fraction(ION_S_p3),
+            equilibrium_tolerance);
+      }
+    }
+  }
+
+  // test the batched temperature calculation: it should give the same result
+  // as the single cell calculation for every cell, including cells that take
+  // one of the neutral shortcuts
+  {
+    std::vector< std::vector< double > > inputs;
+    std::ifstream file("tbal_testdata.txt");
+    std::string line;
+    while (getline(file, line)) {
+      std::istringstream linestream(line);
+      std::vector< double > input(NUMBER_OF_IONNAMES + 4);
+      for (unsigned int i = 0; i < input.size(); ++i) {
+        linestream >> input[i];
+      }
+      if (input[NUMBER_OF_IONNAMES + 2] > 30000.) {
+        continue;
+      }
+      input[NUMBER_OF_IONNAMES] = UnitConverter::to_SI< QUANTITY_ENERGY_RATE >(
+          input[NUMBER_OF_IONNAMES], "erg s^-1");
+      input[NUMBER_OF_IONNAMES + 1] =
+          UnitConverter::to_SI< QUANTITY_ENERGY_RATE >(
+              input[NUMBER_OF_IONNAMES + 1], "erg s^-1");
+      input[NUMBER_OF_IONNAMES + 3] =
+          UnitConverter::to_SI< QUANTITY_NUMBER_DENSITY >(
+              input[NUMBER_OF_IONNAMES + 3], "cm^-3");
+      inputs.push_back(input);
+    }
+    // add a cell without radiation and an empty cell
+    inputs.push_back(std::vector< double >(NUMBER_OF_IONNAMES + 4, 0.));
+    inputs.back()[NUMBER_OF_IONNAMES + 2] = 8000.;
+    inputs.back()[NUMBER_OF_IONNAMES + 3] = 1.e8;
+    inputs.push_back(inputs[0]);
+    inputs.back()[NUMBER_OF_IONNAMES + 3] = 0.;
+
+    // the number of cells is not a multiple of the block size
+    CartesianDensityGrid block_grid(box, CoordinateVector< int >(5), function);
+    std::pair< unsigned long, unsigned long > block_grid_block =
+        std::make_pair(0, block_grid.get_number_of_cells());
+    block_grid.initialize(block_grid_block);
+
+    // the second calculator has cosmic ray heating, which has its own neutral
+    // shortcut
+    TemperatureCalculator cr_calculator(1., abundances, 1., 1., 0.5, 0.1, data,
+                                        rates, ctr);
+    const TemperatureCalculator *calculators[2] = {&calculator,
+                                                   &cr_calculator};
+    for (unsigned int icalc = 0; icalc < 2; ++icalc) {
+      unsigned int index = 0;
+      for (auto it = block_grid.begin(); it != block_grid.end(); ++it) {
+        set_cell_values(it, inputs[index % inputs.size()]);
+        ++index;
+      }
+
+      calculators[icalc]->calculate_temperature(1., 1., block_grid.begin(),
+                                                block_grid.end());
+
+      index = 0;
+      for (auto it = block_grid.begin(); it != block_grid.end(); ++it) {
+        IonizationVariables &ionization_variables =
+            it.get_ionization_variables();
+        double block_fractions[NUMBER_OF_IONNAMES];
+        for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+          block_fractions[ion] = ionization_variables.get_ionic_fraction(
+              static_cast< IonName >(ion));
+        }
+        const double block_temperature = ionization_variables.get_temperature();
+
+        set_cell_values(it, inputs[index % inputs.size()]);
+        ++index;
+        calculators[icalc]->calculate_temperature(
+            1. / it.get_volume(), 1. / it.get_volume(), it);
+
+        // both calculations only differ in the order of some operations
+        const double tolerance = 1.e-10;
+        for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+          assert_values_equal_rel(ionization_variables.get_ionic_fraction(
+                                      static_cast< IonName >(ion)),
+                                  block_fractions[ion], tolerance);
+        }
+        assert_values_equal_rel(ionization_variables.get_temperature(),
+                                block_temperature, tolerance);
+      }
+    }
+
+    // with dirty cell tracking, cells with an unchanged hydrogen mean
+    // intensity are not recomputed, unless they did not receive any radiation
+    TemperatureCalculator dirty_calculator(1., abundances, 1., 0., 1., 0., data,
+                                           rates, ctr, 0.01);
+    block_grid.mark_all_cells_dirty();
+    unsigned long numdark = 0;
+    for (int iloop = 0; iloop < 2; ++iloop) {
+      unsigned int index = 0;
+      for (auto it = block_grid.begin(); it != block_grid.end(); ++it) {
+        set_cell_values(it, inputs[index % inputs.size()]);
+        if (iloop == 0 && inputs[index % inputs.size()][ION_H_n] == 0.) {
+          ++numdark;
+        }
+        ++index;
+      }
+
+      unsigned long numupdated = 0;
+      dirty_calculator.calculate_temperature(
+          1., 1., block_grid.begin(), block_grid.end(), &numupdated);
+      if (iloop == 0) {
+        assert_condition(numupdated == block_grid.get_number_of_cells());
+      } else {
+        assert_condition(numupdated == numdark);
+        index = 0;
+        for (auto it = block_grid.begin(); it != block_grid.end(); ++it) {
+          const std::vector< double > &input = inputs[index % inputs.size()];
+          if (input[ION_H_n] > 0.) {
+            assert_condition(it.get_ionization_variables().get_temperature() ==
+                             input[NUMBER_OF_IONNAMES + 2]);
+          }
+          ++index;
+        }
+      }
     }
   }
 
@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testTemperatureTable.cpp
+ *
+ * @brief Unit test for the TemperatureTable class and the tabulated atomic
+ * rates that use it.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "ChargeTransferRates.hpp"
+#include "ReemissionProbabilityTable.hpp"
+#include "TabulatedChargeTransferRates.hpp"
+#include "TabulatedRecombinationRates.hpp"
+#include "TemperatureTable.hpp"
+#include "Utilities.hpp"
+#include "VernerRecombinationRates.hpp"
+
+#include <cmath>
+
+/*! @brief Number of random temperatures used to test the interpolation. */
+#define NUMTEMPERATURE 10000
+
+/**
+ * @brief Get a random temperature, uniformly distributed in log space.
+ *
+ * @param minimum_temperature Minimum temperature (in K).
+ * @param maximum_temperature Maximum temperature (in K).
+ * @return Random temperature (in K).
+ */
+double get_random_temperature(double minimum_temperature,
+                              double maximum_temperature) {
+  const double logmin = std::log10(minimum_temperature);
+  const double logmax = std::log10(maximum_temperature);
+  return std::pow(10., logmin + Utilities::random_double() * (logmax - logmin));
+}
+
+/**
+ * @brief Get the maximum relative error of the tabulated recombination rates
+ * for the given table.
+ *
+ * Some of the fits become negative (and are hence set to zero) above
+ * ~2x10^5 K, which makes the relative error meaningless close to these
+ * temperatures. We therefore only use the table values up to 10^5 K.
+ *
+ * @param rates Exact RecombinationRates.
+ * @param table TemperatureTable.
+ * @return Maximum relative error.
+ */
+double get_recombination_rate_error(const RecombinationRates &rates,
+                                    const TemperatureTable &table) {
+  TabulatedRecombinationRates tabulated_rates(rates, table);
+  double max_error = 0.;
+  for (unsigned int i = 0; i < NUMTEMPERATURE; ++i) {
+    const double T =
+        get_random_temperature(table.get_minimum_temperature(), 1.e5);
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      const IonName name = static_cast< IonName >(ion);
+      const double exact = rates.get_recombination_rate(name, T);
+      const double tabulated = tabulated_rates.get_recombination_rate(name, T);
+      max_error = std::max(max_error, std::abs(tabulated - exact) / exact);
+    }
+  }
+  return max_error;
+}
+
+/**
+ * @brief Unit test for the TemperatureTable class and the tabulated atomic
+ * rates that use it.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// TemperatureTable
+  {
+    TemperatureTable table(100., 1.e6, 10);
+    assert_condition(table.get_number_of_points() == 41);
+    assert_values_equal_rel(table.get_temperature(0), 100., 1.e-15);
+    assert_values_equal_rel(table.get_temperature(10), 1000., 1.e-12);
+    assert_values_equal_rel(table.get_temperature(40), 1.e6, 1.e-15);
+
+    unsigned int index;
+    double fraction;
+    assert_condition(table.get_interpolation(1000., index, fraction));
+    assert_condition(index == 10 || index == 9);
+    assert_values_equal_tol(index + fraction, 10., 1.e-12);
+    assert_condition(table.get_interpolation(1.e6, index, fraction));
+    assert_condition(index == 39);
+    assert_values_equal_tol(fraction, 1., 1.e-12);
+    assert_condition(!table.get_interpolation(99., index, fraction));
+    assert_condition(!table.get_interpolation(1.1e6, index, fraction));
+
+    // power laws are interpolated linearly in log T
+    double values[41];
+    for (unsigned int i = 0; i < 41; ++i) {
+      values[i] = std::log10(table.get_temperature(i));
+    }
+    assert_condition(table.get_interpolation(3.e4, index, fraction));
+    assert_values_equal_rel(
+        TemperatureTable::interpolate(values, index, fraction),
+        std::log10(3.e4), 1.e-12);
+  }
+
+  /// TabulatedRecombinationRates
+  {
+    VernerRecombinationRates rates;
+
+    // the error should decrease quadratically with the number of points
+    const double error10 =
+        get_recombination_rate_error(rates, TemperatureTable(1000., 1.e6, 10));
+    const double error100 =
+        get_recombination_rate_error(rates, TemperatureTable(1000., 1.e6, 100));
+    cmac_status("Maximum relative error: %g (10 points per decade), %g (100 "
+                "points per decade)",
+                error10, error100);
+    assert_condition(error100 < 1.e-3);
+    assert_condition(error100 < 0.05 * error10);
+
+    // outside the table, we get the exact values
+    const TemperatureTable table(1000., 1.e6, 100);
+    TabulatedRecombinationRates tabulated_rates(rates, table);
+    assert_condition(tabulated_rates.get_recombination_rate(ION_H_n, 500.) ==
+                     rates.get_recombination_rate(ION_H_n, 500.));
+    assert_condition(tabulated_rates.get_recombination_rate(ION_S_p3, 1.e8) ==
+                     rates.get_recombination_rate(ION_S_p3, 1.e8));
+  }
+
+  /// TabulatedChargeTransferRates
+  {
+    ChargeTransferRates rates;
+    const TemperatureTable table(1000., 1.e6, 100);
+    TabulatedChargeTransferRates tabulated_rates(table);
+    cmac_status("Charge transfer table size: %lu bytes",
+                tabulated_rates.get_table_size());
+
+    // the stage and atom combinations that are used in the ionization balance
+    const unsigned char recombination[10][2] = {
+        {4, 6}, {2, 7}, {3, 7}, {4, 7}, {2, 8},
+        {3, 8}, {3, 10}, {3, 16}, {4, 16}, {5, 16}};
+    const unsigned char ionization[2][2] = {{1, 7}, {1, 8}};
+    const unsigned char recombination_He[7][2] = {
+        {4, 6}, {3, 7}, {4, 7}, {3, 8}, {3, 10}, {4, 16}, {5, 16}};
+    // the charge transfer ionization rates contain steep exp(-E/T) factors
+    // that are less accurately interpolated at low temperatures, where the
+    // gas is neutral anyway; we only test the temperature range in which the
+    // TemperatureCalculator looks for a solution
+    for (unsigned int i = 0; i < NUMTEMPERATURE; ++i) {
+      const double T = get_random_temperature(4000., 1.e5);
+      for (unsigned int j = 0; j < 10; ++j) {
+        const double exact = rates.get_charge_transfer_recombination_rate(
+            recombination[j][0], recombination[j][1], T);
+        const double tabulated =
+            tabulated_rates.get_charge_transfer_recombination_rate(
+                recombination[j][0], recombination[j][1], T);
+        assert_values_equal_rel(tabulated, exact, 1.e-3);
+      }
+      for (unsigned int j = 0; j < 2; ++j) {
+        const double exact = rates.get_charge_transfer_ionization_rate(
+            ionization[j][0], ionization[j][1], T);
+        const double tabulated =
+            tabulated_rates.get_charge_transfer_ionization_rate(
+                ionization[j][0], ionization[j][1], T);
+        assert_values_equal_rel(tabulated, exact, 1.e-3);
+      }
+      for (unsigned int j = 0; j < 7; ++j) {
+        const double exact = rates.get_charge_transfer_recombination_rate_He(
+            recombination_He[j][0], recombination_He[j][1], T);
+        const double tabulated =
+            tabulated_rates.get_charge_transfer_recombination_rate_He(
+                recombination_He[j][0], recombination_He[j][1], T);
+        assert_values_equal_rel(tabulated, exact, 1.e-3);
+      }
+    }
+
+    // rates that are zero everywhere stay zero
+    assert_condition(
+        tabulated_rates.get_charge_transfer_recombination_rate_He(2, 8, 1.e4) ==
+        0.);
+    assert_condition(
+        tabulated_rates.get_charge_transfer_recombination_rate(1, 8, 1.e4) ==
+        0.);
+  }
+
+  /// ReemissionProbabilityTable
+  {
+    ReemissionProbabilityTable table(TemperatureTable(100., 1.e6, 100));
+    for (unsigned int i = 0; i < NUMTEMPERATURE; ++i) {
+      const double T = get_random_temperature(100., 1.e7);
+      double exact[NUMBER_OF_REEMISSIONPROBABILITIES];
+      double tabulated[NUMBER_OF_REEMISSIONPROBABILITIES];
+      ReemissionProbabilityTable::get_exact_probabilities(T, exact);
+      table.get_probabilities(T, tabulated);
+      for (int j = 0; j < NUMBER_OF_REEMISSIONPROBABILITIES; ++j) {
+        assert_values_equal_rel(tabulated[j], exact[j], 1.e-4);
+      }
+    }
+
+    // temperatures outside the configured range use the exact fits
+    ReemissionProbabilityTable narrow_table(TemperatureTable(1.e3, 1.e5, 10));
+    double exact[NUMBER_OF_REEMISSIONPROBABILITIES];
+    double tabulated[NUMBER_OF_REEMISSIONPROBABILITIES];
+    ReemissionProbabilityTable::get_exact_probabilities(500., exact);
+    narrow_table.get_probabilities(500., tabulated);
+    for (int j = 0; j < NUMBER_OF_REEMISSIONPROBABILITIES; ++j) {
+      assert_condition(tabulated[j] == exact[j]);
+    }
+  }
+
+  return 0;
+}
@@ -25,10 +25,26 @@
  */
 #include "Assert.hpp"
 #include "HomogeneousDensityFunction.hpp"
+#include "Photon.hpp"
 #include "UniformRandomVoronoiGeneratorDistribution.hpp"
 #include "UniformRegularVoronoiGeneratorDistribution.hpp"
+#include "Utilities.hpp"
 #include "VoronoiDensityGrid.hpp"
 #include "VoronoiGeneratorDistribution.hpp"
+#include <cmath>
+
+/**
+ * @brief Get a random isotropic direction.
+ *
+ * @return Random unit vector.
+ */
+inline static CoordinateVector<> get_random_direction() {
+  const double cost = 2. * Utilities::random_double() - 1.;
+  const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+  const double phi = 2. * M_PI * Utilities::random_double();
+  return CoordinateVector<>(sint * std::cos(phi), sint * std::sin(phi), cost);
+}
+
 /**
  * @brief Unit test for the VoronoiDensityGrid class.
  *
@@ -70,5 +86,150 @@ int main(int argc, char **argv) {
     assert_values_equal(2000., grid.get_average_temperature());
   }
 
+  /// Lloyd iterations (the New grid is updated rather than reconstructed)
+  {
+    HomogeneousDensityFunction density_function(1., 2000.);
+    Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+    UniformRandomVoronoiGeneratorDistribution *test_positions =
+        new UniformRandomVoronoiGeneratorDistribution(box, 100, 42);
+    VoronoiDensityGrid grid(test_positions, density_function, box, "New", 5,
+                            false, false, 0., 5. / 3., nullptr);
+    std::pair< unsigned long, unsigned long > block =
+        std::make_pair(0, grid.get_number_of_cells());
+    grid.initialize(block);
+
+    assert_values_equal(1., grid.get_total_hydrogen_number());
+    assert_values_equal(2000., grid.get_average_temperature());
+  }
+
+  /// photon traversal using the compact face information, compared with the
+  /// traversal that queries the faces from the VoronoiGrid
+  {
+    const std::string grid_types[2] = {"Old", "New"};
+    for (unsigned int itype = 0; itype < 2; ++itype) {
+      HomogeneousDensityFunction density_function(100., 2000.);
+      Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+      VoronoiDensityGrid face_grid(
+          new UniformRandomVoronoiGeneratorDistribution(box, 1000, 42),
+          density_function, box, grid_types[itype]);
+      VoronoiDensityGrid voronoi_grid(
+          new UniformRandomVoronoiGeneratorDistribution(box, 1000, 42),
+          density_function, box, grid_types[itype]);
+      std::pair< unsigned long, unsigned long > block =
+          std::make_pair(0, face_grid.get_number_of_cells());
+      face_grid.initialize(block);
+      voronoi_grid.initialize(block);
+
+      unsigned int numescaped = 0;
+      for (unsigned int i = 0; i < 1000; ++i) {
+        const CoordinateVector<> origin(Utilities::random_double(),
+                                        Utilities::random_double(),
+                                        Utilities::random_double());
+        const CoordinateVector<> direction = get_random_direction();
+        const double optical_depth = -std::log(Utilities::random_double());
+
+        Photon face_photon(origin, direction, 1.);
+        face_photon.set_cross_section(ION_H_n, 1.e4);
+        face_photon.set_cross_section(ION_He_n, 0.);
+        Photon voronoi_photon(face_photon);
+
+        DensityGrid::iterator face_cell =
+            face_grid.interact(face_photon, optical_depth);
+        DensityGrid::iterator voronoi_cell =
+            voronoi_grid.interact_voronoi_grid(voronoi_photon, optical_depth);
+
+        if (voronoi_cell == voronoi_grid.end()) {
+          assert_condition(face_cell == face_grid.end());
+          ++numescaped;
+        } else {
+          assert_condition(face_cell.get_index() == voronoi_cell.get_index());
+        }
+        const CoordinateVector<> face_position = face_photon.get_position();
+        const CoordinateVector<> voronoi_position =
+            voronoi_photon.get_position();
+        assert_values_equal_tol(face_position.x(), voronoi_position.x(),
+                                1.e-10);
+        assert_values_equal_tol(face_position.y(), voronoi_position.y(),
+                                1.e-10);
+        assert_values_equal_tol(face_position.z(), voronoi_position.z(),
+                                1.e-10);
+      }
+      // make sure we tested both escaping and absorbed photons
+      assert_condition(numescaped > 0 && numescaped < 1000);
+
+      face_grid.reduce_accumulators();
+      voronoi_grid.reduce_accumulators();
+      for (auto face_it = face_grid.begin(), voronoi_it = voronoi_grid.begin();
+           face_it != face_grid.end(); ++face_it, ++voronoi_it) {
+        assert_values_equal_rel(
+            face_it.get_ionization_variables().get_mean_intensity(ION_H_n),
+            voronoi_it.get_ionization_variables().get_mean_intensity(ION_H_n),
+            1.e-10);
+      }
+    }
+  }
+
+  /// point location by walking through the grid from a known cell, and
+  /// traversal of reemitted photons and photons emitted by discrete sources
+  {
+    const std::string grid_types[2] = {"Old", "New"};
+    for (unsigned int itype = 0; itype < 2; ++itype) {
+      HomogeneousDensityFunction density_function(100., 2000.);
+      Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+      VoronoiDensityGrid grid(
+          new UniformRandomVoronoiGeneratorDistribution(box, 1000, 42),
+          density_function, box, grid_types[itype]);
+      std::pair< unsigned long, unsigned long > block =
+          std::make_pair(0, grid.get_number_of_cells());
+      grid.initialize(block);
+
+      for (unsigned int i = 0; i < 1000; ++i) {
+        const CoordinateVector<> position = Utilities::random_position();
+        const unsigned int start =
+            Utilities::random_int(0, grid.get_number_of_cells());
+        const unsigned int walk_index = grid.locate_from_cell(position, start);
+        const unsigned int full_index = grid.get_cell_index(position);
+        assert_condition(walk_index == full_index);
+      }
+
+      const CoordinateVector<> source_position(0.5, 0.5, 0.5);
+      grid.set_source_positions(
+          std::vector< CoordinateVector<> >(1, source_position));
+      unsigned int source_cell = 0;
+      assert_condition(grid.get_source_cell(0, source_cell));
+      assert_condition(source_cell == grid.get_cell_index(source_position));
+      assert_condition(!grid.get_source_cell(1, source_cell));
+      assert_condition(!grid.get_source_cell(PHOTON_NO_SOURCE, source_cell));
+
+      unsigned int numreemitted = 0;
+      for (unsigned int i = 0; i < 1000; ++i) {
+        Photon photon(source_position, get_random_direction(), 1.);
+        photon.set_source_index(0);
+        photon.set_cross_section(ION_H_n, 1.e4);
+        photon.set_cross_section(ION_He_n, 0.);
+        double optical_depth = -std::log(Utilities::random_double());
+        DensityGrid::iterator cell = grid.interact(photon, optical_depth);
+        if (cell != grid.end()) {
+          // the photon has moved away from its source
+          assert_condition(photon.get_source_index() == PHOTON_NO_SOURCE);
+          photon.set_direction(get_random_direction());
+          Photon reference_photon(photon);
+          optical_depth = -std::log(Utilities::random_double());
+          const DensityGrid::iterator walk_cell =
+              grid.interact_from_cell(photon, optical_depth, cell);
+          const DensityGrid::iterator reference_cell =
+              grid.interact(reference_photon, optical_depth);
+          assert_condition(walk_cell == reference_cell);
+          const CoordinateVector<> walk_position = photon.get_position();
+          const CoordinateVector<> reference_position =
+              reference_photon.get_position();
+          assert_condition(walk_position == reference_position);
+          ++numreemitted;
+        }
+      }
+      assert_condition(numreemitted > 0);
+    }
+  }
+
   return 0;
 }
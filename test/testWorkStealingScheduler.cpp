@@ -0,0 +1,200 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file testWorkStealingScheduler.cpp
+ *
+ * @brief Unit test for the WorkStealingScheduler class.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Assert.hpp"
+#include "WorkDistributor.hpp"
+#include "WorkStealingScheduler.hpp"
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Job that counts how many times every element of a range is visited.
+ */
+class TestJob {
+private:
+  /*! @brief Visit counters. */
+  std::vector< std::atomic< unsigned int > > &_counts;
+
+  /*! @brief Begin of the range. */
+  unsigned long _begin;
+
+  /*! @brief End of the range. */
+  unsigned long _end;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param counts Visit counters.
+   */
+  inline TestJob(std::vector< std::atomic< unsigned int > > &counts)
+      : _counts(counts), _begin(0), _end(0) {}
+
+  /**
+   * @brief Set the range of elements to visit.
+   *
+   * @param begin Begin of the range.
+   * @param end End of the range.
+   */
+  inline void set_range(unsigned long begin, unsigned long end) {
+    _begin = begin;
+    _end = end;
+  }
+
+  /**
+   * @brief Should a completed job be deleted?
+   *
+   * @return False, jobs are owned by the TestJobMarket.
+   */
+  inline bool do_cleanup() const { return false; }
+
+  /**
+   * @brief Visit all elements in the range.
+   *
+   * The amount of work per element strongly varies, so that threads need to
+   * steal work from each other.
+   */
+  inline void execute() {
+    for (unsigned long i = _begin; i < _end; ++i) {
+      double x = 1.;
+      for (unsigned int j = 0; j < (i % 97) * (i % 97); ++j) {
+        x = std::sqrt(x + j);
+      }
+      if (x > 0.) {
+        ++_counts[i];
+      }
+    }
+  }
+
+  /**
+   * @brief Get a name tag for this job.
+   *
+   * @return "testjob".
+   */
+  inline std::string get_tag() const { return "testjob"; }
+};
+
+/**
+ * @brief JobMarket that uses a WorkStealingScheduler to hand out TestJobs.
+ */
+class TestJobMarket {
+private:
+  /*! @brief Number of elements. */
+  unsigned long _size;
+
+  /*! @brief WorkStealingScheduler. */
+  WorkStealingScheduler _scheduler;
+
+  /*! @brief Per thread jobs. */
+  std::vector< TestJob > _jobs;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param counts Visit counters.
+   */
+  inline TestJobMarket(std::vector< std::atomic< unsigned int > > &counts)
+      : _size(counts.size()), _jobs(MAX_NUM_THREADS, TestJob(counts)) {}
+
+  /**
+   * @brief Set the number of parallel threads that will be used to execute
+   * the jobs.
+   *
+   * @param worksize Number of parallel threads that will be used.
+   */
+  inline void set_worksize(int worksize) { _scheduler.reset(_size, worksize); }
+
+  /**
+   * @brief Get a job.
+   *
+   * @param thread_id Rank of the thread that wants to get a job.
+   * @return Job, or a nullptr if all work is done.
+   */
+  inline TestJob *get_job(int thread_id) {
+    unsigned long begin, end;
+    if (_scheduler.get_range(thread_id, 10, begin, end)) {
+      _jobs[thread_id].set_range(begin, end);
+      return &_jobs[thread_id];
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+/**
+ * @brief Unit test for the WorkStealingScheduler class.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  /// serial test: a single thread steals all the work of the other threads
+  if (MAX_NUM_THREADS > 2) {
+    WorkStealingScheduler scheduler;
+    scheduler.reset(1003, 3);
+    std::vector< unsigned int > counts(1003, 0);
+    unsigned long begin, end;
+    unsigned int numchunk = 0;
+    while (scheduler.get_range(0, 100, begin, end)) {
+      assert_condition(begin < end);
+      assert_condition(end - begin <= 100);
+      for (unsigned long i = begin; i < end; ++i) {
+        ++counts[i];
+      }
+      ++numchunk;
+    }
+    for (unsigned int i = 0; i < 1003; ++i) {
+      assert_condition(counts[i] == 1);
+    }
+    cmac_status("Serial test used %u chunks.", numchunk);
+
+    // the scheduler can be reused
+    scheduler.reset(0, 3);
+    assert_condition(!scheduler.get_range(1, 100, begin, end));
+  }
+
+  /// parallel test: every element is visited exactly once
+  {
+    const unsigned int size = 100000;
+    std::vector< std::atomic< unsigned int > > counts(size);
+    for (unsigned int i = 0; i < size; ++i) {
+      counts[i] = 0;
+    }
+    TestJobMarket jobs(counts);
+    WorkDistributor< TestJobMarket, TestJob > workdistributor;
+    workdistributor.do_in_parallel(jobs);
+    for (unsigned int i = 0; i < size; ++i) {
+      assert_condition(counts[i] == 1);
+    }
+    cmac_status("Parallel test used %i threads.",
+                workdistributor.get_worksize());
+  }
+
+  return 0;
+}
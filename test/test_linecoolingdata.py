@@ -70,6 +70,22 @@ def main():
                                                   rel = abs(a-b)/abs(a+b))
         sys.exit(1)
 
+  # check the tabulated cooling against the exact level population solver
+  linecoolingdata.tabulate_cooling()
+  if not linecoolingdata.is_tabulated():
+    print "Error: cooling table was not computed!"
+    sys.exit(1)
+  T = 10.**np.linspace(3., 6., 100)
+  ne = 10.**np.linspace(2., 14., 100)
+  abundances = [1.e-4] * 12
+  cool = linecoolingdata.get_cooling(T, ne, abundances)
+  exact = linecoolingdata.get_exact_cooling(T, ne, abundances)
+  rel = abs(cool - exact) / abs(cool + exact)
+  if rel.max() > 5.e-4:
+    print "Error: tabulated cooling is too inaccurate ({rel})!".format(
+      rel = 2. * rel.max())
+    sys.exit(1)
+
   sys.exit(0)
 
 # make sure the main function is executed
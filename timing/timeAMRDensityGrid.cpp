@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+/**
+ * @file timeAMRDensityGrid.cpp
+ *
+ * @brief Timing test for the photon traversal of an AMRDensityGrid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "AMRDensityGrid.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "Photon.hpp"
+#include "SpatialAMRRefinementScheme.hpp"
+#include "TimingTools.hpp"
+#include "Utilities.hpp"
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Timing test for the photon traversal of an AMRDensityGrid.
+ *
+ * We refine the central region of a 32^3 cell grid two levels deeper and let a
+ * large number of photons with random origins and directions cross the grid
+ * without being absorbed, once using the linear cell tables in
+ * AMRDensityGrid::interact(), and once using the original traversal of the
+ * AMRGrid hierarchy in AMRDensityGrid::interact_tree(). For both algorithms,
+ * we output the number of photons per second.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeAMRDensityGrid", argc, argv);
+
+  HomogeneousDensityFunction function(1., 8000.);
+  const Box<> box(CoordinateVector<>(), CoordinateVector<>(1.));
+  AMRRefinementScheme *scheme = new SpatialAMRRefinementScheme(
+      Box<>(CoordinateVector<>(0.25), CoordinateVector<>(0.5)), 7);
+  AMRDensityGrid grid(box, 32, function, scheme);
+  std::pair< unsigned long, unsigned long > block =
+      std::make_pair(0, grid.get_number_of_cells());
+  grid.initialize(block);
+
+  const unsigned int numphoton = 100000;
+  std::vector< CoordinateVector<> > origins(numphoton);
+  std::vector< CoordinateVector<> > directions(numphoton);
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    origins[i] = CoordinateVector<>(Utilities::random_double(),
+                                    Utilities::random_double(),
+                                    Utilities::random_double());
+    const double cost = 2. * Utilities::random_double() - 1.;
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    const double phi = 2. * M_PI * Utilities::random_double();
+    directions[i] =
+        CoordinateVector<>(sint * std::cos(phi), sint * std::sin(phi), cost);
+  }
+
+  timingtools_print("Traversing %u cells with %u photons.",
+                    grid.get_number_of_cells(), numphoton);
+
+  double tree_time = 0.;
+  timingtools_start_timing_block("AMRGrid hierarchy") {
+    timingtools_start_timing();
+    for (unsigned int i = 0; i < numphoton; ++i) {
+      Photon photon(origins[i], directions[i], 1.);
+      grid.interact_tree(photon, 1.);
+    }
+    timingtools_stop_timing();
+    tree_time += timingtools_timer.value();
+  }
+  timingtools_end_timing_block("AMRGrid hierarchy");
+  tree_time /= timingtools_num_sample;
+
+  double table_time = 0.;
+  timingtools_start_timing_block("linear cell tables") {
+    timingtools_start_timing();
+    for (unsigned int i = 0; i < numphoton; ++i) {
+      Photon photon(origins[i], directions[i], 1.);
+      grid.interact(photon, 1.);
+    }
+    timingtools_stop_timing();
+    table_time += timingtools_timer.value();
+  }
+  timingtools_end_timing_block("linear cell tables");
+  table_time /= timingtools_num_sample;
+
+  timingtools_print("AMRGrid hierarchy: %g photons/s.", numphoton / tree_time);
+  timingtools_print("linear cell tables: %g photons/s (speed up: %g).",
+                    numphoton / table_time, tree_time / table_time);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeAliasTable.cpp
+ *
+ * @brief Timing test for the selection of a random discrete photon source.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "AliasTable.hpp"
+#include "TimingTools.hpp"
+#include <vector>
+
+/**
+ * @brief Timing test for the selection of a random discrete photon source.
+ *
+ * For an increasing number of sources with random weights, we compare the cost
+ * of selecting a random source using a linear search through the cumulative
+ * probability distribution (the old PhotonSource algorithm) with the cost of
+ * sampling from an AliasTable.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeAliasTable", argc, argv);
+
+  const unsigned int num_test = 1000000;
+  std::vector< double > random_numbers(num_test);
+  for (unsigned int i = 0; i < num_test; ++i) {
+    random_numbers[i] = Utilities::random_double();
+  }
+
+  for (unsigned int num_source = 10; num_source <= 100000; num_source *= 10) {
+
+    timingtools_print_header("%u sources", num_source);
+
+    std::vector< double > weights(num_source);
+    double total_weight = 0.;
+    for (unsigned int i = 0; i < num_source; ++i) {
+      weights[i] = Utilities::random_double();
+      total_weight += weights[i];
+    }
+    std::vector< double > cumulative(num_source);
+    cumulative[0] = weights[0] / total_weight;
+    for (unsigned int i = 1; i < num_source; ++i) {
+      cumulative[i] = cumulative[i - 1] + weights[i] / total_weight;
+    }
+    cumulative.back() = 1.;
+
+    // the linear search scales with the number of sources, so we use fewer
+    // samples for large numbers of sources to keep the test short
+    const unsigned int num_linear = std::min(num_test, 100000000 / num_source);
+    unsigned long linear_checksum = 0;
+    timingtools_start_timing_block("linear search") {
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < num_linear; ++i) {
+        unsigned int index = 0;
+        while (random_numbers[i] > cumulative[index]) {
+          ++index;
+        }
+        linear_checksum += index;
+      }
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("linear search");
+
+    AliasTable table(weights);
+    unsigned long alias_checksum = 0;
+    timingtools_start_timing_block("alias table") {
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < num_test; ++i) {
+        alias_checksum += table.sample(random_numbers[i]);
+      }
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("alias table");
+
+    // the checksums make sure the loops are not optimized away
+    timingtools_print("Linear search: %u samples (checksum %lu), alias table: "
+                      "%u samples (checksum %lu).",
+                      num_linear, linear_checksum, num_test, alias_checksum);
+  }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeCartesianDensityGrid.cpp
+ *
+ * @brief Timing test for the photon traversal of a CartesianDensityGrid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "CartesianDensityGrid.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "Photon.hpp"
+#include "TimingTools.hpp"
+#include "Utilities.hpp"
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Timing test for the photon traversal of a CartesianDensityGrid.
+ *
+ * We let a large number of photons with random origins and directions cross a
+ * 64^3 cell grid without being absorbed, once using the 3D-DDA traversal in
+ * CartesianDensityGrid::interact(), and once using the original traversal in
+ * CartesianDensityGrid::interact_wall_intersection(). For both algorithms, we
+ * output the number of traversed cells per second.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeCartesianDensityGrid", argc, argv);
+
+  HomogeneousDensityFunction function(1., 8000.);
+  const Box<> box(CoordinateVector<>(), CoordinateVector<>(1.));
+  const int ncell_1D = 64;
+  CartesianDensityGrid grid(box, ncell_1D, function);
+  std::pair< unsigned long, unsigned long > block =
+      std::make_pair(0, grid.get_number_of_cells());
+  grid.initialize(block);
+
+  const unsigned int numphoton = 100000;
+  std::vector< CoordinateVector<> > origins(numphoton);
+  std::vector< CoordinateVector<> > directions(numphoton);
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    origins[i] = CoordinateVector<>(Utilities::random_double(),
+                                    Utilities::random_double(),
+                                    Utilities::random_double());
+    const double cost = 2. * Utilities::random_double() - 1.;
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    const double phi = 2. * M_PI * Utilities::random_double();
+    directions[i] =
+        CoordinateVector<>(sint * std::cos(phi), sint * std::sin(phi), cost);
+  }
+
+  // count the number of cells that is traversed by every photon: this is the
+  // number of walls crossed before leaving the box
+  unsigned long numcell = 0;
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    Photon photon(origins[i], directions[i], 1.);
+    grid.interact(photon, 1.);
+    const CoordinateVector<> &start = origins[i];
+    const CoordinateVector<> &stop = photon.get_position();
+    for (unsigned int j = 0; j < 3; ++j) {
+      const int istart = start[j] * ncell_1D;
+      const int istop = std::min(
+          std::max(static_cast< int >(stop[j] * ncell_1D), 0), ncell_1D - 1);
+      numcell += std::abs(istop - istart);
+    }
+    ++numcell;
+  }
+  timingtools_print("Traversing %lu cells with %u photons.", numcell,
+                    numphoton);
+
+  double wall_time = 0.;
+  timingtools_start_timing_block("wall intersection") {
+    timingtools_start_timing();
+    for (unsigned int i = 0; i < numphoton; ++i) {
+      Photon photon(origins[i], directions[i], 1.);
+      grid.interact_wall_intersection(photon, 1.);
+    }
+    timingtools_stop_timing();
+    wall_time += timingtools_timer.value();
+  }
+  timingtools_end_timing_block("wall intersection");
+  wall_time /= timingtools_num_sample;
+
+  double dda_time = 0.;
+  timingtools_start_timing_block("3D-DDA") {
+    timingtools_start_timing();
+    for (unsigned int i = 0; i < numphoton; ++i) {
+      Photon photon(origins[i], directions[i], 1.);
+      grid.interact(photon, 1.);
+    }
+    timingtools_stop_timing();
+    dda_time += timingtools_timer.value();
+  }
+  timingtools_end_timing_block("3D-DDA");
+  dda_time /= timingtools_num_sample;
+
+  timingtools_print("wall intersection: %g cells/s.", numcell / wall_time);
+  timingtools_print("3D-DDA: %g cells/s (speed up: %g).", numcell / dda_time,
+                    wall_time / dda_time);
+
+  return 0;
+}
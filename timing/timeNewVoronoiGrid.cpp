@@ -99,5 +99,74 @@ int main(int argc, char **argv) {
     timingtools_end_timing_block("NewVoronoiGrid");
   }
 
+  /// Test 3: grid update after a small displacement of the generators
+  {
+    timingtools_print_header("Grid update test.");
+
+    const unsigned int numpositions = 5000;
+
+    // set up the generator positions and their displacements: the
+    // displacements are a few percent of the average cell size, and the
+    // initial positions have a safety margin so that they stay in the box
+    std::vector< CoordinateVector<> > initial_positions(numpositions);
+    std::vector< CoordinateVector<> > displacements(numpositions);
+    for (unsigned int i = 0; i < numpositions; ++i) {
+      initial_positions[i] =
+          CoordinateVector<>(0.05 + 0.9 * Utilities::random_double(),
+                             0.05 + 0.9 * Utilities::random_double(),
+                             0.05 + 0.9 * Utilities::random_double());
+      displacements[i] =
+          CoordinateVector<>(1.e-3 * (Utilities::random_double() - 0.5),
+                             1.e-3 * (Utilities::random_double() - 0.5),
+                             1.e-3 * (Utilities::random_double() - 0.5));
+    }
+
+    // set up the simulation box
+    Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+
+    std::vector< CoordinateVector<> > positions(numpositions);
+
+    double rebuild_time = 0.;
+    timingtools_start_timing_block("full rebuild") {
+      for (unsigned int i = 0; i < numpositions; ++i) {
+        positions[i] = initial_positions[i] + displacements[i];
+      }
+
+      timingtools_start_timing();
+      NewVoronoiGrid grid(positions, box);
+      grid.compute_grid(1);
+      timingtools_stop_timing();
+      rebuild_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("full rebuild");
+    rebuild_time /= timingtools_num_sample;
+
+    // first move all generators, then only move one in ten generators
+    const unsigned int strides[2] = {1, 10};
+    const char *names[2] = {"update (all generators moved)",
+                            "update (10% of generators moved)"};
+    for (unsigned int istride = 0; istride < 2; ++istride) {
+      double update_time = 0.;
+      timingtools_start_timing_block(names[istride]) {
+        positions = initial_positions;
+        NewVoronoiGrid grid(positions, box);
+        grid.compute_grid(1);
+        for (unsigned int i = 0; i < numpositions; i += strides[istride]) {
+          positions[i] += displacements[i];
+        }
+
+        timingtools_start_timing();
+        grid.update_grid(1);
+        timingtools_stop_timing();
+        update_time += timingtools_timer.value();
+      }
+      timingtools_end_timing_block(names[istride]);
+      update_time /= timingtools_num_sample;
+
+      timingtools_print("%s: %g s (speed up: %g).", names[istride],
+                        update_time, rebuild_time / update_time);
+    }
+  }
+
   return 0;
 }
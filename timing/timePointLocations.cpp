@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+/**
+ * @file timePointLocations.cpp
+ *
+ * @brief Timing test for the PointLocations neighbour searches.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "PointLocations.hpp"
+#include "TimingTools.hpp"
+#include "Utilities.hpp"
+
+/**
+ * @brief Timing test for the PointLocations neighbour searches.
+ *
+ * We set up a PointLocations object for 10^5 random positions, using both 1
+ * and 10 positions per grid cell (the values used by the NewVoronoiGrid and the
+ * OldVoronoiGrid), and time the construction, the neighbour search around
+ * existing positions (as done during Voronoi grid construction) and the
+ * closest neighbour search for random positions (as done during point
+ * location).
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timePointLocations", argc, argv);
+
+  const unsigned int numpositions = 100000;
+  const unsigned int numquery = 100000;
+
+  std::vector< CoordinateVector<> > positions(numpositions);
+  for (unsigned int i = 0; i < numpositions; ++i) {
+    positions[i] = Utilities::random_position();
+  }
+  std::vector< CoordinateVector<> > queries(numquery);
+  for (unsigned int i = 0; i < numquery; ++i) {
+    queries[i] = Utilities::random_position();
+  }
+
+  const Box<> box(CoordinateVector<>(0.), CoordinateVector<>(1.));
+
+  // search radius that contains about 50 positions on average
+  const double radius2 =
+      std::pow(50. * 3. / (4. * M_PI * numpositions), 2. / 3.);
+
+  const unsigned int num_per_cell[2] = {1, 10};
+  for (unsigned int inum = 0; inum < 2; ++inum) {
+    timingtools_print_header("%u positions per grid cell", num_per_cell[inum]);
+
+    timingtools_start_timing_block("construction") {
+      timingtools_start_timing();
+      PointLocations locations(positions, num_per_cell[inum], box);
+      timingtools_stop_timing();
+    }
+    timingtools_end_timing_block("construction");
+
+    PointLocations locations(positions, num_per_cell[inum], box);
+
+    // we sum the neighbour indices to make sure the compiler does not optimize
+    // out the searches
+    unsigned long checksum = 0;
+    double search_time = 0.;
+    timingtools_start_timing_block("neighbour search") {
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < numpositions; ++i) {
+        auto it = locations.get_neighbours(i);
+        do {
+          auto ngbs = it.get_neighbours();
+          for (auto ngbit = ngbs.begin(); ngbit != ngbs.end(); ++ngbit) {
+            checksum += *ngbit;
+          }
+        } while (it.increase_range() && it.get_max_radius2() < radius2);
+      }
+      timingtools_stop_timing();
+      search_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("neighbour search");
+    search_time /= timingtools_num_sample;
+
+    double closest_time = 0.;
+    timingtools_start_timing_block("closest neighbour") {
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < numquery; ++i) {
+        checksum += locations.get_closest_neighbour(queries[i]);
+      }
+      timingtools_stop_timing();
+      closest_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("closest neighbour");
+    closest_time /= timingtools_num_sample;
+
+    timingtools_print("neighbour search: %g searches/s.",
+                      numpositions / search_time);
+    timingtools_print("closest neighbour: %g queries/s.",
+                      numquery / closest_time);
+    timingtools_print("(checksum: %lu)", checksum);
+  }
+
+  return 0;
+}
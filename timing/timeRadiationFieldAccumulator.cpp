@@ -0,0 +1,357 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeRadiationFieldAccumulator.cpp
+ *
+ * @brief Scaling test for the RadiationFieldAccumulator.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Lock.hpp"
+#include "RadiationFieldAccumulator.hpp"
+#include "TimingTools.hpp"
+#include "WorkDistributor.hpp"
+#include "WorkEnvironment.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/*! @brief Number of cells in every dimension of the test grid. */
+#define TIMERADIATIONFIELDACCUMULATOR_NCELL 64
+
+/**
+ * @brief Per cell lock accumulation, as done by the DensityGrid when
+ * USE_PRIVATE_ACCUMULATORS is not defined.
+ */
+class LockedCellAccumulator {
+private:
+  /*! @brief Accumulated values. */
+  std::vector< double > _values;
+
+  /*! @brief Per cell locks. */
+  std::vector< Lock > _locks;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param numcell Number of cells in the grid.
+   */
+  inline LockedCellAccumulator(unsigned long numcell)
+      : _values(RADIATIONFIELDACCUMULATOR_NUMVALUE * numcell, 0.),
+        _locks(numcell) {}
+
+  /**
+   * @brief Add the given contributions to the given cell.
+   *
+   * @param thread_id Rank of the calling thread (not used).
+   * @param index Index of the cell.
+   * @param dmean_intensity Mean intensity integral contributions for all ions.
+   * @param dheating Heating integral contributions for all heating terms.
+   */
+  inline void add(int thread_id, unsigned long index,
+                  const double *dmean_intensity, const double *dheating) {
+    double *values = &_values[RADIATIONFIELDACCUMULATOR_NUMVALUE * index];
+    _locks[index].lock();
+    for (int i = 0; i < NUMBER_OF_IONNAMES; ++i) {
+      values[i] += dmean_intensity[i];
+    }
+    for (int i = 0; i < NUMBER_OF_HEATINGTERMS; ++i) {
+      values[NUMBER_OF_IONNAMES + i] += dheating[i];
+    }
+    _locks[index].unlock();
+  }
+};
+
+/**
+ * @brief Job that propagates a range of photon packets from a central source
+ * through a uniform Cartesian grid and accumulates their contributions to the
+ * cells they cross.
+ */
+template < typename _accumulator_ > class PhotonJob {
+private:
+  /*! @brief Accumulator. */
+  _accumulator_ &_accumulator;
+
+  /*! @brief Propagation directions of all photon packets. */
+  const std::vector< double > &_directions;
+
+  /*! @brief Rank of the thread that executes the job. */
+  int _thread_id;
+
+  /*! @brief Begin of the range. */
+  unsigned long _begin;
+
+  /*! @brief End of the range. */
+  unsigned long _end;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param accumulator Accumulator.
+   * @param directions Propagation directions of all photon packets.
+   */
+  inline PhotonJob(_accumulator_ &accumulator,
+                   const std::vector< double > &directions)
+      : _accumulator(accumulator), _directions(directions), _thread_id(0),
+        _begin(0), _end(0) {}
+
+  /**
+   * @brief Set the range of photon packets to propagate.
+   *
+   * @param thread_id Rank of the thread that executes the job.
+   * @param begin Begin of the range.
+   * @param end End of the range.
+   */
+  inline void set_range(int thread_id, unsigned long begin,
+                        unsigned long end) {
+    _thread_id = thread_id;
+    _begin = begin;
+    _end = end;
+  }
+
+  /**
+   * @brief Should a completed job be deleted?
+   *
+   * @return False, jobs are owned by the JobMarket.
+   */
+  inline bool do_cleanup() const { return false; }
+
+  /**
+   * @brief Propagate the photon packets.
+   *
+   * Every packet takes steps of half a cell size from the centre of the box
+   * until it leaves the box.
+   */
+  inline void execute() {
+    const int ncell = TIMERADIATIONFIELDACCUMULATOR_NCELL;
+    const double ds = 0.5;
+    double dmean_intensity[NUMBER_OF_IONNAMES];
+    double dheating[NUMBER_OF_HEATINGTERMS];
+    for (unsigned long i = _begin; i < _end; ++i) {
+      const double *direction = &_directions[3 * i];
+      double x = 0.5 * ncell;
+      double y = 0.5 * ncell;
+      double z = 0.5 * ncell;
+      while (x >= 0. && x < ncell && y >= 0. && y < ncell && z >= 0. &&
+             z < ncell) {
+        const unsigned long index =
+            (static_cast< unsigned long >(x) * ncell +
+             static_cast< unsigned long >(y)) *
+                ncell +
+            static_cast< unsigned long >(z);
+        for (int j = 0; j < NUMBER_OF_IONNAMES; ++j) {
+          dmean_intensity[j] = ds * (j + 1.);
+        }
+        for (int j = 0; j < NUMBER_OF_HEATINGTERMS; ++j) {
+          dheating[j] = ds * (j + 1.);
+        }
+        _accumulator.add(_thread_id, index, dmean_intensity, dheating);
+        x += ds * direction[0];
+        y += ds * direction[1];
+        z += ds * direction[2];
+      }
+    }
+  }
+
+  /**
+   * @brief Get a name tag for this job.
+   *
+   * @return "photonjob".
+   */
+  inline std::string get_tag() const { return "photonjob"; }
+};
+
+/**
+ * @brief JobMarket that hands out PhotonJobs in fixed size chunks.
+ */
+template < typename _accumulator_ > class PhotonJobMarket {
+private:
+  /*! @brief Number of photon packets that still need to be handed out. */
+  unsigned long _size;
+
+  /*! @brief Index of the next photon packet. */
+  unsigned long _next;
+
+  /*! @brief Number of photon packets in a job. */
+  unsigned int _jobsize;
+
+  /*! @brief Lock that protects the counters. */
+  Lock _lock;
+
+  /*! @brief Per thread jobs. */
+  std::vector< PhotonJob< _accumulator_ > > _jobs;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param accumulator Accumulator.
+   * @param directions Propagation directions of all photon packets.
+   * @param jobsize Number of photon packets in a job.
+   */
+  inline PhotonJobMarket(_accumulator_ &accumulator,
+                         const std::vector< double > &directions,
+                         unsigned int jobsize)
+      : _size(directions.size() / 3), _next(0), _jobsize(jobsize),
+        _jobs(MAX_NUM_THREADS,
+              PhotonJob< _accumulator_ >(accumulator, directions)) {}
+
+  /**
+   * @brief Set the number of parallel threads that will be used to execute
+   * the jobs.
+   *
+   * @param worksize Number of parallel threads that will be used.
+   */
+  inline void set_worksize(int worksize) {}
+
+  /**
+   * @brief Get a job.
+   *
+   * @param thread_id Rank of the thread that wants to get a job.
+   * @return Job, or a nullptr if all work is done.
+   */
+  inline PhotonJob< _accumulator_ > *get_job(int thread_id) {
+    _lock.lock();
+    const unsigned long jobsize =
+        std::min(static_cast< unsigned long >(_jobsize), _size);
+    const unsigned long begin = _next;
+    _next += jobsize;
+    _size -= jobsize;
+    _lock.unlock();
+    if (jobsize > 0) {
+      _jobs[thread_id].set_range(thread_id, begin, begin + jobsize);
+      return &_jobs[thread_id];
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+/**
+ * @brief Scaling test for the RadiationFieldAccumulator.
+ *
+ * We propagate photon packets from a central source through a uniform 64^3
+ * grid, so that every thread visits every part of the grid. The contributions
+ * to the mean intensity and heating integrals are accumulated
+ *  - with a lock per cell, as done without USE_PRIVATE_ACCUMULATORS,
+ *  - with thread private accumulators, using the default number of private
+ *    copies (which scales with the number of threads),
+ *  - with thread private accumulators limited to a single private copy of the
+ *    grid, so that most threads add to the shared tiles.
+ *
+ * Every variant first propagates all packets once without timing, so that
+ * the timings reflect the later iterations of a simulation, in which the
+ * accumulator tiles have already been allocated.
+ *
+ * The maximum number of threads is set with the -t command line option, e.g.
+ * "-t 32" for a scaling test from 1 to 32 threads. It cannot be larger than
+ * the MAX_NUMBER_OF_THREADS value used to configure the code.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeRadiationFieldAccumulator", argc, argv);
+
+  const unsigned long numcell = TIMERADIATIONFIELDACCUMULATOR_NCELL *
+                                TIMERADIATIONFIELDACCUMULATOR_NCELL *
+                                TIMERADIATIONFIELDACCUMULATOR_NCELL;
+  const unsigned int num_photon = 100000;
+  const unsigned int jobsize = 100;
+  std::vector< double > directions(3 * num_photon);
+  for (unsigned int i = 0; i < num_photon; ++i) {
+    const double cost = 2. * Utilities::random_double() - 1.;
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    const double phi = 2. * M_PI * Utilities::random_double();
+    directions[3 * i] = sint * std::cos(phi);
+    directions[3 * i + 1] = sint * std::sin(phi);
+    directions[3 * i + 2] = cost;
+  }
+
+  timingtools_start_scaling_block("per cell locks") {
+    LockedCellAccumulator accumulator(numcell);
+    PhotonJobMarket< LockedCellAccumulator > warmup_jobs(
+        accumulator, directions, jobsize);
+    PhotonJobMarket< LockedCellAccumulator > jobs(accumulator, directions,
+                                                  jobsize);
+    WorkDistributor< PhotonJobMarket< LockedCellAccumulator >,
+                     PhotonJob< LockedCellAccumulator > >
+        workers;
+
+    // untimed first pass: allocate the tiles, as in the first iteration of a
+    // simulation
+    workers.do_in_parallel(warmup_jobs);
+
+    timingtools_start_timing();
+    workers.do_in_parallel(jobs);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("per cell locks",
+                                "timeRadiationFieldAccumulator_locked.txt");
+
+  timingtools_start_scaling_block("private accumulators") {
+    RadiationFieldAccumulator accumulator(numcell);
+    WorkDistributor< PhotonJobMarket< RadiationFieldAccumulator >,
+                     PhotonJob< RadiationFieldAccumulator > >
+        workers;
+    accumulator.set_number_of_threads(workers.get_worksize());
+    PhotonJobMarket< RadiationFieldAccumulator > warmup_jobs(
+        accumulator, directions, jobsize);
+    PhotonJobMarket< RadiationFieldAccumulator > jobs(accumulator, directions,
+                                                      jobsize);
+
+    // untimed first pass: allocate the tiles, as in the first iteration of a
+    // simulation
+    workers.do_in_parallel(warmup_jobs);
+
+    timingtools_start_timing();
+    workers.do_in_parallel(jobs);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("private accumulators",
+                                "timeRadiationFieldAccumulator_private.txt");
+
+  timingtools_start_scaling_block("shared accumulators") {
+    RadiationFieldAccumulator accumulator(numcell, MAX_NUM_THREADS, 1);
+    WorkDistributor< PhotonJobMarket< RadiationFieldAccumulator >,
+                     PhotonJob< RadiationFieldAccumulator > >
+        workers;
+    accumulator.set_number_of_threads(workers.get_worksize());
+    PhotonJobMarket< RadiationFieldAccumulator > warmup_jobs(
+        accumulator, directions, jobsize);
+    PhotonJobMarket< RadiationFieldAccumulator > jobs(accumulator, directions,
+                                                      jobsize);
+
+    // untimed first pass: allocate the tiles, as in the first iteration of a
+    // simulation
+    workers.do_in_parallel(warmup_jobs);
+
+    timingtools_start_timing();
+    workers.do_in_parallel(jobs);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("shared accumulators",
+                                "timeRadiationFieldAccumulator_shared.txt");
+
+  return 0;
+}
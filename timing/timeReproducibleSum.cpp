@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeReproducibleSum.cpp
+ *
+ * @brief Timing test for the cost of order independent cell counters.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "RadiationFieldAccumulator.hpp"
+#include "ReproducibleSum.hpp"
+#include "TimingTools.hpp"
+#include <vector>
+
+/**
+ * @brief Timing test for the cost of order independent cell counters.
+ *
+ * We mimic the accumulation of the mean intensity and heating integrals during
+ * photon propagation: for a large number of random cell crossings,
+ * RADIATIONFIELDACCUMULATOR_NUMVALUE contributions are added to the counters of
+ * a random cell. This is done once with ordinary double precision counters,
+ * and once with the ReproducibleSum counters that are used when
+ * USE_REPRODUCIBLE_RESULTS is defined.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeReproducibleSum", argc, argv);
+
+  // set up the test arrays
+  const unsigned int num_cell = 32768;
+  const unsigned int num_test = 1000000;
+  std::vector< unsigned int > cells(num_test);
+  std::vector< double > values(num_test);
+  for (unsigned int i = 0; i < num_test; ++i) {
+    cells[i] = Utilities::random_int(0, num_cell);
+    // path length contributions spanning a few orders of magnitude
+    values[i] = std::pow(10., 4. * Utilities::random_double() - 6.);
+  }
+
+  std::vector< double > double_counters(
+      RADIATIONFIELDACCUMULATOR_NUMVALUE * num_cell, 0.);
+  timingtools_start_timing_block("double counters") {
+    timingtools_start_timing();
+    for (unsigned int i = 0; i < num_test; ++i) {
+      double *counters =
+          &double_counters[RADIATIONFIELDACCUMULATOR_NUMVALUE * cells[i]];
+      for (int j = 0; j < RADIATIONFIELDACCUMULATOR_NUMVALUE; ++j) {
+        counters[j] += (j + 1) * values[i];
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("double counters");
+
+  std::vector< ReproducibleSum > reproducible_counters(
+      RADIATIONFIELDACCUMULATOR_NUMVALUE * num_cell);
+  timingtools_start_timing_block("reproducible counters") {
+    timingtools_start_timing();
+    for (unsigned int i = 0; i < num_test; ++i) {
+      ReproducibleSum *counters =
+          &reproducible_counters[RADIATIONFIELDACCUMULATOR_NUMVALUE *
+                                 cells[i]];
+      for (int j = 0; j < RADIATIONFIELDACCUMULATOR_NUMVALUE; ++j) {
+        counters[j] += (j + 1) * values[i];
+      }
+    }
+    timingtools_stop_timing();
+  }
+  timingtools_end_timing_block("reproducible counters");
+
+  timingtools_print("Memory per cell: %lu bytes (double), %lu bytes "
+                    "(reproducible).",
+                    RADIATIONFIELDACCUMULATOR_NUMVALUE * sizeof(double),
+                    RADIATIONFIELDACCUMULATOR_NUMVALUE *
+                        sizeof(ReproducibleSum));
+
+  return 0;
+}
@@ -0,0 +1,334 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeTemperatureCalculator.cpp
+ *
+ * @brief Timing test for the temperature calculation with exact and tabulated
+ * atomic rates.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Abundances.hpp"
+#include "CartesianDensityGrid.hpp"
+#include "ChargeTransferRates.hpp"
+#include "HomogeneousDensityFunction.hpp"
+#include "LineCoolingData.hpp"
+#include "TabulatedChargeTransferRates.hpp"
+#include "TabulatedRecombinationRates.hpp"
+#include "TemperatureCalculator.hpp"
+#include "TimingTools.hpp"
+#include "UnitConverter.hpp"
+#include "VernerRecombinationRates.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Input values for a single cell.
+ */
+struct CellInput {
+  /*! @brief Mean intensity integrals for all ions (in s^-1). */
+  double _mean_intensity[NUMBER_OF_IONNAMES];
+
+  /*! @brief Heating integrals for hydrogen and helium (in J s^-1). */
+  double _heating[2];
+
+  /*! @brief Initial temperature (in K). */
+  double _temperature;
+
+  /*! @brief Number density (in m^-3). */
+  double _number_density;
+};
+
+/**
+ * @brief Solve for the temperature of all given cells.
+ *
+ * @param inputs Cell inputs.
+ * @param calculator TemperatureCalculator to use.
+ * @param cell DensityGrid::iterator pointing to the cell that is used for the
+ * calculation.
+ * @param temperatures Array to store the resulting temperatures in (in K).
+ * @return Total number of thermal balance iterations.
+ */
+unsigned long solve_temperatures(const std::vector< CellInput > &inputs,
+                        const TemperatureCalculator &calculator,
+                        DensityGrid::iterator &cell,
+                        std::vector< double > &temperatures) {
+  IonizationVariables &ionization_variables = cell.get_ionization_variables();
+  unsigned long niter = 0;
+  for (unsigned int i = 0; i < inputs.size(); ++i) {
+    cell.reset_mean_intensities();
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      ionization_variables.increase_mean_intensity(
+          static_cast< IonName >(ion), inputs[i]._mean_intensity[ion]);
+    }
+    ionization_variables.increase_heating(HEATINGTERM_H, inputs[i]._heating[0]);
+    ionization_variables.increase_heating(HEATINGTERM_He,
+                                          inputs[i]._heating[1]);
+    ionization_variables.set_number_density(inputs[i]._number_density);
+    ionization_variables.set_temperature(inputs[i]._temperature);
+    niter += calculator.calculate_temperature(1., 1., cell);
+    temperatures[i] = ionization_variables.get_temperature();
+  }
+  return niter;
+}
+
+/**
+ * @brief Set the values of all cells in the given grid.
+ *
+ * The cell inputs are repeated if the grid has more cells than inputs.
+ *
+ * @param inputs Cell inputs.
+ * @param grid DensityGrid.
+ */
+void set_grid_values(const std::vector< CellInput > &inputs,
+                     DensityGrid &grid) {
+  unsigned int index = 0;
+  for (auto it = grid.begin(); it != grid.end(); ++it) {
+    const CellInput &input = inputs[index % inputs.size()];
+    ++index;
+    IonizationVariables &ionization_variables = it.get_ionization_variables();
+    it.reset_mean_intensities();
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      ionization_variables.increase_mean_intensity(
+          static_cast< IonName >(ion), input._mean_intensity[ion]);
+    }
+    ionization_variables.increase_heating(HEATINGTERM_H, input._heating[0]);
+    ionization_variables.increase_heating(HEATINGTERM_He, input._heating[1]);
+    ionization_variables.set_number_density(input._number_density);
+    ionization_variables.set_temperature(input._temperature);
+  }
+}
+
+/**
+ * @brief Timing test for the temperature calculation with exact and tabulated
+ * atomic rates.
+ *
+ * We solve for the temperature of the cells in the TemperatureCalculator unit
+ * test data file, once with the exact rate fits, and once with tabulated rates
+ * for a number of table resolutions. For every table resolution, we output the
+ * number of cells per second and the maximum relative temperature difference
+ * w.r.t. the exact rates. We do the same for the tabulated line cooling.
+ *
+ * Finally, we compare the single cell temperature calculation with the batched
+ * calculation that processes TEMPERATURECALCULATOR_BLOCKSIZE cells at once.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeTemperatureCalculator", argc, argv);
+
+  // read the cell values
+  std::vector< CellInput > inputs;
+  std::ifstream file("tbal_testdata.txt");
+  std::string line;
+  while (getline(file, line)) {
+    std::istringstream linestream(line);
+    CellInput input;
+    for (int ion = 0; ion < NUMBER_OF_IONNAMES; ++ion) {
+      linestream >> input._mean_intensity[ion];
+    }
+    double hH, hHe, ntot;
+    linestream >> hH >> hHe >> input._temperature >> ntot;
+    // the calculation is capped at 30,000 K
+    if (input._temperature > 30000.) {
+      continue;
+    }
+    input._heating[0] = UnitConverter::to_SI< QUANTITY_ENERGY_RATE >(
+        hH, "erg s^-1");
+    input._heating[1] = UnitConverter::to_SI< QUANTITY_ENERGY_RATE >(
+        hHe, "erg s^-1");
+    input._number_density =
+        UnitConverter::to_SI< QUANTITY_NUMBER_DENSITY >(ntot, "cm^-3");
+    inputs.push_back(input);
+  }
+  if (inputs.size() == 0) {
+    cmac_error("No cells found in tbal_testdata.txt!");
+  }
+  // repeat the cells to get a sufficiently long timing
+  const unsigned int numrepeat = std::max(1., 10000. / inputs.size());
+  const unsigned int numcell = inputs.size();
+  for (unsigned int irep = 1; irep < numrepeat; ++irep) {
+    for (unsigned int i = 0; i < numcell; ++i) {
+      inputs.push_back(inputs[i]);
+    }
+  }
+  timingtools_print("Using %lu cells.", inputs.size());
+
+  LineCoolingData data;
+  VernerRecombinationRates rates;
+  ChargeTransferRates ctr;
+  Abundances abundances(0.1, 2.2e-4, 4.e-5, 3.3e-4, 5.e-5, 9.e-6);
+
+  HomogeneousDensityFunction function(1.);
+  Box<> box(CoordinateVector<>(), CoordinateVector<>(1.));
+  CartesianDensityGrid grid(box, 1, function);
+  std::pair< unsigned long, unsigned long > block =
+      std::make_pair(0, grid.get_number_of_cells());
+  grid.initialize(block);
+  DensityGrid::iterator cell = grid.begin();
+
+  std::vector< double > exact_temperatures(inputs.size());
+  double exact_time = 0.;
+  unsigned long exact_niter = 0;
+  {
+    TemperatureCalculator calculator(1., abundances, 1., 0., 1., 0., data,
+                                     rates, ctr);
+    timingtools_start_timing_block("exact rates") {
+      timingtools_start_timing();
+      exact_niter =
+          solve_temperatures(inputs, calculator, cell, exact_temperatures);
+      timingtools_stop_timing();
+      exact_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("exact rates");
+    exact_time /= timingtools_num_sample;
+  }
+  timingtools_print("exact rates: %g cells/s, %g thermal balance iterations "
+                    "per cell.",
+                    inputs.size() / exact_time,
+                    exact_niter / static_cast< double >(inputs.size()));
+
+  const unsigned int points_per_decade[3] = {10, 100, 1000};
+  for (unsigned int itable = 0; itable < 3; ++itable) {
+    TemperatureTable table(1000., 1.e6, points_per_decade[itable]);
+    TabulatedRecombinationRates tabulated_rates(rates, table);
+    TabulatedChargeTransferRates tabulated_ctr(table);
+    TemperatureCalculator calculator(1., abundances, 1., 0., 1., 0., data,
+                                     tabulated_rates, tabulated_ctr);
+
+    std::vector< double > temperatures(inputs.size());
+    double time = 0.;
+    timingtools_start_timing_block("tabulated rates") {
+      timingtools_start_timing();
+      solve_temperatures(inputs, calculator, cell, temperatures);
+      timingtools_stop_timing();
+      time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("tabulated rates");
+    time /= timingtools_num_sample;
+
+    double max_difference = 0.;
+    for (unsigned int i = 0; i < inputs.size(); ++i) {
+      max_difference = std::max(
+          max_difference, std::abs(temperatures[i] - exact_temperatures[i]) /
+                              exact_temperatures[i]);
+    }
+    timingtools_print("tabulated rates (%u points per decade): %g cells/s "
+                      "(speed up: %g), maximum relative temperature "
+                      "difference: %g.",
+                      points_per_decade[itable], inputs.size() / time,
+                      exact_time / time, max_difference);
+  }
+
+  {
+    LineCoolingData tabulated_data;
+    tabulated_data.tabulate_cooling();
+    TemperatureCalculator calculator(1., abundances, 1., 0., 1., 0.,
+                                     tabulated_data, rates, ctr);
+
+    std::vector< double > temperatures(inputs.size());
+    double time = 0.;
+    timingtools_start_timing_block("tabulated line cooling") {
+      timingtools_start_timing();
+      solve_temperatures(inputs, calculator, cell, temperatures);
+      timingtools_stop_timing();
+      time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("tabulated line cooling");
+    time /= timingtools_num_sample;
+
+    double max_difference = 0.;
+    for (unsigned int i = 0; i < inputs.size(); ++i) {
+      max_difference = std::max(
+          max_difference, std::abs(temperatures[i] - exact_temperatures[i]) /
+                              exact_temperatures[i]);
+    }
+    timingtools_print("tabulated line cooling: %g cells/s (speed up: %g), "
+                      "maximum relative temperature difference: %g.",
+                      inputs.size() / time, exact_time / time, max_difference);
+  }
+
+  {
+    TemperatureCalculator calculator(1., abundances, 1., 0., 1., 0., data,
+                                     rates, ctr);
+    const unsigned int ncell_1D = std::cbrt(inputs.size()) + 1;
+    CartesianDensityGrid batch_grid(box, CoordinateVector< int >(ncell_1D),
+                                    function);
+    std::pair< unsigned long, unsigned long > batch_block =
+        std::make_pair(0, batch_grid.get_number_of_cells());
+    batch_grid.initialize(batch_block);
+    const double volume = batch_grid.begin().get_volume();
+
+    std::vector< double > single_temperatures;
+    double single_time = 0.;
+    timingtools_start_timing_block("single cell") {
+      set_grid_values(inputs, batch_grid);
+      timingtools_start_timing();
+      for (auto it = batch_grid.begin(); it != batch_grid.end(); ++it) {
+        calculator.calculate_temperature(1. / volume, 1. / volume, it);
+      }
+      timingtools_stop_timing();
+      single_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("single cell");
+    single_time /= timingtools_num_sample;
+    for (auto it = batch_grid.begin(); it != batch_grid.end(); ++it) {
+      single_temperatures.push_back(
+          it.get_ionization_variables().get_temperature());
+    }
+
+    double batch_time = 0.;
+    timingtools_start_timing_block("batched") {
+      set_grid_values(inputs, batch_grid);
+      timingtools_start_timing();
+      calculator.calculate_temperature(1., 1., batch_grid.begin(),
+                                       batch_grid.end());
+      timingtools_stop_timing();
+      batch_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("batched");
+    batch_time /= timingtools_num_sample;
+
+    double max_difference = 0.;
+    unsigned int index = 0;
+    for (auto it = batch_grid.begin(); it != batch_grid.end(); ++it) {
+      const double temperature =
+          it.get_ionization_variables().get_temperature();
+      max_difference = std::max(
+          max_difference, std::abs(temperature - single_temperatures[index]) /
+                              single_temperatures[index]);
+      ++index;
+    }
+    const unsigned long numcell = batch_grid.get_number_of_cells();
+    timingtools_print("single cell: %g cells/s.", numcell / single_time);
+    timingtools_print("batched (%i cells per block): %g cells/s (speed up: "
+                      "%g), maximum relative temperature difference: %g.",
+                      TEMPERATURECALCULATOR_BLOCKSIZE, numcell / batch_time,
+                      single_time / batch_time, max_difference);
+  }
+
+  return 0;
+}
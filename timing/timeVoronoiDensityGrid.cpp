@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+
+/**
+ * @file timeVoronoiDensityGrid.cpp
+ *
+ * @brief Timing test for the photon traversal of a VoronoiDensityGrid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "HomogeneousDensityFunction.hpp"
+#include "Photon.hpp"
+#include "TimingTools.hpp"
+#include "UniformRandomVoronoiGeneratorDistribution.hpp"
+#include "Utilities.hpp"
+#include "VoronoiDensityGrid.hpp"
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Timing test for the photon traversal of a VoronoiDensityGrid.
+ *
+ * For both Voronoi grid implementations, we construct a grid with 10^5 random
+ * generators and let a large number of photons with random origins and
+ * directions cross the grid without being absorbed, once using the compact
+ * face information in VoronoiDensityGrid::interact(), and once querying the
+ * faces from the VoronoiGrid in VoronoiDensityGrid::interact_voronoi_grid().
+ * For both algorithms, we output the number of photons per second.
+ *
+ * We then emit photons from a single discrete source in the centre of the box
+ * and reemit them a fixed number of times, once locating the photon with a
+ * full point location for every interaction, and once using the cached source
+ * cell and the cell of the previous interaction as a starting point
+ * (VoronoiDensityGrid::interact_from_cell()).
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeVoronoiDensityGrid", argc, argv);
+
+  const unsigned int numphoton = 1000;
+  std::vector< CoordinateVector<> > origins(numphoton);
+  std::vector< CoordinateVector<> > directions(numphoton);
+  for (unsigned int i = 0; i < numphoton; ++i) {
+    origins[i] = CoordinateVector<>(Utilities::random_double(),
+                                    Utilities::random_double(),
+                                    Utilities::random_double());
+    const double cost = 2. * Utilities::random_double() - 1.;
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    const double phi = 2. * M_PI * Utilities::random_double();
+    directions[i] =
+        CoordinateVector<>(sint * std::cos(phi), sint * std::sin(phi), cost);
+  }
+
+  const unsigned int numreemission = 20;
+  std::vector< CoordinateVector<> > reemission_directions(numphoton *
+                                                          numreemission);
+  std::vector< double > reemission_optical_depths(numphoton * numreemission);
+  for (unsigned int i = 0; i < numphoton * numreemission; ++i) {
+    const double cost = 2. * Utilities::random_double() - 1.;
+    const double sint = std::sqrt(std::max(1. - cost * cost, 0.));
+    const double phi = 2. * M_PI * Utilities::random_double();
+    reemission_directions[i] =
+        CoordinateVector<>(sint * std::cos(phi), sint * std::sin(phi), cost);
+    reemission_optical_depths[i] = -std::log(Utilities::random_double());
+  }
+  const std::vector< CoordinateVector<> > source_positions(
+      1, CoordinateVector<>(0.5));
+
+  const std::string grid_types[2] = {"Old", "New"};
+  for (unsigned int itype = 0; itype < 2; ++itype) {
+    HomogeneousDensityFunction function(1., 8000.);
+    const Box<> box(CoordinateVector<>(), CoordinateVector<>(1.));
+    VoronoiDensityGrid grid(
+        new UniformRandomVoronoiGeneratorDistribution(box, 100000, 42),
+        function, box, grid_types[itype]);
+    std::pair< unsigned long, unsigned long > block =
+        std::make_pair(0, grid.get_number_of_cells());
+    grid.initialize(block);
+
+    timingtools_print("%s Voronoi grid:", grid_types[itype].c_str());
+
+    double voronoi_time = 0.;
+    timingtools_start_timing_block("VoronoiGrid faces") {
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < numphoton; ++i) {
+        Photon photon(origins[i], directions[i], 1.);
+        grid.interact_voronoi_grid(photon, 1.);
+      }
+      timingtools_stop_timing();
+      voronoi_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("VoronoiGrid faces");
+    voronoi_time /= timingtools_num_sample;
+
+    double face_time = 0.;
+    timingtools_start_timing_block("compact faces") {
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < numphoton; ++i) {
+        Photon photon(origins[i], directions[i], 1.);
+        grid.interact(photon, 1.);
+      }
+      timingtools_stop_timing();
+      face_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("compact faces");
+    face_time /= timingtools_num_sample;
+
+    timingtools_print("VoronoiGrid faces: %g photons/s.",
+                      numphoton / voronoi_time);
+    timingtools_print("compact faces: %g photons/s (speed up: %g).",
+                      numphoton / face_time, voronoi_time / face_time);
+
+    // the cross section is chosen so that the mean free path of the photons
+    // is a few cells
+    double full_time = 0.;
+    timingtools_start_timing_block("full point location") {
+      grid.set_source_positions(std::vector< CoordinateVector<> >());
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < numphoton; ++i) {
+        Photon photon(source_positions[0],
+                      reemission_directions[i * numreemission], 1.);
+        photon.set_source_index(0);
+        photon.set_cross_section(ION_H_n, 2.e7);
+        DensityGrid::iterator cell =
+            grid.interact(photon, reemission_optical_depths[i * numreemission]);
+        for (unsigned int j = 1; j < numreemission && cell != grid.end();
+             ++j) {
+          photon.set_direction(reemission_directions[i * numreemission + j]);
+          cell = grid.interact(
+              photon, reemission_optical_depths[i * numreemission + j]);
+        }
+      }
+      timingtools_stop_timing();
+      full_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("full point location");
+    full_time /= timingtools_num_sample;
+
+    double hint_time = 0.;
+    timingtools_start_timing_block("cell hints") {
+      grid.set_source_positions(source_positions);
+      timingtools_start_timing();
+      for (unsigned int i = 0; i < numphoton; ++i) {
+        Photon photon(source_positions[0],
+                      reemission_directions[i * numreemission], 1.);
+        photon.set_source_index(0);
+        photon.set_cross_section(ION_H_n, 2.e7);
+        DensityGrid::iterator cell =
+            grid.interact(photon, reemission_optical_depths[i * numreemission]);
+        for (unsigned int j = 1; j < numreemission && cell != grid.end();
+             ++j) {
+          photon.set_direction(reemission_directions[i * numreemission + j]);
+          cell = grid.interact_from_cell(
+              photon, reemission_optical_depths[i * numreemission + j], cell);
+        }
+      }
+      timingtools_stop_timing();
+      hint_time += timingtools_timer.value();
+    }
+    timingtools_end_timing_block("cell hints");
+    hint_time /= timingtools_num_sample;
+
+    timingtools_print("full point location: %g photons/s.",
+                      numphoton / full_time);
+    timingtools_print("cell hints: %g photons/s (speed up: %g).",
+                      numphoton / hint_time, full_time / hint_time);
+  }
+
+  return 0;
+}
@@ -0,0 +1,284 @@
+/*******************************************************************************
+ * This file is part of CMacIonize
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * CMacIonize is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CMacIonize is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with CMacIonize. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file timeWorkStealingScheduler.cpp
+ *
+ * @brief Scaling test for the WorkStealingScheduler.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Lock.hpp"
+#include "TimingTools.hpp"
+#include "WorkDistributor.hpp"
+#include "WorkEnvironment.hpp"
+#include "WorkStealingScheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Job that processes a range of work items with a very uneven cost,
+ * mimicking photon packets with very different path lengths.
+ */
+class TimingJob {
+private:
+  /*! @brief Cost (number of iterations) of every work item. */
+  const std::vector< unsigned int > &_costs;
+
+  /*! @brief Result of every work item. */
+  std::vector< double > &_results;
+
+  /*! @brief Begin of the range. */
+  unsigned long _begin;
+
+  /*! @brief End of the range. */
+  unsigned long _end;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param costs Cost (number of iterations) of every work item.
+   * @param results Result of every work item.
+   */
+  inline TimingJob(const std::vector< unsigned int > &costs,
+                   std::vector< double > &results)
+      : _costs(costs), _results(results), _begin(0), _end(0) {}
+
+  /**
+   * @brief Set the range of work items to process.
+   *
+   * @param begin Begin of the range.
+   * @param end End of the range.
+   */
+  inline void set_range(unsigned long begin, unsigned long end) {
+    _begin = begin;
+    _end = end;
+  }
+
+  /**
+   * @brief Should a completed job be deleted?
+   *
+   * @return False, jobs are owned by the JobMarket.
+   */
+  inline bool do_cleanup() const { return false; }
+
+  /**
+   * @brief Process the work items.
+   */
+  inline void execute() {
+    for (unsigned long i = _begin; i < _end; ++i) {
+      double x = 1.;
+      for (unsigned int j = 0; j < _costs[i]; ++j) {
+        x = std::sqrt(x + j);
+      }
+      _results[i] = x;
+    }
+  }
+
+  /**
+   * @brief Get a name tag for this job.
+   *
+   * @return "timingjob".
+   */
+  inline std::string get_tag() const { return "timingjob"; }
+};
+
+/**
+ * @brief JobMarket that hands out TimingJobs using a single central lock, as
+ * the PhotonShootJobMarket did before the WorkStealingScheduler was
+ * introduced.
+ */
+class LockedJobMarket {
+private:
+  /*! @brief Number of work items that still needs to be handed out. */
+  unsigned long _size;
+
+  /*! @brief Index of the next work item. */
+  unsigned long _next;
+
+  /*! @brief Minimum number of work items in a job. */
+  unsigned int _jobsize;
+
+  /*! @brief Number of threads. */
+  int _worksize;
+
+  /*! @brief Lock that protects the counters. */
+  Lock _lock;
+
+  /*! @brief Per thread jobs. */
+  std::vector< TimingJob > _jobs;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param costs Cost (number of iterations) of every work item.
+   * @param results Result of every work item.
+   * @param jobsize Minimum number of work items in a job.
+   */
+  inline LockedJobMarket(const std::vector< unsigned int > &costs,
+                         std::vector< double > &results, unsigned int jobsize)
+      : _size(costs.size()), _next(0), _jobsize(jobsize), _worksize(1),
+        _jobs(MAX_NUM_THREADS, TimingJob(costs, results)) {}
+
+  /**
+   * @brief Set the number of parallel threads that will be used to execute
+   * the jobs.
+   *
+   * @param worksize Number of parallel threads that will be used.
+   */
+  inline void set_worksize(int worksize) { _worksize = worksize; }
+
+  /**
+   * @brief Get a job.
+   *
+   * @param thread_id Rank of the thread that wants to get a job.
+   * @return Job, or a nullptr if all work is done.
+   */
+  inline TimingJob *get_job(int thread_id) {
+    unsigned long jobsize = std::max(_size / (10 * _worksize),
+                                     static_cast< unsigned long >(_jobsize));
+    _lock.lock();
+    jobsize = std::min(jobsize, _size);
+    const unsigned long begin = _next;
+    _next += jobsize;
+    _size -= jobsize;
+    _lock.unlock();
+    if (jobsize > 0) {
+      _jobs[thread_id].set_range(begin, begin + jobsize);
+      return &_jobs[thread_id];
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+/**
+ * @brief JobMarket that hands out TimingJobs using a WorkStealingScheduler.
+ */
+class WorkStealingJobMarket {
+private:
+  /*! @brief Number of work items. */
+  unsigned long _size;
+
+  /*! @brief Number of work items in a job. */
+  unsigned int _jobsize;
+
+  /*! @brief Scheduler. */
+  WorkStealingScheduler _scheduler;
+
+  /*! @brief Per thread jobs. */
+  std::vector< TimingJob > _jobs;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param costs Cost (number of iterations) of every work item.
+   * @param results Result of every work item.
+   * @param jobsize Number of work items in a job.
+   */
+  inline WorkStealingJobMarket(const std::vector< unsigned int > &costs,
+                               std::vector< double > &results,
+                               unsigned int jobsize)
+      : _size(costs.size()), _jobsize(jobsize),
+        _jobs(MAX_NUM_THREADS, TimingJob(costs, results)) {}
+
+  /**
+   * @brief Set the number of parallel threads that will be used to execute
+   * the jobs.
+   *
+   * @param worksize Number of parallel threads that will be used.
+   */
+  inline void set_worksize(int worksize) { _scheduler.reset(_size, worksize); }
+
+  /**
+   * @brief Get a job.
+   *
+   * @param thread_id Rank of the thread that wants to get a job.
+   * @return Job, or a nullptr if all work is done.
+   */
+  inline TimingJob *get_job(int thread_id) {
+    unsigned long begin, end;
+    if (_scheduler.get_range(thread_id, _jobsize, begin, end)) {
+      _jobs[thread_id].set_range(begin, end);
+      return &_jobs[thread_id];
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+/**
+ * @brief Scaling test for the WorkStealingScheduler.
+ *
+ * We process a large number of work items with a heavy tailed cost
+ * distribution (a few items are orders of magnitude more expensive than the
+ * average item), once with a central lock JobMarket and once with a work
+ * stealing JobMarket. Both markets use the same job size and do not allocate
+ * memory per job.
+ *
+ * The maximum number of threads is set with the -t command line option, e.g.
+ * "-t 64" for a scaling test from 1 to 64 threads. It cannot be larger than
+ * the MAX_NUMBER_OF_THREADS value used to configure the code.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  timingtools_init("timeWorkStealingScheduler", argc, argv);
+
+  const unsigned int num_item = 1000000;
+  const unsigned int jobsize = 100;
+  std::vector< unsigned int > costs(num_item);
+  for (unsigned int i = 0; i < num_item; ++i) {
+    // Pareto distribution with index 1.5, truncated at 10^5 iterations
+    const double cost =
+        std::pow(1. - Utilities::random_double(), -1. / 1.5) * 40.;
+    costs[i] = std::min(cost, 1.e5);
+  }
+  std::vector< double > results(num_item);
+
+  timingtools_start_scaling_block("central lock") {
+    LockedJobMarket jobs(costs, results, jobsize);
+    WorkDistributor< LockedJobMarket, TimingJob > workers;
+
+    timingtools_start_timing();
+    workers.do_in_parallel(jobs);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("central lock",
+                                "timeWorkStealingScheduler_locked.txt");
+
+  timingtools_start_scaling_block("work stealing") {
+    WorkStealingJobMarket jobs(costs, results, jobsize);
+    WorkDistributor< WorkStealingJobMarket, TimingJob > workers;
+
+    timingtools_start_timing();
+    workers.do_in_parallel(jobs);
+    timingtools_stop_timing();
+  }
+  timingtools_end_scaling_block("work stealing",
+                                "timeWorkStealingScheduler_stealing.txt");
+
+  return 0;
+}